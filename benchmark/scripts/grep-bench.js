@@ -0,0 +1,119 @@
+#!/usr/bin/env node
+import fs from "fs";
+import os from "os";
+import path from "path";
+import { performance } from "perf_hooks";
+import { DEFAULT_GREP_THREADS, grepFiles } from "../../src/libs/grep-engine.js";
+import { createGrepSpec } from "../../src/libs/grep-matcher.js";
+import WorkspaceIndex from "../../src/libs/workspace-index.js";
+
+/**
+ * Compares full-tree grep strategies on a replicated sample tree. Every
+ * query runs with a match budget large enough to read every file:
+ *
+ * - `legacy-lines`: the former search_text loop (readFile as utf8, split into
+ *   lines, `includes` per line, one file at a time), kept here as the baseline;
+ * - `buffer-inline`: grep-engine's byte matcher on the main thread;
+ * - `buffer-workers`: the same matcher on the worker pool.
+ *
+ *   node benchmark/scripts/grep-bench.js [--copies 10] [--threads N] [--source samples/bash/bash-sources]
+ */
+
+const PROJECT_ROOT = process.cwd();
+const QUERIES = [
+  { term: "execute_command_internal" },
+  { term: "SIGCHLD", ignoreCase: true },
+  { term: "sh_\\w+_error \\(", regex: true },
+];
+
+function parseArgs(tokens) {
+  const options = { copies: 10, source: path.join("samples", "bash", "bash-sources"), threads: DEFAULT_GREP_THREADS };
+  for (let i = 0; i < tokens.length; i += 1) {
+    const token = tokens[i];
+    if (token === "--copies") {
+      options.copies = Number(tokens[i + 1]);
+      i += 1;
+    } else if (token === "--threads") {
+      options.threads = Number(tokens[i + 1]);
+      i += 1;
+    } else if (token === "--source") {
+      options.source = tokens[i + 1];
+      i += 1;
+    }
+  }
+  return options;
+}
+
+async function legacyLines(root, paths, term) {
+  const matches = [];
+  for (const relative of paths) {
+    const content = await fs.promises.readFile(path.join(root, relative), "utf8");
+    if (content.includes("\u0000")) {
+      continue;
+    }
+    const lines = content.split(/\r?\n/);
+    for (let i = 0; i < lines.length; i += 1) {
+      if (lines[i].includes(term)) {
+        matches.push(`${relative}:${i + 1}`);
+      }
+    }
+  }
+  return matches.length;
+}
+
+async function timed(fn) {
+  const started = performance.now();
+  const matches = await fn();
+  return { ms: Math.round(performance.now() - started), matches };
+}
+
+async function main() {
+  const options = parseArgs(process.argv.slice(2));
+  const source = path.resolve(PROJECT_ROOT, options.source);
+  if (!fs.existsSync(source)) {
+    throw new Error(`Sample tree not found: ${source}`);
+  }
+  const root = await fs.promises.mkdtemp(path.join(os.tmpdir(), "miniphi-grep-bench-"));
+  try {
+    console.log(`[grep-bench] replicating ${source} x${options.copies}`);
+    for (let copy = 0; copy < options.copies; copy += 1) {
+      await fs.promises.cp(source, path.join(root, `copy-${String(copy).padStart(3, "0")}`), { recursive: true });
+    }
+    const index = new WorkspaceIndex(root, { indexFile: null }).refreshSync();
+    const paths = [...index.walkFiles()]
+      .filter((entry) => entry.size <= 512 * 1024)
+      .map((entry) => entry.path)
+      .sort((left, right) => (left < right ? -1 : left > right ? 1 : 0));
+    const bytes = [...index.walkFiles()].reduce((sum, entry) => sum + (entry.size <= 512 * 1024 ? entry.size : 0), 0);
+    console.log(`[grep-bench] ${paths.length} files, ${(bytes / 1e6).toFixed(1)} MB, ${options.threads} worker(s)`);
+    const rows = [];
+    for (const query of QUERIES) {
+      const spec = createGrepSpec(query.term, query);
+      const label = `${query.regex ? "regex " : ""}${query.ignoreCase ? "nocase " : ""}${query.term}`;
+      if (!query.regex && !query.ignoreCase) {
+        rows.push({ query: label, engine: "legacy-lines", ...(await timed(() => legacyLines(root, paths, query.term))) });
+      }
+      const budget = { maxMatches: Number.MAX_SAFE_INTEGER };
+      rows.push({
+        query: label,
+        engine: "buffer-inline",
+        ...(await timed(async () => (await grepFiles(root, paths, spec, { ...budget, threads: 1 })).matches.length)),
+      });
+      rows.push({
+        query: label,
+        engine: "buffer-workers",
+        ...(await timed(async () =>
+          (await grepFiles(root, paths, spec, { ...budget, threads: Math.max(2, options.threads) })).matches.length,
+        )),
+      });
+    }
+    console.table(rows);
+  } finally {
+    await fs.promises.rm(root, { recursive: true, force: true });
+  }
+}
+
+main().catch((error) => {
+  console.error(`[grep-bench] ${error instanceof Error ? error.stack : error}`);
+  process.exitCode = 1;
+});
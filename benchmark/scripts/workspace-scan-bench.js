@@ -0,0 +1,147 @@
+#!/usr/bin/env node
+import fs from "fs";
+import os from "os";
+import path from "path";
+import { performance } from "perf_hooks";
+import WorkspaceIndex from "../../src/libs/workspace-index.js";
+
+/**
+ * Compares workspace scanners on a replicated sample tree:
+ *
+ * - `legacy-sync`: the pre-index scanner (readdirSync, per-directory sort,
+ *   `queue.shift()`), kept here verbatim as the baseline;
+ * - `index-sync`: WorkspaceIndex.refreshSync, cold;
+ * - `index-async`: WorkspaceIndex.refresh, cold, bounded-concurrency opendir;
+ * - `index-async-warm`: the same, over the index persisted by the cold run.
+ *
+ * Reports wall time and the worst event-loop delay seen while each scan ran.
+ *
+ *   node benchmark/scripts/workspace-scan-bench.js [--copies 100] [--source samples/bash/bash-sources]
+ */
+
+const PROJECT_ROOT = process.cwd();
+
+function parseArgs(tokens) {
+  const options = { copies: 100, source: path.join("samples", "bash", "bash-sources"), concurrency: undefined };
+  for (let i = 0; i < tokens.length; i += 1) {
+    const token = tokens[i];
+    if (token === "--copies") {
+      options.copies = Number(tokens[i + 1]);
+      i += 1;
+    } else if (token === "--source") {
+      options.source = tokens[i + 1];
+      i += 1;
+    } else if (token === "--concurrency") {
+      options.concurrency = Number(tokens[i + 1]);
+      i += 1;
+    } else if (token === "--keep") {
+      options.keep = true;
+    }
+  }
+  return options;
+}
+
+function legacyScanSync(root) {
+  const files = [];
+  const queue = [{ dir: root, depth: 0 }];
+  const visited = new Set();
+  while (queue.length > 0) {
+    const current = queue.shift();
+    if (visited.has(current.dir)) {
+      continue;
+    }
+    visited.add(current.dir);
+    let dirents = [];
+    try {
+      dirents = fs.readdirSync(current.dir, { withFileTypes: true });
+      dirents.sort((a, b) => a.name.localeCompare(b.name));
+    } catch {
+      continue;
+    }
+    for (const dirent of dirents) {
+      const fullPath = path.join(current.dir, dirent.name);
+      if (dirent.isDirectory()) {
+        if (!dirent.name.startsWith(".") && dirent.name !== "node_modules") {
+          queue.push({ dir: fullPath, depth: current.depth + 1 });
+        }
+        continue;
+      }
+      if (dirent.isFile()) {
+        files.push(path.relative(root, fullPath).replace(/\\/g, "/"));
+      }
+    }
+  }
+  return files.length;
+}
+
+/**
+ * Runs `fn` while a 1 ms interval timer probes the event loop; the longest gap
+ * between two ticks (past the interval) is the worst stall a concurrent
+ * request would have seen. A sync scan shows up as one gap as long as itself.
+ */
+async function measure(label, fn) {
+  let last = performance.now();
+  let maxLoopDelayMs = 0;
+  const probe = setInterval(() => {
+    const now = performance.now();
+    maxLoopDelayMs = Math.max(maxLoopDelayMs, now - last - 1);
+    last = now;
+  }, 1);
+  await new Promise((resolve) => setTimeout(resolve, 5));
+  const started = performance.now();
+  const files = await fn();
+  const elapsed = performance.now() - started;
+  await new Promise((resolve) => setTimeout(resolve, 5));
+  clearInterval(probe);
+  return {
+    label,
+    files,
+    ms: Math.round(elapsed),
+    maxLoopDelayMs: Math.round(maxLoopDelayMs),
+  };
+}
+
+async function main() {
+  const options = parseArgs(process.argv.slice(2));
+  const source = path.resolve(PROJECT_ROOT, options.source);
+  if (!fs.existsSync(source)) {
+    throw new Error(`Sample tree not found: ${source}`);
+  }
+  const root = await fs.promises.mkdtemp(path.join(os.tmpdir(), "miniphi-scan-bench-"));
+  const tree = path.join(root, "tree");
+  const indexFile = path.join(root, "index.json");
+  try {
+    console.log(`[scan-bench] replicating ${source} x${options.copies} into ${tree}`);
+    for (let copy = 0; copy < options.copies; copy += 1) {
+      await fs.promises.cp(source, path.join(tree, `copy-${String(copy).padStart(3, "0")}`), {
+        recursive: true,
+      });
+    }
+    const countFiles = (index) => index.files.size;
+    const results = [];
+    results.push(await measure("legacy-sync", () => legacyScanSync(tree)));
+    results.push(
+      await measure("index-sync", () => countFiles(new WorkspaceIndex(tree, { indexFile: null }).refreshSync())),
+    );
+    results.push(
+      await measure("index-async", async () =>
+        countFiles(await new WorkspaceIndex(tree, { indexFile, concurrency: options.concurrency }).refresh()),
+      ),
+    );
+    results.push(
+      await measure("index-async-warm", async () =>
+        countFiles(await new WorkspaceIndex(tree, { indexFile, concurrency: options.concurrency }).refresh()),
+      ),
+    );
+    console.table(results);
+  } finally {
+    if (!options.keep) {
+      await fs.promises.rm(root, { recursive: true, force: true });
+    }
+  }
+}
+
+main().catch((error) => {
+  console.error(`[scan-bench] ${error instanceof Error ? error.stack : error}`);
+  process.exitCode = 1;
+});
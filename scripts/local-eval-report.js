@@ -1,6 +1,8 @@
 import fs from "fs";
 import path from "path";
+import { once } from "events";
 import MiniPhiMemory from "../src/libs/miniphi-memory.js";
+import PromptRecorder from "../src/libs/prompt-recorder.js";
 
 function parseArgs(tokens) {
   const options = {};
@@ -16,6 +18,11 @@ function parseArgs(tokens) {
       i += 1;
       continue;
     }
+    if (token === "--export") {
+      options.export = tokens[i + 1];
+      i += 1;
+      continue;
+    }
     if (token === "--limit") {
       options.limit = Number(tokens[i + 1]);
       i += 1;
@@ -39,7 +46,7 @@ function percent(numerator, denominator) {
 async function main() {
   const options = parseArgs(process.argv.slice(2));
   if (options.help) {
-    console.log("Usage: node scripts/local-eval-report.js [--root <path>] [--output <path>] [--limit <n>]");
+    console.log("Usage: node scripts/local-eval-report.js [--root <path>] [--output <path>] [--limit <n>] [--export <file.ndjson>]");
     process.exitCode = 0;
     return;
   }
@@ -47,23 +54,13 @@ async function main() {
   const memory = new MiniPhiMemory(root);
   await memory.prepare();
   const baseDir = memory.baseDir;
-  const indexPath = path.join(baseDir, "prompt-exchanges", "index.json");
-  let entries = [];
-  try {
-    const index = JSON.parse(await fs.promises.readFile(indexPath, "utf8"));
-    entries = Array.isArray(index.entries) ? index.entries : [];
-  } catch (error) {
-    if (error?.code !== "ENOENT") {
-      console.error(`[MiniPhi] Unable to read prompt exchanges index at ${indexPath}`);
-      process.exitCode = 1;
-      return;
-    }
-  }
+  const recorder = new PromptRecorder(baseDir);
+  await recorder.prepare();
   const limit =
-    Number.isFinite(options.limit) && options.limit > 0
-      ? Math.floor(options.limit)
-      : entries.length;
-  const sliced = entries.slice(0, limit);
+    Number.isFinite(options.limit) && options.limit > 0 ? Math.floor(options.limit) : null;
+  const exportStream = options.export
+    ? fs.createWriteStream(path.resolve(options.export), { encoding: "utf8" })
+    : null;
   let total = 0;
   let withResponseFormat = 0;
   let withSchemaName = 0;
@@ -72,16 +69,9 @@ async function main() {
   let withRawResponseText = 0;
   const schemaNames = {};
 
-  for (const entry of sliced) {
-    const file = entry?.file ? path.join(baseDir, entry.file) : null;
-    if (!file) {
-      continue;
-    }
-    let payload;
-    try {
-      payload = JSON.parse(await fs.promises.readFile(file, "utf8"));
-    } catch {
-      continue;
+  for await (const payload of recorder.entries(limit ? { limit } : undefined, { resolveBlobs: true })) {
+    if (exportStream && !exportStream.write(`${JSON.stringify(payload)}\n`)) {
+      await once(exportStream, "drain");
     }
     total += 1;
     const responseFormat =
@@ -117,8 +107,13 @@ async function main() {
       rawResponseText: { count: withRawResponseText, percent: percent(withRawResponseText, total) },
     },
     schemaNames,
-    sampleLimit: limit,
+    sampleLimit: limit ?? total,
   };
+  if (exportStream) {
+    exportStream.end();
+    await once(exportStream, "close");
+    console.error(`[MiniPhi] Exported ${total} prompt exchanges to ${path.resolve(options.export)}`);
+  }
 
   if (options.output) {
     const outputPath = path.resolve(options.output);
@@ -13,7 +13,7 @@ const FENCE_LINE = /^[ \t]*(?:```|~~~)/m;
 // Directory segments whose contents are installed or generated, never authored.
 const VENDORED_PATH = /(?:^|\/)(node_modules|\.git|vendor|dist|build|\.venv|__pycache__)(?:\/|$)/;
 
-export const READONLY_ACTION_TYPES = new Set(["read_file", "list_dir", "search_text"]);
+export const READONLY_ACTION_TYPES = new Set(["read_file", "list_dir", "search_text", "read_symbol"]);
 export const RESEARCH_ACTION_TYPES = new Set(["web_research"]);
 export const VISUAL_ACTION_TYPES = new Set(["visual_review"]);
 export const KNOWLEDGE_ACTION_TYPES = new Set(["knowledge_lookup"]);
@@ -122,6 +122,9 @@ export function describeAction(action) {
   if (!action || typeof action !== "object") {
     return "(invalid action)";
   }
+  if (action.symbol) {
+    return `${action.type} ${action.symbol}${action.path ? ` in ${action.path}` : ""}`;
+  }
   const target =
     action.path ??
     action.url ??
@@ -170,6 +173,28 @@ export function normalizeAgentAction(rawAction, cwd) {
       return { ok: false, error: "search_text requires a non-empty term" };
     }
     action.term = term;
+    action.regex = rawAction.regex === true;
+    action.ignoreCase = rawAction.ignore_case === true;
+    return { ok: true, action, category };
+  }
+
+  if (type === "read_symbol") {
+    const symbol = typeof rawAction.symbol === "string" ? rawAction.symbol.trim() : "";
+    if (!symbol) {
+      return { ok: false, error: "read_symbol requires a non-empty symbol (a function, class or Class.method name)" };
+    }
+    action.symbol = symbol.slice(0, 200);
+    // `path` is optional here: it only narrows the lookup to one file.
+    if (rawAction.path !== undefined && rawAction.path !== null && rawAction.path !== "") {
+      const relPath = resolveWorkspacePath(rawAction.path, cwd);
+      if (!relPath) {
+        return {
+          ok: false,
+          error: `path "${rawAction.path}" is absolute or escapes the workspace; omit it to search every source file`,
+        };
+      }
+      action.path = relPath;
+    }
     return { ok: true, action, category };
   }
 
@@ -395,10 +420,11 @@ export async function buildMutationProposal({ action, cwd }) {
 
 /**
  * Applies a previously-built mutation proposal through the guarded writer so the
- * write is hash-verified with a rollback copy under `rollbackDir`. Returns the
- * {@link writeFileWithGuard} result (`written`/`unchanged`/`hash-mismatch`/`rollback`/`failed`).
+ * write is hash-verified with a rollback copy — in `blobStore` when given
+ * (returned as `rollbackBlob`), otherwise as a file under `rollbackDir`. Returns
+ * the {@link writeFileWithGuard} result (`written`/`unchanged`/`hash-mismatch`/`rollback`/`failed`).
  */
-export async function commitMutation({ proposal, cwd, rollbackDir }) {
+export async function commitMutation({ proposal, cwd, rollbackDir, blobStore = null }) {
   const targetPath = path.resolve(cwd, proposal.path);
   return writeFileWithGuard({
     targetPath,
@@ -406,6 +432,7 @@ export async function commitMutation({ proposal, cwd, rollbackDir }) {
     expectedHash: proposal.expectedHash ?? null,
     rollbackDir: rollbackDir ?? null,
     rollbackLabel: proposal.path,
+    blobStore,
     diffSummaryFn: summarizeDiff,
   });
 }
@@ -420,8 +447,10 @@ export async function executeReadonly({ action, cwd, maxOutputChars = DEFAULT_MA
   // use `path`. Translate so read/list/search stay identical to the plan flow.
   const mapped =
     action.type === "search_text"
-      ? { type: "search_text", term: action.term }
-      : { type: action.type, target: action.path };
+      ? { type: "search_text", term: action.term, regex: action.regex, ignoreCase: action.ignoreCase }
+      : action.type === "read_symbol"
+        ? { type: "read_symbol", symbol: action.symbol, target: action.path ?? null }
+        : { type: action.type, target: action.path };
   return executeReadonlyAction(mapped, cwd, { maxOutputChars });
 }
 
@@ -10,6 +10,7 @@ import ContextGraph, {
   estimateTokens,
 } from "../libs/context-graph.js";
 import ContextReferenceComposer from "../libs/context-reference-composer.js";
+import { getBlobStore } from "../libs/blob-store.js";
 import {
   buildMutationProposal,
   classifyActionType,
@@ -67,7 +68,7 @@ const mergeReferenceCandidates = (...groups) => {
 
 const SYSTEM_PROMPT = `You are MiniPhi, a local coding agent operating inside the operator's repository.
 Work in turns. Each turn respond with ONLY a JSON object matching the provided schema (no prose, no markdown fences).
-Use read_file/list_dir/search_text to gather context (these run automatically, no approval needed).
+Use read_file/list_dir/search_text/read_symbol to gather context (these run automatically, no approval needed). read_symbol returns just the signature and body of one function, class or method (\`symbol\`, optionally \`path\`); prefer it over read_file when you need one definition from a large file.
 Use web_research for current library choices, unfamiliar APIs, or best-practice comparisons (it runs automatically and returns bounded JSON search results). When the task asks you to choose libraries, research before deciding unless no external library is needed; explain that choice in your summary.
 Never repeat an action after MiniPhi reports it as duplicate or skipped-budget. Use the existing observation and move to implementation.
 Propose changes with write_file (full file content) or edit_file (a unique anchor + replacement, or a full content replacement). write_file, edit_file and run_cmd require operator approval and may be rejected.
@@ -98,7 +99,7 @@ const KNOWLEDGE_LOOKUP_GUIDE = `A knowledge base (taught via the separate "cheet
  * loop powers both the Ink UI and the headless CLI path.
  *
  * Events: `status`, `token`, `action-start`, `action-result`, `edit-proposed`,
- * `permission-request` (via a UI approver), `done`, `error`.
+ * `permission-request` (via a UI approver), `external-change`, `done`, `error`.
  */
 export default class AgentSession extends EventEmitter {
   constructor(options = undefined) {
@@ -153,6 +154,8 @@ export default class AgentSession extends EventEmitter {
     }
     this.sessionDeadline = Number.isFinite(options?.sessionDeadline) ? options.sessionDeadline : null;
     this.logger = typeof options?.logger === "function" ? options.logger : null;
+    // A WorkspaceWatcher (workspace-watcher.js) on this workspace, or null.
+    this.workspaceWatcher = options?.workspaceWatcher ?? null;
     this.contextEngine =
       options?.contextEngine ??
       (typeof options?.contextEngineFactory === "function"
@@ -245,6 +248,10 @@ export default class AgentSession extends EventEmitter {
     this._anchorFailures = new Map();
     this._usedCorrectionGraces = new Set();
     this._correctionGracePending = false;
+    // path -> content hash of this session's own last write, so the watcher
+    // echo of a guarded write is not mistaken for an outside edit.
+    this._ownWrites = new Map();
+    this._externalChanges = [];
   }
 
   cancel() {
@@ -344,7 +351,10 @@ export default class AgentSession extends EventEmitter {
       return;
     }
     try {
-      await fs.appendFile(path.join(dir, "transcript.jsonl"), `${JSON.stringify(entry)}\n`, "utf8");
+      // File snapshots and long tool outputs are stored once in the blob store
+      // and referenced by hash, instead of being copied into every session.
+      const stored = this.baseDir ? await getBlobStore(this.baseDir).externalize(entry) : entry;
+      await fs.appendFile(path.join(dir, "transcript.jsonl"), `${JSON.stringify(stored)}\n`, "utf8");
     } catch {
       // ignore
     }
@@ -410,6 +420,7 @@ export default class AgentSession extends EventEmitter {
    * repair the old source instead of the file that is actually on disk.
    */
   _retireSupersededFileContext(filePath) {
+    let dropped = 0;
     const staleLabels = new Set([
       `read_file ${filePath}`,
       `requested ${filePath}`,
@@ -428,16 +439,73 @@ export default class AgentSession extends EventEmitter {
           importance: 0,
           pinned: false,
         });
+        dropped += 1;
       }
     }
     // Read/search deduplication is version-sensitive. Once a file changes, a
-    // new read of that path and a new workspace search can return new evidence.
+    // new read of that path, a new workspace search and a new symbol read can
+    // return new evidence.
     this._actionSignatures.delete(`read_file:${filePath}`);
     for (const signature of this._actionSignatures) {
-      if (signature.startsWith("search_text:")) {
+      if (signature.startsWith("search_text:") || signature.startsWith("read_symbol:")) {
         this._actionSignatures.delete(signature);
       }
     }
+    return dropped;
+  }
+
+  /**
+   * Applies the files the workspace watcher saw change outside this session
+   * since the last turn: their reads and edit snapshots are retired like after
+   * one of our own writes, and the model is told once which files it had
+   * loaded are now different, so it re-reads instead of editing from memory.
+   * The watcher's echo of our own guarded writes is recognised by content
+   * hash and ignored.
+   */
+  async _applyExternalChanges(turn) {
+    if (!this.workspaceWatcher) {
+      return;
+    }
+    await this.workspaceWatcher.flush();
+    const batches = this._externalChanges.splice(0);
+    const touched = new Map();
+    for (const { changed, removed } of batches) {
+      for (const rel of changed) {
+        touched.set(rel, "changed");
+      }
+      for (const rel of removed) {
+        touched.set(rel, "removed");
+      }
+    }
+    const stale = [];
+    for (const [rel, change] of touched) {
+      const filePath = path.relative(this.cwd, path.join(this.workspaceWatcher.root, rel)).split(path.sep).join("/");
+      if (!filePath || filePath.startsWith("../") || path.isAbsolute(filePath)) {
+        continue;
+      }
+      const ownHash = this._ownWrites.get(filePath);
+      if (ownHash && change === "changed") {
+        const current = await fs.readFile(path.join(this.cwd, filePath), "utf8").catch(() => null);
+        if (current !== null && hashText(current) === ownHash) {
+          continue;
+        }
+      }
+      this._ownWrites.delete(filePath);
+      if (this._retireSupersededFileContext(filePath) > 0) {
+        stale.push(`${filePath} (${change})`);
+      }
+    }
+    if (!stale.length) {
+      return;
+    }
+    this.emit("external-change", { turn, paths: stale });
+    this._remember({
+      layer: "contract",
+      label: "external changes",
+      text: `Changed outside this session since you read them: ${stale.join(", ")}. Your earlier view of these files was dropped; read_file again before editing them.`,
+      importance: 1,
+      ttlTurns: 1,
+    });
   }
 
   /** Flat view of the live context, kept for logging/debugging convenience. */
@@ -555,9 +623,10 @@ export default class AgentSession extends EventEmitter {
   /**
    * Ranks durable `.miniphi` memory against this turn's seed. Failures are
    * never fatal: a broken local store degrades to "no extra candidates", the
-   * same way an unreachable Cheetah does.
+   * same way an unreachable Cheetah does. Awaited because the SQLite backend
+   * answers asynchronously; the JSONL one simply returns.
    */
-  _recallLocalMemory() {
+  async _recallLocalMemory() {
     if (!this.localMemory || typeof this.localMemory.recall !== "function") {
       return [];
     }
@@ -566,7 +635,7 @@ export default class AgentSession extends EventEmitter {
       return [];
     }
     try {
-      const result = this.localMemory.recall({
+      const result = await this.localMemory.recall({
         text: seed,
         limit: this.localMemoryCandidates,
         // The live session's own nodes are already rendered into the prompt;
@@ -594,7 +663,7 @@ export default class AgentSession extends EventEmitter {
   }
 
   async _selectContextEngine() {
-    const localCandidates = this._recallLocalMemory();
+    const localCandidates = await this._recallLocalMemory();
     if (!this.contextEngine || typeof this.contextEngine.select !== "function") {
       return {
         ok: true,
@@ -1090,12 +1159,18 @@ export default class AgentSession extends EventEmitter {
       await this._appendTranscript({ kind: "action-result", ...result });
       return;
     }
-    const guard = await commitMutation({ proposal, cwd: this.cwd, rollbackDir: this.rollbackDir });
+    const guard = await commitMutation({
+      proposal,
+      cwd: this.cwd,
+      rollbackDir: this.rollbackDir,
+      blobStore: this.baseDir ? getBlobStore(this.baseDir) : null,
+    });
     const result = {
       turn,
       action: { type: action.type, path: proposal.path },
       status: guard.status,
       rollbackPath: guard.rollbackPath ?? null,
+      rollbackBlob: guard.rollbackBlob ?? null,
       error: guard.error ?? null,
     };
     this.appliedEdits.push(result);
@@ -1110,6 +1185,7 @@ export default class AgentSession extends EventEmitter {
       mutationPathsThisTurn?.add(proposal.path);
       this._progressThisTurn = true;
       this._retireSupersededFileContext(proposal.path);
+      this._ownWrites.set(proposal.path, hashText(proposal.afterContent));
     }
     const nudge =
       guard.status === "unchanged"
@@ -1302,7 +1378,7 @@ export default class AgentSession extends EventEmitter {
   async _handleReadonly({ action, turn }) {
     // Skip repeated identical reads/searches: they add no new context and would
     // otherwise let the model keep the loop alive without progress.
-    const signature = `${action.type}:${action.path ?? action.term ?? ""}`;
+    const signature = `${action.type}:${action.symbol ? `${action.symbol}@` : ""}${action.path ?? action.term ?? ""}`;
     // "Already gathered" is only true while the gathered text is still *there*.
     // Budget pressure demotes an old read to a digest and then to a stub, and at
     // that point refusing the re-read leaves the model unable to obtain the file
@@ -1625,6 +1701,19 @@ export default class AgentSession extends EventEmitter {
    * `done` event with the same payload.
    */
   async submitTask(task, selectedFiles = []) {
+    if (!this.workspaceWatcher) {
+      return this._runTask(task, selectedFiles);
+    }
+    const onChange = (changes) => this._externalChanges.push(changes);
+    this.workspaceWatcher.on("change", onChange);
+    try {
+      return await this._runTask(task, selectedFiles);
+    } finally {
+      this.workspaceWatcher.off("change", onChange);
+    }
+  }
+
+  async _runTask(task, selectedFiles) {
     const responseFormat = this._buildResponseFormat();
     await this._ensureSessionDir();
     this._seedInvariants(task);
@@ -1673,6 +1762,7 @@ export default class AgentSession extends EventEmitter {
       // Age the graph one turn before rendering: fresh evidence outranks old
       // evidence at equal priority, without ever touching the invariant layers.
       this.context.decay({ turn });
+      await this._applyExternalChanges(turn);
       const turnData = await this._getTurn(task, responseFormat);
       this._noteTruncatedTurn(turn);
       finalSummary = turnData.summary ?? finalSummary;
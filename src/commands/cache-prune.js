@@ -1,6 +1,7 @@
 import path from "path";
 import MiniPhiMemory from "../libs/miniphi-memory.js";
 import { pruneMiniPhiCache } from "../libs/cache-pruner.js";
+import { formatByteSize, resolveCacheGcPolicy, runCacheGc } from "../libs/cache-gc.js";
 
 function resolveRetention(options, configData) {
   const configRetention = configData?.retention ?? {};
@@ -28,6 +29,20 @@ function resolveRetention(options, configData) {
   };
 }
 
+function parseQuotaOption(value) {
+  if (typeof value !== "string") {
+    return undefined;
+  }
+  const quotas = {};
+  for (const pair of value.split(",")) {
+    const [name, size] = pair.split("=").map((part) => part?.trim());
+    if (name && size) {
+      quotas[name] = size;
+    }
+  }
+  return quotas;
+}
+
 function formatRetentionLabel(value) {
   if (value === null || value === undefined) {
     return "auto";
@@ -35,6 +50,37 @@ function formatRetentionLabel(value) {
   return value.toString();
 }
 
+function printGcSummary(gc, verbose) {
+  if (gc.skipped) {
+    console.log(`[MiniPhi] quota gc: skipped (${gc.reason})`);
+    return;
+  }
+  const limits = [
+    gc.policy.maxBytes !== null ? `max ${formatByteSize(gc.policy.maxBytes)}` : null,
+    ...Object.entries(gc.policy.quotas).map(([name, bytes]) => `${name} ${formatByteSize(bytes)}`),
+  ].filter(Boolean);
+  console.log(
+    `[MiniPhi] quota gc: ${formatByteSize(gc.before.totalBytes)} → ${formatByteSize(gc.after.totalBytes)}, evicted ${gc.evicted.length} entries and ${gc.removedBlobs} orphaned blobs (${limits.length ? limits.join(", ") : "no budgets set"})`,
+  );
+  if (gc.overBudget.length) {
+    console.log(
+      `[MiniPhi] quota gc: still over budget for ${gc.overBudget.join(", ")} (recent or pinned entries are kept)`,
+    );
+  }
+  if (verbose) {
+    for (const [name, usage] of Object.entries(gc.after.categories)) {
+      if (usage.units) {
+        console.log(`[MiniPhi]   ${name}: ${formatByteSize(usage.bytes)} in ${usage.units} entries`);
+      }
+    }
+    for (const entry of gc.evicted) {
+      console.log(
+        `[MiniPhi]   evicted ${entry.key} (${formatByteSize(entry.bytes)}, last used ${entry.lastAccessAt})`,
+      );
+    }
+  }
+}
+
 export async function handleCachePruneCommand(context) {
   const { options, verbose, configData } = context;
   const cwd = options.cwd ? path.resolve(options.cwd) : process.cwd();
@@ -42,6 +88,13 @@ export async function handleCachePruneCommand(context) {
   const retention = resolveRetention(options, configData);
   const dryRun = Boolean(options["dry-run"]);
   const result = await pruneMiniPhiCache(memory, { retention, dryRun });
+  if (options.gc) {
+    const policy = resolveCacheGcPolicy(configData?.retention, {
+      maxBytes: typeof options["max-bytes"] === "string" ? options["max-bytes"] : undefined,
+      quotas: parseQuotaOption(options.quota),
+    });
+    result.gc = await runCacheGc(memory, { policy, dryRun });
+  }
 
   if (options.json) {
     console.log(JSON.stringify(result, null, 2));
@@ -67,4 +120,7 @@ export async function handleCachePruneCommand(context) {
       `[MiniPhi] Cache prune summary: removed ${result.summary.removedEntries} entries (${result.summary.removedTargets} paths), skipped ${result.summary.skippedTargets}, errors ${result.summary.errors}`,
     );
   }
+  if (result.gc) {
+    printGcSummary(result.gc, verbose);
+  }
 }
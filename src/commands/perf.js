@@ -0,0 +1,156 @@
+import fs from "fs";
+import path from "path";
+import PromptPerformanceTracker from "../libs/prompt-performance-tracker.js";
+import {
+  buildPerfReport,
+  precedingWindow,
+  resolveDay,
+  DEFAULT_REGRESSION_THRESHOLD,
+} from "../libs/prompt-perf-report.js";
+
+function formatMs(value) {
+  if (value === null || value === undefined) {
+    return "-";
+  }
+  if (value < 1000) {
+    return `${Math.round(value)}ms`;
+  }
+  return `${(value / 1000).toFixed(value < 10_000 ? 2 : 1)}s`;
+}
+
+function formatNumber(value, digits = 1) {
+  return value === null || value === undefined ? "-" : Number(value).toFixed(digits);
+}
+
+function formatPercent(value) {
+  return value === null || value === undefined ? "-" : `${(value * 100).toFixed(1)}%`;
+}
+
+function formatMetric(key, value) {
+  if (key.endsWith("Ms")) {
+    return formatMs(value);
+  }
+  if (key === "slowStartRate") {
+    return formatPercent(value);
+  }
+  return formatNumber(value, 2);
+}
+
+function resolveGroupBy(value) {
+  const fields = String(value ?? "model")
+    .split(/[,+]/)
+    .map((field) => field.trim().toLowerCase())
+    .filter(Boolean);
+  const allowed = fields.filter((field) => field === "model" || field === "schema");
+  return allowed.length ? Array.from(new Set(allowed)) : ["model"];
+}
+
+const COLUMNS = [
+  { label: "Prompts", width: 8, render: (row) => String(row.prompts) },
+  { label: "TTFT p50", width: 9, render: (row) => formatMs(row.ttftP50Ms) },
+  { label: "TTFT p95", width: 9, render: (row) => formatMs(row.ttftP95Ms) },
+  { label: "Dur p50", width: 9, render: (row) => formatMs(row.durationP50Ms) },
+  { label: "Dur p95", width: 9, render: (row) => formatMs(row.durationP95Ms) },
+  { label: "Tok/s", width: 7, render: (row) => formatNumber(row.tokensPerSecond) },
+  { label: "Slow%", width: 7, render: (row) => formatPercent(row.slowStartRate) },
+  { label: "Rtry/100", width: 9, render: (row) => formatNumber(row.retriesPer100) },
+  { label: "Rtry cost", width: 10, render: (row) => formatMs(row.retryCostMs) },
+];
+
+function printTable(summary) {
+  const labelWidth = Math.min(
+    48,
+    Math.max(12, ...summary.groups.map((row) => row.group.length + 1)),
+  );
+  const fit = (text) => (text.length > labelWidth - 1 ? `${text.slice(0, labelWidth - 2)}…` : text);
+  console.log(
+    "Group".padEnd(labelWidth) + COLUMNS.map((column) => column.label.padStart(column.width)).join(""),
+  );
+  for (const row of [...summary.groups, { group: "all", ...summary.total }]) {
+    console.log(
+      fit(row.group).padEnd(labelWidth) +
+        COLUMNS.map((column) => column.render(row).padStart(column.width)).join(""),
+    );
+  }
+}
+
+export async function handlePerfCommand(context) {
+  const { options, verbose, dbPath } = context;
+  const resolvedDbPath = options.db ? path.resolve(options.db) : dbPath;
+  if (!resolvedDbPath || !fs.existsSync(resolvedDbPath)) {
+    console.log(
+      `[MiniPhi][Perf] No prompt telemetry database at ${resolvedDbPath ?? "(unset)"} yet. Run a few prompts first.`,
+    );
+    return;
+  }
+  const since = resolveDay(options.since ?? "7d");
+  const until = resolveDay(options.until ?? "today");
+  if (since > until) {
+    throw new Error(`--since (${since}) is after --until (${until}).`);
+  }
+  let baseline = null;
+  if (options["baseline-since"] || options["baseline-until"]) {
+    const explicit = precedingWindow(since, until);
+    baseline = {
+      since: options["baseline-since"] ? resolveDay(options["baseline-since"]) : explicit.since,
+      until: options["baseline-until"] ? resolveDay(options["baseline-until"]) : explicit.until,
+    };
+  } else if (options.compare) {
+    baseline = precedingWindow(since, until);
+  }
+  const threshold = Number.isFinite(Number(options.threshold))
+    ? Number(options.threshold) / 100
+    : DEFAULT_REGRESSION_THRESHOLD;
+
+  const tracker = new PromptPerformanceTracker({ dbPath: resolvedDbPath });
+  await tracker.prepare();
+  let report;
+  try {
+    report = await buildPerfReport(tracker.db, {
+      since,
+      until,
+      groupBy: resolveGroupBy(options.by),
+      model: options.model && options.model !== "auto" ? options.model : undefined,
+      schema: options.schema,
+      baseline,
+      threshold,
+    });
+  } finally {
+    await tracker.dispose();
+  }
+
+  if (options.json) {
+    console.log(JSON.stringify(report, null, 2));
+    return;
+  }
+  const { current } = report;
+  console.log(
+    `[MiniPhi][Perf] ${current.since} → ${current.until}: ${current.total.prompts} prompts over ${current.days} day(s), grouped by ${current.groupBy.join("+")}`,
+  );
+  if (verbose) {
+    console.log(
+      `[MiniPhi][Perf] Rollups refreshed for ${report.refresh.daysRefreshed} day(s) (${resolvedDbPath})`,
+    );
+  }
+  if (!current.groups.length) {
+    console.log("[MiniPhi][Perf] No prompts recorded in this window.");
+    return;
+  }
+  printTable(current);
+  if (!report.baseline) {
+    return;
+  }
+  console.log(
+    `\n[MiniPhi][Perf] Compared with ${report.baseline.since} → ${report.baseline.until} (${report.baseline.total.prompts} prompts, threshold ${Math.round(threshold * 100)}%):`,
+  );
+  if (!report.changes.length) {
+    console.log("  No significant changes.");
+    return;
+  }
+  for (const change of report.changes) {
+    const delta = change.change === null ? "new" : `${change.change > 0 ? "+" : ""}${(change.change * 100).toFixed(0)}%`;
+    console.log(
+      `  ${change.regression ? "REGRESSION" : "improved  "} ${change.group}: ${change.label} ${formatMetric(change.metric, change.baseline)} → ${formatMetric(change.metric, change.current)} (${delta})`,
+    );
+  }
+}
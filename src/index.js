@@ -90,12 +90,16 @@ import {
 } from "./libs/truncation-utils.js";
 import { handleBenchmarkCommand } from "./commands/benchmark.js";
 import { handleCachePruneCommand } from "./commands/cache-prune.js";
+import { resolveCacheGcPolicy, scheduleCacheGc } from "./libs/cache-gc.js";
+import { flushJsonIndexes } from "./libs/json-index-store.js";
+import { flushTaskExecutionRegisters } from "./libs/task-execution-register.js";
 import { handleCommandLibrary } from "./commands/command-library.js";
 import { handleHelpersCommand } from "./commands/helpers.js";
 import { handleHistoryNotes } from "./commands/history-notes.js";
 import { handleLmStudioHealthCommand, probeLmStudioHealth } from "./commands/lmstudio-health.js";
 import { handleMigrateStopReasonsCommand } from "./commands/migrate-stop-reasons.js";
 import { handleModelsCommand } from "./commands/models.js";
+import { handlePerfCommand } from "./commands/perf.js";
 import { handleCheetahLearnCommand } from "./commands/cheetah-learn.js";
 import { buildPrimaryCommandContext, executePrimaryCommand } from "./commands/primary-flow.js";
 import { handlePromptTemplateCommand } from "./commands/prompt-template.js";
@@ -118,6 +122,7 @@ const COMMANDS = new Set([
   "command-library",
   "helpers",
   "cache-prune",
+  "perf",
   "migrate-stop-reasons",
   "nitpick",
   "models",
@@ -1234,6 +1239,13 @@ async function main() {
     return;
   }
   const lmStudioEndpoints = resolveLmStudioEndpoints(configData);
+  // Byte quotas from `retention` are enforced once this command has finished.
+  const cacheGcPolicy = resolveCacheGcPolicy(configData?.retention);
+  if (cacheGcPolicy.auto) {
+    scheduleCacheGc(new MiniPhiMemory(options.cwd ? path.resolve(options.cwd) : process.cwd()), cacheGcPolicy, {
+      verbose,
+    });
+  }
   if (configPath && verbose) {
     const relPath = path.relative(process.cwd(), configPath) || configPath;
     console.log(`[MiniPhi] Loaded configuration from ${relPath}`);
@@ -1777,6 +1789,11 @@ async function main() {
     return;
   }
 
+  if (command === "perf") {
+    await handlePerfCommand({ options, verbose, dbPath: globalMemory.promptDbPath });
+    return;
+  }
+
   if (command === "migrate-stop-reasons") {
     await handleMigrateStopReasonsCommand({ options, verbose });
     return;
@@ -2528,6 +2545,7 @@ async function main() {
     let sessionTimeoutTriggered = false;
     let result;
     let workspaceContext = null;
+    let commandContext = null;
   const archiveMetadata = {
     promptId,
     model: modelSelection.modelKey,
@@ -2680,7 +2698,7 @@ const describeWorkspace = (dir, options = undefined) =>
     await lmStudioRuntime.load({ contextLength, gpu });
     scoringPhi = lmStudioRuntime.scoringPhi;
 
-    const commandContext = buildPrimaryCommandContext({
+    commandContext = buildPrimaryCommandContext({
       command,
       options,
       positionals,
@@ -3025,12 +3043,23 @@ const describeWorkspace = (dir, options = undefined) =>
       }
     }
     if (performanceTracker) {
+      if (debugLm) {
+        const latency = performanceTracker.getLatencyStats();
+        console.log(
+          `[MiniPhi][Debug][LM] Prompt tracking latency: track p50=${latency.track.p50Ms ?? "n/a"}ms p99=${latency.track.p99Ms ?? "n/a"}ms; batch commit p50=${latency.batchCommit.p50Ms ?? "n/a"}ms over ${latency.writes.batches} batches (${latency.writes.rows} rows)`,
+        );
+      }
       try {
         await performanceTracker.dispose();
       } catch {
         // no-op
       }
     }
+    // Memory writers commit their own indexes; this catches any write still
+    // queued (e.g. cache access times) and the execution register headers
+    // before a session timeout can exit.
+    await flushTaskExecutionRegisters().catch(() => {});
+    await flushJsonIndexes().catch(() => {});
   }
 
   if (sessionTimeoutTriggered) {
@@ -3126,6 +3155,8 @@ Usage:
   node src/index.js command-library --limit 10
   node src/index.js helpers --limit 6
   node src/index.js cache-prune --dry-run
+  node src/index.js cache-prune --gc --max-bytes 2GB --quota executions=800MB
+  node src/index.js perf --since 7d --by model,schema --compare
   node src/index.js migrate-stop-reasons --dry-run
   node src/index.js workspace --task "Plan README refresh"
   node src/index.js recompose --sample samples/recompose/hello-flow --direction roundtrip --clean
@@ -3295,9 +3326,25 @@ Cache prune:
   --retain-prompt-templates <n>  Keep the newest N prompt templates (default: 200)
   --retain-history-notes <n>   Keep the newest N history notes (default: 200)
   --retain-research <n>        Keep the newest N research snapshots (default: 200)
+  --gc                         Also enforce byte quotas: evict least-recently-used entries and orphaned blobs
+  --max-bytes <size>           Overall .miniphi ceiling for --gc, e.g. 2GB (config: retention.maxBytes)
+  --quota <category=size,...>  Per-category budgets for --gc, e.g. executions=800MB,blobs=300MB
   --dry-run                    Report deletions without removing files
   --json                       Output JSON summary instead of human-readable text
 
+Perf report (prompt telemetry in ~/.miniphi/prompts/miniphi-prompts.db):
+  --since <date|Nd>            Window start: YYYY-MM-DD, ISO time, or 7d/24h/2w (default: 7d)
+  --until <date|Nd>            Window end (default: today)
+  --by <model|schema|model,schema>  Group rows by model key and/or schema id (default: model)
+  --model <id>                 Only prompts sent to this model
+  --schema <id>                Only prompts bound to this schema
+  --compare                    Compare against the preceding window of the same length
+  --baseline-since <date>      Explicit baseline window start (implies --compare)
+  --baseline-until <date>      Explicit baseline window end
+  --threshold <percent>        Change that counts as a regression (default: 10)
+  --db <path>                  Read a different telemetry database
+  --json                       Output the full report as JSON
+
 Stop reason + prompt-exchange metadata migration:
   --history-root <path>        Override the starting directory used to locate .miniphi (default: cwd)
   --include-global             Also migrate ~/.miniphi when present
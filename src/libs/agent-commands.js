@@ -3,6 +3,7 @@ const DEFAULT_AGENT_COMMANDS = [
   { id: "list_dir", description: "List files/dirs (bounded depth, respects ignore)." },
   { id: "read_file", description: "Show file content for review (no edits)." },
   { id: "search_text", description: "Ripgrep text pattern across workspace." },
+  { id: "read_symbol", description: "Show one function/class/method definition (no edits)." },
   { id: "edit_file", description: "Apply minimal patch/write to a file." },
   { id: "run_cmd", description: "Execute safe shell command with timeout." },
   { id: "analyze_file", description: "Summarize a file with schema-checked JSON." },
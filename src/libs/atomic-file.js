@@ -0,0 +1,369 @@
+import fs from "fs";
+import os from "os";
+import path from "path";
+import { randomUUID } from "crypto";
+
+/**
+ * Crash- and multi-process-safe primitives for `.miniphi` storage.
+ *
+ * - `writeFileAtomic` writes a sibling temp file and renames it over the
+ *   target, so readers (and a crash) see either the old or the new content,
+ *   never a torn file.
+ * - `acquireFileLock` is an advisory `<file>.lock` taken with O_EXCL. The
+ *   lock records its owner; a holder that died (same host, pid gone) or
+ *   stopped refreshing the lock for `staleMs` is broken. Holders refresh the
+ *   lock's mtime while they work, so a long critical section is not mistaken
+ *   for a dead one.
+ * - `WriteAheadLog` makes multi-file updates all-or-nothing: every file is
+ *   staged next to its target, a journal naming the renames is committed
+ *   atomically, then the renames run. `recover()` finishes committed
+ *   journals and discards uncommitted ones after a crash.
+ */
+
+export const DEFAULT_LOCK_STALE_MS = 10_000;
+export const DEFAULT_LOCK_TIMEOUT_MS = 30_000;
+const LOCK_RETRY_MS = 15;
+const HOSTNAME = os.hostname();
+
+let tempCounter = 0;
+const tempPathFor = (filePath, tag = "tmp") =>
+  `${filePath}.${process.pid}.${(tempCounter += 1).toString(36)}.${tag}`;
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms));
+
+async function writeAndSync(filePath, data, { fsync, flag = "w" }) {
+  const handle = await fs.promises.open(filePath, flag);
+  try {
+    await handle.writeFile(data, typeof data === "string" ? "utf8" : undefined);
+    if (fsync) {
+      await handle.sync();
+    }
+  } finally {
+    await handle.close();
+  }
+}
+
+/**
+ * Replaces `filePath` with `data` via temp file + rename.
+ * @param {{ fsync?: boolean, mkdir?: boolean }} [options]
+ */
+export async function writeFileAtomic(filePath, data, options = undefined) {
+  if (options?.mkdir) {
+    await fs.promises.mkdir(path.dirname(filePath), { recursive: true });
+  }
+  const tempFile = tempPathFor(filePath);
+  try {
+    await writeAndSync(tempFile, data, { fsync: Boolean(options?.fsync) });
+    await fs.promises.rename(tempFile, filePath);
+  } catch (error) {
+    await fs.promises.rm(tempFile, { force: true }).catch(() => {});
+    throw error;
+  }
+}
+
+export function writeFileAtomicSync(filePath, data) {
+  const tempFile = tempPathFor(filePath);
+  try {
+    fs.writeFileSync(tempFile, data, typeof data === "string" ? "utf8" : undefined);
+    fs.renameSync(tempFile, filePath);
+  } catch (error) {
+    try {
+      fs.rmSync(tempFile, { force: true });
+    } catch {
+      // ignore
+    }
+    throw error;
+  }
+}
+
+/**
+ * Creates `filePath` with `data` only if it does not exist yet; never
+ * clobbers a file another process created first. Resolves to true when this
+ * call created it.
+ */
+export async function createFileExclusive(filePath, data) {
+  const tempFile = tempPathFor(filePath);
+  await writeAndSync(tempFile, data, { fsync: false });
+  try {
+    await fs.promises.link(tempFile, filePath);
+    return true;
+  } catch (error) {
+    if (error?.code === "EEXIST") {
+      return false;
+    }
+    // Filesystems without hard links: fall back to an exclusive create.
+    try {
+      await writeAndSync(filePath, data, { fsync: false, flag: "wx" });
+      return true;
+    } catch (inner) {
+      if (inner?.code === "EEXIST") {
+        return false;
+      }
+      throw inner;
+    }
+  } finally {
+    await fs.promises.rm(tempFile, { force: true }).catch(() => {});
+  }
+}
+
+/**
+ * Copies an unparseable file aside (`<file>.corrupt-<stamp>`) so the write
+ * that follows a fallback cannot silently destroy whatever is left of it.
+ * The original stays in place: it may be a non-atomic writer mid-write.
+ */
+export async function quarantineCorruptFile(filePath) {
+  const target = `${filePath}.corrupt-${new Date().toISOString().replace(/[:.]/g, "-")}`;
+  try {
+    await fs.promises.copyFile(filePath, target, fs.constants.COPYFILE_EXCL);
+    return target;
+  } catch {
+    return null;
+  }
+}
+
+function isProcessAlive(pid) {
+  if (!Number.isInteger(pid) || pid <= 0) {
+    return false;
+  }
+  try {
+    process.kill(pid, 0);
+    return true;
+  } catch (error) {
+    return error?.code === "EPERM";
+  }
+}
+
+async function readLockOwner(lockPath) {
+  try {
+    const raw = await fs.promises.readFile(lockPath, "utf8");
+    const owner = JSON.parse(raw);
+    return owner && typeof owner === "object" ? owner : null;
+  } catch {
+    return null;
+  }
+}
+
+/**
+ * Takes the advisory lock for `filePath` and resolves to an async release
+ * function. Rejects with code `ELOCKTIMEOUT` after `timeoutMs`.
+ * @param {{ staleMs?: number, timeoutMs?: number }} [options]
+ */
+export async function acquireFileLock(filePath, options = undefined) {
+  const lockPath = `${filePath}.lock`;
+  const staleMs = Number.isFinite(options?.staleMs) ? options.staleMs : DEFAULT_LOCK_STALE_MS;
+  const timeoutMs = Number.isFinite(options?.timeoutMs) ? options.timeoutMs : DEFAULT_LOCK_TIMEOUT_MS;
+  const token = randomUUID();
+  const deadline = Date.now() + timeoutMs;
+  await fs.promises.mkdir(path.dirname(lockPath), { recursive: true });
+  for (;;) {
+    try {
+      await writeAndSync(
+        lockPath,
+        JSON.stringify({ pid: process.pid, host: HOSTNAME, token, at: new Date().toISOString() }),
+        { fsync: false, flag: "wx" },
+      );
+      break;
+    } catch (error) {
+      if (error?.code !== "EEXIST") {
+        throw error;
+      }
+    }
+    let stale = false;
+    let judged = null;
+    try {
+      const stat = await fs.promises.stat(lockPath);
+      judged = stat.ino;
+      stale = Date.now() - stat.mtimeMs > staleMs;
+      if (!stale) {
+        const owner = await readLockOwner(lockPath);
+        stale = Boolean(owner && owner.host === HOSTNAME && !isProcessAlive(owner.pid));
+      }
+    } catch {
+      continue;
+    }
+    if (stale) {
+      // Move the lock aside, then make sure it was the one judged stale: if
+      // another waiter took a fresh lock in between, put that one back.
+      const broken = tempPathFor(lockPath, "stale");
+      try {
+        await fs.promises.rename(lockPath, broken);
+        if ((await fs.promises.stat(broken)).ino !== judged) {
+          await fs.promises.link(broken, lockPath).catch(() => {});
+        }
+        await fs.promises.rm(broken, { force: true });
+      } catch {
+        // someone else broke it
+      }
+      continue;
+    }
+    if (Date.now() >= deadline) {
+      const error = new Error(`Timed out waiting for lock ${lockPath}`);
+      error.code = "ELOCKTIMEOUT";
+      throw error;
+    }
+    await sleep(LOCK_RETRY_MS + Math.floor(Math.random() * LOCK_RETRY_MS));
+  }
+  const heartbeat = setInterval(() => {
+    const now = new Date();
+    fs.promises.utimes(lockPath, now, now).catch(() => {});
+  }, Math.max(50, Math.floor(staleMs / 3)));
+  heartbeat.unref?.();
+  let released = false;
+  return async () => {
+    if (released) {
+      return;
+    }
+    released = true;
+    clearInterval(heartbeat);
+    const owner = await readLockOwner(lockPath);
+    if (owner?.token === token) {
+      await fs.promises.rm(lockPath, { force: true }).catch(() => {});
+    }
+  };
+}
+
+/**
+ * Single non-blocking attempt at the lock, for synchronous exit hooks.
+ * Returns a release function, or null when the lock is held elsewhere.
+ */
+export function tryAcquireFileLockSync(filePath) {
+  const lockPath = `${filePath}.lock`;
+  const token = randomUUID();
+  try {
+    fs.writeFileSync(
+      lockPath,
+      JSON.stringify({ pid: process.pid, host: HOSTNAME, token, at: new Date().toISOString() }),
+      { flag: "wx" },
+    );
+  } catch {
+    return null;
+  }
+  return () => {
+    try {
+      if (JSON.parse(fs.readFileSync(lockPath, "utf8"))?.token === token) {
+        fs.rmSync(lockPath, { force: true });
+      }
+    } catch {
+      // ignore
+    }
+  };
+}
+
+/** Runs `fn` while holding the advisory lock for `filePath`. */
+export async function withFileLock(filePath, fn, options = undefined) {
+  const release = await acquireFileLock(filePath, options);
+  try {
+    return await fn();
+  } finally {
+    await release();
+  }
+}
+
+/**
+ * Journaled multi-file writes under one directory (`.miniphi/wal/`).
+ *
+ * `commit([{ path, data }])`:
+ * 1. writes `<txid>.json` with `state: "pending"` and the staged temp names;
+ * 2. stages every file as `<target>.<txid>.wal` (fsynced);
+ * 3. atomically rewrites the journal with `state: "committed"` — the commit
+ *    point;
+ * 4. renames each staged file over its target and deletes the journal.
+ *
+ * A crash before step 3 leaves targets untouched and `recover()` deletes the
+ * staged files; a crash after it is rolled forward by `recover()`.
+ */
+export class WriteAheadLog {
+  constructor(walDir) {
+    this.dir = walDir;
+  }
+
+  _journalPath(txid) {
+    return path.join(this.dir, `${txid}.json`);
+  }
+
+  async commit(writes) {
+    const items = (writes ?? []).filter((write) => write?.path);
+    if (!items.length) {
+      return null;
+    }
+    await fs.promises.mkdir(this.dir, { recursive: true });
+    const txid = `${Date.now().toString(36)}-${process.pid}-${randomUUID().slice(0, 8)}`;
+    const journalPath = this._journalPath(txid);
+    const renames = items.map((write) => ({
+      from: `${path.resolve(write.path)}.${txid}.wal`,
+      to: path.resolve(write.path),
+    }));
+    const journal = { txid, pid: process.pid, createdAt: new Date().toISOString(), renames };
+    await writeFileAtomic(journalPath, JSON.stringify({ ...journal, state: "pending" }), { fsync: true });
+    try {
+      await Promise.all(
+        items.map(async (write, index) => {
+          await fs.promises.mkdir(path.dirname(renames[index].to), { recursive: true });
+          await writeAndSync(renames[index].from, write.data, { fsync: true });
+        }),
+      );
+      await writeFileAtomic(journalPath, JSON.stringify({ ...journal, state: "committed" }), {
+        fsync: true,
+      });
+    } catch (error) {
+      await this._rollBack(renames);
+      await fs.promises.rm(journalPath, { force: true }).catch(() => {});
+      throw error;
+    }
+    await this._rollForward(renames);
+    await fs.promises.rm(journalPath, { force: true });
+    return txid;
+  }
+
+  async _rollForward(renames) {
+    for (const { from, to } of renames) {
+      try {
+        await fs.promises.rename(from, to);
+      } catch (error) {
+        if (error?.code !== "ENOENT") {
+          throw error;
+        }
+      }
+    }
+  }
+
+  async _rollBack(renames) {
+    await Promise.all(renames.map(({ from }) => fs.promises.rm(from, { force: true }).catch(() => {})));
+  }
+
+  /**
+   * Completes or discards journals left by crashed writers. Journals of live
+   * processes on this host are left alone. Resolves to `{ rolledForward, rolledBack }`.
+   */
+  async recover() {
+    const result = { rolledForward: 0, rolledBack: 0 };
+    let names = [];
+    try {
+      names = await fs.promises.readdir(this.dir);
+    } catch {
+      return result;
+    }
+    for (const name of names.filter((entry) => entry.endsWith(".json"))) {
+      const journalPath = path.join(this.dir, name);
+      let journal;
+      try {
+        journal = JSON.parse(await fs.promises.readFile(journalPath, "utf8"));
+      } catch {
+        continue;
+      }
+      if (isProcessAlive(journal?.pid)) {
+        continue;
+      }
+      const renames = Array.isArray(journal?.renames) ? journal.renames : [];
+      if (journal.state === "committed") {
+        await this._rollForward(renames);
+        result.rolledForward += 1;
+      } else {
+        await this._rollBack(renames);
+        result.rolledBack += 1;
+      }
+      await fs.promises.rm(journalPath, { force: true });
+    }
+    return result;
+  }
+}
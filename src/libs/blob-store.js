@@ -0,0 +1,192 @@
+import fs from "fs";
+import path from "path";
+import zlib from "zlib";
+import { promisify } from "util";
+import { createHash } from "crypto";
+
+const brotliCompress = promisify(zlib.brotliCompress);
+const brotliDecompress = promisify(zlib.brotliDecompress);
+
+/**
+ * Content-addressed, compressed storage for the large strings MiniPhi keeps
+ * writing again: system prompts and schema blocks inside every prompt
+ * exchange and execution-register entry, compressed log segments, file
+ * snapshots in agent transcripts, and rollback copies of edited files.
+ *
+ * Layout: `.miniphi/blobs/<first two hex>/<sha256>.br`, brotli-compressed (the
+ * Node 20 runtime has no zstd binding; brotli at a mid quality is close in
+ * ratio and fast enough for multi-KB text). Artifacts embed
+ * `{ "$blob": "sha256:<hex>", "bytes": n }` in place of the string, so a prompt
+ * repeated across a hundred exchanges is stored — and written — once. Any
+ * brotli tool can read a blob back (`brotli -d < blob.br`).
+ *
+ * Blobs are immutable and never rewritten; a blob no artifact references any
+ * more is garbage for the cache pruner, not an error.
+ */
+
+export const BLOBS_DIRNAME = "blobs";
+export const DEFAULT_BLOB_MIN_BYTES = 2048;
+
+const BLOB_PREFIX = "sha256:";
+const BROTLI_QUALITY = 5;
+
+export const isBlobRef = (value) =>
+  Boolean(value) &&
+  typeof value === "object" &&
+  !Array.isArray(value) &&
+  typeof value.$blob === "string" &&
+  value.$blob.startsWith(BLOB_PREFIX);
+
+const hashOf = (buffer) => createHash("sha256").update(buffer).digest("hex");
+
+export default class BlobStore {
+  /**
+   * @param {string} baseDir The `.miniphi` directory.
+   * @param {{ minBytes?: number }} [options]
+   */
+  constructor(baseDir, options = undefined) {
+    this.baseDir = path.resolve(baseDir);
+    this.blobsDir = path.join(this.baseDir, BLOBS_DIRNAME);
+    this.minBytes = Number.isFinite(options?.minBytes)
+      ? Math.max(1, Math.floor(options.minBytes))
+      : DEFAULT_BLOB_MIN_BYTES;
+    /** Hashes known to be on disk, so a repeat put costs a hash and nothing else. */
+    this._known = new Set();
+    /** @type {Map<string, Promise<void>>} in-flight writes, keyed by hash */
+    this._writing = new Map();
+    this.stats = { puts: 0, written: 0, deduplicated: 0, bytesIn: 0, bytesWritten: 0 };
+  }
+
+  pathFor(ref) {
+    const hex = String(ref).startsWith(BLOB_PREFIX) ? String(ref).slice(BLOB_PREFIX.length) : String(ref);
+    if (!/^[0-9a-f]{64}$/.test(hex)) {
+      throw new Error(`Invalid blob reference: ${ref}`);
+    }
+    return path.join(this.blobsDir, hex.slice(0, 2), `${hex}.br`);
+  }
+
+  /** Stores `content` (string or Buffer) and returns its `sha256:` reference. */
+  async put(content) {
+    const buffer = Buffer.isBuffer(content) ? content : Buffer.from(String(content ?? ""), "utf8");
+    const hex = hashOf(buffer);
+    const ref = `${BLOB_PREFIX}${hex}`;
+    this.stats.puts += 1;
+    this.stats.bytesIn += buffer.length;
+    if (this._known.has(hex)) {
+      this.stats.deduplicated += 1;
+      return ref;
+    }
+    if (!this._writing.has(hex)) {
+      this._writing.set(
+        hex,
+        this._write(ref, buffer).finally(() => this._writing.delete(hex)),
+      );
+    }
+    await this._writing.get(hex);
+    return ref;
+  }
+
+  async _write(ref, buffer) {
+    const target = this.pathFor(ref);
+    const hex = ref.slice(BLOB_PREFIX.length);
+    try {
+      await fs.promises.access(target, fs.constants.F_OK);
+      this._known.add(hex);
+      this.stats.deduplicated += 1;
+      return;
+    } catch {
+      // not stored yet
+    }
+    const compressed = await brotliCompress(buffer, {
+      params: {
+        [zlib.constants.BROTLI_PARAM_QUALITY]: BROTLI_QUALITY,
+        [zlib.constants.BROTLI_PARAM_SIZE_HINT]: buffer.length,
+      },
+    });
+    await fs.promises.mkdir(path.dirname(target), { recursive: true });
+    const tempFile = `${target}.${process.pid}.tmp`;
+    await fs.promises.writeFile(tempFile, compressed);
+    await fs.promises.rename(tempFile, target);
+    this._known.add(hex);
+    this.stats.written += 1;
+    this.stats.bytesWritten += compressed.length;
+  }
+
+  /** Reads a blob back as a Buffer. */
+  async getBuffer(ref) {
+    const compressed = await fs.promises.readFile(this.pathFor(ref));
+    return brotliDecompress(compressed);
+  }
+
+  /** Reads a blob back as UTF-8 text. */
+  async get(ref) {
+    return (await this.getBuffer(ref)).toString("utf8");
+  }
+
+  /**
+   * Returns a deep copy of `value` with every string of at least `minBytes`
+   * UTF-8 bytes replaced by a blob reference. Objects and arrays keep their
+   * shape, so small fields stay greppable in the artifact itself.
+   */
+  async externalize(value, options = undefined) {
+    const minBytes = Number.isFinite(options?.minBytes) ? options.minBytes : this.minBytes;
+    const visit = async (node) => {
+      if (typeof node === "string") {
+        const bytes = Buffer.byteLength(node, "utf8");
+        if (bytes < minBytes) {
+          return node;
+        }
+        return { $blob: await this.put(node), bytes };
+      }
+      if (Array.isArray(node)) {
+        return Promise.all(node.map(visit));
+      }
+      if (node && typeof node === "object" && !isBlobRef(node)) {
+        const entries = await Promise.all(
+          Object.entries(node).map(async ([key, child]) => [key, await visit(child)]),
+        );
+        return Object.fromEntries(entries);
+      }
+      return node;
+    };
+    return visit(value);
+  }
+
+  /**
+   * The inverse of `externalize`. A missing blob (pruned, or never synced to
+   * this machine) is left as its reference rather than failing the read.
+   */
+  async internalize(value) {
+    const visit = async (node) => {
+      if (isBlobRef(node)) {
+        try {
+          return await this.get(node.$blob);
+        } catch {
+          return node;
+        }
+      }
+      if (Array.isArray(node)) {
+        return Promise.all(node.map(visit));
+      }
+      if (node && typeof node === "object") {
+        const entries = await Promise.all(
+          Object.entries(node).map(async ([key, child]) => [key, await visit(child)]),
+        );
+        return Object.fromEntries(entries);
+      }
+      return node;
+    };
+    return visit(value);
+  }
+}
+
+const sharedStores = new Map();
+
+/** One store per `.miniphi` directory, so every writer shares the known-hash set. */
+export function getBlobStore(baseDir) {
+  const key = path.resolve(baseDir);
+  if (!sharedStores.has(key)) {
+    sharedStores.set(key, new BlobStore(key));
+  }
+  return sharedStores.get(key);
+}
@@ -0,0 +1,98 @@
+import path from "path";
+import { getJsonIndexStore } from "./json-index-store.js";
+
+/**
+ * Last-access log for `.miniphi` artifacts, read by the quota GC
+ * (see cache-gc.js) to evict least-recently-used entries first.
+ *
+ * File mtimes only tell when an artifact was written; a prompt session or
+ * execution plan that is read back every run would otherwise look as stale as
+ * one nobody has opened in months. Reads record `{ "<path under .miniphi>":
+ * epochMs }` in `indices/cache-access.json` through the shared JSON index
+ * store, so a burst of touches is one coalesced write at most. A path touched
+ * again within `ACCESS_RESOLUTION_MS` in the same process is not re-recorded:
+ * LRU ordering only needs minute-level resolution.
+ */
+
+export const CACHE_ACCESS_FILENAME = "cache-access.json";
+export const ACCESS_RESOLUTION_MS = 60_000;
+
+const recentTouches = new Map();
+
+export function cacheAccessFile(baseDir) {
+  return path.join(baseDir, "indices", CACHE_ACCESS_FILENAME);
+}
+
+/** Normalized key for `target` (absolute or relative to `baseDir`), or null outside it. */
+export function cacheAccessKey(baseDir, target) {
+  if (!baseDir || !target) {
+    return null;
+  }
+  const relative = path.relative(baseDir, path.resolve(baseDir, target));
+  if (!relative || relative.startsWith("..") || path.isAbsolute(relative)) {
+    return null;
+  }
+  return relative.split(path.sep).join("/");
+}
+
+/** Records a read of `target`; never throws and never waits for disk. */
+export function recordCacheAccess(baseDir, target, now = Date.now()) {
+  const key = cacheAccessKey(baseDir, target);
+  if (!key) {
+    return;
+  }
+  const file = cacheAccessFile(baseDir);
+  const memoKey = `${file}\0${key}`;
+  if (now - (recentTouches.get(memoKey) ?? 0) < ACCESS_RESOLUTION_MS) {
+    return;
+  }
+  recentTouches.set(memoKey, now);
+  getJsonIndexStore()
+    .update(
+      file,
+      (doc) => {
+        const entries = doc?.entries && typeof doc.entries === "object" ? doc.entries : {};
+        if (!(entries[key] >= now)) {
+          entries[key] = now;
+        }
+        return { ...(doc ?? {}), entries };
+      },
+      { fallback: { entries: {} } },
+    )
+    .catch(() => {});
+}
+
+/** Current access map (`key -> epochMs`). */
+export async function readCacheAccess(baseDir) {
+  const doc = await getJsonIndexStore().read(cacheAccessFile(baseDir), { entries: {} });
+  return doc?.entries && typeof doc.entries === "object" ? doc.entries : {};
+}
+
+/** Drops access records at or under any of `keys` (evicted units). */
+export async function forgetCacheAccess(baseDir, keys) {
+  const removed = new Set(keys);
+  if (!removed.size) {
+    return;
+  }
+  const isRemoved = (key) => {
+    for (let cut = key.length; cut > 0; cut = key.lastIndexOf("/", cut - 1)) {
+      if (removed.has(key.slice(0, cut))) {
+        return true;
+      }
+    }
+    return false;
+  };
+  await getJsonIndexStore().update(
+    cacheAccessFile(baseDir),
+    (doc) => {
+      const entries = {};
+      for (const [key, value] of Object.entries(doc?.entries ?? {})) {
+        if (!isRemoved(key)) {
+          entries[key] = value;
+        }
+      }
+      return { ...(doc ?? {}), entries };
+    },
+    { fallback: { entries: {} } },
+  );
+}
@@ -0,0 +1,617 @@
+import fs from "fs";
+import path from "path";
+import zlib from "zlib";
+import { promisify } from "util";
+import PromptArchive from "./prompt-archive.js";
+import { BLOBS_DIRNAME } from "./blob-store.js";
+import { rebuildExecutionIndexRefs } from "./cache-pruner.js";
+import {
+  CACHE_ACCESS_FILENAME,
+  cacheAccessKey,
+  forgetCacheAccess,
+  readCacheAccess,
+} from "./cache-access.js";
+import { getJsonIndexStore } from "./json-index-store.js";
+
+const gunzip = promisify(zlib.gunzip);
+
+/**
+ * Size-quota garbage collector for a `.miniphi` directory.
+ *
+ * `pruneMiniPhiCache` keeps a fixed number of index entries; this collector
+ * keeps bytes under budget instead. Each category below is a directory whose
+ * direct children are the eviction units (an execution folder, an archive
+ * segment, a prompt-session file, ...). A run:
+ *
+ * 1. measures every unit (bytes, newest mtime) in one stat walk and orders
+ *    units by last access — the newer of their mtime and the reads recorded
+ *    in `indices/cache-access.json` (see cache-access.js);
+ * 2. if a budget is exceeded (or in a full run), scans artifacts for
+ *    `sha256:<hex>` blob references, so each blob knows which units hold it;
+ * 3. evicts least-recently-used units until every per-category quota and the
+ *    overall `maxBytes` ceiling are met. A blob is freed only once the last
+ *    unit referencing it is evicted; blobs referenced by files outside any
+ *    category (indexes, knowledge, ...) are never freed. A `blobs` quota is met
+ *    by evicting the least recently used units that hold blobs;
+ * 4. deletes the units and orphaned blobs, then drops index entries and access
+ *    records that pointed into them.
+ *
+ * Units and blobs modified within `minAgeMs` are never evicted, so a run does
+ * not race a concurrent process that is still writing (or has written a blob
+ * whose referencing artifact has not landed yet). If any artifact cannot be
+ * scanned, no blob is deleted.
+ *
+ * The incremental mode (`scheduleCacheGc`, run after each CLI command) is
+ * throttled to one run per `intervalMs` and stops after the stat walk when
+ * everything is within budget.
+ */
+
+export const CACHE_GC_CATEGORIES = [
+  { name: "executions", dir: "executions" },
+  { name: "prompt-archive", dir: "prompt-exchanges/archive", match: /^segment-.+\.ndjson\.gz$/ },
+  { name: "prompt-journals", dir: "prompt-exchanges/stepwise" },
+  { name: "prompt-sessions", dir: "prompt-sessions" },
+  { name: "agent-sessions", dir: "agent-sessions" },
+  { name: "history-notes", dir: "history-notes" },
+  { name: "research", dir: "research" },
+  { name: "web", dir: "web" },
+  { name: "nitpick", dir: "nitpick" },
+  { name: "dev-logs", dir: "dev-logs" },
+  { name: "workspace-index", dir: "index" },
+];
+export const BLOBS_CATEGORY = "blobs";
+export const CACHE_GC_STATE_FILENAME = "cache-gc.json";
+export const DEFAULT_GC_INTERVAL_MS = 15 * 60 * 1000;
+export const DEFAULT_GC_MIN_AGE_MS = 5 * 60 * 1000;
+
+const CATEGORY_NAMES = new Set([...CACHE_GC_CATEGORIES.map((entry) => entry.name), BLOBS_CATEGORY]);
+const BLOB_REF_PATTERN = /sha256:([0-9a-f]{64})/g;
+const BLOB_FILE_PATTERN = /^([0-9a-f]{64})\.br$/;
+const MAX_SCAN_BYTES = 256 * 1024 * 1024;
+const SCAN_CONCURRENCY = 8;
+const SIZE_UNITS = { "": 1, k: 1024, m: 1024 ** 2, g: 1024 ** 3, t: 1024 ** 4 };
+
+/** Parses `"500MB"`, `"1.5g"`, `"2GiB"` or a byte count; null when unset or invalid. */
+export function parseByteSize(value) {
+  if (value === undefined || value === null || value === "" || value === false) {
+    return null;
+  }
+  if (typeof value === "number") {
+    return Number.isFinite(value) && value >= 0 ? Math.floor(value) : null;
+  }
+  const match = String(value).trim().toLowerCase().match(/^(\d+(?:\.\d+)?)\s*([kmgt]?)(?:i?b)?$/);
+  if (!match) {
+    return null;
+  }
+  return Math.floor(Number(match[1]) * SIZE_UNITS[match[2]]);
+}
+
+export function formatByteSize(bytes) {
+  if (!Number.isFinite(bytes)) {
+    return "-";
+  }
+  const units = ["B", "KB", "MB", "GB", "TB"];
+  let value = bytes;
+  let unit = 0;
+  while (value >= 1024 && unit < units.length - 1) {
+    value /= 1024;
+    unit += 1;
+  }
+  return `${unit === 0 ? value : value.toFixed(1)}${units[unit]}`;
+}
+
+function normalizeCategory(name) {
+  const kebab = String(name ?? "")
+    .trim()
+    .replace(/([a-z0-9])([A-Z])/g, "$1-$2")
+    .toLowerCase();
+  return CATEGORY_NAMES.has(kebab) ? kebab : null;
+}
+
+const isDisabled = (value) =>
+  ["0", "false", "no", "off"].includes(String(value ?? "").trim().toLowerCase());
+
+/**
+ * Reads the GC policy from the `retention` config block:
+ * `{ maxBytes, quotas: { <category>: size }, autoGc, gcIntervalMinutes }`.
+ * `overrides` (CLI flags) win over config. The background collector is on
+ * whenever a budget is set, unless `autoGc: false` or `MINIPHI_CACHE_GC=0`.
+ */
+export function resolveCacheGcPolicy(retention = undefined, overrides = undefined) {
+  const maxBytes = parseByteSize(overrides?.maxBytes ?? retention?.maxBytes);
+  const quotas = {};
+  for (const source of [retention?.quotas, overrides?.quotas]) {
+    for (const [name, value] of Object.entries(source ?? {})) {
+      const category = normalizeCategory(name);
+      const bytes = parseByteSize(value);
+      if (category && bytes !== null) {
+        quotas[category] = bytes;
+      }
+    }
+  }
+  const limited = maxBytes !== null || Object.keys(quotas).length > 0;
+  const minutes = Number(retention?.gcIntervalMinutes);
+  return {
+    maxBytes,
+    quotas,
+    auto: limited && retention?.autoGc !== false && !isDisabled(process.env.MINIPHI_CACHE_GC),
+    intervalMs: Number.isFinite(minutes) && minutes >= 0 ? minutes * 60 * 1000 : DEFAULT_GC_INTERVAL_MS,
+  };
+}
+
+async function walkFiles(dir, visit) {
+  let dirents;
+  try {
+    dirents = await fs.promises.readdir(dir, { withFileTypes: true });
+  } catch {
+    return;
+  }
+  await Promise.all(
+    dirents.map(async (dirent) => {
+      const full = path.join(dir, dirent.name);
+      if (dirent.isDirectory()) {
+        await walkFiles(full, visit);
+        return;
+      }
+      if (!dirent.isFile()) {
+        return;
+      }
+      try {
+        visit(full, await fs.promises.stat(full));
+      } catch {
+        // removed while walking
+      }
+    }),
+  );
+}
+
+/** Category and unit key for a file key, or null for files outside every category. */
+function locateUnit(fileKey) {
+  for (const category of CACHE_GC_CATEGORIES) {
+    if (!fileKey.startsWith(`${category.dir}/`)) {
+      continue;
+    }
+    const rest = fileKey.slice(category.dir.length + 1);
+    const slash = rest.indexOf("/");
+    const name = slash === -1 ? rest : rest.slice(0, slash);
+    if (slash === -1 && (name === "index.json" || /\.(tmp|lock)$/.test(name))) {
+      return null;
+    }
+    if (category.match && !category.match.test(name)) {
+      return null;
+    }
+    return { category: category.name, key: `${category.dir}/${name}` };
+  }
+  return null;
+}
+
+/** Stat-only pass: every unit, blob and pinned file with its size and mtime. */
+async function measureCache(baseDir, access) {
+  const units = new Map();
+  const blobs = new Map();
+  const pinned = { bytes: 0, files: [] };
+  const skip = new Set([
+    `indices/${CACHE_ACCESS_FILENAME}`,
+    `indices/${CACHE_GC_STATE_FILENAME}`,
+  ]);
+  await walkFiles(baseDir, (file, stat) => {
+    const key = cacheAccessKey(baseDir, file);
+    if (!key || skip.has(key)) {
+      return;
+    }
+    if (key.startsWith(`${BLOBS_DIRNAME}/`)) {
+      const match = path.basename(file).match(BLOB_FILE_PATTERN);
+      if (match) {
+        blobs.set(match[1], { hex: match[1], file, bytes: stat.size, mtimeMs: stat.mtimeMs, refs: 0, pinned: false });
+      }
+      return;
+    }
+    const located = locateUnit(key);
+    if (!located) {
+      pinned.bytes += stat.size;
+      pinned.files.push(file);
+      return;
+    }
+    let unit = units.get(located.key);
+    if (!unit) {
+      unit = { ...located, bytes: 0, mtimeMs: 0, lastAccessMs: 0, files: [], blobs: new Set() };
+      units.set(located.key, unit);
+    }
+    unit.bytes += stat.size;
+    unit.mtimeMs = Math.max(unit.mtimeMs, stat.mtimeMs);
+    unit.files.push(file);
+  });
+  const staleAccessKeys = [];
+  for (const [key, at] of Object.entries(access)) {
+    const located = locateUnit(key);
+    const unit = located ? units.get(located.key) : null;
+    if (unit) {
+      unit.lastAccessMs = Math.max(unit.lastAccessMs, Number(at) || 0);
+    } else {
+      staleAccessKeys.push(key);
+    }
+  }
+  for (const unit of units.values()) {
+    unit.lastAccessMs = Math.max(unit.lastAccessMs, unit.mtimeMs);
+  }
+  return { units, blobs, pinned, staleAccessKeys };
+}
+
+async function readReferences(file) {
+  const stat = await fs.promises.stat(file);
+  if (stat.size > MAX_SCAN_BYTES) {
+    throw new Error(`too large to scan: ${file}`);
+  }
+  let buffer = await fs.promises.readFile(file);
+  if (file.endsWith(".gz")) {
+    try {
+      buffer = await gunzip(buffer);
+    } catch {
+      // not actually gzip; scan the raw bytes
+    }
+  }
+  const refs = new Set();
+  for (const match of buffer.toString("latin1").matchAll(BLOB_REF_PATTERN)) {
+    refs.add(match[1]);
+  }
+  return refs;
+}
+
+/**
+ * Fills `unit.blobs` and blob reference counts. Returns false when some
+ * artifact could not be read, in which case no blob may be deleted.
+ */
+async function scanReferences(measured) {
+  const jobs = [];
+  for (const unit of measured.units.values()) {
+    for (const file of unit.files) {
+      jobs.push({ file, unit });
+    }
+  }
+  for (const file of measured.pinned.files) {
+    jobs.push({ file, unit: null });
+  }
+  let complete = true;
+  let next = 0;
+  const worker = async () => {
+    while (next < jobs.length) {
+      const job = jobs[next];
+      next += 1;
+      try {
+        for (const hex of await readReferences(job.file)) {
+          if (job.unit) {
+            job.unit.blobs.add(hex);
+          } else if (measured.blobs.has(hex)) {
+            measured.blobs.get(hex).pinned = true;
+          }
+        }
+      } catch (error) {
+        if (error?.code !== "ENOENT") {
+          complete = false;
+        }
+      }
+    }
+  };
+  await Promise.all(Array.from({ length: SCAN_CONCURRENCY }, worker));
+  for (const unit of measured.units.values()) {
+    for (const hex of unit.blobs) {
+      const blob = measured.blobs.get(hex);
+      if (blob) {
+        blob.refs += 1;
+      }
+    }
+  }
+  return complete;
+}
+
+function summarizeUsage(measured) {
+  const categories = {};
+  for (const category of CACHE_GC_CATEGORIES) {
+    categories[category.name] = { bytes: 0, units: 0 };
+  }
+  for (const unit of measured.units.values()) {
+    categories[unit.category].bytes += unit.bytes;
+    categories[unit.category].units += 1;
+  }
+  let blobBytes = 0;
+  for (const blob of measured.blobs.values()) {
+    blobBytes += blob.bytes;
+  }
+  categories[BLOBS_CATEGORY] = { bytes: blobBytes, units: measured.blobs.size };
+  const totalBytes =
+    Object.values(categories).reduce((sum, entry) => sum + entry.bytes, 0) + measured.pinned.bytes;
+  return { totalBytes, pinnedBytes: measured.pinned.bytes, categories };
+}
+
+function overBudget(usage, policy) {
+  const over = Object.entries(policy.quotas)
+    .filter(([name, quota]) => (usage.categories[name]?.bytes ?? 0) > quota)
+    .map(([name]) => name);
+  if (policy.maxBytes !== null && usage.totalBytes > policy.maxBytes) {
+    over.push("total");
+  }
+  return over;
+}
+
+/** Chooses what to delete; mutates `usage` to the post-eviction figures. */
+function planEvictions(measured, usage, policy, { now, minAgeMs, referencesKnown }) {
+  const evicted = [];
+  const freedBlobs = [];
+  const settled = (mtimeMs) => now - mtimeMs >= minAgeMs;
+  const candidates = Array.from(measured.units.values())
+    .filter((unit) => settled(unit.mtimeMs))
+    .sort((left, right) => left.lastAccessMs - right.lastAccessMs);
+
+  const release = (blob) => {
+    if (blob.released || blob.pinned || blob.refs > 0 || !settled(blob.mtimeMs) || !referencesKnown) {
+      return;
+    }
+    blob.released = true;
+    freedBlobs.push(blob);
+    usage.categories[BLOBS_CATEGORY].bytes -= blob.bytes;
+    usage.categories[BLOBS_CATEGORY].units -= 1;
+    usage.totalBytes -= blob.bytes;
+  };
+  const evict = (unit) => {
+    unit.evicted = true;
+    evicted.push(unit);
+    usage.categories[unit.category].bytes -= unit.bytes;
+    usage.categories[unit.category].units -= 1;
+    usage.totalBytes -= unit.bytes;
+    for (const hex of unit.blobs) {
+      const blob = measured.blobs.get(hex);
+      if (blob) {
+        blob.refs -= 1;
+        release(blob);
+      }
+    }
+  };
+
+  // Blobs nothing references any more cost nothing to drop.
+  for (const blob of measured.blobs.values()) {
+    release(blob);
+  }
+  for (const [name, quota] of Object.entries(policy.quotas)) {
+    if (name === BLOBS_CATEGORY) {
+      continue;
+    }
+    for (const unit of candidates) {
+      if (usage.categories[name].bytes <= quota) {
+        break;
+      }
+      if (unit.category === name && !unit.evicted) {
+        evict(unit);
+      }
+    }
+  }
+  const blobQuota = policy.quotas[BLOBS_CATEGORY];
+  if (blobQuota !== undefined && referencesKnown) {
+    for (const unit of candidates) {
+      if (usage.categories[BLOBS_CATEGORY].bytes <= blobQuota) {
+        break;
+      }
+      if (!unit.evicted && unit.blobs.size) {
+        evict(unit);
+      }
+    }
+  }
+  if (policy.maxBytes !== null) {
+    for (const unit of candidates) {
+      if (usage.totalBytes <= policy.maxBytes) {
+        break;
+      }
+      if (!unit.evicted) {
+        evict(unit);
+      }
+    }
+  }
+  return { evicted, freedBlobs };
+}
+
+function isWithin(baseDir, target) {
+  const relative = path.relative(baseDir, target);
+  return Boolean(relative) && !relative.startsWith("..") && !path.isAbsolute(relative);
+}
+
+const INDEX_FIELDS = ["path", "file", "markdown", "archive"];
+
+/** Drops index entries whose artifacts lived in an evicted unit. */
+async function dropDanglingIndexEntries(memory, removedKeys) {
+  const removed = new Set(removedKeys);
+  const baseDir = memory.baseDir;
+  const dangling = (entry) =>
+    INDEX_FIELDS.some((field) => {
+      const key = typeof entry?.[field] === "string" ? cacheAccessKey(baseDir, entry[field]) : null;
+      const located = key ? locateUnit(key) : null;
+      return Boolean(located && removed.has(located.key));
+    });
+  const indexes = [
+    { file: memory.executionsIndexFile, rebuild: rebuildExecutionIndexRefs },
+    { file: path.join(memory.promptExchangesDir, "index.json") },
+    { file: memory.promptSessionsIndexFile },
+    { file: memory.promptStepJournalIndexFile },
+    { file: memory.historyNotesIndexFile },
+    { file: memory.researchIndexFile },
+    { file: memory.webIndexFile },
+    { file: memory.nitpickIndexFile },
+  ];
+  let dropped = 0;
+  for (const { file, rebuild } of indexes) {
+    if (!file || !fs.existsSync(file)) {
+      continue;
+    }
+    const before = (await memory._readJSON(file, null))?.entries?.length ?? 0;
+    const after = await memory._updateIndex(file, null, (doc) => {
+      if (!doc || !Array.isArray(doc.entries)) {
+        return doc;
+      }
+      const kept = doc.entries.filter((entry) => !dangling(entry));
+      if (kept.length === doc.entries.length) {
+        return doc;
+      }
+      doc.entries = kept;
+      rebuild?.(doc, kept);
+      doc.updatedAt = new Date().toISOString();
+      return doc;
+    });
+    dropped += Math.max(0, before - (after?.entries?.length ?? before));
+  }
+  return dropped;
+}
+
+async function removeUnits(memory, units) {
+  const segments = units.filter((unit) => unit.category === "prompt-archive");
+  let errors = 0;
+  if (segments.length) {
+    try {
+      const archive = new PromptArchive(memory.promptExchangesDir);
+      await archive.removeSegments(segments.map((unit) => path.basename(unit.key)));
+    } catch {
+      errors += segments.length;
+    }
+  }
+  for (const unit of units) {
+    if (unit.category === "prompt-archive") {
+      continue;
+    }
+    const target = path.join(memory.baseDir, ...unit.key.split("/"));
+    if (!isWithin(memory.baseDir, target)) {
+      continue;
+    }
+    try {
+      await fs.promises.rm(target, { recursive: true, force: true });
+    } catch {
+      errors += 1;
+    }
+  }
+  return errors;
+}
+
+function gcStateFile(baseDir) {
+  return path.join(baseDir, "indices", CACHE_GC_STATE_FILENAME);
+}
+
+/**
+ * Runs one collection over `memory.baseDir`.
+ * @param {import("./miniphi-memory.js").default} memory
+ * @param {{
+ *   policy?: ReturnType<typeof resolveCacheGcPolicy>,
+ *   dryRun?: boolean,
+ *   incremental?: boolean,
+ *   minAgeMs?: number,
+ *   now?: number,
+ * }} [options]
+ */
+export async function runCacheGc(memory, options = {}) {
+  if (!memory) {
+    throw new Error("Cache GC requires a MiniPhiMemory instance.");
+  }
+  const baseDir = memory.baseDir;
+  const policy = options.policy ?? resolveCacheGcPolicy();
+  const dryRun = Boolean(options.dryRun);
+  const incremental = Boolean(options.incremental);
+  const now = Number.isFinite(options.now) ? options.now : Date.now();
+  const minAgeMs = Number.isFinite(options.minAgeMs) ? options.minAgeMs : DEFAULT_GC_MIN_AGE_MS;
+  const result = {
+    baseDir,
+    dryRun,
+    incremental,
+    policy: { maxBytes: policy.maxBytes, quotas: policy.quotas },
+    skipped: false,
+    reason: null,
+    before: null,
+    after: null,
+    overBudget: [],
+    evicted: [],
+    removedBlobs: 0,
+    freedBytes: 0,
+    droppedIndexEntries: 0,
+    referencesScanned: false,
+    errors: 0,
+  };
+  if (!fs.existsSync(baseDir)) {
+    return { ...result, skipped: true, reason: "no .miniphi directory" };
+  }
+  const indexes = getJsonIndexStore();
+  const stateFile = gcStateFile(baseDir);
+  if (incremental) {
+    const state = await indexes.read(stateFile, {});
+    if (Number.isFinite(state?.lastRunAt) && now - state.lastRunAt < policy.intervalMs) {
+      return { ...result, skipped: true, reason: "ran recently" };
+    }
+  }
+
+  const measured = await measureCache(baseDir, await readCacheAccess(baseDir));
+  const usage = summarizeUsage(measured);
+  result.before = structuredClone(usage);
+  result.overBudget = overBudget(usage, policy);
+  let plan = { evicted: [], freedBlobs: [] };
+  if (!incremental || result.overBudget.length) {
+    const referencesKnown = await scanReferences(measured);
+    result.referencesScanned = true;
+    plan = planEvictions(measured, usage, policy, { now, minAgeMs, referencesKnown });
+  }
+  result.after = usage;
+  result.evicted = plan.evicted.map((unit) => ({
+    category: unit.category,
+    key: unit.key,
+    bytes: unit.bytes,
+    lastAccessAt: new Date(unit.lastAccessMs).toISOString(),
+  }));
+  result.removedBlobs = plan.freedBlobs.length;
+  result.freedBytes = result.before.totalBytes - usage.totalBytes;
+  result.overBudget = overBudget(usage, policy);
+
+  if (!dryRun) {
+    result.errors += await removeUnits(memory, plan.evicted);
+    for (const blob of plan.freedBlobs) {
+      try {
+        await fs.promises.rm(blob.file, { force: true });
+      } catch {
+        result.errors += 1;
+      }
+    }
+    const removedKeys = plan.evicted.map((unit) => unit.key);
+    if (removedKeys.length) {
+      result.droppedIndexEntries = await dropDanglingIndexEntries(memory, removedKeys);
+    }
+    if (removedKeys.length || measured.staleAccessKeys.length) {
+      await forgetCacheAccess(baseDir, [...removedKeys, ...measured.staleAccessKeys]);
+    }
+    await indexes.write(stateFile, {
+      lastRunAt: now,
+      totalBytes: usage.totalBytes,
+      freedBytes: result.freedBytes,
+      overBudget: result.overBudget,
+    });
+    await indexes.flush();
+  }
+  return result;
+}
+
+/**
+ * Queues an incremental collection for when the CLI's event loop drains, so
+ * it never delays a command's own output. A no-op unless the policy enables
+ * it and the workspace already has a `.miniphi` directory.
+ */
+export function scheduleCacheGc(memory, policy, { verbose = false } = {}) {
+  if (!memory || !policy?.auto || !fs.existsSync(memory.baseDir)) {
+    return false;
+  }
+  process.once("beforeExit", () => {
+    runCacheGc(memory, { policy, incremental: true })
+      .then((result) => {
+        if (verbose && !result.skipped && result.evicted.length + result.removedBlobs > 0) {
+          console.log(
+            `[MiniPhi] Cache GC freed ${formatByteSize(result.freedBytes)} (${result.evicted.length} entries, ${result.removedBlobs} blobs); .miniphi now ${formatByteSize(result.after.totalBytes)}`,
+          );
+        }
+      })
+      .catch((error) => {
+        if (verbose) {
+          console.warn(`[MiniPhi] Cache GC failed: ${error instanceof Error ? error.message : error}`);
+        }
+      });
+  });
+  return true;
+}
@@ -1,5 +1,6 @@
 import fs from "fs";
 import path from "path";
+import PromptArchive from "./prompt-archive.js";
 
 const DEFAULT_LIMITS = {
   executions: 200,
@@ -60,6 +61,73 @@ async function removeTarget(target, { baseDir, dryRun }) {
   return true;
 }
 
+/** Drops `byTask` references to executions that are no longer indexed. */
+export function rebuildExecutionIndexRefs(index, keptEntries) {
+  const keptIds = new Set(keptEntries.map((entry) => entry?.id).filter(Boolean));
+  const byTask = index.byTask ?? {};
+  const updated = {};
+  for (const [key, value] of Object.entries(byTask)) {
+    const execIds = Array.isArray(value?.executions)
+      ? value.executions.filter((id) => keptIds.has(id))
+      : [];
+    if (execIds.length) {
+      updated[key] = { ...(value ?? {}), executions: execIds };
+    }
+  }
+  index.byTask = updated;
+  index.latest = keptEntries[0] ?? null;
+}
+
+/**
+ * The prompt-exchange archive is pruned by whole segments (see
+ * PromptArchive.prune); the result uses the same shape as index pruning.
+ */
+async function prunePromptArchive(memory, { keep, dryRun }) {
+  const label = "prompt-archive";
+  const archive = new PromptArchive(memory.promptExchangesDir);
+  if (keep === null) {
+    const totalEntries = await archive.refresh();
+    return {
+      label,
+      keep,
+      totalEntries,
+      keptEntries: totalEntries,
+      removedEntries: 0,
+      removedTargets: 0,
+      skippedTargets: 0,
+      errors: 0,
+      skipped: true,
+      reason: "retention disabled",
+    };
+  }
+  try {
+    const pruned = await archive.prune({ keep, dryRun });
+    return {
+      label,
+      keep,
+      totalEntries: pruned.totalEntries,
+      keptEntries: pruned.keptEntries,
+      removedEntries: pruned.removedEntries,
+      removedTargets: pruned.removedSegments,
+      skippedTargets: 0,
+      errors: 0,
+      skipped: false,
+    };
+  } catch {
+    return {
+      label,
+      keep,
+      totalEntries: 0,
+      keptEntries: 0,
+      removedEntries: 0,
+      removedTargets: 0,
+      skippedTargets: 0,
+      errors: 1,
+      skipped: false,
+    };
+  }
+}
+
 async function pruneIndexEntries(memory, config) {
   const { indexFile, label, keep, resolveTargets, updateIndex, dryRun } = config;
   const baseDir = memory.baseDir;
@@ -193,21 +261,7 @@ export async function pruneMiniPhiCache(memory, options = {}) {
         const folder = path.dirname(entryPath);
         return folder ? [folder] : [];
       },
-      updateIndex: (index, keptEntries) => {
-        const keptIds = new Set(keptEntries.map((entry) => entry?.id).filter(Boolean));
-        const byTask = index.byTask ?? {};
-        const updated = {};
-        for (const [key, value] of Object.entries(byTask)) {
-          const execIds = Array.isArray(value?.executions)
-            ? value.executions.filter((id) => keptIds.has(id))
-            : [];
-          if (execIds.length) {
-            updated[key] = { ...(value ?? {}), executions: execIds };
-          }
-        }
-        index.byTask = updated;
-        index.latest = keptEntries[0] ?? null;
-      },
+      updateIndex: rebuildExecutionIndexRefs,
       dryRun,
     }),
   );
@@ -220,6 +274,7 @@ export async function pruneMiniPhiCache(memory, options = {}) {
       dryRun,
     }),
   );
+  results.push(await prunePromptArchive(memory, { keep: limits.promptExchanges, dryRun }));
   results.push(
     await pruneIndexEntries(memory, {
       label: "prompt-journals",
@@ -281,6 +336,7 @@ export async function pruneMiniPhiCache(memory, options = {}) {
       dryRun,
     }),
   );
+  await memory._commitIndexes();
 
   const summary = results.reduce(
     (acc, entry) => {
@@ -1,5 +1,8 @@
 import fs from "fs";
 import path from "path";
+import { C_SOURCE_EXTENSIONS, isCSourcePath } from "./source-facts.js";
+import { getSourceFactsIndex } from "./source-facts-index.js";
+import WorkspaceIndex, { getWorkspaceIndex } from "./workspace-index.js";
 
 const DEFAULT_MAX_FILES = 200;
 const DEFAULT_MAX_BYTES = 96 * 1024;
@@ -13,6 +16,7 @@ const SUPPORTED_EXTENSIONS = new Set([
   ".py",
   ".sh",
   ".bash",
+  ...C_SOURCE_EXTENSIONS,
 ]);
 const IMPORT_EXTENSIONS = ["", ".js", ".jsx", ".ts", ".tsx", ".mjs", ".cjs", ".py"];
 const INDEX_FILES = ["index.js", "index.ts", "index.tsx", "index.jsx"];
@@ -29,7 +33,43 @@ const IGNORED_DIRECTORIES = new Set([
   ".idea",
   ".vscode",
 ]);
+const SKIP_DIR = (name) => IGNORED_DIRECTORIES.has(name.toLowerCase()) || name.startsWith(".");
 
+function sharedDirDepth(left, right) {
+  const leftParts = left.split("/").slice(0, -1);
+  const rightParts = right.split("/").slice(0, -1);
+  let depth = 0;
+  while (depth < leftParts.length && leftParts[depth] === rightParts[depth]) {
+    depth += 1;
+  }
+  return depth - Math.abs(leftParts.length - rightParts.length) / 100;
+}
+
+/** Ties go to a file named after the function (`xmalloc` → `xmalloc.c`). */
+function nearestDefinition(caller, name, targets) {
+  if (targets.includes(caller)) {
+    return caller;
+  }
+  const score = (target) =>
+    sharedDirDepth(caller, target) + (path.posix.basename(target).replace(/\.[^.]+$/, "") === name ? 0.001 : 0);
+  let best = targets[0];
+  for (const target of targets) {
+    if (score(target) > score(best)) {
+      best = target;
+    }
+  }
+  return best;
+}
+
+/**
+ * Maps how workspace files connect. JS/TS and Python imports are read with
+ * regexes; C and C++ sources use structural facts (source-facts.js):
+ * `#include` edges plus function definitions and the calls between them,
+ * so hotspots also name the most-called functions of native codebases.
+ * `analyze` is synchronous and parses uncached native files inline with the
+ * lexical scanner; `prepare` parses them ahead of time on the tree-sitter
+ * worker pool, after which `analyze` is served from the cache.
+ */
 export default class FileConnectionAnalyzer {
   constructor(options = undefined) {
     this.maxFiles = options?.maxFiles ?? DEFAULT_MAX_FILES;
@@ -37,6 +77,25 @@ export default class FileConnectionAnalyzer {
     this.logger = typeof options?.logger === "function" ? options.logger : null;
     this.extensions =
       options?.extensions instanceof Set ? options.extensions : SUPPORTED_EXTENSIONS;
+    this.privateIndexes = new Map();
+  }
+
+  /**
+   * Parses the native sources `analyze` will read on the worker pool, so the
+   * synchronous pass that follows finds their facts cached.
+   * @param {string} [rootDir]
+   */
+  async prepare(rootDir = process.cwd()) {
+    const root = path.resolve(rootDir);
+    if (!fs.existsSync(root)) {
+      return;
+    }
+    await this._resolveIndex(root).ensureFresh();
+    const { index, files } = this._collectFiles(root);
+    const nativeFiles = files.filter((relative) => isCSourcePath(relative));
+    if (nativeFiles.length) {
+      await getSourceFactsIndex(index).collect(nativeFiles);
+    }
   }
 
   analyze(rootDir = process.cwd()) {
@@ -44,18 +103,27 @@ export default class FileConnectionAnalyzer {
     if (!fs.existsSync(root)) {
       throw new Error(`Workspace root not found: ${root}`);
     }
-    const files = this._collectFiles(root);
+    const { index, files } = this._collectFiles(root);
     const nodes = new Map();
     const importCache = new Map();
+    const nativeFiles = files.filter((relative) => isCSourcePath(relative));
+    const nativeFacts = nativeFiles.length ? getSourceFactsIndex(index).collectSync(nativeFiles) : new Map();
+    const headerLookup = nativeFiles.length ? this._buildHeaderLookup(index) : null;
 
-    for (const filePath of files) {
-      const relative = path.relative(root, filePath).replace(/\\/g, "/");
-      const content = this._readFileSafely(filePath);
-      const imports = this._extractImports(filePath, content, root, importCache);
+    for (const relative of files) {
+      const facts = nativeFacts.get(relative);
+      let imports;
+      if (isCSourcePath(relative)) {
+        imports = facts ? this._resolveIncludes(relative, facts.includes, index, headerLookup) : [];
+      } else {
+        const filePath = path.join(root, relative);
+        imports = this._extractImports(filePath, this._readFileSafely(filePath), root, importCache);
+      }
       nodes.set(relative, {
         path: relative,
         imports,
         importedBy: [],
+        ...(facts ? { functions: facts.functions.length } : {}),
       });
     }
 
@@ -71,8 +139,12 @@ export default class FileConnectionAnalyzer {
       });
     }
 
+    const calls = nativeFacts.size ? this._buildCallGraph(nativeFacts) : null;
     const hotspots = this._buildHotspots(nodes);
-    const summary = this._buildSummary(hotspots, nodes.size, edgeCount);
+    if (calls) {
+      hotspots.topCalledFunctions = calls.topCalled;
+    }
+    const summary = this._buildSummary(hotspots, nodes.size, edgeCount, calls);
     const graph = this._buildGraphSample(nodes);
 
     return {
@@ -80,55 +152,52 @@ export default class FileConnectionAnalyzer {
       filesAnalyzed: nodes.size,
       edges: edgeCount,
       nodes: Object.fromEntries(nodes),
+      functions: calls?.functions ?? 0,
+      callEdges: calls?.edges ?? 0,
       hotspots,
       summary,
       graph,
     };
   }
 
-  _collectFiles(root) {
-    const queue = [root];
-    const collected = [];
-    const visited = new Set();
+  /** The shared index when it covers these skip rules, otherwise a private one kept per root. */
+  _resolveIndex(root) {
+    const shared = getWorkspaceIndex(root);
+    if (shared.canServe(SKIP_DIR)) {
+      return shared;
+    }
+    let index = this.privateIndexes.get(root);
+    if (!index) {
+      index = new WorkspaceIndex(root, { ignoredDirs: IGNORED_DIRECTORIES, indexFile: null });
+      this.privateIndexes.set(root, index);
+    }
+    return index;
+  }
 
-    while (queue.length > 0 && collected.length < this.maxFiles) {
-      const current = queue.shift();
-      if (!current || visited.has(current)) {
+  /**
+   * Up to `maxFiles` matching files, in walk order, from a fresh index. When
+   * the index is stale the files come from a disk walk that stops at the cap
+   * instead of a full sync refresh; `prepare` refreshes it asynchronously.
+   * Only native sources force the refresh here, since resolving `#include`
+   * targets needs every header in the tree.
+   */
+  _collectFiles(root) {
+    const index = this._resolveIndex(root);
+    const entries = index.isFresh() ? index.walk({ skipDir: SKIP_DIR }) : index.walkDisk({ skipDir: SKIP_DIR });
+    const files = [];
+    for (const entry of entries) {
+      if (entry.type !== "file" || !this.extensions.has(path.extname(entry.path).toLowerCase())) {
         continue;
       }
-      visited.add(current);
-
-      let entries = [];
-      try {
-        entries = fs.readdirSync(current, { withFileTypes: true });
-      } catch {
-        continue;
-      }
-
-      for (const entry of entries) {
-        const fullPath = path.join(current, entry.name);
-        if (entry.isDirectory()) {
-          if (IGNORED_DIRECTORIES.has(entry.name.toLowerCase()) || entry.name.startsWith(".")) {
-            continue;
-          }
-          queue.push(fullPath);
-          continue;
-        }
-        if (!entry.isFile()) {
-          continue;
-        }
-        const ext = path.extname(entry.name).toLowerCase();
-        if (!this.extensions.has(ext)) {
-          continue;
-        }
-        collected.push(fullPath);
-        if (collected.length >= this.maxFiles) {
-          break;
-        }
+      files.push(entry.path);
+      if (files.length >= this.maxFiles) {
+        break;
       }
     }
-
-    return collected;
+    if (files.some((relative) => isCSourcePath(relative))) {
+      index.ensureFreshSync();
+    }
+    return { index, files };
   }
 
   _readFileSafely(filePath) {
@@ -248,6 +317,91 @@ export default class FileConnectionAnalyzer {
     return relative;
   }
 
+  /** Indexed C/C++ headers by file name, for `#include` targets that are not relative to the includer. */
+  _buildHeaderLookup(index) {
+    const byName = new Map();
+    for (const relative of index.files.keys()) {
+      if (!isCSourcePath(relative)) {
+        continue;
+      }
+      const name = relative.slice(relative.lastIndexOf("/") + 1);
+      const list = byName.get(name) ?? [];
+      list.push(relative);
+      byName.set(name, list);
+    }
+    return byName;
+  }
+
+  /**
+   * Resolves `#include` targets the way a compiler with `-I` set to the
+   * workspace directories would: quoted includes relative to the includer
+   * first, then from the root, then the one indexed header whose path ends
+   * with the include (e.g. `<readline/readline.h>` → `lib/readline/readline.h`).
+   */
+  _resolveIncludes(relative, includes, index, headerLookup) {
+    const resolved = new Set();
+    const dir = path.posix.dirname(relative);
+    for (const include of includes) {
+      const target = include.path.replace(/\\/g, "/");
+      const candidates = include.system ? [] : [path.posix.normalize(path.posix.join(dir, target))];
+      candidates.push(path.posix.normalize(target));
+      let match = candidates.find((candidate) => !candidate.startsWith("../") && index.files.has(candidate));
+      if (!match) {
+        const name = target.slice(target.lastIndexOf("/") + 1);
+        const suffixed = (headerLookup.get(name) ?? []).filter(
+          (candidate) => candidate === target || candidate.endsWith(`/${target}`),
+        );
+        match = suffixed.length === 1 ? suffixed[0] : null;
+      }
+      if (match && match !== relative) {
+        resolved.add(match);
+      }
+    }
+    return Array.from(resolved);
+  }
+
+  /**
+   * Links calls to the functions defined in the analyzed native files. A
+   * name defined in several files (static helpers, standalone tools, test
+   * stubs) binds to the caller's own file, else to the definition nearest to
+   * it in the directory tree.
+   */
+  _buildCallGraph(nativeFacts) {
+    const definitions = new Map();
+    let functions = 0;
+    for (const [relative, facts] of nativeFacts) {
+      for (const fn of facts.functions) {
+        functions += 1;
+        const list = definitions.get(fn.name) ?? [];
+        list.push(relative);
+        definitions.set(fn.name, list);
+      }
+    }
+    const callers = new Map();
+    let edges = 0;
+    for (const [relative, facts] of nativeFacts) {
+      for (const fn of facts.functions) {
+        for (const callee of fn.calls) {
+          const targets = definitions.get(callee);
+          if (!targets) {
+            continue;
+          }
+          const target = targets.length === 1 ? targets[0] : nearestDefinition(relative, callee, targets);
+          const key = `${target}\0${callee}`;
+          callers.set(key, (callers.get(key) ?? 0) + 1);
+          edges += 1;
+        }
+      }
+    }
+    const topCalled = Array.from(callers, ([key, count]) => {
+      const [file, name] = key.split("\0");
+      return { name, path: file, callers: count };
+    })
+      .sort((a, b) => b.callers - a.callers || a.name.localeCompare(b.name))
+      .slice(0, 5);
+    return { functions, edges, topCalled };
+  }
+
   _buildHotspots(nodes) {
     const allNodes = Array.from(nodes.values()).map((node) => ({
       path: node.path,
@@ -267,10 +421,13 @@ export default class FileConnectionAnalyzer {
     return { topImporters, topDependents };
   }
 
-  _buildSummary(hotspots, nodeCount, edgeCount) {
+  _buildSummary(hotspots, nodeCount, edgeCount, calls = null) {
     const lines = [
       `Scanned ${nodeCount} files (${edgeCount} verified internal connections).`,
     ];
+    if (calls) {
+      lines[0] += ` Native sources define ${calls.functions} functions with ${calls.edges} internal calls.`;
+    }
     if (hotspots.topImporters.length) {
       const importerLines = hotspots.topImporters
         .map((node) => `- ${node.path}: imports ${node.imports} files`)
@@ -283,6 +440,12 @@ export default class FileConnectionAnalyzer {
         .join("\n");
       lines.push(`Most referenced files:\n${dependentLines}`);
     }
+    if (hotspots.topCalledFunctions?.length) {
+      const calledLines = hotspots.topCalledFunctions
+        .map((fn) => `- ${fn.name} (${fn.path}): called from ${fn.callers} functions`)
+        .join("\n");
+      lines.push(`Most called functions:\n${calledLines}`);
+    }
     return lines.join("\n\n");
   }
 
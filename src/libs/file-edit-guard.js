@@ -1,6 +1,7 @@
 import fs from "fs";
 import path from "path";
 import { createHash } from "crypto";
+import { invalidateWorkspaceIndexes } from "./workspace-index.js";
 
 const DEFAULT_ENCODING = "utf8";
 const ROLLBACK_LABEL_FALLBACK = "file";
@@ -42,7 +43,23 @@ const readFileIfExists = async (targetPath, encoding) => {
 
 const describeError = (error) => (error instanceof Error ? error.message : String(error));
 
-const attemptRollback = async ({ targetPath, rollbackPath, beforeContent, encoding }) => {
+const attemptRollback = async ({
+  targetPath,
+  rollbackPath,
+  rollbackBlob = null,
+  blobStore = null,
+  beforeContent,
+  encoding,
+}) => {
+  invalidateWorkspaceIndexes(targetPath);
+  if (rollbackBlob && blobStore) {
+    try {
+      await fs.promises.writeFile(targetPath, await blobStore.getBuffer(rollbackBlob));
+      return { applied: true, source: rollbackBlob };
+    } catch {
+      // fall through to the in-memory copy
+    }
+  }
   if (rollbackPath) {
     try {
       await fs.promises.copyFile(rollbackPath, targetPath);
@@ -70,6 +87,7 @@ export async function writeFileWithGuard(options = {}) {
     expectedHash = null,
     rollbackDir = null,
     rollbackLabel = null,
+    blobStore = null,
     diffSummaryFn = null,
   } = options;
 
@@ -107,8 +125,17 @@ export async function writeFileWithGuard(options = {}) {
   }
 
   let rollbackPath = null;
+  let rollbackBlob = null;
   let rollbackError = null;
-  if (exists && rollbackDir) {
+  if (exists && blobStore) {
+    // Content-addressed: re-editing a file whose previous version was already
+    // saved (or that matches any other stored snapshot) writes nothing new.
+    try {
+      rollbackBlob = await blobStore.put(Buffer.from(beforeContent, encoding));
+    } catch (error) {
+      rollbackError = describeError(error);
+    }
+  } else if (exists && rollbackDir) {
     try {
       await fs.promises.mkdir(rollbackDir, { recursive: true });
       const label = sanitizeRollbackLabel(rollbackLabel ?? path.basename(targetPath));
@@ -126,10 +153,13 @@ export async function writeFileWithGuard(options = {}) {
       await fs.promises.mkdir(path.dirname(targetPath), { recursive: true });
     }
     await fs.promises.writeFile(targetPath, normalizedContent, encoding);
+    invalidateWorkspaceIndexes(targetPath);
   } catch (error) {
     const rollbackResult = await attemptRollback({
       targetPath,
       rollbackPath,
+      rollbackBlob,
+      blobStore,
       beforeContent,
       encoding,
     });
@@ -141,6 +171,7 @@ export async function writeFileWithGuard(options = {}) {
       expectedHash,
       diffSummary,
       rollbackPath,
+      rollbackBlob,
       rollbackError,
       error: describeError(error),
       rollbackStatus: rollbackResult,
@@ -154,6 +185,8 @@ export async function writeFileWithGuard(options = {}) {
       const rollbackResult = await attemptRollback({
         targetPath,
         rollbackPath,
+        rollbackBlob,
+        blobStore,
         beforeContent,
         encoding,
       });
@@ -165,6 +198,7 @@ export async function writeFileWithGuard(options = {}) {
         expectedHash,
         diffSummary,
         rollbackPath,
+        rollbackBlob,
         rollbackError,
         error: "Write verification failed: hash mismatch.",
         rollbackStatus: rollbackResult,
@@ -174,6 +208,8 @@ export async function writeFileWithGuard(options = {}) {
     const rollbackResult = await attemptRollback({
       targetPath,
       rollbackPath,
+      rollbackBlob,
+      blobStore,
       beforeContent,
       encoding,
     });
@@ -185,6 +221,7 @@ export async function writeFileWithGuard(options = {}) {
       expectedHash,
       diffSummary,
       rollbackPath,
+      rollbackBlob,
       rollbackError,
       error: describeError(error),
       rollbackStatus: rollbackResult,
@@ -199,6 +236,7 @@ export async function writeFileWithGuard(options = {}) {
     expectedHash,
     diffSummary,
     rollbackPath,
+    rollbackBlob,
     rollbackError,
   };
 }
@@ -0,0 +1,153 @@
+import fs from "fs";
+import { spawn, spawnSync } from "child_process";
+import { writeFileAtomic } from "./atomic-file.js";
+
+/**
+ * Last-commit metadata for every tracked file below a directory, collected by
+ * a single streamed `git log --name-only` pass instead of one `git log -1`
+ * process per file.
+ *
+ * The log is walked newest-first; the first commit that names a path is its
+ * last commit (merges list no files, so a path is attributed to the commit
+ * that actually changed it, as `git log -1 -- <path>` does for ordinary
+ * histories). The result only depends on HEAD, so it is cached in memory and
+ * on disk keyed by the HEAD commit: reruns on an unchanged HEAD spawn nothing
+ * but the `rev-parse` that reads it.
+ */
+
+const CACHE_VERSION = 1;
+const RECORD_SEPARATOR = "\x1e";
+/** cwd -> { head, commits } for the last HEAD seen there. */
+const memoryCache = new Map();
+
+/**
+ * @param {string} cwd
+ * @returns {string | null} the HEAD commit, or null outside a repo / before the first commit
+ */
+export function readHeadCommit(cwd) {
+  try {
+    const result = spawnSync("git", ["-C", cwd, "rev-parse", "--verify", "-q", "HEAD"], { encoding: "utf8" });
+    const head = result.status === 0 ? result.stdout.trim() : "";
+    return head || null;
+  } catch {
+    return null;
+  }
+}
+
+function streamLastCommits(cwd) {
+  return new Promise((resolve, reject) => {
+    const commits = new Map();
+    const child = spawn(
+      "git",
+      [
+        "-C",
+        cwd,
+        "-c",
+        "core.quotepath=off",
+        "log",
+        `--format=${RECORD_SEPARATOR}%H|%cI|%cn`,
+        "--name-only",
+        "--no-renames",
+        "--relative",
+        "-z",
+        "--",
+        ".",
+      ],
+      { stdio: ["ignore", "pipe", "ignore"] },
+    );
+    let current = null;
+    let pending = "";
+    const consume = (token) => {
+      const field = token.startsWith("\n") ? token.slice(1) : token;
+      if (field.startsWith(RECORD_SEPARATOR)) {
+        const [hash, committedAt, ...author] = field.slice(1).split("|");
+        current = { hash: hash || null, committedAt: committedAt || null, author: author.join("|") || null };
+      } else if (field && current && !commits.has(field)) {
+        commits.set(field, current);
+      }
+    };
+    child.stdout.setEncoding("utf8");
+    child.stdout.on("data", (chunk) => {
+      const tokens = (pending + chunk).split("\0");
+      pending = tokens.pop();
+      for (const token of tokens) {
+        consume(token);
+      }
+    });
+    child.on("error", reject);
+    child.on("close", (code) => {
+      if (code !== 0) {
+        reject(new Error(`git log exited with code ${code}`));
+        return;
+      }
+      if (pending) {
+        consume(pending);
+      }
+      resolve(commits);
+    });
+  });
+}
+
+async function readCacheFile(cacheFile, head) {
+  try {
+    const parsed = JSON.parse(await fs.promises.readFile(cacheFile, "utf8"));
+    if (parsed?.version !== CACHE_VERSION || parsed.head !== head || !parsed.commits) {
+      return null;
+    }
+    const commits = new Map();
+    for (const [relative, [hash, committedAt, author]] of Object.entries(parsed.commits)) {
+      commits.set(relative, { hash, committedAt, author });
+    }
+    return commits;
+  } catch {
+    return null;
+  }
+}
+
+async function writeCacheFile(cacheFile, head, commits) {
+  const serialized = {};
+  for (const [relative, commit] of commits) {
+    serialized[relative] = [commit.hash, commit.committedAt, commit.author];
+  }
+  try {
+    await writeFileAtomic(cacheFile, JSON.stringify({ version: CACHE_VERSION, head, commits: serialized }), {
+      mkdir: true,
+    });
+  } catch {
+    // The cache is an optimization; the next run simply re-reads the log.
+  }
+}
+
+/**
+ * Maps each tracked path below `cwd` (POSIX, relative to `cwd`) to its last
+ * commit. Untracked paths are absent.
+ * @param {string} cwd
+ * @param {{ cacheFile?: string | null }} [options] `cacheFile` persists the map keyed by HEAD.
+ * @returns {Promise<{ head: string | null, commits: Map<string, { hash: string | null, committedAt: string | null, author: string | null }>, source: "memory" | "disk" | "git" | "none" }>}
+ */
+export async function readLastCommits(cwd, options = undefined) {
+  const head = readHeadCommit(cwd);
+  if (!head) {
+    return { head: null, commits: new Map(), source: "none" };
+  }
+  const remembered = memoryCache.get(cwd);
+  if (remembered?.head === head) {
+    return { head, commits: remembered.commits, source: "memory" };
+  }
+  const cacheFile = options?.cacheFile ?? null;
+  let commits = cacheFile ? await readCacheFile(cacheFile, head) : null;
+  let source = "disk";
+  if (!commits) {
+    commits = await streamLastCommits(cwd);
+    source = "git";
+    if (cacheFile) {
+      await writeCacheFile(cacheFile, head, commits);
+    }
+  }
+  memoryCache.set(cwd, { head, commits });
+  return { head, commits, source };
+}
+
+export function resetLastCommitCache() {
+  memoryCache.clear();
+}
@@ -2,6 +2,7 @@ import fs from "fs";
 import os from "os";
 import path from "path";
 import MemoryStoreBase from "./memory-store-base.js";
+import { PROMPT_COMPOSITION_ORDERS, buildPromptCompositionFilter } from "./memory-store-utils.js";
 
 const DEFAULT_DIR_NAME = ".miniphi";
 
@@ -32,6 +33,10 @@ export default class GlobalMiniPhiMemory extends MemoryStoreBase {
     this.promptDbPath = path.join(this.promptsDir, "miniphi-prompts.db");
     this.systemProfileFile = path.join(this.configDir, "system-profile.json");
     this.commandPolicyFile = path.join(this.preferencesDir, "command-policy.json");
+    this._registerPagedIndexes([
+      [this.commandLibraryFile],
+      [this.promptCompositionsFile, { orders: PROMPT_COMPOSITION_ORDERS }],
+    ]);
     this.prepared = false;
   }
 
@@ -143,6 +148,7 @@ export default class GlobalMiniPhiMemory extends MemoryStoreBase {
       originalPath: this._relative(payload.sourcePath),
     };
     await this._upsertIndexEntry(this.helperIndexFile, entry, { limit: 200 });
+    await this._commitIndexes();
     return entry;
   }
 
@@ -177,6 +183,7 @@ export default class GlobalMiniPhiMemory extends MemoryStoreBase {
       updatedAt: timestamp,
     };
     await this._upsertIndexEntry(this.promptTemplateIndexFile, entry, { limit: 200 });
+    await this._commitIndexes();
     return entry;
   }
 
@@ -307,13 +314,10 @@ export default class GlobalMiniPhiMemory extends MemoryStoreBase {
 
   async loadCommandLibrary(limit = 20) {
     await this.prepare();
-    const data = await this._readJSON(this.commandLibraryFile, { entries: [] });
-    if (!Array.isArray(data.entries) || data.entries.length === 0) {
-      return [];
-    }
     const maxEntries =
       Number.isFinite(Number(limit)) && Number(limit) > 0 ? Math.floor(Number(limit)) : 20;
-    return data.entries.slice(0, maxEntries).map((entry) => ({
+    const { entries } = await this._queryIndex(this.commandLibraryFile, { limit: maxEntries });
+    return entries.map((entry) => ({
       ...entry,
       source: entry.source ?? "global",
     }));
@@ -380,55 +384,17 @@ export default class GlobalMiniPhiMemory extends MemoryStoreBase {
 
   async loadPromptCompositions(options = undefined) {
     await this.prepare();
-    const cache = await this._readJSON(this.promptCompositionsFile, { entries: [] });
-    let entries = Array.isArray(cache.entries) ? cache.entries : [];
     const limit =
       Number.isFinite(Number(options?.limit)) && Number(options.limit) > 0
         ? Number(options.limit)
         : 12;
-    const workspaceFilter =
-      typeof options?.workspaceType === "string" && options.workspaceType.trim().length
-        ? options.workspaceType.trim().toLowerCase()
-        : null;
-    const modeFilter =
-      typeof options?.mode === "string" && options.mode.trim().length
-        ? options.mode.trim().toLowerCase()
-        : null;
-    const includeFallback = Boolean(options?.includeFallback);
-    const includeInvalid = Boolean(options?.includeInvalid);
-
-    entries = entries.filter((entry) => {
-      if (!entry) {
-        return false;
-      }
-      if (!includeInvalid && entry.status === "invalid") {
-        return false;
-      }
-      if (!includeFallback && entry.status === "fallback") {
-        return false;
-      }
-      if (workspaceFilter) {
-        const label = (entry.workspaceType ?? "").toLowerCase();
-        if (label && label !== workspaceFilter) {
-          return false;
-        }
-      }
-      if (modeFilter) {
-        const mode = (entry.mode ?? "").toLowerCase();
-        if (mode && mode !== modeFilter) {
-          return false;
-        }
-      }
-      return true;
+    const { entries } = await this._queryIndex(this.promptCompositionsFile, {
+      limit,
+      cursor: options?.cursor,
+      order: options?.order === "score" ? "score" : "time",
+      filter: buildPromptCompositionFilter(options),
     });
-
-    entries.sort((a, b) => {
-      const aTime = Date.parse(a.updatedAt ?? a.firstSeenAt ?? 0) || 0;
-      const bTime = Date.parse(b.updatedAt ?? b.firstSeenAt ?? 0) || 0;
-      return bTime - aTime;
-    });
-
-    return entries.slice(0, limit);
+    return entries;
   }
 
   async loadCommandPolicy() {
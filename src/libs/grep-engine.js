@@ -0,0 +1,254 @@
+import fs from "fs";
+import os from "os";
+import path from "path";
+import { Worker } from "worker_threads";
+import { createGrepSpec, grepBuffer } from "./grep-matcher.js";
+import { getWorkspaceIndex } from "./workspace-index.js";
+
+/**
+ * Multi-threaded grep over a list of workspace files, used when search_text
+ * cannot be answered from the trigram index (no `.miniphi` to keep one in)
+ * and to verify the index's candidates.
+ *
+ * Files are handed to a pool of `worker_threads` in chunks of
+ * `GREP_CHUNK_FILES`, in path order. Each worker reads whole files as
+ * Buffers and matches bytes (grep-matcher.js). Results come back out of
+ * order but are released strictly by path position, so the output is
+ * deterministic, and no further chunks are handed out once `maxMatches`
+ * lines are released. The pool is created on first use, shared by every
+ * search in the process and unref'd while idle, so it never keeps a
+ * command alive. With `threads: 1`, or too few files to be worth a
+ * hand-off, the same matcher runs on the main thread.
+ */
+
+export const GREP_CHUNK_FILES = 32;
+export const GREP_MAX_FILE_BYTES = 512 * 1024;
+export const DEFAULT_GREP_THREADS = (() => {
+  const configured = Number(process.env.MINIPHI_GREP_THREADS);
+  if (Number.isFinite(configured) && configured >= 1) {
+    return Math.floor(configured);
+  }
+  const cores = typeof os.availableParallelism === "function" ? os.availableParallelism() : os.cpus().length;
+  // Even on one core a second thread pays off: workers read with blocking
+  // calls, which costs far less than the main thread's thread-pool round trips.
+  return Math.max(2, Math.min(8, cores - 1));
+})();
+
+const INLINE_READ_CONCURRENCY = 16;
+
+class GrepPool {
+  constructor(size) {
+    this.size = size;
+    this.workers = [];
+    this.searches = [];
+    this.nextId = 1;
+  }
+
+  _spawn() {
+    const worker = new Worker(new URL("./grep-worker.js", import.meta.url));
+    worker.job = null;
+    worker.unref();
+    worker.on("message", (message) => this._onMessage(worker, message));
+    worker.on("error", (error) => this._onFailure(worker, error));
+    worker.on("exit", (code) => this._onFailure(worker, new Error(`grep worker exited with code ${code}`)));
+    this.workers.push(worker);
+    return worker;
+  }
+
+  _onMessage(worker, message) {
+    const search = worker.job;
+    worker.job = null;
+    worker.unref();
+    if (search && search.id === message.id) {
+      search.accept(message.results);
+    }
+    this._dispatch();
+  }
+
+  _onFailure(worker, error) {
+    const index = this.workers.indexOf(worker);
+    if (index === -1) {
+      return;
+    }
+    this.workers.splice(index, 1);
+    worker.job?.fail(error);
+    worker.job = null;
+  }
+
+  _dispatch() {
+    this.searches = this.searches.filter((search) => !search.done);
+    for (;;) {
+      const search = this.searches.find((candidate) => candidate.hasWork());
+      if (!search) {
+        return;
+      }
+      let worker = this.workers.find((candidate) => !candidate.job);
+      if (!worker) {
+        if (this.workers.length >= this.size) {
+          return;
+        }
+        worker = this._spawn();
+      }
+      worker.job = search;
+      worker.ref();
+      worker.postMessage(search.takeChunk());
+    }
+  }
+
+  run(search) {
+    search.id = this.nextId;
+    this.nextId += 1;
+    this.searches.push(search);
+    this._dispatch();
+    return search.promise;
+  }
+}
+
+class GrepSearch {
+  constructor(root, paths, spec, maxMatches) {
+    this.root = root;
+    this.paths = paths;
+    this.spec = spec;
+    this.maxMatches = maxMatches;
+    this.next = 0;
+    this.results = new Array(paths.length);
+    this.released = 0;
+    this.matches = [];
+    this.done = false;
+    this.promise = new Promise((resolve, reject) => {
+      this.resolve = resolve;
+      this.reject = reject;
+    });
+  }
+
+  hasWork() {
+    return !this.done && this.next < this.paths.length;
+  }
+
+  takeChunk() {
+    const end = Math.min(this.paths.length, this.next + GREP_CHUNK_FILES);
+    const files = [];
+    for (let index = this.next; index < end; index += 1) {
+      files.push([index, this.paths[index]]);
+    }
+    this.next = end;
+    return { id: this.id, root: this.root, spec: this.spec, limit: this.maxMatches, files };
+  }
+
+  accept(results) {
+    if (this.done) {
+      return;
+    }
+    for (const result of results) {
+      this.results[result.index] = result.matches;
+    }
+    while (this.released < this.paths.length && this.results[this.released]) {
+      const relative = this.paths[this.released];
+      for (const match of this.results[this.released]) {
+        if (this.matches.length >= this.maxMatches) {
+          break;
+        }
+        this.matches.push({ path: relative, line: match.line, text: match.text });
+      }
+      this.results[this.released] = null;
+      this.released += 1;
+      if (this.matches.length >= this.maxMatches) {
+        this.finish(true);
+        return;
+      }
+    }
+    if (this.released >= this.paths.length) {
+      this.finish(false);
+    }
+  }
+
+  finish(truncated) {
+    this.done = true;
+    this.resolve({ matches: this.matches, scanned: this.released, truncated });
+  }
+
+  fail(error) {
+    if (!this.done) {
+      this.done = true;
+      this.reject(error);
+    }
+  }
+}
+
+const pools = new Map();
+
+function poolOf(size) {
+  let pool = pools.get(size);
+  if (!pool) {
+    pool = new GrepPool(size);
+    pools.set(size, pool);
+  }
+  return pool;
+}
+
+async function grepInline(root, paths, spec, maxMatches) {
+  const matches = [];
+  let scanned = 0;
+  for (let start = 0; start < paths.length; start += INLINE_READ_CONCURRENCY) {
+    const batch = paths.slice(start, start + INLINE_READ_CONCURRENCY);
+    const buffers = await Promise.all(
+      batch.map((relative) => fs.promises.readFile(path.join(root, relative)).catch(() => null)),
+    );
+    for (let offset = 0; offset < batch.length; offset += 1) {
+      scanned += 1;
+      if (!buffers[offset]) {
+        continue;
+      }
+      for (const match of grepBuffer(buffers[offset], spec, maxMatches - matches.length).matches) {
+        matches.push({ path: batch[offset], line: match.line, text: match.text });
+      }
+      if (matches.length >= maxMatches) {
+        return { matches, scanned, truncated: true };
+      }
+    }
+  }
+  return { matches, scanned, truncated: false };
+}
+
+/**
+ * Greps `paths` (POSIX, relative to `root`) in the given order.
+ * @param {string} root
+ * @param {string[]} paths
+ * @param {{ term: string, regex: boolean, ignoreCase: boolean }} spec from `createGrepSpec`
+ * @param {{ maxMatches?: number, threads?: number }} [options]
+ * @returns {Promise<{ matches: Array<{ path: string, line: number, text: string }>, scanned: number, truncated: boolean }>}
+ *   `scanned` counts the files whose results were consumed before stopping.
+ */
+export async function grepFiles(root, paths, spec, options = undefined) {
+  const maxMatches = Number.isFinite(options?.maxMatches) ? Math.max(1, options.maxMatches) : 20;
+  const threads = Number.isFinite(options?.threads) ? Math.max(1, Math.floor(options.threads)) : DEFAULT_GREP_THREADS;
+  if (threads <= 1 || paths.length <= GREP_CHUNK_FILES) {
+    return grepInline(root, paths, spec, maxMatches);
+  }
+  try {
+    return await poolOf(threads).run(new GrepSearch(root, paths, spec, maxMatches));
+  } catch {
+    return grepInline(root, paths, spec, maxMatches);
+  }
+}
+
+/**
+ * Greps every file of the shared workspace index under `root`, in path
+ * order, skipping directories matched by `skipDir` and files over
+ * `GREP_MAX_FILE_BYTES`. Throws a SyntaxError for an invalid regex.
+ * @param {string} root
+ * @param {string} term
+ * @param {{ regex?: boolean, ignoreCase?: boolean, maxMatches?: number, skipDir?: (name: string) => boolean, threads?: number }} [options]
+ */
+export async function grepWorkspace(root, term, options = undefined) {
+  const spec = createGrepSpec(term, options);
+  const index = await getWorkspaceIndex(root).ensureFresh();
+  const paths = [];
+  for (const entry of index.walkFiles({ skipDir: options?.skipDir })) {
+    if (entry.size <= GREP_MAX_FILE_BYTES) {
+      paths.push(entry.path);
+    }
+  }
+  paths.sort((left, right) => (left < right ? -1 : left > right ? 1 : 0));
+  return grepFiles(index.root, paths, spec, options);
+}
@@ -0,0 +1,315 @@
+/**
+ * Byte-level line matching shared by the main thread and the grep workers.
+ * It has no dependencies beyond Buffer, so a worker can load it cheaply.
+ *
+ * `grepBuffer` searches the raw file bytes with `Buffer.indexOf` and decodes
+ * only the lines that hold a hit:
+ *
+ * - a literal term is the needle itself; a case-insensitive ASCII term is
+ *   searched in a lower-cased latin1 view of the buffer;
+ * - a regex with a single top-level alternative uses its longest required
+ *   literal run as the needle, and only lines containing it are tested
+ *   against the regex (per-line semantics mean every match holds the run);
+ * - other regexes decode the file and test every line.
+ *
+ * Files with a NUL byte in their first `BINARY_SNIFF_BYTES` are skipped.
+ */
+
+export const BINARY_SNIFF_BYTES = 8000;
+export const MAX_LINE_CHARS = 1024;
+
+/** True when a NUL byte appears in the first `BINARY_SNIFF_BYTES` bytes. */
+export function looksBinary(buffer) {
+  const end = Math.min(buffer.length, BINARY_SNIFF_BYTES);
+  for (let index = 0; index < end; index += 1) {
+    if (buffer[index] === 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+function skipEscape(source, index) {
+  const kind = source[index + 1];
+  const braced = (start) => {
+    const close = source.indexOf("}", start);
+    return close === -1 ? source.length : close + 1;
+  };
+  if (kind === "x") {
+    return index + 4;
+  }
+  if (kind === "u") {
+    return source[index + 2] === "{" ? braced(index + 2) : index + 6;
+  }
+  if ((kind === "p" || kind === "P") && source[index + 2] === "{") {
+    return braced(index + 2);
+  }
+  if (kind === "k" && source[index + 2] === "<") {
+    const close = source.indexOf(">", index + 2);
+    return close === -1 ? source.length : close + 1;
+  }
+  if (kind === "c") {
+    return index + 3;
+  }
+  if (/[0-9]/.test(kind)) {
+    let end = index + 1;
+    while (end < source.length && /[0-9]/.test(source[end])) {
+      end += 1;
+    }
+    return end;
+  }
+  return index + 2;
+}
+
+function skipClass(source, index) {
+  for (let cursor = index + 1; cursor < source.length; cursor += 1) {
+    if (source[cursor] === "\\") {
+      cursor += 1;
+    } else if (source[cursor] === "]") {
+      return cursor + 1;
+    }
+  }
+  return source.length;
+}
+
+function skipGroup(source, index) {
+  let depth = 0;
+  for (let cursor = index; cursor < source.length; cursor += 1) {
+    const char = source[cursor];
+    if (char === "\\") {
+      cursor += 1;
+    } else if (char === "[") {
+      cursor = skipClass(source, cursor) - 1;
+    } else if (char === "(") {
+      depth += 1;
+    } else if (char === ")") {
+      depth -= 1;
+      if (depth === 0) {
+        return cursor + 1;
+      }
+    }
+  }
+  return source.length;
+}
+
+/** `{ min, end }` of a quantifier starting at `index`, or null. */
+function readQuantifier(source, index) {
+  const char = source[index];
+  let min = null;
+  let end = index + 1;
+  if (char === "*" || char === "?") {
+    min = 0;
+  } else if (char === "+") {
+    min = 1;
+  } else if (char === "{") {
+    const match = /^\{(\d+)(?:,\d*)?\}/.exec(source.slice(index));
+    if (!match) {
+      return null;
+    }
+    min = Number(match[1]);
+    end = index + match[0].length;
+  } else {
+    return null;
+  }
+  if (source[end] === "?") {
+    end += 1;
+  }
+  return { min, end };
+}
+
+function splitAlternatives(source) {
+  const parts = [];
+  let depth = 0;
+  let start = 0;
+  for (let cursor = 0; cursor < source.length; cursor += 1) {
+    const char = source[cursor];
+    if (char === "\\") {
+      cursor += 1;
+    } else if (char === "[") {
+      cursor = skipClass(source, cursor) - 1;
+    } else if (char === "(") {
+      depth += 1;
+    } else if (char === ")") {
+      depth -= 1;
+    } else if (char === "|" && depth === 0) {
+      parts.push(source.slice(start, cursor));
+      start = cursor + 1;
+    }
+  }
+  parts.push(source.slice(start));
+  return parts;
+}
+
+/**
+ * Literal runs that every match of one alternative must contain. Groups,
+ * classes, escapes like `\w` and optional atoms end a run; an atom repeated
+ * one or more times ends the run just after itself.
+ */
+function literalRuns(branch) {
+  const runs = [];
+  let current = "";
+  const flush = () => {
+    if (current) {
+      runs.push(current);
+    }
+    current = "";
+  };
+  let index = 0;
+  while (index < branch.length) {
+    const char = branch[index];
+    let atom = null;
+    if (char === "\\") {
+      const next = branch[index + 1] ?? "";
+      if (/[A-Za-z0-9]/.test(next)) {
+        index = skipEscape(branch, index);
+      } else {
+        atom = next;
+        index += 2;
+      }
+    } else if (char === "[") {
+      index = skipClass(branch, index);
+    } else if (char === "(") {
+      index = skipGroup(branch, index);
+    } else if (char === "." || char === "^" || char === "$") {
+      index += 1;
+    } else {
+      atom = char;
+      index += 1;
+    }
+    const quantifier = readQuantifier(branch, index);
+    if (quantifier) {
+      index = quantifier.end;
+      if (atom !== null && quantifier.min >= 1) {
+        current += atom;
+      }
+      flush();
+    } else if (atom === null) {
+      flush();
+    } else {
+      current += atom;
+    }
+  }
+  flush();
+  return runs;
+}
+
+/**
+ * The literal runs of each top-level alternative of a regex source. Every
+ * match of an alternative contains all of that alternative's runs.
+ * @param {string} source
+ * @returns {string[][]}
+ */
+export function regexLiteralRuns(source) {
+  return splitAlternatives(source).map(literalRuns);
+}
+
+const escapeRegExp = (text) => text.replace(/[.*+?^${}()|[\]\\]/g, "\\$&");
+const isAscii = (text) => /^[\x00-\x7f]*$/.test(text);
+
+/**
+ * A structured-clone-safe description of a search, checked up front: an
+ * invalid `regex` throws a SyntaxError here rather than inside a worker.
+ * @param {string} term
+ * @param {{ regex?: boolean, ignoreCase?: boolean }} [options]
+ */
+export function createGrepSpec(term, options = undefined) {
+  const spec = { term: String(term), regex: Boolean(options?.regex), ignoreCase: Boolean(options?.ignoreCase) };
+  compileGrepSpec(spec);
+  return spec;
+}
+
+const compiled = new Map();
+
+function compileGrepSpec(spec) {
+  const key = `${spec.regex ? "r" : "l"}${spec.ignoreCase ? "i" : ""}:${spec.term}`;
+  const cached = compiled.get(key);
+  if (cached) {
+    return cached;
+  }
+  let plan;
+  if (!spec.regex && (!spec.ignoreCase || isAscii(spec.term))) {
+    const needle = spec.ignoreCase ? spec.term.toLowerCase() : spec.term;
+    plan = { needle: Buffer.from(needle, "utf8"), fold: spec.ignoreCase, lineTest: null };
+  } else {
+    const source = spec.regex ? spec.term : escapeRegExp(spec.term);
+    const pattern = new RegExp(source, spec.ignoreCase ? "i" : "");
+    const branches = spec.regex ? regexLiteralRuns(source) : [[spec.term]];
+    let run = "";
+    if (branches.length === 1) {
+      for (const candidate of branches[0]) {
+        if ((!spec.ignoreCase || isAscii(candidate)) && candidate.length > run.length) {
+          run = candidate;
+        }
+      }
+    }
+    plan = {
+      needle: run ? Buffer.from(spec.ignoreCase ? run.toLowerCase() : run, "utf8") : null,
+      fold: spec.ignoreCase,
+      lineTest: (line) => pattern.test(line),
+    };
+  }
+  if (compiled.size >= 32) {
+    compiled.clear();
+  }
+  compiled.set(key, plan);
+  return plan;
+}
+
+const clip = (text) => (text.length > MAX_LINE_CHARS ? text.slice(0, MAX_LINE_CHARS) : text);
+
+/**
+ * Matching lines of one file, at most `limit`, in file order.
+ * @param {Buffer} buffer
+ * @param {{ term: string, regex: boolean, ignoreCase: boolean }} spec from `createGrepSpec`
+ * @param {number} limit
+ * @returns {{ binary: boolean, matches: Array<{ line: number, text: string }> }}
+ */
+export function grepBuffer(buffer, spec, limit) {
+  if (looksBinary(buffer)) {
+    return { binary: true, matches: [] };
+  }
+  const plan = compileGrepSpec(spec);
+  const matches = [];
+  if (!plan.needle) {
+    const lines = buffer.toString("utf8").split(/\r?\n/);
+    for (let index = 0; index < lines.length && matches.length < limit; index += 1) {
+      if (plan.lineTest(lines[index])) {
+        matches.push({ line: index + 1, text: clip(lines[index]) });
+      }
+    }
+    return { binary: false, matches };
+  }
+  if (!plan.needle.length || plan.needle.includes(10)) {
+    return { binary: false, matches };
+  }
+  // latin1 maps bytes 1:1 to UTF-16 units and lower-casing it keeps every
+  // position, so hits in the folded string are byte offsets into `buffer`.
+  const folded = plan.fold ? buffer.toString("latin1").toLowerCase() : null;
+  const needle = plan.fold ? plan.needle.toString("latin1") : plan.needle;
+  let from = 0;
+  let line = 1;
+  let counted = 0;
+  while (matches.length < limit) {
+    const hit = folded ? folded.indexOf(needle, from) : buffer.indexOf(needle, from);
+    if (hit === -1) {
+      break;
+    }
+    const start = hit === 0 ? 0 : buffer.lastIndexOf(10, hit - 1) + 1;
+    let end = buffer.indexOf(10, hit);
+    if (end === -1) {
+      end = buffer.length;
+    }
+    for (let newline = buffer.indexOf(10, counted); newline !== -1 && newline < start; ) {
+      line += 1;
+      counted = newline + 1;
+      newline = buffer.indexOf(10, counted);
+    }
+    const textEnd = end > start && buffer[end - 1] === 13 ? end - 1 : end;
+    const text = buffer.toString("utf8", start, textEnd);
+    if (!plan.lineTest || plan.lineTest(text)) {
+      matches.push({ line, text: clip(text) });
+    }
+    from = end + 1;
+  }
+  return { binary: false, matches };
+}
@@ -0,0 +1,20 @@
+import fs from "fs";
+import path from "path";
+import { parentPort } from "worker_threads";
+import { grepBuffer } from "./grep-matcher.js";
+
+/**
+ * Worker side of the grep pool (see grep-engine.js): greps one chunk of
+ * files per message and posts the per-file results back, tagged with the
+ * files' positions so the pool can emit them in path order.
+ */
+parentPort.on("message", ({ id, root, spec, limit, files }) => {
+  const results = files.map(([index, relative]) => {
+    try {
+      return { index, ...grepBuffer(fs.readFileSync(path.join(root, relative)), spec, limit) };
+    } catch {
+      return { index, binary: false, matches: [] };
+    }
+  });
+  parentPort.postMessage({ id, results });
+});
@@ -1,8 +1,12 @@
-import fs from "fs";
 import path from "path";
 import { spawnSync } from "child_process";
+import { readLastCommits } from "./git-last-commits.js";
+import { WORKSPACE_INDEX_DIRNAME, getWorkspaceIndex } from "./workspace-index.js";
 
-const IGNORED_DIRS = new Set(["history-notes"]);
+// Snapshots skip their own output and the workspace index cache.
+const IGNORED_DIRS = new Set(["history-notes", WORKSPACE_INDEX_DIRNAME]);
+// Last-commit map for the snapshot tree, reused while HEAD does not move.
+const GIT_COMMITS_CACHE_FILE = path.join(WORKSPACE_INDEX_DIRNAME, "git-last-commits.json");
 
 export default class HistoryNotesManager {
   constructor(memory) {
@@ -59,47 +63,27 @@ export default class HistoryNotesManager {
   async _collectEntries(baseDir, includeGit) {
     const entries = [];
     const gitAvailable = includeGit && this._ensureGitReady();
-    const stack = [""];
-
-    while (stack.length) {
-      const relativeDir = stack.pop();
-      const absoluteDir = path.join(baseDir, relativeDir);
-      let dirents;
-      try {
-        dirents = await fs.promises.readdir(absoluteDir, { withFileTypes: true });
-      } catch {
-        continue;
-      }
-      for (const dirent of dirents) {
-        const relPath = path.join(relativeDir, dirent.name);
-        if (IGNORED_DIRS.has(dirent.name)) {
-          continue;
-        }
-        const absolutePath = path.join(baseDir, relPath);
-        if (dirent.isDirectory()) {
-          stack.push(relPath);
-          continue;
-        }
-        if (!dirent.isFile()) {
-          continue;
-        }
-        let stats;
-        try {
-          stats = await fs.promises.stat(absolutePath);
-        } catch {
-          continue;
-        }
-        const entry = {
-          path: relPath.replace(/\\/g, "/"),
-          size: stats.size,
-          lastModified: stats.mtime.toISOString(),
-          lastModifiedMs: stats.mtimeMs,
-        };
-        if (gitAvailable) {
-          entry.git = this._readGitInfo(absolutePath);
-        }
-        entries.push(entry);
+    const index = await getWorkspaceIndex(baseDir, {
+      ignoredDirs: IGNORED_DIRS,
+      skipDotDirs: false,
+      // Notes cover every MiniPhi artifact, including ones a repo ignores.
+      ignoreFiles: [],
+    }).ensureFresh();
+    const gitCommits = gitAvailable ? await this._readGitCommits(baseDir) : null;
+
+    for (const file of index.walkFiles()) {
+      const entry = {
+        path: file.path,
+        size: file.size,
+        lastModified: new Date(file.mtimeMs).toISOString(),
+        lastModifiedMs: file.mtimeMs,
+      };
+      if (gitAvailable) {
+        entry.git = gitCommits
+          ? gitCommits.get(file.path) ?? { hash: null, committedAt: null, author: null }
+          : null;
       }
+      entries.push(entry);
     }
 
     entries.sort((a, b) => a.path.localeCompare(b.path));
@@ -165,25 +149,12 @@ export default class HistoryNotesManager {
     return this.gitStatus.available;
   }
 
-  _readGitInfo(absolutePath) {
-    if (!this.gitStatus.available) {
-      return null;
-    }
+  async _readGitCommits(baseDir) {
     try {
-      const result = spawnSync(
-        "git",
-        ["-C", this.memory.projectRoot, "log", "-1", "--pretty=format:%H|%cI|%cn", "--", absolutePath],
-        { encoding: "utf8" },
-      );
-      if (result.status !== 0) {
-        return null;
-      }
-      const [hash, committedAt, author] = result.stdout.trim().split("|");
-      return {
-        hash: hash || null,
-        committedAt: committedAt || null,
-        author: author || null,
-      };
+      const { commits } = await readLastCommits(baseDir, {
+        cacheFile: path.join(baseDir, GIT_COMMITS_CACHE_FILE),
+      });
+      return commits;
     } catch {
       return null;
     }
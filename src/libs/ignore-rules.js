@@ -0,0 +1,180 @@
+/**
+ * `.gitignore`-style rules for workspace traversal. Every `.gitignore` and
+ * `.miniphiignore` met while walking a tree is compiled once and applied to
+ * the entries of its directory and everything below it, so the walkers never
+ * open an ignored subtree.
+ *
+ * Supported syntax is git's: comments and blank lines, `!` negation, a
+ * trailing `/` for directories only, patterns anchored by a leading or inner
+ * `/`, and `*`, `?`, `[...]` and `**`. As in git, the last matching rule
+ * wins and a deeper file overrides a shallower one; `.miniphiignore` is read
+ * after `.gitignore` of the same directory, so it can override it.
+ *
+ * Rules that are a plain name (`generated`, `vendor/`) are kept in a map and
+ * found with one lookup per entry; only real globs are tested as regexes.
+ */
+
+export const IGNORE_FILE_NAMES = [".gitignore", ".miniphiignore"];
+
+const GLOB_CHARS = /[*?[\\]/;
+
+function globToRegexSource(glob) {
+  let source = "";
+  for (let index = 0; index < glob.length; index += 1) {
+    const char = glob[index];
+    if (char === "*") {
+      if (glob[index + 1] === "*") {
+        const atStart = index === 0 || glob[index - 1] === "/";
+        const atEnd = index + 2 === glob.length || glob[index + 2] === "/";
+        if (atStart && atEnd) {
+          // "**/" matches zero or more directories; a trailing "**" matches everything below.
+          source += index + 2 === glob.length ? ".*" : "(?:.*/)?";
+          index += 2;
+          continue;
+        }
+      }
+      source += "[^/]*";
+      while (glob[index + 1] === "*") {
+        index += 1;
+      }
+    } else if (char === "?") {
+      source += "[^/]";
+    } else if (char === "[") {
+      const close = glob.indexOf("]", index + 2);
+      if (close === -1) {
+        source += "\\[";
+        continue;
+      }
+      let body = glob.slice(index + 1, close);
+      if (body.startsWith("!")) {
+        body = `^${body.slice(1)}`;
+      }
+      source += `[${body.replace(/\\/g, "\\\\")}]`;
+      index = close;
+    } else if (char === "\\" && index + 1 < glob.length) {
+      index += 1;
+      source += glob[index].replace(/[.*+?^${}()|[\]\\/]/g, "\\$&");
+    } else {
+      source += char.replace(/[.*+?^${}()|[\]\\/]/g, "\\$&");
+    }
+  }
+  return source;
+}
+
+/**
+ * Compiles the text of one ignore file.
+ * @param {string} text
+ * @returns {{ names: Map<string, Array<{ order: number, negate: boolean, dirOnly: boolean }>>, globs: Array<{ order: number, negate: boolean, dirOnly: boolean, anchored: boolean, regex: RegExp }> }}
+ */
+export function compileIgnoreRules(text) {
+  const names = new Map();
+  const globs = [];
+  let order = 0;
+  for (const rawLine of String(text ?? "").split(/\r?\n/)) {
+    let line = rawLine.replace(/(?<!\\)\s+$/, "");
+    if (!line || line.startsWith("#")) {
+      continue;
+    }
+    let negate = false;
+    if (line.startsWith("!")) {
+      negate = true;
+      line = line.slice(1);
+    } else if (line.startsWith("\\!") || line.startsWith("\\#")) {
+      line = line.slice(1);
+    }
+    let dirOnly = false;
+    if (line.endsWith("/") && !line.endsWith("\\/")) {
+      dirOnly = true;
+      line = line.replace(/\/+$/, "");
+    }
+    if (!line) {
+      continue;
+    }
+    const anchored = line.includes("/");
+    line = line.replace(/^\//, "");
+    order += 1;
+    if (!anchored && !GLOB_CHARS.test(line)) {
+      const rules = names.get(line) ?? [];
+      rules.push({ order, negate, dirOnly });
+      names.set(line, rules);
+      continue;
+    }
+    globs.push({ order, negate, dirOnly, anchored, regex: new RegExp(`^${globToRegexSource(line)}$`) });
+  }
+  return { names, globs };
+}
+
+/** "ignore", "include" or null (no rule of this file matches). */
+function decide(compiled, relative, name, isDir) {
+  let best = null;
+  for (const rule of compiled.names.get(name) ?? []) {
+    if ((!rule.dirOnly || isDir) && (!best || rule.order > best.order)) {
+      best = rule;
+    }
+  }
+  for (let index = compiled.globs.length - 1; index >= 0; index -= 1) {
+    const rule = compiled.globs[index];
+    if (best && rule.order < best.order) {
+      break;
+    }
+    if ((!rule.dirOnly || isDir) && rule.regex.test(rule.anchored ? relative : name)) {
+      best = rule;
+      break;
+    }
+  }
+  if (!best) {
+    return null;
+  }
+  return best.negate ? "include" : "ignore";
+}
+
+export class IgnoreRules {
+  constructor() {
+    /** @type {Map<string, Array<ReturnType<typeof compileIgnoreRules>>>} directory -> compiled files, in read order */
+    this.byDir = new Map();
+  }
+
+  get size() {
+    return this.byDir.size;
+  }
+
+  /** Adds the rules of an ignore file found in directory `dirRel` ("" for the root). */
+  add(dirRel, text) {
+    const compiled = compileIgnoreRules(text);
+    if (!compiled.names.size && !compiled.globs.length) {
+      return;
+    }
+    const list = this.byDir.get(dirRel) ?? [];
+    list.push(compiled);
+    this.byDir.set(dirRel, list);
+  }
+
+  /**
+   * Whether the entry `relative` (POSIX, from the root) is ignored by the
+   * rules of its ancestors. Its ancestors' own status is not checked: a
+   * traversal never reaches the entries of an ignored directory.
+   */
+  ignores(relative, isDir) {
+    if (!this.byDir.size) {
+      return false;
+    }
+    const name = relative.slice(relative.lastIndexOf("/") + 1);
+    let dir = relative.includes("/") ? relative.slice(0, relative.lastIndexOf("/")) : "";
+    for (;;) {
+      const compiledFiles = this.byDir.get(dir);
+      if (compiledFiles) {
+        const local = dir ? relative.slice(dir.length + 1) : relative;
+        for (let index = compiledFiles.length - 1; index >= 0; index -= 1) {
+          const verdict = decide(compiledFiles[index], local, name, isDir);
+          if (verdict) {
+            return verdict === "ignore";
+          }
+        }
+      }
+      if (!dir) {
+        return false;
+      }
+      dir = dir.includes("/") ? dir.slice(0, dir.lastIndexOf("/")) : "";
+    }
+  }
+}
@@ -0,0 +1,301 @@
+import fs from "fs";
+import path from "path";
+import { writeFileAtomic } from "./atomic-file.js";
+
+/**
+ * Paged reads of MiniPhi's list indexes (`{ entries: [...] }` documents).
+ *
+ * Workspace snapshots only render a handful of entries from each index, but
+ * the loaders used to read and parse every file in full. A registered index
+ * now gets a small sidecar, `<name>.head.json`, written by JsonIndexStore on
+ * every commit:
+ *
+ * - `views` holds the first `headSize` entries in stored order and in each
+ *   registered sort order (`time`, `score`, ...), newest/highest first, as
+ *   positions into a deduplicated `rows` array;
+ * - `total` and the document's scalar fields (`updatedAt`, `summary`, ...)
+ *   answer "how many / when" without the entries;
+ * - `source` is the inode/size/mtime of the index the head was built from. A
+ *   head whose stamp does not match the index on disk (another writer, an
+ *   older MiniPhi) is ignored, so a stale head can never be served.
+ *
+ * `queryIndexPage` serves `limit`/`offset` (or an opaque `cursor`) windows from
+ * the head when it covers them and falls back to the full file otherwise,
+ * rebuilding the head on the way.
+ */
+
+export const DEFAULT_HEAD_SIZE = 32;
+export const HEAD_SUFFIX = ".head.json";
+export const STORED_ORDER = "stored";
+
+const HEAD_VERSION = 1;
+
+/** @type {Map<string, { headSize: number, orders: Record<string, (entry: any) => number> }>} */
+const registry = new Map();
+
+export function headPathFor(filePath) {
+  const resolved = path.resolve(filePath);
+  return `${resolved.replace(/\.json$/i, "")}${HEAD_SUFFIX}`;
+}
+
+/**
+ * Opts an index into head sidecars. `orders` maps a view name to a numeric
+ * sort key; views are sorted by it descending, ties kept in stored order.
+ * @param {string} filePath
+ * @param {{ headSize?: number, orders?: Record<string, (entry: any) => number> }} [options]
+ */
+export function registerPagedIndex(filePath, options = undefined) {
+  const headSize = Number(options?.headSize);
+  registry.set(path.resolve(filePath), {
+    headSize: Number.isFinite(headSize) && headSize >= 0 ? Math.floor(headSize) : DEFAULT_HEAD_SIZE,
+    orders: { ...(options?.orders ?? {}) },
+  });
+}
+
+export function isPagedIndex(filePath) {
+  return Boolean(filePath) && registry.has(path.resolve(filePath));
+}
+
+const sortKey = (fn, entry) => {
+  try {
+    const value = Number(fn(entry));
+    return Number.isFinite(value) ? value : Number.NEGATIVE_INFINITY;
+  } catch {
+    return Number.NEGATIVE_INFINITY;
+  }
+};
+
+function orderEntries(entries, order, config) {
+  const fn = order && order !== STORED_ORDER ? config?.orders?.[order] : null;
+  const positions = entries.map((_, position) => position);
+  if (!fn) {
+    return positions;
+  }
+  const keys = entries.map((entry) => sortKey(fn, entry));
+  return positions.sort((left, right) => keys[right] - keys[left] || left - right);
+}
+
+function scalarFields(doc) {
+  const meta = {};
+  for (const [key, value] of Object.entries(doc ?? {})) {
+    if (value === null || ["string", "number", "boolean"].includes(typeof value)) {
+      meta[key] = value;
+    }
+  }
+  return meta;
+}
+
+/**
+ * Builds the head for `doc` under `filePath`'s registration, or null when the
+ * index is not registered. Rows are copied, so `doc` may change afterwards.
+ */
+export function buildIndexHead(filePath, doc) {
+  const config = registry.get(path.resolve(filePath));
+  if (!config || !doc || typeof doc !== "object") {
+    return null;
+  }
+  const entries = Array.isArray(doc.entries) ? doc.entries : null;
+  const head = {
+    version: HEAD_VERSION,
+    source: null,
+    total: entries ? entries.length : null,
+    meta: scalarFields(doc),
+    rows: [],
+    views: {},
+  };
+  if (!entries) {
+    return head;
+  }
+  const rowOf = new Map();
+  for (const order of [STORED_ORDER, ...Object.keys(config.orders)]) {
+    head.views[order] = orderEntries(entries, order, config)
+      .slice(0, config.headSize)
+      .map((position) => {
+        if (!rowOf.has(position)) {
+          rowOf.set(position, head.rows.length);
+          head.rows.push(structuredClone(entries[position]));
+        }
+        return rowOf.get(position);
+      });
+  }
+  return head;
+}
+
+const stampOf = (stat) => (stat ? { ino: stat.ino, size: stat.size, mtimeMs: stat.mtimeMs } : null);
+
+const sameSource = (left, right) =>
+  Boolean(left && right && left.ino === right.ino && left.size === right.size && left.mtimeMs === right.mtimeMs);
+
+/** Writes a head built by `buildIndexHead` for the index version `stamp` describes. */
+export async function writeIndexHead(filePath, head, stamp) {
+  if (!head || !stamp) {
+    return;
+  }
+  await writeFileAtomic(headPathFor(filePath), JSON.stringify({ ...head, source: stampOf(stamp) }));
+}
+
+/** The head of `filePath` when it matches the index on disk, else null. */
+export async function readIndexHead(filePath) {
+  if (!isPagedIndex(filePath)) {
+    return null;
+  }
+  try {
+    const [stat, raw] = await Promise.all([
+      fs.promises.stat(filePath),
+      fs.promises.readFile(headPathFor(filePath), "utf8"),
+    ]);
+    const head = JSON.parse(raw);
+    if (head?.version !== HEAD_VERSION || !sameSource(head.source, stampOf(stat))) {
+      return null;
+    }
+    return head;
+  } catch {
+    return null;
+  }
+}
+
+/** Reads the full index and, when it did not change underneath, refreshes its head. */
+async function readFullIndex(filePath, fallback) {
+  let before = null;
+  let doc = null;
+  try {
+    before = await fs.promises.stat(filePath);
+    doc = JSON.parse(await fs.promises.readFile(filePath, "utf8"));
+  } catch {
+    return fallback;
+  }
+  const head = buildIndexHead(filePath, doc);
+  if (head) {
+    try {
+      const after = await fs.promises.stat(filePath);
+      if (sameSource(stampOf(before), stampOf(after))) {
+        await writeIndexHead(filePath, head, after);
+      }
+    } catch {
+      // best effort; the next commit writes a head anyway
+    }
+  }
+  return doc && typeof doc === "object" ? doc : fallback;
+}
+
+export function encodeIndexCursor(order, offset) {
+  return Buffer.from(JSON.stringify({ order, offset }), "utf8").toString("base64url");
+}
+
+export function decodeIndexCursor(cursor) {
+  if (typeof cursor !== "string" || !cursor) {
+    return null;
+  }
+  try {
+    const parsed = JSON.parse(Buffer.from(cursor, "base64url").toString("utf8"));
+    return Number.isInteger(parsed?.offset) && parsed.offset >= 0 ? parsed : null;
+  } catch {
+    return null;
+  }
+}
+
+/**
+ * One page of an index's entries.
+ *
+ * @param {string} filePath
+ * @param {{
+ *   limit?: number,
+ *   offset?: number,
+ *   cursor?: string,
+ *   order?: string,
+ *   filter?: (entry: any) => boolean,
+ *   fallback?: object,
+ *   store?: { has(file: string): boolean, read(file: string, fallback?: object): Promise<object> },
+ * }} [options] `order` names a registered view (`"stored"` by default);
+ *   `store` is consulted first when it already holds the index in memory.
+ * @returns {Promise<{ entries: any[], total: number, nextCursor: string | null, meta: Record<string, any>, source: "memory" | "head" | "file" }>}
+ *   `total` is the size of the whole index, before `filter`; `nextCursor` is
+ *   null once the index is exhausted.
+ */
+export async function queryIndexPage(filePath, options = undefined) {
+  const limitRaw = Number(options?.limit);
+  const limit = Number.isFinite(limitRaw) && limitRaw > 0 ? Math.floor(limitRaw) : 20;
+  const order = typeof options?.order === "string" && options.order ? options.order : STORED_ORDER;
+  const cursor = decodeIndexCursor(options?.cursor);
+  const offsetRaw = Number(options?.offset);
+  const offset =
+    cursor && cursor.order === order
+      ? cursor.offset
+      : Number.isFinite(offsetRaw) && offsetRaw > 0
+        ? Math.floor(offsetRaw)
+        : 0;
+  const filter = typeof options?.filter === "function" ? options.filter : () => true;
+  const wanted = offset + limit;
+  const page = (matched, total, meta, source, exhausted) => {
+    const entries = matched.slice(offset, wanted);
+    const more = !exhausted || matched.length > wanted;
+    return {
+      entries,
+      total,
+      nextCursor: more && entries.length ? encodeIndexCursor(order, offset + entries.length) : null,
+      meta,
+      source,
+    };
+  };
+
+  if (!options?.store?.has(filePath)) {
+    const head = await readIndexHead(filePath);
+    const view = head?.views?.[order];
+    if (head && Array.isArray(view)) {
+      const matched = [];
+      for (const row of view) {
+        const entry = head.rows[row];
+        if (entry && filter(entry)) {
+          matched.push(entry);
+        }
+      }
+      const complete = view.length >= (head.total ?? 0);
+      if (complete || matched.length > wanted) {
+        return page(matched, head.total ?? 0, head.meta ?? {}, "head", complete);
+      }
+    } else if (head && head.total === null) {
+      return page([], 0, head.meta ?? {}, "head", true);
+    }
+  }
+
+  const fallback = options?.fallback ?? { entries: [] };
+  const inMemory = Boolean(options?.store?.has(filePath));
+  const doc = inMemory
+    ? await options.store.read(filePath, fallback)
+    : await readFullIndex(filePath, fallback);
+  const entries = Array.isArray(doc?.entries) ? doc.entries : [];
+  const config = registry.get(path.resolve(filePath));
+  const matched = [];
+  for (const position of orderEntries(entries, order, config)) {
+    const entry = entries[position];
+    if (entry && filter(entry)) {
+      matched.push(entry);
+    }
+  }
+  return page(matched, entries.length, scalarFields(doc), inMemory ? "memory" : "file", true);
+}
+
+/**
+ * `{ total, meta }` of an index — its entry count and scalar fields — from the
+ * head when it is current, else from the file.
+ */
+export async function summarizeIndex(filePath, options = undefined) {
+  if (!options?.store?.has(filePath)) {
+    const head = await readIndexHead(filePath);
+    if (head) {
+      return { total: head.total, meta: head.meta ?? {} };
+    }
+  }
+  const doc = options?.store?.has(filePath)
+    ? await options.store.read(filePath, null)
+    : isPagedIndex(filePath)
+      ? await readFullIndex(filePath, null)
+      : await fs.promises
+          .readFile(filePath, "utf8")
+          .then((raw) => JSON.parse(raw))
+          .catch(() => null);
+  if (!doc || typeof doc !== "object") {
+    return null;
+  }
+  return { total: Array.isArray(doc.entries) ? doc.entries.length : null, meta: scalarFields(doc) };
+}
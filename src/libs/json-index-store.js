@@ -0,0 +1,408 @@
+import fs from "fs";
+import path from "path";
+import {
+  DEFAULT_LOCK_STALE_MS,
+  acquireFileLock,
+  quarantineCorruptFile,
+  tryAcquireFileLockSync,
+} from "./atomic-file.js";
+import { buildIndexHead, writeIndexHead } from "./index-pages.js";
+
+/**
+ * Single-writer manager for the small JSON indexes under `.miniphi/`
+ * (`indices/*.json`, `prompt-exchanges/index.json`, the root index, ...).
+ *
+ * The old path re-read, re-parsed, filtered and re-wrote a whole index for
+ * every upsert, and MiniPhiMemory issues several per execution — each one also
+ * followed by a root-index rewrite. Here each index is loaded once per process
+ * and kept in memory:
+ *
+ * - **Upserts are O(1) by id.** Entries live in a Map in recency order; the
+ *   `entries` array is only materialized when the file is written or read.
+ * - **Commits are coalesced.** Mutations mark the index dirty and one atomic
+ *   temp+rename write lands after `flushDelayMs`, however many upserts came in
+ *   between. Callers that need the writes on disk before they continue (the
+ *   memory stores, once per record; `main()` when a command ends) `flush`;
+ *   concurrent flushes still share one commit. A process `exit` hook writes anything
+ *   still pending synchronously, so a CLI run that ends with `process.exit()`
+ *   loses nothing. Pending operations stay queued until their commit's rename
+ *   lands, so a failed write is retried by the next commit.
+ * - **Other writers are noticed.** Before committing, the file's inode, size
+ *   and mtime are compared with what this process last saw; if another process
+ *   wrote it, the index is re-read and this process's pending operations are
+ *   replayed on top.
+ *   With `lock: true` — the shared store's default; `MINIPHI_INDEX_LOCK=0`
+ *   turns it off — that check-replay-write runs under the advisory
+ *   `<file>.lock` from atomic-file.js, so concurrent MiniPhi processes cannot
+ *   interleave; a dead holder's lock is broken.
+ * - **Registered list indexes get a head.** After the commit, indexes opted
+ *   in through index-pages.js also get their small `<name>.head.json`
+ *   sidecar, so paged readers need not parse the whole file.
+ * - **Corrupt files are kept.** An index that exists but does not parse is
+ *   copied aside (`<file>.corrupt-<stamp>`) before the fallback replaces it.
+ */
+
+const DEFAULT_FLUSH_DELAY_MS = 50;
+const DEFAULT_LIMIT = 200;
+
+const isFalsy = (value) =>
+  ["0", "false", "no", "off"].includes(String(value ?? "").trim().toLowerCase());
+
+const clone = (value) => (value === undefined ? undefined : structuredClone(value));
+
+// Every commit is a temp+rename, so the inode changes on each write even when
+// size and a coarse mtime do not.
+const sameStamp = (left, right) =>
+  (left === null && right === null) ||
+  Boolean(
+    left &&
+      right &&
+      left.ino === right.ino &&
+      left.size === right.size &&
+      left.mtimeMs === right.mtimeMs,
+  );
+
+const toStamp = (stat) =>
+  stat ? { ino: stat.ino, size: stat.size, mtimeMs: stat.mtimeMs } : null;
+
+export class JsonIndexStore {
+  constructor(options = undefined) {
+    this.flushDelayMs = Number.isFinite(options?.flushDelayMs)
+      ? Math.max(0, Number(options.flushDelayMs))
+      : DEFAULT_FLUSH_DELAY_MS;
+    this.lock = Boolean(options?.lock);
+    this.lockStaleMs = Number.isFinite(options?.lockStaleMs)
+      ? Number(options.lockStaleMs)
+      : DEFAULT_LOCK_STALE_MS;
+    /** @type {Map<string, object>} absolute path -> index state */
+    this._states = new Map();
+    this.stats = { upserts: 0, updates: 0, commits: 0, rebases: 0 };
+  }
+
+  /** True when this process holds `filePath` in memory. */
+  has(filePath) {
+    return this._states.has(path.resolve(filePath));
+  }
+
+  async _state(filePath, fallback) {
+    const key = path.resolve(filePath);
+    let state = this._states.get(key);
+    if (!state) {
+      state = {
+        path: key,
+        fallback: clone(fallback ?? { entries: [] }),
+        doc: null,
+        keyed: null,
+        pending: [],
+        stamp: null,
+        timer: null,
+        chain: Promise.resolve(),
+        ready: null,
+      };
+      state.ready = this._load(state);
+      this._states.set(key, state);
+    }
+    await state.ready;
+    return state;
+  }
+
+  async _load(state) {
+    let stat = null;
+    let doc = null;
+    try {
+      stat = await fs.promises.stat(state.path);
+      doc = JSON.parse(await fs.promises.readFile(state.path, "utf8"));
+    } catch {
+      if (stat?.size) {
+        await quarantineCorruptFile(state.path);
+      }
+      doc = null;
+    }
+    state.doc = doc && typeof doc === "object" ? doc : clone(state.fallback);
+    state.stamp = toStamp(stat);
+  }
+
+  /**
+   * The recency-ordered id map behind `entries` (oldest first, so the newest
+   * is always the last insertion). Built lazily, dropped by whole-doc updates.
+   */
+  _keyed(state, idKey, limit) {
+    if (!state.keyed || state.keyed.idKey !== idKey) {
+      this._materialize(state);
+      const map = new Map();
+      const entries = Array.isArray(state.doc.entries) ? state.doc.entries : [];
+      for (let index = entries.length - 1; index >= 0; index -= 1) {
+        const entry = entries[index];
+        if (!entry) {
+          continue;
+        }
+        const id = Object.prototype.hasOwnProperty.call(entry, idKey) ? entry[idKey] : null;
+        const key = id ? id : Symbol("entry");
+        map.delete(key);
+        map.set(key, entry);
+      }
+      state.keyed = { idKey, limit, map };
+    }
+    state.keyed.limit = limit;
+    return state.keyed;
+  }
+
+  _materialize(state) {
+    if (state.keyed) {
+      state.doc.entries = [...state.keyed.map.values()].reverse();
+    }
+    return state.doc;
+  }
+
+  _applyUpsert(state, entry, options) {
+    const idKey = typeof options?.idKey === "string" && options.idKey.trim() ? options.idKey : "id";
+    const limitRaw = Number(options?.limit);
+    const limit = Number.isFinite(limitRaw) && limitRaw > 0 ? Math.floor(limitRaw) : DEFAULT_LIMIT;
+    const { map } = this._keyed(state, idKey, limit);
+    if (entry) {
+      const id = Object.prototype.hasOwnProperty.call(entry, idKey) ? entry[idKey] : null;
+      const key = id ? id : Symbol("entry");
+      map.delete(key);
+      map.set(key, entry);
+    }
+    while (map.size > limit) {
+      map.delete(map.keys().next().value);
+    }
+    if (options?.setUpdatedAt !== false) {
+      state.doc.updatedAt = options?.updatedAt ?? new Date().toISOString();
+    }
+  }
+
+  _applyUpdate(state, mutate) {
+    const doc = this._materialize(state);
+    state.keyed = null;
+    const next = mutate(doc);
+    if (next && typeof next === "object") {
+      state.doc = next;
+    }
+  }
+
+  _apply(state, op) {
+    if (op.type === "upsert") {
+      this._applyUpsert(state, op.entry, op.options);
+    } else {
+      this._applyUpdate(state, op.mutate);
+    }
+  }
+
+  _push(state, op) {
+    this._apply(state, op);
+    state.pending.push(op);
+    this._schedule(state);
+  }
+
+  /** A deep copy of the index as this process currently sees it. */
+  async read(filePath, fallback = undefined) {
+    const state = await this._state(filePath, fallback);
+    return clone(this._materialize(state));
+  }
+
+  /**
+   * `upsertIndexEntry` semantics — newest first, one entry per id, capped at
+   * `limit` — against the in-memory index. Returns the entry count; nothing
+   * is materialized until the next read or commit.
+   */
+  async upsert(filePath, entry, options = undefined) {
+    if (!filePath) {
+      return null;
+    }
+    const state = await this._state(filePath, options?.fallback);
+    this._push(state, { type: "upsert", entry: clone(entry), options: { ...(options ?? {}) } });
+    this.stats.upserts += 1;
+    return state.keyed.map.size;
+  }
+
+  /**
+   * Applies `mutate(doc)` (which may edit in place or return a replacement).
+   * `mutate` must be replayable: after another process's write it runs again
+   * against the freshly read index.
+   */
+  async update(filePath, mutate, options = undefined) {
+    const state = await this._state(filePath, options?.fallback);
+    this._push(state, { type: "update", mutate });
+    this.stats.updates += 1;
+    return this._materialize(state);
+  }
+
+  /** Replaces the whole document. */
+  async write(filePath, data) {
+    const snapshot = clone(data);
+    return this.update(filePath, () => clone(snapshot));
+  }
+
+  _schedule(state) {
+    if (state.timer) {
+      return;
+    }
+    // Deliberately not unref'd: a normally exiting process still commits.
+    state.timer = setTimeout(() => {
+      state.timer = null;
+      this._enqueue(state).catch(() => {});
+    }, this.flushDelayMs);
+  }
+
+  _enqueue(state) {
+    state.chain = state.chain.catch(() => {}).then(() => this._commit(state));
+    return state.chain;
+  }
+
+  /** Commits every pending index (or just `filePath`) and waits for the writes. */
+  async flush(filePath = undefined) {
+    const states = filePath
+      ? [this._states.get(path.resolve(filePath))].filter(Boolean)
+      : [...this._states.values()];
+    await Promise.all(
+      states.map(async (state) => {
+        await state.ready;
+        if (state.timer) {
+          clearTimeout(state.timer);
+          state.timer = null;
+        }
+        return this._enqueue(state);
+      }),
+    );
+  }
+
+  /** Drops cached state (after flushing), e.g. before a test removes the directory. */
+  async close() {
+    await this.flush();
+    this._states.clear();
+  }
+
+  _rebase(state, disk) {
+    state.doc = disk && typeof disk === "object" ? disk : clone(state.fallback);
+    state.keyed = null;
+    for (const op of state.pending) {
+      this._apply(state, op);
+    }
+    this.stats.rebases += 1;
+  }
+
+  async _commit(state) {
+    if (!state.pending.length) {
+      return;
+    }
+    const release = this.lock
+      ? await acquireFileLock(state.path, { staleMs: this.lockStaleMs })
+      : null;
+    try {
+      let stat = null;
+      try {
+        stat = await fs.promises.stat(state.path);
+      } catch {
+        stat = null;
+      }
+      if (!sameStamp(toStamp(stat), state.stamp)) {
+        let disk = null;
+        try {
+          disk = JSON.parse(await fs.promises.readFile(state.path, "utf8"));
+        } catch {
+          if (stat?.size) {
+            await quarantineCorruptFile(state.path);
+          }
+          disk = null;
+        }
+        this._rebase(state, disk);
+      }
+      // Serialize and count `pending` in one synchronous step: anything that
+      // arrives while the write is in flight belongs to the next commit. The
+      // counted operations leave the queue only once the rename has landed; if
+      // the write fails they are replayed by the next commit.
+      const doc = this._materialize(state);
+      const text = JSON.stringify(doc, null, 2);
+      const head = buildIndexHead(state.path, doc);
+      const committed = state.pending.length;
+      await fs.promises.mkdir(path.dirname(state.path), { recursive: true });
+      const tempFile = `${state.path}.${process.pid}.tmp`;
+      let written;
+      try {
+        await fs.promises.writeFile(tempFile, text, "utf8");
+        written = await fs.promises.stat(tempFile);
+        await fs.promises.rename(tempFile, state.path);
+      } catch (error) {
+        await fs.promises.rm(tempFile, { force: true }).catch(() => {});
+        throw error;
+      }
+      state.pending.splice(0, committed);
+      state.stamp = toStamp(await fs.promises.stat(state.path));
+      this.stats.commits += 1;
+      // Only describe the file if it is still the one just written.
+      if (head && state.stamp?.ino === written.ino) {
+        await writeIndexHead(state.path, head, state.stamp).catch(() => {});
+      }
+    } finally {
+      await release?.();
+    }
+  }
+
+  /**
+   * Synchronous last-chance commit for the process `exit` hook. With locking
+   * on, an index whose lock another process holds is skipped: writing it
+   * without the lock could overwrite that process's commit in progress.
+   */
+  flushSync() {
+    for (const state of this._states.values()) {
+      if (!state.pending.length || !state.doc) {
+        continue;
+      }
+      const release = this.lock ? tryAcquireFileLockSync(state.path) : null;
+      if (this.lock && !release) {
+        continue;
+      }
+      try {
+        let stat = null;
+        try {
+          stat = fs.statSync(state.path);
+        } catch {
+          stat = null;
+        }
+        if (!sameStamp(toStamp(stat), state.stamp)) {
+          let disk = null;
+          try {
+            disk = JSON.parse(fs.readFileSync(state.path, "utf8"));
+          } catch {
+            disk = null;
+          }
+          this._rebase(state, disk);
+        }
+        const tempFile = `${state.path}.${process.pid}.exit.tmp`;
+        fs.mkdirSync(path.dirname(state.path), { recursive: true });
+        fs.writeFileSync(tempFile, JSON.stringify(this._materialize(state), null, 2), "utf8");
+        fs.renameSync(tempFile, state.path);
+        state.pending = [];
+      } catch {
+        // Exit hooks cannot report; the previous committed index stays intact.
+      } finally {
+        release?.();
+      }
+    }
+  }
+}
+
+let sharedStore = null;
+
+/**
+ * The process-wide store every MiniPhi writer shares, so two components
+ * touching the same index never hold diverging copies.
+ */
+export function getJsonIndexStore() {
+  if (!sharedStore) {
+    sharedStore = new JsonIndexStore({
+      lock: !isFalsy(process.env.MINIPHI_INDEX_LOCK),
+      flushDelayMs: Number(process.env.MINIPHI_INDEX_FLUSH_MS ?? Number.NaN),
+    });
+    const store = sharedStore;
+    process.once("exit", () => store.flushSync());
+  }
+  return sharedStore;
+}
+
+/** Flushes the shared store, if one was ever created. */
+export async function flushJsonIndexes() {
+  await sharedStore?.flush();
+}
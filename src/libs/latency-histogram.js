@@ -0,0 +1,116 @@
+/**
+ * Fixed-bucket latency histogram for in-process instrumentation. Recording is
+ * one bucket search and two additions, so it is cheap enough to wrap hot
+ * paths (prompt tracking, index commits) unconditionally. Quantiles are
+ * bucket upper bounds — coarse, but stable and mergeable across runs.
+ */
+
+export const DEFAULT_LATENCY_BOUNDS_MS = [
+  0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000,
+];
+
+/**
+ * Log-spaced bucket bounds from `minMs` to `maxMs`, each `ratio` times the
+ * previous one; ratio 1.1 keeps quantiles within ~5% of the true value.
+ */
+export function buildLogBounds(minMs, maxMs, ratio = 1.1) {
+  const bounds = [];
+  for (let bound = minMs; bound < maxMs; bound *= ratio) {
+    bounds.push(Number(bound.toPrecision(4)));
+  }
+  bounds.push(maxMs);
+  return bounds;
+}
+
+export default class LatencyHistogram {
+  /**
+   * @param {number[]} [boundsMs] Ascending bucket upper bounds in milliseconds.
+   */
+  constructor(boundsMs = DEFAULT_LATENCY_BOUNDS_MS) {
+    this.boundsMs = boundsMs;
+    this.counts = new Array(boundsMs.length + 1).fill(0);
+    this.count = 0;
+    this.sumMs = 0;
+    this.maxMs = 0;
+  }
+
+  record(durationMs) {
+    if (!Number.isFinite(durationMs) || durationMs < 0) {
+      return;
+    }
+    // First bound >= durationMs; the overflow bucket sits past the last bound.
+    let low = 0;
+    let high = this.boundsMs.length;
+    while (low < high) {
+      const mid = (low + high) >> 1;
+      if (this.boundsMs[mid] < durationMs) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    const bucket = low;
+    this.counts[bucket] += 1;
+    this.count += 1;
+    this.sumMs += durationMs;
+    if (durationMs > this.maxMs) {
+      this.maxMs = durationMs;
+    }
+  }
+
+  /** Adds sparse `{ bucketIndex: count }` counts (see `sparseCounts`) recorded with the same bounds. */
+  mergeSparse(counts, { sumMs = 0, maxMs = 0 } = {}) {
+    for (const [bucket, count] of Object.entries(counts ?? {})) {
+      const index = Number(bucket);
+      if (Number.isInteger(index) && index >= 0 && index < this.counts.length && count > 0) {
+        this.counts[index] += count;
+        this.count += count;
+      }
+    }
+    this.sumMs += sumMs;
+    this.maxMs = Math.max(this.maxMs, maxMs);
+    return this;
+  }
+
+  /** Non-empty buckets as `{ bucketIndex: count }`, compact enough to store per row. */
+  sparseCounts() {
+    const sparse = {};
+    this.counts.forEach((count, bucket) => {
+      if (count > 0) {
+        sparse[bucket] = count;
+      }
+    });
+    return sparse;
+  }
+
+  /** Upper bound of the bucket holding the `q` quantile (the max for the overflow bucket). */
+  quantile(q) {
+    if (!this.count) {
+      return null;
+    }
+    const rank = Math.max(1, Math.ceil(q * this.count));
+    let seen = 0;
+    for (let bucket = 0; bucket < this.counts.length; bucket += 1) {
+      seen += this.counts[bucket];
+      if (seen >= rank) {
+        return bucket < this.boundsMs.length ? Math.min(this.boundsMs[bucket], this.maxMs) : this.maxMs;
+      }
+    }
+    return this.maxMs;
+  }
+
+  toJSON() {
+    const round = (value) => (value === null ? null : Number(value.toFixed(3)));
+    return {
+      count: this.count,
+      meanMs: this.count ? round(this.sumMs / this.count) : null,
+      p50Ms: round(this.quantile(0.5)),
+      p95Ms: round(this.quantile(0.95)),
+      p99Ms: round(this.quantile(0.99)),
+      maxMs: round(this.maxMs),
+      buckets: this.counts
+        .map((count, bucket) => ({ leMs: this.boundsMs[bucket] ?? null, count }))
+        .filter((bucket) => bucket.count > 0),
+    };
+  }
+}
@@ -0,0 +1,604 @@
+import { createHash } from "node:crypto";
+import fs from "node:fs";
+import path from "node:path";
+import { open } from "sqlite";
+import sqlite3 from "sqlite3";
+
+import LocalContextMemory from "./local-context-memory.js";
+
+/**
+ * The SQLite backend for `.miniphi/memory/`.
+ *
+ * The JSONL backend keeps the whole corpus resident: `prepare()` parses every
+ * record and builds the posting lists in process, which is the right trade for
+ * a few thousand facts and the wrong one for a memory that spans months of
+ * sessions (or several projects sharing one database file). This backend keeps
+ * the same lifecycle, the same harvesters and the same candidate shape, but the
+ * corpus lives in SQLite:
+ *
+ * - `memory_records` holds one row per record with indexed kind / session /
+ *   importance columns and the full record as JSON;
+ * - `memory_fts_<scope hash>` is an FTS5 table with one row per reference
+ *   sentence (plus one title+tags row per record), populated with the *stemmed*
+ *   content words, so a query matches exactly the vocabulary the JSONL backend
+ *   matches;
+ * - `memory_tags` and `memory_sources` replace the tag postings and `index.json`.
+ *
+ * Recall is one ranked FTS query bounded by `LIMIT`, so its cost follows the
+ * matches rather than the corpus, and nothing but the current page of hits is
+ * ever resident. BM25's scale depends on the corpus, so a record's relevance is
+ * normalized against the query's best hit before the tag and importance terms
+ * are added — scores land on the same rough 0..1.5 scale the JSONL backend
+ * produces, which is what `ContextReferenceComposer` compares across pools.
+ *
+ * Every row carries a `scope` (the resolved `.miniphi` directory), so `dbPath`
+ * may point several projects at one shared file without their records or their
+ * harvested sources colliding. The FTS table is per scope instead: a shared
+ * table would MATCH every project's sentences and rank them with BM25
+ * statistics drawn from every project's corpus.
+ */
+
+const DB_FILE = "memory.db";
+const RESULT_WINDOW_FACTOR = 8;
+
+const ftsQuery = (terms) =>
+  [...terms].map((term) => `"${String(term).replace(/"/g, '""')}"`).join(" OR ");
+
+export default class SqliteLocalContextMemory extends LocalContextMemory {
+  constructor(options = undefined) {
+    super(options);
+    this.dbPath =
+      typeof options?.dbPath === "string" && options.dbPath.trim()
+        ? path.resolve(options.dbPath.trim())
+        : path.join(this.memoryDir, DB_FILE);
+    this.scope = this.baseDir;
+    this.ftsTable = `memory_fts_${createHash("sha1").update(this.scope).digest("hex").slice(0, 16)}`;
+    this.db = null;
+    this._count = 0;
+    this._stats.backend = "sqlite";
+  }
+
+  async prepare() {
+    if (this._prepared) {
+      return this;
+    }
+    await fs.promises.mkdir(this.notesDir, { recursive: true });
+    await fs.promises.mkdir(path.dirname(this.dbPath), { recursive: true });
+    this.db = await open({ filename: this.dbPath, driver: sqlite3.Database });
+    await this.db.exec("PRAGMA journal_mode = WAL;");
+    await this.db.exec("PRAGMA synchronous = NORMAL;");
+    await this._migrate();
+    await this._loadSources();
+    this._count = await this._countRecords();
+    if (!this._count) {
+      await this._importJsonl();
+    }
+    this._prepared = true;
+    return this;
+  }
+
+  async dispose() {
+    await this._writeChain;
+    if (this.db) {
+      try {
+        await this.db.close();
+      } catch {
+        // ignore dispose errors
+      }
+      this.db = null;
+    }
+    this._prepared = false;
+  }
+
+  async _migrate() {
+    await this.db.exec(`
+      CREATE TABLE IF NOT EXISTS memory_records (
+        scope TEXT NOT NULL,
+        id TEXT NOT NULL,
+        kind TEXT NOT NULL,
+        session_id TEXT,
+        project_id TEXT,
+        importance REAL NOT NULL,
+        created_at TEXT NOT NULL,
+        updated_at TEXT NOT NULL,
+        body TEXT NOT NULL,
+        PRIMARY KEY (scope, id)
+      );
+      CREATE INDEX IF NOT EXISTS idx_memory_records_kind ON memory_records(scope, kind);
+      CREATE INDEX IF NOT EXISTS idx_memory_records_session ON memory_records(scope, session_id);
+      CREATE INDEX IF NOT EXISTS idx_memory_records_rank
+        ON memory_records(scope, importance DESC, updated_at DESC);
+      CREATE TABLE IF NOT EXISTS memory_references (
+        ref_rowid INTEGER PRIMARY KEY,
+        scope TEXT NOT NULL,
+        record_id TEXT NOT NULL,
+        reference_id TEXT,
+        ordinal INTEGER NOT NULL DEFAULT 0
+      );
+      CREATE INDEX IF NOT EXISTS idx_memory_references_record
+        ON memory_references(scope, record_id);
+      CREATE VIRTUAL TABLE IF NOT EXISTS ${this.ftsTable} USING fts5(terms, tokenize = 'unicode61');
+      CREATE TABLE IF NOT EXISTS memory_tags (
+        scope TEXT NOT NULL,
+        tag TEXT NOT NULL,
+        record_id TEXT NOT NULL,
+        PRIMARY KEY (scope, tag, record_id)
+      ) WITHOUT ROWID;
+      CREATE INDEX IF NOT EXISTS idx_memory_tags_record ON memory_tags(scope, record_id);
+      CREATE TABLE IF NOT EXISTS memory_sources (
+        scope TEXT NOT NULL,
+        key TEXT NOT NULL,
+        size INTEGER NOT NULL,
+        mtime_ms INTEGER NOT NULL,
+        record_ids TEXT NOT NULL,
+        PRIMARY KEY (scope, key)
+      );
+    `);
+    await this._migrateSharedFts();
+  }
+
+  /**
+   * Earlier databases kept every scope's sentences in one `memory_fts` table.
+   * Moves this scope's rows into its own table and drops the shared one once
+   * no scope is left in it.
+   */
+  async _migrateSharedFts() {
+    const legacy = await this.db.get(
+      "SELECT name FROM sqlite_master WHERE type = 'table' AND name = 'memory_fts'",
+    );
+    if (!legacy) {
+      return;
+    }
+    const owned = "SELECT ref_rowid FROM memory_references WHERE scope = ?";
+    await this._transaction(async () => {
+      await this.db.run(
+        `INSERT INTO ${this.ftsTable} (rowid, terms)
+         SELECT rowid, terms FROM memory_fts WHERE rowid IN (${owned})`,
+        this.scope,
+      );
+      await this.db.run(`DELETE FROM memory_fts WHERE rowid IN (${owned})`, this.scope);
+      if (!(await this.db.get("SELECT rowid FROM memory_fts LIMIT 1"))) {
+        await this.db.run("DROP TABLE memory_fts");
+      }
+    });
+  }
+
+  async _loadSources() {
+    const rows = await this.db.all(
+      "SELECT key, size, mtime_ms AS mtimeMs, record_ids AS recordIds FROM memory_sources WHERE scope = ?",
+      this.scope,
+    );
+    for (const row of rows) {
+      let recordIds = [];
+      try {
+        recordIds = JSON.parse(row.recordIds);
+      } catch {
+        recordIds = [];
+      }
+      this._sources.set(row.key, {
+        size: Number(row.size) || 0,
+        mtimeMs: Number(row.mtimeMs) || 0,
+        recordIds: Array.isArray(recordIds)
+          ? recordIds.filter((id) => typeof id === "string")
+          : [],
+      });
+    }
+  }
+
+  async _countRecords() {
+    const row = await this.db.get(
+      "SELECT COUNT(*) AS count FROM memory_records WHERE scope = ?",
+      this.scope,
+    );
+    return Number(row?.count) || 0;
+  }
+
+  _recordCount() {
+    return this._count;
+  }
+
+  /**
+   * An empty database next to an existing `records.jsonl` imports it once, so
+   * switching backends never loses what the project already remembered.
+   */
+  async _importJsonl() {
+    await this._loadRecords();
+    if (!this._records.size) {
+      return;
+    }
+    const records = [...this._records.values()];
+    this._records.clear();
+    await this._transaction(async () => {
+      for (const record of records) {
+        await this._writeRecord(record);
+      }
+    });
+    this._count = await this._countRecords();
+    this._log(`imported ${records.length} record(s) from ${this.recordsPath}`);
+  }
+
+  /** Writes are serialized on one connection: SQLite has no nested transactions. */
+  _transaction(work) {
+    const run = this._writeChain.then(async () => {
+      await this.db.exec("BEGIN IMMEDIATE");
+      try {
+        const result = await work();
+        await this.db.exec("COMMIT");
+        return result;
+      } catch (error) {
+        await this.db.exec("ROLLBACK").catch(() => {});
+        throw error;
+      }
+    });
+    this._writeChain = run.catch(() => {});
+    return run;
+  }
+
+  async _getRecord(id) {
+    const row = await this.db.get(
+      "SELECT body FROM memory_records WHERE scope = ? AND id = ?",
+      this.scope,
+      id,
+    );
+    return row ? JSON.parse(row.body) : null;
+  }
+
+  async _deleteRecordRows(id) {
+    await this.db.run(
+      `DELETE FROM ${this.ftsTable} WHERE rowid IN (SELECT ref_rowid FROM memory_references WHERE scope = ? AND record_id = ?)`,
+      this.scope,
+      id,
+    );
+    await this.db.run(
+      "DELETE FROM memory_references WHERE scope = ? AND record_id = ?",
+      this.scope,
+      id,
+    );
+    await this.db.run("DELETE FROM memory_tags WHERE scope = ? AND record_id = ?", this.scope, id);
+    const result = await this.db.run(
+      "DELETE FROM memory_records WHERE scope = ? AND id = ?",
+      this.scope,
+      id,
+    );
+    return (result?.changes ?? 0) > 0;
+  }
+
+  async _writeRecord(record) {
+    await this._deleteRecordRows(record.id);
+    await this.db.run(
+      `INSERT INTO memory_records
+        (scope, id, kind, session_id, project_id, importance, created_at, updated_at, body)
+       VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)`,
+      this.scope,
+      record.id,
+      record.kind,
+      record.sessionId,
+      record.projectId,
+      record.importance,
+      record.createdAt,
+      record.updatedAt,
+      JSON.stringify(record),
+    );
+    const derived = this._deriveTerms(record);
+    // The title+tags row carries no reference id: it lets a record match on its
+    // title the way the JSONL posting lists do, but it is never emitted.
+    const rows = [
+      {
+        referenceId: null,
+        ordinal: -1,
+        terms: derived.terms.filter(
+          (term) => !derived.references.some((terms) => terms.has(term)),
+        ),
+      },
+      ...record.references.map((reference, position) => ({
+        referenceId: reference.id,
+        ordinal: reference.ordinal ?? position,
+        terms: [...(derived.references[position] ?? [])],
+      })),
+    ];
+    for (const row of rows) {
+      if (!row.terms.length) {
+        continue;
+      }
+      const inserted = await this.db.run(
+        "INSERT INTO memory_references (scope, record_id, reference_id, ordinal) VALUES (?, ?, ?, ?)",
+        this.scope,
+        record.id,
+        row.referenceId,
+        row.ordinal,
+      );
+      await this.db.run(
+        `INSERT INTO ${this.ftsTable} (rowid, terms) VALUES (?, ?)`,
+        inserted.lastID,
+        row.terms.join(" "),
+      );
+    }
+    for (const tag of derived.tags) {
+      await this.db.run(
+        "INSERT OR IGNORE INTO memory_tags (scope, tag, record_id) VALUES (?, ?, ?)",
+        this.scope,
+        tag,
+        record.id,
+      );
+    }
+  }
+
+  async _putRecord(record) {
+    await this._writeRecord(record);
+  }
+
+  async _dropRecord(id) {
+    return this._deleteRecordRows(id);
+  }
+
+  /** Same rule as the JSONL trim: least important, then oldest, goes first. */
+  async _trim() {
+    if (this._count <= this.maxRecords) {
+      return;
+    }
+    const rows = await this.db.all(
+      `SELECT id FROM memory_records WHERE scope = ?
+       ORDER BY importance DESC, updated_at DESC LIMIT -1 OFFSET ?`,
+      this.scope,
+      this.maxRecords,
+    );
+    for (const row of rows) {
+      await this._deleteRecordRows(row.id);
+    }
+  }
+
+  async _stageAsync(entry) {
+    const staged = this._normalizeRecord({
+      ...entry,
+      sessionId: entry?.sessionId ?? this.sessionId,
+      projectId: entry?.projectId ?? this.projectId,
+      createdAt: entry?.createdAt ?? new Date().toISOString(),
+      updatedAt: new Date().toISOString(),
+    });
+    if (!staged) {
+      return null;
+    }
+    const existing = await this._getRecord(staged.id);
+    if (existing) {
+      // Same content, seen again: keep the first sighting's provenance.
+      existing.updatedAt = staged.updatedAt;
+      existing.importance = Math.max(existing.importance, staged.importance);
+      existing.tags = [...new Set([...existing.tags, ...staged.tags])].slice(0, 12);
+      await this._writeRecord(existing);
+      return existing;
+    }
+    await this._writeRecord(staged);
+    this._stats.remembered += 1;
+    return staged;
+  }
+
+  async remember(entry = undefined) {
+    const [record] = await this.rememberMany([entry]);
+    return record ?? null;
+  }
+
+  async rememberMany(entries) {
+    await this.prepare();
+    const out = await this._transaction(async () => {
+      const records = [];
+      for (const entry of Array.isArray(entries) ? entries : []) {
+        const record = await this._stageAsync(entry);
+        if (record) {
+          records.push(record);
+        }
+      }
+      return records;
+    });
+    this._count = await this._countRecords();
+    return out;
+  }
+
+  async forget(id) {
+    await this.prepare();
+    const removed = await this._transaction(() => this._deleteRecordRows(id));
+    this._count = await this._countRecords();
+    return removed;
+  }
+
+  /** One transaction per refresh, however many sources changed. */
+  async _applyHarvest(changes) {
+    await this._transaction(async () => {
+      for (const change of changes) {
+        for (const staleId of change.staleIds) {
+          await this._deleteRecordRows(staleId);
+        }
+        if (change.removed) {
+          this._sources.delete(change.key);
+          await this.db.run(
+            "DELETE FROM memory_sources WHERE scope = ? AND key = ?",
+            this.scope,
+            change.key,
+          );
+          continue;
+        }
+        for (const record of change.records) {
+          await this._writeRecord(record);
+        }
+        const recordIds = change.records.map((record) => record.id);
+        this._sources.set(change.key, {
+          size: change.size,
+          mtimeMs: change.mtimeMs,
+          recordIds,
+        });
+        await this.db.run(
+          `INSERT INTO memory_sources (scope, key, size, mtime_ms, record_ids) VALUES (?, ?, ?, ?, ?)
+           ON CONFLICT(scope, key) DO UPDATE SET
+             size = excluded.size, mtime_ms = excluded.mtime_ms, record_ids = excluded.record_ids`,
+          this.scope,
+          change.key,
+          change.size,
+          change.mtimeMs,
+          JSON.stringify(recordIds),
+        );
+      }
+      this._count = await this._countRecords();
+      await this._trim();
+    });
+    this._count = await this._countRecords();
+  }
+
+  /** Every write commits in its own transaction, so there is nothing to flush. */
+  async flush() {
+    await this._writeChain;
+    return false;
+  }
+
+  /**
+   * Ranked FTS recall. Async, unlike the JSONL backend's — callers await it,
+   * which is harmless for the synchronous one.
+   */
+  async recall({ text = "", tags = [], limit = undefined, excludeSessionId = null } = {}) {
+    const started = Date.now();
+    await this.prepare();
+    const max =
+      Number.isFinite(Number(limit)) && Number(limit) > 0
+        ? Math.floor(Number(limit))
+        : this.maxCandidates;
+    const { queryTerms, wantedTags } = this._parseQuery({ text, tags });
+    const empty = (scanned = 0) => ({
+      ok: true,
+      engine: "local",
+      backend: "sqlite",
+      referenceCandidates: [],
+      matched: 0,
+      scanned,
+      elapsedMs: Date.now() - started,
+    });
+    if (!queryTerms.size && !wantedTags.size) {
+      return empty();
+    }
+    const window = max * RESULT_WINDOW_FACTOR;
+    const exclude = excludeSessionId || null;
+
+    /** @type {Map<string, {best:number, references:Map<string, number>}>} */
+    const hits = new Map();
+    let scanned = 0;
+    if (queryTerms.size) {
+      const rows = await this.db.all(
+        `SELECT r.record_id AS recordId, r.reference_id AS referenceId, bm25(${this.ftsTable}) AS rank
+         FROM ${this.ftsTable}
+         JOIN memory_references r ON r.ref_rowid = ${this.ftsTable}.rowid
+         JOIN memory_records m ON m.scope = r.scope AND m.id = r.record_id
+         WHERE ${this.ftsTable} MATCH ? AND r.scope = ?
+           AND (? IS NULL OR m.session_id IS NULL OR m.session_id <> ?)
+         ORDER BY rank
+         LIMIT ?`,
+        ftsQuery(queryTerms),
+        this.scope,
+        exclude,
+        exclude,
+        window,
+      );
+      scanned += rows.length;
+      for (const row of rows) {
+        const entry = hits.get(row.recordId) ?? { best: row.rank, references: new Map() };
+        entry.best = Math.min(entry.best, row.rank);
+        if (row.referenceId && !entry.references.has(row.referenceId)) {
+          entry.references.set(row.referenceId, row.rank);
+        }
+        hits.set(row.recordId, entry);
+      }
+    }
+    if (wantedTags.size) {
+      const tagList = [...wantedTags];
+      const rows = await this.db.all(
+        `SELECT t.record_id AS recordId FROM memory_tags t
+         JOIN memory_records m ON m.scope = t.scope AND m.id = t.record_id
+         WHERE t.scope = ? AND t.tag IN (${tagList.map(() => "?").join(", ")})
+           AND (? IS NULL OR m.session_id IS NULL OR m.session_id <> ?)
+         GROUP BY t.record_id
+         ORDER BY COUNT(*) DESC, m.importance DESC, m.updated_at DESC
+         LIMIT ?`,
+        this.scope,
+        ...tagList,
+        exclude,
+        exclude,
+        window,
+      );
+      scanned += rows.length;
+      for (const row of rows) {
+        if (!hits.has(row.recordId)) {
+          hits.set(row.recordId, { best: 0, references: new Map() });
+        }
+      }
+    }
+    if (!hits.size) {
+      return empty(scanned);
+    }
+
+    const ids = [...hits.keys()];
+    const bodies = await this.db.all(
+      `SELECT body FROM memory_records WHERE scope = ? AND id IN (${ids.map(() => "?").join(", ")})`,
+      this.scope,
+      ...ids,
+    );
+    // bm25() is negative, better hits more so; the best hit anchors 1.0.
+    const bestRank = Math.min(...[...hits.values()].map((entry) => entry.best));
+    const scored = [];
+    for (const { body } of bodies) {
+      const record = JSON.parse(body);
+      const hit = hits.get(record.id);
+      const relevance = bestRank < 0 && hit.best < 0 ? hit.best / bestRank : hit.best < 0 ? 1 : 0;
+      const tagHits = (record.tags ?? []).filter((tag) => wantedTags.has(tag)).length;
+      const score = relevance + tagHits * 0.4 + record.importance * 0.15;
+      if (score < this.minScore) {
+        continue;
+      }
+      scored.push({ record, score, hit });
+    }
+    scored.sort(
+      (left, right) =>
+        right.score - left.score ||
+        String(right.record.updatedAt).localeCompare(String(left.record.updatedAt)) ||
+        left.record.id.localeCompare(right.record.id),
+    );
+
+    const referenceCandidates = [];
+    const seenText = new Set();
+    for (const { record, score, hit } of scored) {
+      // Matched sentences first, best BM25 first; the rest in storage order.
+      const ranked = [...record.references].sort(
+        (left, right) =>
+          (hit.references.get(left.id) ?? 0) - (hit.references.get(right.id) ?? 0) ||
+          (left.ordinal ?? 0) - (right.ordinal ?? 0),
+      );
+      for (const reference of ranked) {
+        if (referenceCandidates.length >= max) {
+          break;
+        }
+        const candidateText = String(reference.text ?? "").trim();
+        if (!candidateText || seenText.has(candidateText)) {
+          continue;
+        }
+        seenText.add(candidateText);
+        referenceCandidates.push(this._candidate(record, reference, candidateText, score));
+      }
+      if (referenceCandidates.length >= max) {
+        break;
+      }
+    }
+    this._stats.queries += 1;
+    this._stats.candidates += referenceCandidates.length;
+    return {
+      ok: true,
+      engine: "local",
+      backend: "sqlite",
+      referenceCandidates,
+      matched: scored.length,
+      scanned,
+      elapsedMs: Date.now() - started,
+    };
+  }
+
+  stats() {
+    return {
+      ...super.stats(),
+      dbPath: this.dbPath,
+    };
+  }
+}
@@ -6,7 +6,12 @@ import {
   buildCompleteReferenceSentences,
   normalizeReferenceSentences,
 } from "./context-reference-memory.js";
+import { writeFileAtomic } from "./atomic-file.js";
 import { contentWords, questionCues } from "./cheetah-memory-layers.js";
+import LocalMemoryEmbeddings, {
+  LOCAL_EMBEDDINGS_DIRNAME,
+  embeddingHash,
+} from "./local-memory-embeddings.js";
 
 /**
  * The `.miniphi`-backed half of MiniPhi's graph memory.
@@ -42,8 +47,16 @@ import { contentWords, questionCues } from "./cheetah-memory-layers.js";
  *   size + mtime; deleting it costs one rescan, never a fact. The records and
  *   the notes are the only durable state, and both are human-readable so they
  *   can be copied, synced, or committed to reach another device.
+ * - **`records.jsonl` is a log, not a snapshot.** Writes append one line per
+ *   changed record (or a `forgotten` tombstone) and the last line for an id
+ *   wins on load. Appends are group-committed after a short debounce, and the
+ *   file is compacted back to one line per live record once superseded lines
+ *   outnumber live ones.
  * - **Recall is deterministic and model-free**, like `cheetah-memory-layers`:
- *   it is a ranking over stored sentences, not a second inference call.
+ *   it is a ranking over stored sentences, not a second inference call. The
+ *   optional semantic layer (`attachEmbeddings`) only adds an embedding lookup
+ *   for the seed; it never generates text, and when the embedding endpoint is
+ *   down recall degrades to the lexical ranking instead of failing.
  */
 
 export const LOCAL_MEMORY_SCHEMA_VERSION = "local-context-memory@v1";
@@ -59,6 +72,19 @@ const DEFAULT_MAX_REFERENCES_PER_RECORD = 8;
 const DEFAULT_MAX_TEXT_CHARS = 4000;
 const DEFAULT_MIN_SCORE = 0.08;
 const DEFAULT_HARVEST_SESSIONS = 12;
+const DEFAULT_FLUSH_DELAY_MS = 25;
+const DEFAULT_SQLITE_MAX_RECORDS = 1_000_000;
+const DEFAULT_IO_CONCURRENCY = 16;
+const SESSIONS_DIRNAME = "agent-sessions";
+const HARVESTED_SESSION_FILES = new Set(["context-graph.json", "result.json"]);
+const BACKENDS = new Set(["jsonl", "sqlite"]);
+const COMPACT_MIN_LINES = 256;
+const DEFAULT_SEMANTIC_WEIGHT = 0.6;
+const DEFAULT_MIN_SIMILARITY = 0.55;
+// Embedding requests per background sync step (saved after each step), and
+// how long new sentences wait before retrying after a failed sync.
+const EMBEDDING_SYNC_BATCHES = 4;
+const EMBEDDING_RETRY_MS = 30_000;
 
 const KINDS = new Set([
   "note",
@@ -162,6 +188,82 @@ export function lightStem(word) {
 
 const stemAll = (words) => words.map(lightStem);
 
+/**
+ * Runs `task` over `items` with at most `limit` in flight and returns results
+ * in input order. A `.miniphi` scan waits on stat/read latency, not CPU, so a
+ * few hundred sessions cost a handful of round trips instead of one each.
+ */
+const mapWithConcurrency = async (items, limit, task) => {
+  const results = new Array(items.length);
+  let next = 0;
+  const worker = async () => {
+    while (next < items.length) {
+      const index = next;
+      next += 1;
+      results[index] = await task(items[index], index);
+    }
+  };
+  await Promise.all(Array.from({ length: Math.min(Math.max(1, limit), items.length) }, worker));
+  return results;
+};
+
+const addPosting = (postings, key, id) => {
+  let ids = postings.get(key);
+  if (!ids) {
+    ids = new Set();
+    postings.set(key, ids);
+  }
+  ids.add(id);
+};
+
+const removePosting = (postings, key, id) => {
+  const ids = postings.get(key);
+  if (!ids) {
+    return;
+  }
+  ids.delete(id);
+  if (!ids.size) {
+    postings.delete(key);
+  }
+};
+
+const compareScored = (left, right) =>
+  right.score - left.score ||
+  String(right.record.updatedAt).localeCompare(String(left.record.updatedAt)) ||
+  left.record.id.localeCompare(right.record.id);
+
+/**
+ * The best `count` entries of `items` in `compare` order, without sorting the
+ * rest. Recall consumes a few dozen records at most, and a broad seed can match
+ * most of a large corpus; a full sort there was the second O(n log n) per turn.
+ */
+const takeTop = (items, count, compare) => {
+  if (items.length <= count) {
+    return [...items].sort(compare);
+  }
+  const top = [];
+  for (const item of items) {
+    if (top.length === count && compare(item, top[top.length - 1]) >= 0) {
+      continue;
+    }
+    let low = 0;
+    let high = top.length;
+    while (low < high) {
+      const middle = (low + high) >> 1;
+      if (compare(item, top[middle]) < 0) {
+        high = middle;
+      } else {
+        low = middle + 1;
+      }
+    }
+    top.splice(low, 0, item);
+    if (top.length > count) {
+      top.pop();
+    }
+  }
+  return top;
+};
+
 /** A record's searchable surface: title, tags and every reference sentence. */
 const recordTerms = (record) => {
   const bag = [record.title ?? "", ...(record.tags ?? [])];
@@ -211,16 +313,55 @@ export default class LocalContextMemory {
       options?.harvestSessions,
       DEFAULT_HARVEST_SESSIONS,
     );
+    this.ioConcurrency = toPositiveInteger(options?.ioConcurrency, DEFAULT_IO_CONCURRENCY);
+    this.flushDelayMs = Number.isFinite(options?.flushDelayMs)
+      ? Math.max(0, Number(options.flushDelayMs))
+      : DEFAULT_FLUSH_DELAY_MS;
     /** @type {Map<string, object>} */
     this._records = new Map();
     /** @type {Map<string, {size:number,mtimeMs:number,recordIds:string[]}>} */
     this._sources = new Map();
-    /** @type {Map<string, string[]>} derived per-record term list */
-    this._terms = new Map();
-    /** @type {Map<string, number>} document frequency per term */
-    this._documentFrequency = new Map();
+    /**
+     * Derived, per-record: the unique stemmed terms, the tags as indexed, and
+     * one stemmed term set per reference sentence (aligned with `references`).
+     * @type {Map<string, {terms:string[], tags:string[], references:Set<string>[]}>}
+     */
+    this._derived = new Map();
+    /** @type {Map<string, Set<string>>} term -> ids of the records containing it */
+    this._postings = new Map();
+    /** @type {Map<string, Set<string>>} tag -> ids of the records carrying it */
+    this._tagPostings = new Map();
     this._prepared = false;
-    this._dirty = false;
+    /** @type {Set<string>} ids whose current state (or absence) is not yet logged */
+    this._pendingIds = new Set();
+    this._sourcesDirty = false;
+    /** Lines currently in `records.jsonl`, live or superseded. */
+    this._logLines = 0;
+    this._needsCompaction = false;
+    /** @type {{promise: Promise<boolean>, resolve: Function, reject: Function, timer: NodeJS.Timeout}|null} */
+    this._scheduledFlush = null;
+    this._writeChain = Promise.resolve();
+    /** @type {fs.FSWatcher[]} */
+    this._watchers = [];
+    this._sessionsWatched = false;
+    /** Source keys touched since the last refresh, while watching. */
+    this._dirtySources = new Set();
+    /** Set when an event could not be narrowed to one source key. */
+    this._watchFull = true;
+    /** @type {LocalMemoryEmbeddings|null} */
+    this.embeddings = null;
+    this.semanticWeight = DEFAULT_SEMANTIC_WEIGHT;
+    this.minSimilarity = DEFAULT_MIN_SIMILARITY;
+    /** @type {Map<string, {recordId:string, referenceId:string}[]>} sentence hash -> references */
+    this._referencesByHash = new Map();
+    /** @type {Map<string, string[]>} record id -> its sentence hashes, for un-posting */
+    this._hashesByRecord = new Map();
+    /** @type {Map<string, string>} sentence hash -> text, posted but not embedded yet */
+    this._embeddingQueue = new Map();
+    /** @type {Promise<void>|null} */
+    this._embeddingSync = null;
+    /** After a failed sync, new sentences wait until then before trying again. */
+    this._embeddingRetryAt = 0;
     this._stats = {
       engine: "local",
       schemaVersion: LOCAL_MEMORY_SCHEMA_VERSION,
@@ -229,6 +370,9 @@ export default class LocalContextMemory {
       remembered: 0,
       queries: 0,
       candidates: 0,
+      appends: 0,
+      compactions: 0,
+      semanticHits: 0,
       lastError: null,
     };
   }
@@ -258,11 +402,15 @@ export default class LocalContextMemory {
     } catch {
       return;
     }
+    // Appending after a torn last line would glue the next record onto it, so
+    // the first commit rewrites the file instead.
+    this._needsCompaction = raw.length > 0 && !raw.endsWith("\n");
     for (const line of raw.split("\n")) {
       const trimmed = line.trim();
       if (!trimmed) {
         continue;
       }
+      this._logLines += 1;
       let parsed = null;
       try {
         parsed = JSON.parse(trimmed);
@@ -270,6 +418,10 @@ export default class LocalContextMemory {
         // A half-written last line (interrupted run) must not lose the file.
         continue;
       }
+      if (parsed?.forgotten === true && typeof parsed.id === "string") {
+        this._records.delete(parsed.id);
+        continue;
+      }
       const normalized = this._normalizeRecord(parsed);
       if (normalized) {
         this._records.set(normalized.id, normalized);
@@ -358,21 +510,112 @@ export default class LocalContextMemory {
   }
 
   _rebuildDerived() {
-    this._terms.clear();
-    this._documentFrequency.clear();
+    this._derived.clear();
+    this._postings.clear();
+    this._tagPostings.clear();
+    this._referencesByHash.clear();
+    this._hashesByRecord.clear();
     for (const record of this._records.values()) {
-      const terms = recordTerms(record);
-      this._terms.set(record.id, terms);
-      for (const term of new Set(terms)) {
-        this._documentFrequency.set(term, (this._documentFrequency.get(term) ?? 0) + 1);
-      }
+      this._indexRecord(record);
     }
     this._stats.records = this._records.size;
   }
 
-  /** Adds (or refreshes) one memory that outlives this session. */
+  /**
+   * Posts one record into the inverted index. A term's document frequency is
+   * simply the size of its posting list, so adding or dropping a record costs
+   * only its own terms — the full rebuild above runs once, in `prepare()`.
+   */
+  _indexRecord(record) {
+    this._unindexRecord(record.id);
+    const derived = this._deriveTerms(record);
+    for (const term of derived.terms) {
+      addPosting(this._postings, term, record.id);
+    }
+    for (const tag of derived.tags) {
+      addPosting(this._tagPostings, tag, record.id);
+    }
+    this._derived.set(record.id, derived);
+    if (this.embeddings) {
+      this._postSentences(record);
+    }
+  }
+
+  _deriveTerms(record) {
+    return {
+      terms: [...new Set(recordTerms(record))],
+      tags: [...record.tags],
+      // Stemmed once here instead of once per recall per matched record.
+      references: record.references.map(
+        (reference) => new Set(stemAll(contentWords(reference.text ?? ""))),
+      ),
+    };
+  }
+
+  _unindexRecord(id) {
+    const derived = this._derived.get(id);
+    if (!derived) {
+      return;
+    }
+    for (const term of derived.terms) {
+      removePosting(this._postings, term, id);
+    }
+    for (const tag of derived.tags) {
+      removePosting(this._tagPostings, tag, id);
+    }
+    this._derived.delete(id);
+    this._unpostSentences(id);
+  }
+
+  /**
+   * Every write to `_records` goes through these two, so neither the index nor
+   * the log can drift from the in-memory corpus.
+   */
+  _putRecord(record) {
+    this._records.set(record.id, record);
+    this._indexRecord(record);
+    this._pendingIds.add(record.id);
+  }
+
+  _dropRecord(id) {
+    if (!this._records.delete(id)) {
+      return false;
+    }
+    this._unindexRecord(id);
+    this._pendingIds.add(id);
+    return true;
+  }
+
+  /**
+   * Adds (or refreshes) one memory that outlives this session. Resolves once
+   * the record's line is on disk; concurrent callers share that one append.
+   */
   async remember(entry = undefined) {
     await this.prepare();
+    const record = this._stage(entry);
+    if (record) {
+      await this._scheduleFlush();
+    }
+    return record;
+  }
+
+  /** Stages every entry in memory, then commits them as a single append. */
+  async rememberMany(entries) {
+    await this.prepare();
+    const out = [];
+    for (const entry of Array.isArray(entries) ? entries : []) {
+      const record = this._stage(entry);
+      if (record) {
+        out.push(record);
+      }
+    }
+    if (out.length) {
+      await this.flush();
+    }
+    return out;
+  }
+
+  _stage(entry) {
     const record = this._normalizeRecord({
       ...entry,
       sessionId: entry?.sessionId ?? this.sessionId,
@@ -390,52 +633,38 @@ export default class LocalContextMemory {
       existing.updatedAt = record.updatedAt;
       existing.importance = Math.max(existing.importance, record.importance);
       existing.tags = normalizeTags([...existing.tags, ...record.tags]);
-      this._dirty = true;
-      this._rebuildDerived();
-      await this.flush();
+      this._putRecord(existing);
       return existing;
     }
-    this._records.set(record.id, record);
+    this._putRecord(record);
     this._stats.remembered += 1;
-    this._dirty = true;
-    this._rebuildDerived();
-    await this.flush();
     return record;
   }
 
-  async rememberMany(entries) {
-    const out = [];
-    for (const entry of Array.isArray(entries) ? entries : []) {
-      const record = await this.remember(entry);
-      if (record) {
-        out.push(record);
-      }
-    }
-    return out;
-  }
-
   async forget(id) {
     await this.prepare();
-    if (!this._records.delete(id)) {
+    if (!this._dropRecord(id)) {
       return false;
     }
-    this._dirty = true;
-    this._rebuildDerived();
-    await this.flush();
+    await this._scheduleFlush();
     return true;
   }
 
   /**
    * Scans `.miniphi/` for artifacts written since the last refresh and turns the
    * durable parts into records. Cheap by construction: a source whose size and
-   * mtime are unchanged is skipped without being read.
+   * mtime are unchanged is skipped without being read, stats and reads run
+   * `ioConcurrency` at a time, and while `watch()` is active only the sources
+   * an event named are stat'ed at all.
    */
   async refresh({ force = false } = {}) {
     await this.prepare();
     const started = Date.now();
-    let harvested = 0;
-    const seenSources = new Set();
-    for (const source of await this._collectSources()) {
+    const only = this._takeDirtySources(force);
+    const { sources, untouched } = await this._collectSources({ only });
+    const seenSources = new Set(untouched);
+    const changed = [];
+    for (const source of sources) {
       seenSources.add(source.key);
       const cached = this._sources.get(source.key);
       if (
@@ -446,22 +675,24 @@ export default class LocalContextMemory {
       ) {
         continue;
       }
-      let entries = [];
+      changed.push({ source, cached });
+    }
+    const reads = await mapWithConcurrency(changed, this.ioConcurrency, async ({ source }) => {
       try {
-        entries = await source.read();
+        return await source.read();
       } catch (error) {
         this._stats.lastError = error instanceof Error ? error.message : String(error);
         this._log(`failed to harvest ${source.key}: ${this._stats.lastError}`);
-        continue;
+        return null;
       }
-      // A re-read replaces whatever this source contributed last time, so an
-      // edited note does not leave its previous wording behind as a ghost.
-      // Records written through `remember()` are never listed in a source's
-      // `recordIds`, so this cannot reach them.
-      for (const staleId of cached?.recordIds ?? []) {
-        this._records.delete(staleId);
+    });
+    const changes = [];
+    for (const [index, { source, cached }] of changed.entries()) {
+      const entries = reads[index];
+      if (!entries) {
+        continue;
       }
-      const recordIds = [];
+      const records = [];
       for (const entry of entries) {
         const record = this._normalizeRecord({
           ...entry,
@@ -469,46 +700,170 @@ export default class LocalContextMemory {
           createdAt: entry.createdAt ?? nowIso(),
           updatedAt: nowIso(),
         });
-        if (!record) {
-          continue;
+        if (record) {
+          records.push(record);
         }
-        this._records.set(record.id, record);
-        recordIds.push(record.id);
-        harvested += 1;
       }
-      this._sources.set(source.key, {
+      changes.push({
+        key: source.key,
         size: source.size,
         mtimeMs: source.mtimeMs,
-        recordIds,
+        staleIds: cached?.recordIds ?? [],
+        records,
       });
-      this._dirty = true;
     }
     // A source that disappeared takes its records with it.
-    for (const [key, cached] of [...this._sources.entries()]) {
-      if (seenSources.has(key)) {
-        continue;
-      }
-      for (const staleId of cached.recordIds ?? []) {
-        this._records.delete(staleId);
+    for (const [key, cached] of this._sources.entries()) {
+      if (!seenSources.has(key)) {
+        changes.push({ key, removed: true, staleIds: cached.recordIds ?? [], records: [] });
       }
-      this._sources.delete(key);
-      this._dirty = true;
     }
-    if (this._dirty) {
-      this._trim();
-      this._rebuildDerived();
-      await this.flush();
+    const harvested = changes.reduce((total, change) => total + change.records.length, 0);
+    if (changes.length) {
+      await this._applyHarvest(changes);
     }
     this._stats.harvested += harvested;
     return {
       ok: true,
       harvested,
-      records: this._records.size,
+      records: this._recordCount(),
       sources: this._sources.size,
+      mode: only ? "watched" : "full",
+      checked: sources.length,
       elapsedMs: Date.now() - started,
     };
   }
 
+  /**
+   * Keeps a dirty set of source keys from `fs.watch` events so a long-lived
+   * process re-checks only what changed. Anything the watcher cannot narrow to
+   * one source — a new session directory (which shifts the harvest window), an
+   * event without a filename, a watcher error — falls back to one full scan.
+   * Watchers are unref'd and never keep the process alive.
+   */
+  watch() {
+    if (this._watchers.length) {
+      return this;
+    }
+    this._watchFull = true;
+    this._attachWatcher(this.notesDir, { recursive: false }, (filename) =>
+      `${LOCAL_MEMORY_DIRNAME}/${NOTES_DIRNAME}/${filename}`,
+    );
+    this._watchSessions();
+    return this;
+  }
+
+  unwatch() {
+    for (const watcher of this._watchers) {
+      watcher.close();
+    }
+    this._watchers = [];
+    this._sessionsWatched = false;
+    this._dirtySources.clear();
+    this._watchFull = true;
+  }
+
+  _watchSessions() {
+    if (this._sessionsWatched || !this._watchers.length) {
+      return;
+    }
+    this._sessionsWatched = this._attachWatcher(
+      path.join(this.baseDir, SESSIONS_DIRNAME),
+      { recursive: true },
+      (filename) => {
+        const parts = filename.split(/[\\/]/).filter(Boolean);
+        if (parts.length < 2) {
+          // A session directory appeared or went away.
+          return null;
+        }
+        if (parts.length !== 2 || !HARVESTED_SESSION_FILES.has(parts[1])) {
+          // Transcripts, prompts, snapshots: written constantly, never harvested.
+          return undefined;
+        }
+        return `${SESSIONS_DIRNAME}/${parts[0]}/${parts[1]}`;
+      },
+    );
+  }
+
+  /**
+   * `toKey` maps an event filename to a source key, `null` when the event needs
+   * a full scan, or `undefined` when it is irrelevant.
+   */
+  _attachWatcher(dir, { recursive }, toKey) {
+    let watcher = null;
+    try {
+      watcher = fs.watch(dir, { recursive, persistent: false }, (_event, filename) => {
+        const key = filename ? toKey(String(filename)) : null;
+        if (key === null) {
+          this._watchFull = true;
+        } else if (key) {
+          this._dirtySources.add(key);
+        }
+      });
+    } catch {
+      return false;
+    }
+    watcher.on("error", () => {
+      watcher.close();
+      this._watchers = this._watchers.filter((entry) => entry !== watcher);
+      this._sessionsWatched = false;
+      this._watchFull = true;
+    });
+    watcher.unref?.();
+    this._watchers.push(watcher);
+    return true;
+  }
+
+  /** Null means "scan everything"; otherwise the keys to re-check. */
+  _takeDirtySources(force) {
+    if (!this._watchers.length) {
+      return null;
+    }
+    // The sessions directory may not have existed when watching started.
+    this._watchSessions();
+    if (force || this._watchFull || !this._sessionsWatched) {
+      this._watchFull = false;
+      this._dirtySources.clear();
+      return null;
+    }
+    const dirty = new Set(this._dirtySources);
+    this._dirtySources.clear();
+    return dirty;
+  }
+
+  /**
+   * Applies one refresh's worth of source changes. A re-read replaces whatever
+   * the source contributed last time, so an edited note does not leave its
+   * previous wording behind as a ghost. Records written through `remember()`
+   * are never listed in a source's `recordIds`, so this cannot reach them.
+   */
+  async _applyHarvest(changes) {
+    for (const change of changes) {
+      for (const staleId of change.staleIds) {
+        this._dropRecord(staleId);
+      }
+      if (change.removed) {
+        this._sources.delete(change.key);
+      } else {
+        for (const record of change.records) {
+          this._putRecord(record);
+        }
+        this._sources.set(change.key, {
+          size: change.size,
+          mtimeMs: change.mtimeMs,
+          recordIds: change.records.map((record) => record.id),
+        });
+      }
+      this._sourcesDirty = true;
+    }
+    this._trim();
+    await this.flush();
+  }
+
+  _recordCount() {
+    return this._records.size;
+  }
+
   /** Oldest, least important records go first when the corpus outgrows the cap. */
   _trim() {
     if (this._records.size <= this.maxRecords) {
@@ -519,59 +874,150 @@ export default class LocalContextMemory {
         right.importance - left.importance ||
         String(right.updatedAt).localeCompare(String(left.updatedAt)),
     );
-    this._records = new Map(
-      ordered.slice(0, this.maxRecords).map((record) => [record.id, record]),
-    );
+    for (const record of ordered.slice(this.maxRecords)) {
+      this._dropRecord(record.id);
+    }
+  }
+
+  /**
+   * Debounced group commit: every caller inside one `flushDelayMs` window
+   * awaits the same append, so an agent turn that remembers several notes
+   * touches the file once.
+   */
+  _scheduleFlush() {
+    if (!this._scheduledFlush) {
+      const waiter = {};
+      waiter.promise = new Promise((resolve, reject) => {
+        waiter.resolve = resolve;
+        waiter.reject = reject;
+      });
+      waiter.timer = setTimeout(() => {
+        this.flush().catch(() => {});
+      }, this.flushDelayMs);
+      this._scheduledFlush = waiter;
+    }
+    return this._scheduledFlush.promise;
   }
 
+  /** Commits everything staged so far, now. Resolves true when anything was written. */
   async flush() {
-    if (!this._dirty) {
+    const waiter = this._scheduledFlush;
+    if (waiter) {
+      clearTimeout(waiter.timer);
+      this._scheduledFlush = null;
+    }
+    // Commits are serialized: an append must never interleave with a
+    // compaction that is renaming the file underneath it.
+    const run = this._writeChain.then(() => this._commit());
+    this._writeChain = run.catch(() => {});
+    try {
+      const wrote = await run;
+      waiter?.resolve(wrote);
+      return wrote;
+    } catch (error) {
+      waiter?.reject(error);
+      throw error;
+    }
+  }
+
+  async _commit() {
+    if (!this._pendingIds.size && !this._sourcesDirty) {
       return false;
     }
-    await fs.promises.mkdir(this.memoryDir, { recursive: true });
+    // Ids staged while this commit runs go to the next one (their records may
+    // have changed after these lines were built); ids of a failed commit are
+    // queued again, so nothing is dropped before it is on disk.
+    const ids = [...this._pendingIds];
+    this._pendingIds = new Set();
+    const compact =
+      this._needsCompaction ||
+      this._logLines + ids.length > Math.max(COMPACT_MIN_LINES, this._records.size * 2);
+    try {
+      await fs.promises.mkdir(this.memoryDir, { recursive: true });
+      if (compact) {
+        await this._compact();
+      } else if (ids.length) {
+        const lines = ids.map((id) => {
+          const record = this._records.get(id);
+          return JSON.stringify(record ?? { id, forgotten: true, updatedAt: nowIso() });
+        });
+        await fs.promises.appendFile(this.recordsPath, `${lines.join("\n")}\n`, "utf8");
+        this._logLines += lines.length;
+        this._stats.appends += 1;
+      }
+    } catch (error) {
+      for (const id of ids) {
+        this._pendingIds.add(id);
+      }
+      throw error;
+    }
+    if (this._sourcesDirty || compact) {
+      this._sourcesDirty = false;
+      try {
+        await writeFileAtomic(
+          this.indexPath,
+          JSON.stringify(
+            {
+              schemaVersion: LOCAL_MEMORY_SCHEMA_VERSION,
+              updatedAt: nowIso(),
+              records: this._records.size,
+              sources: Object.fromEntries(this._sources),
+            },
+            null,
+            2,
+          ),
+        );
+      } catch (error) {
+        this._sourcesDirty = true;
+        throw error;
+      }
+    }
+    return true;
+  }
+
+  /** Rewrites the log as one line per live record, oldest first. */
+  async _compact() {
     const lines = [...this._records.values()]
       .sort((left, right) => String(left.createdAt).localeCompare(String(right.createdAt)))
       .map((record) => JSON.stringify(record));
-    const tempPath = `${this.recordsPath}.tmp`;
-    await fs.promises.writeFile(tempPath, lines.length ? `${lines.join("\n")}\n` : "", "utf8");
-    await fs.promises.rename(tempPath, this.recordsPath);
-    await fs.promises.writeFile(
-      this.indexPath,
-      JSON.stringify(
-        {
-          schemaVersion: LOCAL_MEMORY_SCHEMA_VERSION,
-          updatedAt: nowIso(),
-          records: this._records.size,
-          sources: Object.fromEntries(this._sources),
-        },
-        null,
-        2,
+    await writeFileAtomic(this.recordsPath, lines.length ? `${lines.join("\n")}\n` : "");
+    this._logLines = lines.length;
+    this._needsCompaction = false;
+    this._stats.compactions += 1;
+  }
+
+  /** The stemmed term set and normalized tag set a recall seed asks for. */
+  _parseQuery({ text = "", tags = [] } = {}) {
+    const seedText = normalizeText(text, 6000);
+    // `questionCues` adds the capitalized runs (library names, file paths,
+    // product names) that `contentWords` alone lowercases into the same bag as
+    // ordinary prose — they are the highest-signal part of an agent seed.
+    const cues = questionCues(seedText);
+    return {
+      queryTerms: new Set(
+        stemAll([
+          ...contentWords(seedText),
+          ...(cues?.phrases ?? []).flatMap((phrase) => contentWords(phrase)),
+        ]),
       ),
-      "utf8",
-    );
-    this._dirty = false;
-    return true;
+      wantedTags: new Set(normalizeTags(tags)),
+    };
   }
 
   /**
    * Ranks stored references against a free-text seed. Returns Cheetah-shaped
    * reference candidates so the caller can merge them into one selection pool.
+   * Synchronous for the lexical store; with embeddings attached it resolves
+   * asynchronously, so callers should always `await` it.
    */
-  recall({ text = "", tags = [], limit = undefined, excludeSessionId = null } = {}) {
+  recall(options = undefined) {
+    return this.embeddings ? this._recallHybrid(options) : this._recallLexical(options);
+  }
+
+  _recallLexical({ text = "", tags = [], limit = undefined, excludeSessionId = null } = {}) {
     const started = Date.now();
     const max = toPositiveInteger(limit, this.maxCandidates);
-    const seedText = normalizeText(text, 6000);
-    // `questionCues` adds the capitalized runs (library names, file paths,
-    // product names) that `contentWords` alone lowercases into the same bag as
-    // ordinary prose — they are the highest-signal part of an agent seed.
-    const cues = questionCues(seedText);
-    const queryTerms = new Set(
-      stemAll([
-        ...contentWords(seedText),
-        ...(cues?.phrases ?? []).flatMap((phrase) => contentWords(phrase)),
-      ]),
-    );
-    const wantedTags = new Set(normalizeTags(tags));
+    const { queryTerms, wantedTags } = this._parseQuery({ text, tags });
     if (!queryTerms.size && !wantedTags.size) {
       return {
         ok: true,
@@ -583,26 +1029,39 @@ export default class LocalContextMemory {
       };
     }
     const totalDocs = Math.max(1, this._records.size);
+    // Term-at-a-time over the posting lists: only records sharing at least one
+    // query term are ever touched, and each accumulates exactly the IDF sum the
+    // old full scan computed for it, so ranking is unchanged.
+    const overlaps = new Map();
+    for (const term of queryTerms) {
+      const ids = this._postings.get(term);
+      if (!ids) {
+        continue;
+      }
+      const weight = Math.log(1 + totalDocs / ids.size);
+      for (const id of ids) {
+        overlaps.set(id, (overlaps.get(id) ?? 0) + weight);
+      }
+    }
+    // With wanted tags every record carries an importance floor that can clear
+    // `minScore` on its own, so that (rare, caller-chosen) query still has to
+    // visit the whole corpus — but only for arithmetic, never for re-stemming.
+    const candidateIds = wantedTags.size ? this._records.keys() : overlaps.keys();
     const scored = [];
-    for (const record of this._records.values()) {
+    for (const id of candidateIds) {
+      const record = this._records.get(id);
+      if (!record) {
+        continue;
+      }
       if (excludeSessionId && record.sessionId === excludeSessionId) {
         // The live session's own graph is already in the prompt; re-serving it
         // from disk would just spend budget on a duplicate.
         continue;
       }
-      const terms = this._terms.get(record.id) ?? [];
-      if (!terms.length) {
+      if (!this._derived.get(id)?.terms.length) {
         continue;
       }
-      const unique = new Set(terms);
-      let overlap = 0;
-      for (const term of unique) {
-        if (!queryTerms.has(term)) {
-          continue;
-        }
-        const df = this._documentFrequency.get(term) ?? 1;
-        overlap += Math.log(1 + totalDocs / df);
-      }
+      const overlap = overlaps.get(id) ?? 0;
       if (!overlap && !wantedTags.size) {
         continue;
       }
@@ -616,29 +1075,29 @@ export default class LocalContextMemory {
       }
       scored.push({ record, score });
     }
-    scored.sort(
-      (left, right) =>
-        right.score - left.score ||
-        String(right.record.updatedAt).localeCompare(String(left.record.updatedAt)) ||
-        left.record.id.localeCompare(right.record.id),
-    );
 
     const referenceCandidates = [];
     const seenText = new Set();
-    for (const { record, score } of scored) {
+    // Most records yield at least one candidate, so twice the budget is nearly
+    // always enough; when duplicates exhaust it, fall back to the full order.
+    let ordered = takeTop(scored, max * 2, compareScored);
+    for (let index = 0; index < ordered.length; index += 1) {
+      const { record, score } = ordered[index];
+      const referenceTerms = this._derived.get(record.id)?.references ?? [];
       // A record matches as a whole, but only some of its sentences answer the
       // seed. Emitting them in storage order means a four-sentence recap can
       // spend the whole candidate budget on its title line and never surface
       // the file list that actually matched.
-      const ranked = [...record.references]
-        .map((reference) => ({
-          reference,
-          hits: new Set(stemAll(contentWords(reference.text))).size
-            ? [...new Set(stemAll(contentWords(reference.text)))].filter((term) =>
-                queryTerms.has(term),
-              ).length
-            : 0,
-        }))
+      const ranked = record.references
+        .map((reference, position) => {
+          let hits = 0;
+          for (const term of referenceTerms[position] ?? []) {
+            if (queryTerms.has(term)) {
+              hits += 1;
+            }
+          }
+          return { reference, hits };
+        })
         .sort(
           (left, right) =>
             right.hits - left.hits ||
@@ -653,23 +1112,14 @@ export default class LocalContextMemory {
           continue;
         }
         seenText.add(text);
-        referenceCandidates.push({
-          // `local:` is what keeps this out of the graph-node boost path: it
-          // names a stored sentence, never a live ContextGraph node.
-          id: `local:${record.id}:${reference.id}`,
-          referenceId: reference.id,
-          text,
-          sourceNodeId: null,
-          origin: "local",
-          recordId: record.id,
-          kind: record.kind,
-          source: reference.source || record.source,
-          ordinal: reference.ordinal ?? 0,
-          score,
-          novelty: 0,
-          distance: 0,
-          sourceCount: 1,
-        });
+        referenceCandidates.push(this._candidate(record, reference, text, score));
+      }
+      if (
+        index === ordered.length - 1 &&
+        referenceCandidates.length < max &&
+        ordered.length < scored.length
+      ) {
+        ordered = [...scored].sort(compareScored);
       }
       if (referenceCandidates.length >= max) {
         break;
@@ -682,16 +1132,247 @@ export default class LocalContextMemory {
       engine: "local",
       referenceCandidates,
       matched: scored.length,
-      scanned: this._records.size,
+      scanned: wantedTags.size ? this._records.size : overlaps.size,
+      elapsedMs: Date.now() - started,
+    };
+  }
+
+  // ---------------------------------------------------------------------------
+  // Semantic layer. Optional, JSONL-only, and strictly additive: it widens the
+  // pool the lexical ranking produces, it never replaces it.
+  // ---------------------------------------------------------------------------
+
+  /**
+   * Enables hybrid recall over `embeddings` (a `LocalMemoryEmbeddings`).
+   * `weight` scales cosine similarity into the lexical score range;
+   * `minSimilarity` is the floor for a sentence with no lexical overlap to
+   * enter the pool at all.
+   */
+  attachEmbeddings(embeddings, { weight = undefined, minSimilarity = undefined } = {}) {
+    this._referencesByHash.clear();
+    this._hashesByRecord.clear();
+    this._embeddingQueue.clear();
+    this.embeddings = embeddings ?? null;
+    if (Number.isFinite(weight)) {
+      this.semanticWeight = Math.max(0, Number(weight));
+    }
+    if (Number.isFinite(minSimilarity)) {
+      this.minSimilarity = Number(minSimilarity);
+    }
+    if (this.embeddings) {
+      // The one full pass: from here on records post their own sentences.
+      for (const record of this._records.values()) {
+        this._postSentences(record);
+      }
+    }
+    return this;
+  }
+
+  /** Maps one record's sentences to their hashes and queues the ones without a vector. */
+  _postSentences(record) {
+    const hashes = [];
+    for (const reference of record.references) {
+      const text = reference.text.trim();
+      if (!text) {
+        continue;
+      }
+      const hash = embeddingHash(text);
+      const posted = this._referencesByHash.get(hash);
+      if (posted) {
+        posted.push({ recordId: record.id, referenceId: reference.id });
+      } else {
+        this._referencesByHash.set(hash, [{ recordId: record.id, referenceId: reference.id }]);
+      }
+      hashes.push(hash);
+      if (!this.embeddings.has(hash)) {
+        this._embeddingQueue.set(hash, text);
+      }
+    }
+    this._hashesByRecord.set(record.id, hashes);
+    if (this._embeddingQueue.size && Date.now() >= this._embeddingRetryAt) {
+      this.syncEmbeddings().catch(() => {});
+    }
+  }
+
+  /** The reverse; a sentence no record holds any more is forgotten by the vector cache too. */
+  _unpostSentences(id) {
+    const hashes = this._hashesByRecord.get(id);
+    if (!hashes) {
+      return;
+    }
+    this._hashesByRecord.delete(id);
+    for (const hash of hashes) {
+      const remaining = (this._referencesByHash.get(hash) ?? []).filter((entry) => entry.recordId !== id);
+      if (remaining.length) {
+        this._referencesByHash.set(hash, remaining);
+        continue;
+      }
+      this._referencesByHash.delete(hash);
+      this._embeddingQueue.delete(hash);
+      this.embeddings?.forget(hash);
+    }
+  }
+
+  /**
+   * Embeds the queued sentences in the background, a few batches at a time,
+   * saving after each step so recall can use them as they land. Concurrent
+   * callers share one pass; a failure leaves the rest queued.
+   */
+  syncEmbeddings() {
+    if (!this.embeddings) {
+      return Promise.resolve();
+    }
+    if (!this._embeddingSync) {
+      const embeddings = this.embeddings;
+      this._embeddingSync = (async () => {
+        await embeddings.load();
+        while (this._embeddingQueue.size && this.embeddings === embeddings) {
+          const step = [...this._embeddingQueue]
+            .slice(0, embeddings.batchSize * EMBEDDING_SYNC_BATCHES)
+            .map(([hash, text]) => ({ hash, text }));
+          await embeddings.ensure(step);
+          for (const { hash, text } of step) {
+            if (this._embeddingQueue.get(hash) === text) {
+              this._embeddingQueue.delete(hash);
+            }
+          }
+          await embeddings.save();
+        }
+        // Forgotten sentences are persisted too, when nothing was embedded.
+        await embeddings.save();
+      })()
+        .catch((error) => {
+          const message = error instanceof Error ? error.message : String(error);
+          this._stats.lastError = message;
+          this._embeddingRetryAt = Date.now() + EMBEDDING_RETRY_MS;
+          this._log(`embedding sync failed; ${this._embeddingQueue.size} sentence(s) stay queued: ${message}`);
+          throw error;
+        })
+        .finally(() => {
+          this._embeddingSync = null;
+        });
+    }
+    return this._embeddingSync;
+  }
+
+  /**
+   * Lexical recall widened by nearest-neighbour sentences. Lexical candidates
+   * keep their score plus `semanticWeight * cosine`; sentences reached only
+   * through the vector index enter with their record's importance floor plus
+   * the same term, so a paraphrase can outrank a weak keyword hit but a strong
+   * keyword hit is never displaced by a vague one. The candidate budget is the
+   * same as lexical recall's, so the prompt does not grow.
+   */
+  async _recallHybrid(options = undefined) {
+    const started = Date.now();
+    const max = toPositiveInteger(options?.limit, this.maxCandidates);
+    const lexical = this._recallLexical({ ...(options ?? {}), limit: max * 2 });
+    const seedText = normalizeText(options?.text, 6000);
+    const lexicalOnly = () => ({
+      ...lexical,
+      referenceCandidates: lexical.referenceCandidates.slice(0, max),
+      semantic: 0,
+      elapsedMs: Date.now() - started,
+    });
+    if (!seedText) {
+      return lexicalOnly();
+    }
+    let query = null;
+    let hits = [];
+    try {
+      // Only what is already embedded is searched; sentences still queued are
+      // ranked lexically, and the sync catches up in the background.
+      await this.embeddings.load();
+      if (this._embeddingQueue.size && !this._embeddingSync && Date.now() >= this._embeddingRetryAt) {
+        this.syncEmbeddings().catch(() => {});
+      }
+      query = await this.embeddings.embedQuery(seedText);
+      hits = this.embeddings.search(query, max * 2);
+    } catch (error) {
+      const message = error instanceof Error ? error.message : String(error);
+      this._stats.lastError = message;
+      this._log(`semantic recall unavailable, using lexical ranking: ${message}`);
+      return lexicalOnly();
+    }
+    const pool = new Map();
+    for (const candidate of lexical.referenceCandidates) {
+      const similarity = this.embeddings.similarityTo(query, embeddingHash(candidate.text)) ?? 0;
+      pool.set(candidate.text, { candidate, similarity: Math.max(0, similarity) });
+    }
+    let semantic = 0;
+    for (const { hash, similarity } of hits) {
+      if (similarity < this.minSimilarity) {
+        break;
+      }
+      for (const { recordId, referenceId } of this._referencesByHash.get(hash) ?? []) {
+        const record = this._records.get(recordId);
+        if (!record || (options?.excludeSessionId && record.sessionId === options.excludeSessionId)) {
+          continue;
+        }
+        const reference = record.references.find((entry) => entry.id === referenceId);
+        const text = reference?.text.trim();
+        if (!text) {
+          continue;
+        }
+        if (!pool.has(text)) {
+          pool.set(text, {
+            candidate: this._candidate(record, reference, text, record.importance * 0.15),
+            similarity,
+          });
+          semantic += 1;
+        }
+        break;
+      }
+    }
+    const referenceCandidates = [...pool.values()]
+      .map(({ candidate, similarity }) => ({
+        ...candidate,
+        score: candidate.score + this.semanticWeight * similarity,
+        similarity,
+      }))
+      .sort((left, right) => right.score - left.score || left.id.localeCompare(right.id))
+      .slice(0, max);
+    this._stats.semanticHits += semantic;
+    return {
+      ok: true,
+      engine: "local",
+      referenceCandidates,
+      matched: lexical.matched + semantic,
+      semantic,
+      scanned: lexical.scanned,
       elapsedMs: Date.now() - started,
     };
   }
 
+  /** The Cheetah reference-candidate shape every backend returns. */
+  _candidate(record, reference, text, score) {
+    return {
+      // `local:` is what keeps this out of the graph-node boost path: it
+      // names a stored sentence, never a live ContextGraph node.
+      id: `local:${record.id}:${reference.id}`,
+      referenceId: reference.id,
+      text,
+      sourceNodeId: null,
+      origin: "local",
+      recordId: record.id,
+      kind: record.kind,
+      source: reference.source || record.source,
+      ordinal: reference.ordinal ?? 0,
+      score,
+      novelty: 0,
+      distance: 0,
+      sourceCount: 1,
+    };
+  }
+
   stats() {
     return {
       ...this._stats,
-      records: this._records.size,
+      records: this._recordCount(),
       sources: this._sources.size,
+      embeddings: this.embeddings
+        ? { model: this.embeddings.model, vectors: this.embeddings.size, ...this.embeddings.stats }
+        : null,
       memoryDir: this.memoryDir,
       projectId: this.projectId,
     };
@@ -702,44 +1383,64 @@ export default class LocalContextMemory {
   // so nothing has to be persisted twice to become recallable.
   // ---------------------------------------------------------------------------
 
-  async _collectSources() {
-    const sources = [];
-    const push = async (absolutePath, read) => {
-      let stat = null;
-      try {
-        stat = await fs.promises.stat(absolutePath);
-      } catch {
-        return;
-      }
-      if (!stat.isFile()) {
-        return;
-      }
-      sources.push({
+  /**
+   * Lists every harvestable source, then stats them `ioConcurrency` at a time.
+   * With `only`, candidates outside that key set are not stat'ed and come back
+   * as `untouched`, so the caller keeps their cached state instead of treating
+   * them as deleted.
+   */
+  async _collectSources({ only = null } = {}) {
+    const candidates = [];
+    const candidate = (absolutePath, read) =>
+      candidates.push({
         key: path.relative(this.baseDir, absolutePath).split(path.sep).join("/"),
-        size: stat.size,
-        mtimeMs: Math.floor(stat.mtimeMs),
+        absolutePath,
         read: () => read(absolutePath),
       });
-    };
 
     for (const noteFile of await this._listDir(this.notesDir)) {
       if (!/\.(md|markdown|txt)$/i.test(noteFile)) {
         continue;
       }
-      await push(path.join(this.notesDir, noteFile), (target) => this._readNote(target));
+      candidate(path.join(this.notesDir, noteFile), (target) => this._readNote(target));
     }
 
-    const sessionsDir = path.join(this.baseDir, "agent-sessions");
+    const sessionsDir = path.join(this.baseDir, SESSIONS_DIRNAME);
     const sessionDirs = (await this._listDir(sessionsDir)).sort().slice(-this.harvestSessions);
     for (const sessionDir of sessionDirs) {
-      await push(path.join(sessionsDir, sessionDir, "context-graph.json"), (target) =>
+      candidate(path.join(sessionsDir, sessionDir, "context-graph.json"), (target) =>
         this._readContextGraph(target, sessionDir),
       );
-      await push(path.join(sessionsDir, sessionDir, "result.json"), (target) =>
+      candidate(path.join(sessionsDir, sessionDir, "result.json"), (target) =>
         this._readResult(target, sessionDir),
       );
     }
-    return sources;
+
+    const wanted = only ? candidates.filter((entry) => only.has(entry.key)) : candidates;
+    const untouched = only
+      ? candidates.filter((entry) => !only.has(entry.key)).map((entry) => entry.key)
+      : [];
+    const stats = await mapWithConcurrency(wanted, this.ioConcurrency, async (entry) => {
+      try {
+        return await fs.promises.stat(entry.absolutePath);
+      } catch {
+        return null;
+      }
+    });
+    const sources = [];
+    for (const [index, entry] of wanted.entries()) {
+      const stat = stats[index];
+      if (!stat?.isFile()) {
+        continue;
+      }
+      sources.push({
+        key: entry.key,
+        size: stat.size,
+        mtimeMs: Math.floor(stat.mtimeMs),
+        read: entry.read,
+      });
+    }
+    return { sources, untouched };
   }
 
   async _listDir(dir) {
@@ -912,21 +1613,61 @@ export function resolveLocalMemoryConfig(configData = undefined, env = process.e
     rawEnabled === undefined || rawEnabled === null
       ? true
       : !["0", "false", "no", "off", "disabled"].includes(String(rawEnabled).trim().toLowerCase());
+  const rawBackend = String(env.MINIPHI_LOCAL_MEMORY_BACKEND ?? local.backend ?? "jsonl")
+    .trim()
+    .toLowerCase();
+  const backend = BACKENDS.has(rawBackend) ? rawBackend : "jsonl";
   return {
     enabled,
+    backend,
+    dbPath: typeof local.dbPath === "string" && local.dbPath.trim() ? local.dbPath.trim() : null,
     maxCandidates: toPositiveInteger(
       env.MINIPHI_LOCAL_MEMORY_CANDIDATES ?? local.maxCandidates,
       DEFAULT_MAX_CANDIDATES,
     ),
-    maxRecords: toPositiveInteger(local.maxRecords, DEFAULT_MAX_RECORDS),
+    // The cap exists to keep the resident JSONL corpus small; SQLite keeps
+    // nothing resident, so its default only guards against runaway growth.
+    maxRecords: toPositiveInteger(
+      local.maxRecords,
+      backend === "sqlite" ? DEFAULT_SQLITE_MAX_RECORDS : DEFAULT_MAX_RECORDS,
+    ),
     harvestSessions: toPositiveInteger(local.harvestSessions, DEFAULT_HARVEST_SESSIONS),
     minScore: Number.isFinite(local.minScore) ? Number(local.minScore) : DEFAULT_MIN_SCORE,
+    flushDelayMs: Number.isFinite(local.flushDelayMs)
+      ? Math.max(0, Number(local.flushDelayMs))
+      : DEFAULT_FLUSH_DELAY_MS,
+    ioConcurrency: toPositiveInteger(local.ioConcurrency, DEFAULT_IO_CONCURRENCY),
+    watch: local.watch === true,
+    embeddings: resolveEmbeddingsConfig(local.embeddings, env),
+  };
+}
+
+/**
+ * Semantic recall is opt-in and needs an embedding model loaded in LM Studio;
+ * naming the model (config or `MINIPHI_LOCAL_MEMORY_EMBEDDING_MODEL`) is what
+ * turns it on, and `enabled: false` turns it back off.
+ */
+function resolveEmbeddingsConfig(raw, env) {
+  const embeddings = raw && typeof raw === "object" ? raw : {};
+  const model = String(env.MINIPHI_LOCAL_MEMORY_EMBEDDING_MODEL ?? embeddings.model ?? "").trim();
+  return {
+    enabled: Boolean(model) && embeddings.enabled !== false,
+    model: model || null,
+    batchSize: toPositiveInteger(embeddings.batchSize, 32),
+    weight: Number.isFinite(embeddings.weight) ? Number(embeddings.weight) : DEFAULT_SEMANTIC_WEIGHT,
+    minSimilarity: Number.isFinite(embeddings.minSimilarity)
+      ? Number(embeddings.minSimilarity)
+      : DEFAULT_MIN_SIMILARITY,
   };
 }
 
 /**
  * Builds a prepared, refreshed store. Returns null when disabled so callers can
- * treat "no local memory" the same way they treat "no Cheetah".
+ * treat "no local memory" the same way they treat "no Cheetah". The SQLite
+ * backend is loaded lazily; if its driver (or FTS5) is unavailable the store
+ * falls back to JSONL rather than running without memory. `embeddingClient`
+ * (an `LMStudioRestClient`) enables semantic recall when an embedding model is
+ * configured; the first embedding pass runs in the background.
  */
 export async function createLocalContextMemory({
   baseDir,
@@ -935,12 +1676,13 @@ export async function createLocalContextMemory({
   sessionId = null,
   projectId = null,
   logger = null,
+  embeddingClient = null,
 } = {}) {
   const config = resolveLocalMemoryConfig(configData, env);
   if (!config.enabled || !baseDir) {
     return null;
   }
-  const memory = new LocalContextMemory({
+  const options = {
     baseDir,
     sessionId,
     projectId,
@@ -949,8 +1691,57 @@ export async function createLocalContextMemory({
     maxRecords: config.maxRecords,
     harvestSessions: config.harvestSessions,
     minScore: config.minScore,
-  });
-  await memory.prepare();
+    flushDelayMs: config.flushDelayMs,
+    ioConcurrency: config.ioConcurrency,
+    dbPath: config.dbPath,
+  };
+  let memory = null;
+  if (config.backend === "sqlite") {
+    try {
+      const { default: SqliteLocalContextMemory } = await import(
+        "./local-context-memory-sqlite.js"
+      );
+      memory = new SqliteLocalContextMemory(options);
+      await memory.prepare();
+    } catch (error) {
+      const message = error instanceof Error ? error.message : String(error);
+      logger?.(`[LocalContextMemory] SQLite backend unavailable, using JSONL: ${message}`);
+      memory = null;
+    }
+  }
+  if (!memory) {
+    const jsonl = resolveLocalMemoryConfig(configData, {
+      ...env,
+      MINIPHI_LOCAL_MEMORY_BACKEND: "jsonl",
+    });
+    memory = new LocalContextMemory({ ...options, maxRecords: jsonl.maxRecords });
+    await memory.prepare();
+  }
+  if (config.embeddings.enabled && embeddingClient) {
+    if (memory.constructor === LocalContextMemory) {
+      memory.attachEmbeddings(
+        new LocalMemoryEmbeddings({
+          dir: path.join(memory.memoryDir, LOCAL_EMBEDDINGS_DIRNAME),
+          client: embeddingClient,
+          model: config.embeddings.model,
+          batchSize: config.embeddings.batchSize,
+          logger,
+        }),
+        config.embeddings,
+      );
+    } else {
+      logger?.("[LocalContextMemory] semantic recall needs the jsonl backend; using FTS only");
+    }
+  }
+  if (config.watch) {
+    memory.watch();
+  }
   await memory.refresh();
+  if (memory.embeddings) {
+    memory.syncEmbeddings().catch((error) => {
+      const message = error instanceof Error ? error.message : String(error);
+      logger?.(`[LocalContextMemory] embedding warm-up failed: ${message}`);
+    });
+  }
   return memory;
 }
@@ -0,0 +1,660 @@
+import { createHash } from "node:crypto";
+import fs from "node:fs";
+import path from "node:path";
+import { writeFileAtomic } from "./atomic-file.js";
+
+/**
+ * Dense vectors for local memory's reference sentences.
+ *
+ * Every other recall path in MiniPhi is bag-of-words, which is exactly right
+ * for file names and identifiers and exactly wrong for a paraphrase: "which
+ * database did we settle on" shares no content word with "uploads are stored
+ * in SQLite". This module embeds each stored sentence once through LM Studio's
+ * `/embeddings` route and answers nearest-neighbour queries in process.
+ *
+ * - **Cached by content hash.** A vector is keyed by the SHA-256 of the
+ *   sentence text, so re-harvesting an unchanged note, or the same sentence in
+ *   two records, never costs another embedding call. Switching the embedding
+ *   model (or its dimensionality) discards the cache instead of mixing spaces.
+ * - **Batched.** Missing sentences go to the endpoint `batchSize` at a time.
+ * - **HNSW above a threshold.** Below `bruteForceBelow` vectors an exact scan is
+ *   both faster and simpler; above it a small HNSW graph keeps queries
+ *   sub-linear. Node levels are derived from the content hash, so rebuilding the
+ *   graph from the same vectors yields the same graph.
+ * - **Forgetting tombstones.** `forget(hash)` takes a sentence out of results
+ *   at once; its node stays in the graph as a waypoint (and is revived free if
+ *   the sentence comes back) until compaction drops it.
+ * - **Append-only on disk.** `vectors-<generation>.f32` gets each new vector
+ *   appended, and `graph-<generation>.jsonl` one line per node whose hash,
+ *   links or tombstone changed (the last line for a node wins). Once
+ *   tombstones or superseded lines pile up, a compaction rebuilds both files
+ *   from the live vectors under a new generation, switched over by rewriting
+ *   the small `index.json`.
+ * - **Disposable.** Everything under `embeddings/` is a cache; deleting it costs
+ *   one re-embedding pass, never a fact.
+ */
+
+export const LOCAL_EMBEDDINGS_SCHEMA_VERSION = "local-memory-embeddings@v2";
+export const LOCAL_EMBEDDINGS_DIRNAME = "embeddings";
+
+const META_FILE = "index.json";
+const DATA_FILE_PATTERN = /^(?:vectors(?:-[a-z0-9]+)?\.f32|graph-[a-z0-9]+\.jsonl)$/;
+const COMPACT_MIN_TOMBSTONES = 64;
+const COMPACT_MIN_LINES = 1024;
+const DEFAULT_BATCH_SIZE = 32;
+const DEFAULT_BRUTE_FORCE_BELOW = 1024;
+const DEFAULT_M = 16;
+const DEFAULT_EF_CONSTRUCTION = 100;
+const QUERY_CACHE_SIZE = 64;
+
+export const embeddingHash = (text) =>
+  createHash("sha256").update(String(text ?? ""), "utf8").digest("hex").slice(0, 32);
+
+const normalizeVector = (values) => {
+  const vector = Float32Array.from(values, (value) => Number(value) || 0);
+  let norm = 0;
+  for (const value of vector) {
+    norm += value * value;
+  }
+  norm = Math.sqrt(norm);
+  if (!norm) {
+    return null;
+  }
+  for (let index = 0; index < vector.length; index += 1) {
+    vector[index] /= norm;
+  }
+  return vector;
+};
+
+const dot = (left, right) => {
+  let sum = 0;
+  for (let index = 0; index < left.length; index += 1) {
+    sum += left[index] * right[index];
+  }
+  return sum;
+};
+
+/** A binary heap; `before(a, b)` is true when `a` belongs nearer the top. */
+class Heap {
+  constructor(before) {
+    this.before = before;
+    this.items = [];
+  }
+
+  get size() {
+    return this.items.length;
+  }
+
+  peek() {
+    return this.items[0];
+  }
+
+  push(item) {
+    const items = this.items;
+    items.push(item);
+    let index = items.length - 1;
+    while (index > 0) {
+      const parent = (index - 1) >> 1;
+      if (!this.before(items[index], items[parent])) {
+        break;
+      }
+      [items[index], items[parent]] = [items[parent], items[index]];
+      index = parent;
+    }
+  }
+
+  pop() {
+    const items = this.items;
+    const top = items[0];
+    const last = items.pop();
+    if (items.length) {
+      items[0] = last;
+      let index = 0;
+      for (;;) {
+        const left = index * 2 + 1;
+        const right = left + 1;
+        let best = index;
+        if (left < items.length && this.before(items[left], items[best])) {
+          best = left;
+        }
+        if (right < items.length && this.before(items[right], items[best])) {
+          best = right;
+        }
+        if (best === index) {
+          break;
+        }
+        [items[index], items[best]] = [items[best], items[index]];
+        index = best;
+      }
+    }
+    return top;
+  }
+}
+
+/**
+ * Hierarchical navigable small-world graph over unit vectors (cosine = dot).
+ * Nodes are dense integers in insertion order; the caller owns the mapping
+ * from node to content hash.
+ */
+export class HnswIndex {
+  constructor({ m = DEFAULT_M, efConstruction = DEFAULT_EF_CONSTRUCTION } = {}) {
+    this.m = m;
+    this.efConstruction = efConstruction;
+    this.levelFactor = 1 / Math.log(m);
+    /** @type {Float32Array[]} */
+    this.vectors = [];
+    /** @type {number[][][]} neighbors[node][level] */
+    this.neighbors = [];
+    this.entryPoint = -1;
+    this.maxLevel = -1;
+    /** Nodes added, or whose links changed, since the owner last cleared this. */
+    this.changed = new Set();
+  }
+
+  get size() {
+    return this.vectors.length;
+  }
+
+  /** `unit` in (0, 1] picks the node's level; pass a hash-derived value for determinism. */
+  add(vector, unit) {
+    const node = this.vectors.length;
+    const level = Math.floor(-Math.log(Math.min(1, Math.max(unit, 1e-12))) * this.levelFactor);
+    this.vectors.push(vector);
+    this.neighbors.push(Array.from({ length: level + 1 }, () => []));
+    this.changed.add(node);
+    if (this.entryPoint < 0) {
+      this.entryPoint = node;
+      this.maxLevel = level;
+      return node;
+    }
+    let entry = this.entryPoint;
+    for (let layer = this.maxLevel; layer > level; layer -= 1) {
+      entry = this._searchLayer(vector, [entry], 1, layer)[0].node;
+    }
+    for (let layer = Math.min(level, this.maxLevel); layer >= 0; layer -= 1) {
+      const found = this._searchLayer(vector, [entry], this.efConstruction, layer);
+      const limit = layer === 0 ? this.m * 2 : this.m;
+      const selected = found.slice(0, limit).map((hit) => hit.node);
+      this.neighbors[node][layer] = selected;
+      for (const other of selected) {
+        const links = this.neighbors[other][layer];
+        links.push(node);
+        this.changed.add(other);
+        if (links.length > limit) {
+          const base = this.vectors[other];
+          links.sort((left, right) => dot(base, this.vectors[right]) - dot(base, this.vectors[left]));
+          links.length = limit;
+        }
+      }
+      entry = found[0].node;
+    }
+    if (level > this.maxLevel) {
+      this.entryPoint = node;
+      this.maxLevel = level;
+    }
+    return node;
+  }
+
+  search(query, k, ef = Math.max(k, 64)) {
+    if (this.entryPoint < 0) {
+      return [];
+    }
+    let entry = this.entryPoint;
+    for (let layer = this.maxLevel; layer > 0; layer -= 1) {
+      entry = this._searchLayer(query, [entry], 1, layer)[0].node;
+    }
+    return this._searchLayer(query, [entry], Math.max(ef, k), 0).slice(0, k);
+  }
+
+  _searchLayer(query, entries, ef, layer) {
+    const visited = new Set(entries);
+    const candidates = new Heap((left, right) => left.similarity > right.similarity);
+    const results = new Heap((left, right) => left.similarity < right.similarity);
+    for (const node of entries) {
+      const hit = { node, similarity: dot(query, this.vectors[node]) };
+      candidates.push(hit);
+      results.push(hit);
+    }
+    while (candidates.size) {
+      const current = candidates.pop();
+      if (results.size >= ef && current.similarity < results.peek().similarity) {
+        break;
+      }
+      for (const neighbor of this.neighbors[current.node][layer] ?? []) {
+        if (visited.has(neighbor)) {
+          continue;
+        }
+        visited.add(neighbor);
+        const similarity = dot(query, this.vectors[neighbor]);
+        if (results.size < ef || similarity > results.peek().similarity) {
+          const hit = { node: neighbor, similarity };
+          candidates.push(hit);
+          results.push(hit);
+          if (results.size > ef) {
+            results.pop();
+          }
+        }
+      }
+    }
+    const out = [];
+    while (results.size) {
+      out.push(results.pop());
+    }
+    return out.reverse();
+  }
+
+  /** An index over `vectors` with links restored from disk. */
+  static restore({ m, efConstruction, entryPoint, maxLevel }, vectors, neighbors) {
+    const index = new HnswIndex({ m, efConstruction });
+    index.vectors = vectors;
+    index.neighbors = neighbors;
+    index.entryPoint = entryPoint;
+    index.maxLevel = maxLevel;
+    return index;
+  }
+}
+
+
+const newGeneration = () =>
+  `${Date.now().toString(36)}${Math.floor(Math.random() * 0x100000).toString(36)}`;
+
+/**
+ * The on-disk embedding cache plus its ANN index, for one embedding model.
+ */
+export default class LocalMemoryEmbeddings {
+  constructor(options = undefined) {
+    this.dir = path.resolve(options?.dir ?? path.join(process.cwd(), ".miniphi", "memory", LOCAL_EMBEDDINGS_DIRNAME));
+    this.client = options?.client ?? null;
+    this.model = typeof options?.model === "string" && options.model.trim() ? options.model.trim() : null;
+    this.batchSize = Math.max(1, Math.floor(Number(options?.batchSize) || DEFAULT_BATCH_SIZE));
+    this.bruteForceBelow = Number.isFinite(options?.bruteForceBelow)
+      ? Math.max(0, Number(options.bruteForceBelow))
+      : DEFAULT_BRUTE_FORCE_BELOW;
+    this.timeoutMs = Number.isFinite(options?.timeoutMs) ? Number(options.timeoutMs) : undefined;
+    this.logger = typeof options?.logger === "function" ? options.logger : null;
+    this.dimensions = 0;
+    /** @type {string[]} node -> hash, tombstoned nodes included */
+    this.hashes = [];
+    /** @type {Map<string, number>} hash -> node, live sentences only */
+    this.nodes = new Map();
+    /** @type {Map<string, number>} hash -> node, tombstoned sentences */
+    this.tombstones = new Map();
+    this.index = new HnswIndex();
+    this._queryCache = new Map();
+    this._loading = null;
+    this._loaded = false;
+    /** Hashes forgotten before the cache finished loading. */
+    this._forgetOnLoad = new Set();
+    this._dirty = false;
+    // On-disk state: the generation's files hold `_savedNodes` vectors and
+    // `_logLines` graph lines; null until the first save (or after a reset).
+    this.generation = null;
+    this._savedNodes = 0;
+    this._logLines = 0;
+    this.stats = { embedded: 0, requests: 0, queries: 0, forgotten: 0, compactions: 0, lastError: null };
+  }
+
+  /** Live (not forgotten) vectors. */
+  get size() {
+    return this.nodes.size;
+  }
+
+  _log(message) {
+    if (this.logger) {
+      this.logger(`[LocalMemoryEmbeddings] ${message}`);
+    }
+  }
+
+  _reset() {
+    this.dimensions = 0;
+    this.hashes = [];
+    this.nodes = new Map();
+    this.tombstones = new Map();
+    this.index = new HnswIndex();
+    this._queryCache.clear();
+    this.generation = null;
+    this._savedNodes = 0;
+    this._logLines = 0;
+  }
+
+  _vectorsPath(generation = this.generation) {
+    return path.join(this.dir, `vectors-${generation}.f32`);
+  }
+
+  _graphPath(generation = this.generation) {
+    return path.join(this.dir, `graph-${generation}.jsonl`);
+  }
+
+  load() {
+    if (!this._loading) {
+      this._loading = this._load().finally(() => {
+        this._loaded = true;
+        for (const hash of this._forgetOnLoad) {
+          this.forget(hash);
+        }
+        this._forgetOnLoad.clear();
+      });
+    }
+    return this._loading.then(() => this);
+  }
+
+  async _load() {
+    let meta = null;
+    let buffer = null;
+    let log = "";
+    try {
+      meta = JSON.parse(await fs.promises.readFile(path.join(this.dir, META_FILE), "utf8"));
+      if (typeof meta?.generation !== "string") {
+        return;
+      }
+      buffer = await fs.promises.readFile(this._vectorsPath(meta.generation));
+      log = await fs.promises.readFile(this._graphPath(meta.generation), "utf8");
+    } catch {
+      return;
+    }
+    const dimensions = Number(meta.dimensions) || 0;
+    if (meta.schemaVersion !== LOCAL_EMBEDDINGS_SCHEMA_VERSION || meta.model !== this.model || !dimensions) {
+      // A different model is a different vector space; never mix the two.
+      return;
+    }
+    const stored = Math.floor(buffer.byteLength / (dimensions * 4));
+    const hashes = [];
+    const neighbors = [];
+    const dead = new Set();
+    let lines = 0;
+    for (const line of log.split("\n")) {
+      let parsed;
+      try {
+        parsed = line ? JSON.parse(line) : null;
+      } catch {
+        continue; // a torn last line
+      }
+      const [node, hash, links, tombstone] = Array.isArray(parsed) ? parsed : [];
+      if (!Number.isInteger(node) || node < 0 || node >= stored || typeof hash !== "string" || !Array.isArray(links)) {
+        continue;
+      }
+      lines += 1;
+      hashes[node] = hash;
+      neighbors[node] = links;
+      if (tombstone) {
+        dead.add(node);
+      } else {
+        dead.delete(node);
+      }
+    }
+    // Vectors are appended before their graph lines, so a crash in between
+    // leaves vectors without a node; everything from the first gap is dropped.
+    let count = 0;
+    while (count < stored && neighbors[count]) {
+      count += 1;
+    }
+    if (!count) {
+      return;
+    }
+    const floats = new Float32Array(buffer.buffer, buffer.byteOffset, count * dimensions);
+    const vectors = Array.from({ length: count }, (_, node) =>
+      floats.slice(node * dimensions, (node + 1) * dimensions),
+    );
+    const links = neighbors
+      .slice(0, count)
+      .map((layers) => layers.map((layer) => (Array.isArray(layer) ? layer.filter((other) => other < count) : [])));
+    let entryPoint = Number.isInteger(meta.entryPoint) && meta.entryPoint < count ? meta.entryPoint : 0;
+    for (let node = 0; node < count; node += 1) {
+      if (links[node].length > links[entryPoint].length) {
+        entryPoint = node;
+      }
+    }
+    this.dimensions = dimensions;
+    this.hashes = hashes.slice(0, count);
+    this.nodes = new Map();
+    this.tombstones = new Map();
+    this.hashes.forEach((hash, node) => (dead.has(node) ? this.tombstones : this.nodes).set(hash, node));
+    this.index = HnswIndex.restore(
+      { m: meta.m, efConstruction: meta.efConstruction, entryPoint, maxLevel: links[entryPoint].length - 1 },
+      vectors,
+      links,
+    );
+    this.generation = meta.generation;
+    this._savedNodes = count;
+    this._logLines = lines;
+    if (count < stored) {
+      await fs.promises.truncate(this._vectorsPath(), count * dimensions * 4).catch(() => {
+        this.generation = null;
+      });
+    }
+  }
+
+  _levelUnit(hash) {
+    return (parseInt(String(hash).slice(0, 8), 16) + 1) / 0x100000001;
+  }
+
+  has(hash) {
+    return this.nodes.has(hash);
+  }
+
+  /**
+   * Takes a sentence out of results. Its vector is kept as a tombstone until
+   * the next compaction. Returns whether it was cached.
+   */
+  forget(hash) {
+    if (!this._loaded) {
+      this._forgetOnLoad.add(hash);
+      return false;
+    }
+    const node = this.nodes.get(hash);
+    if (node === undefined) {
+      return false;
+    }
+    this.nodes.delete(hash);
+    this.tombstones.set(hash, node);
+    this.index.changed.add(node);
+    this.stats.forgotten += 1;
+    this._dirty = true;
+    return true;
+  }
+
+  async _embed(texts) {
+    if (!this.client || typeof this.client.createEmbedding !== "function" || !this.model) {
+      throw new Error("no embedding client/model configured");
+    }
+    this.stats.requests += 1;
+    const response = await this.client.createEmbedding({
+      model: this.model,
+      input: texts,
+      ...(this.timeoutMs ? { timeoutMs: this.timeoutMs } : {}),
+    });
+    const data = Array.isArray(response?.data) ? [...response.data] : [];
+    data.sort((left, right) => (left?.index ?? 0) - (right?.index ?? 0));
+    if (data.length !== texts.length) {
+      throw new Error(`embedding endpoint returned ${data.length} vector(s) for ${texts.length} input(s)`);
+    }
+    return data.map((entry) => normalizeVector(entry?.embedding ?? []));
+  }
+
+  /**
+   * Embeds every `{ hash, text }` not already cached, `batchSize` per request;
+   * a tombstoned sentence is revived without a request. Returns the number of
+   * vectors added or revived.
+   */
+  async ensure(items) {
+    await this.load();
+    const missing = [];
+    const queued = new Set();
+    let added = 0;
+    for (const item of items) {
+      if (!item?.hash || this.nodes.has(item.hash) || queued.has(item.hash)) {
+        continue;
+      }
+      const dead = this.tombstones.get(item.hash);
+      if (dead !== undefined) {
+        this.tombstones.delete(item.hash);
+        this.nodes.set(item.hash, dead);
+        this.index.changed.add(dead);
+        added += 1;
+        continue;
+      }
+      queued.add(item.hash);
+      missing.push(item);
+    }
+    for (let offset = 0; offset < missing.length; offset += this.batchSize) {
+      const batch = missing.slice(offset, offset + this.batchSize);
+      const vectors = await this._embed(batch.map((item) => item.text));
+      for (const [position, vector] of vectors.entries()) {
+        if (!vector) {
+          continue;
+        }
+        if (this.dimensions && vector.length !== this.dimensions) {
+          this._log(`dimension changed (${this.dimensions} -> ${vector.length}); resetting cache`);
+          this._reset();
+        }
+        this.dimensions = vector.length;
+        const hash = batch[position].hash;
+        this.nodes.set(hash, this.hashes.length);
+        this.hashes.push(hash);
+        this.index.add(vector, this._levelUnit(hash));
+        this.stats.embedded += 1;
+        added += 1;
+      }
+    }
+    if (added) {
+      this._dirty = true;
+    }
+    return added;
+  }
+
+  async embedQuery(text) {
+    const key = embeddingHash(text);
+    if (this._queryCache.has(key)) {
+      const cached = this._queryCache.get(key);
+      this._queryCache.delete(key);
+      this._queryCache.set(key, cached);
+      return cached;
+    }
+    const [vector] = await this._embed([text]);
+    this._queryCache.set(key, vector);
+    if (this._queryCache.size > QUERY_CACHE_SIZE) {
+      this._queryCache.delete(this._queryCache.keys().next().value);
+    }
+    return vector;
+  }
+
+  /** Cosine similarity between `vector` and one cached sentence, or null if it is not cached. */
+  similarityTo(vector, hash) {
+    const node = this.nodes.get(hash);
+    if (node === undefined || !vector || vector.length !== this.dimensions) {
+      return null;
+    }
+    return dot(vector, this.index.vectors[node]);
+  }
+
+  /** Nearest cached sentences to `vector`, best first, as `{ hash, similarity }`. */
+  search(vector, k) {
+    if (!vector || !this.nodes.size || vector.length !== this.dimensions) {
+      return [];
+    }
+    this.stats.queries += 1;
+    let hits;
+    if (this.nodes.size < this.bruteForceBelow) {
+      hits = [...this.nodes.values()]
+        .map((node) => ({ node, similarity: dot(vector, this.index.vectors[node]) }))
+        .sort((left, right) => right.similarity - left.similarity)
+        .slice(0, k);
+    } else {
+      // Tombstones still route the search; ask for enough to drop them.
+      hits = this.index
+        .search(vector, k + this.tombstones.size)
+        .filter((hit) => !this.tombstones.has(this.hashes[hit.node]))
+        .slice(0, k);
+    }
+    return hits.map((hit) => ({ hash: this.hashes[hit.node], similarity: hit.similarity }));
+  }
+
+  _graphLine(node) {
+    const hash = this.hashes[node];
+    return JSON.stringify([node, hash, this.index.neighbors[node], ...(this.tombstones.has(hash) ? [1] : [])]);
+  }
+
+  _needsCompaction() {
+    return (
+      !this.generation ||
+      this.tombstones.size > Math.max(COMPACT_MIN_TOMBSTONES, this.nodes.size / 4) ||
+      this._logLines > Math.max(COMPACT_MIN_LINES, this.index.size * 4)
+    );
+  }
+
+  /** Appends what changed since the last save, or compacts. Resolves true when anything was written. */
+  async save() {
+    if (!this._dirty) {
+      return false;
+    }
+    await fs.promises.mkdir(this.dir, { recursive: true });
+    if (this._needsCompaction()) {
+      await this._compact();
+    } else {
+      const fresh = this.index.vectors.slice(this._savedNodes);
+      if (fresh.length) {
+        const floats = new Float32Array(fresh.length * this.dimensions);
+        fresh.forEach((vector, position) => floats.set(vector, position * this.dimensions));
+        await fs.promises.appendFile(this._vectorsPath(), Buffer.from(floats.buffer));
+      }
+      const lines = [...this.index.changed].sort((left, right) => left - right).map((node) => this._graphLine(node));
+      if (lines.length) {
+        await fs.promises.appendFile(this._graphPath(), `${lines.join("\n")}\n`, "utf8");
+      }
+      this._savedNodes = this.index.size;
+      this._logLines += lines.length;
+      await this._writeMeta();
+    }
+    this.index.changed.clear();
+    this._dirty = false;
+    return true;
+  }
+
+  /** Rebuilds the graph from the live vectors and writes it under a new generation. */
+  async _compact() {
+    const live = [...this.nodes.entries()].sort((left, right) => left[1] - right[1]);
+    const index = new HnswIndex({ m: this.index.m, efConstruction: this.index.efConstruction });
+    this.hashes = [];
+    this.nodes = new Map();
+    for (const [hash, node] of live) {
+      this.nodes.set(hash, this.hashes.length);
+      this.hashes.push(hash);
+      index.add(this.index.vectors[node], this._levelUnit(hash));
+    }
+    this.index = index;
+    this.tombstones = new Map();
+    this.generation = newGeneration();
+    const floats = new Float32Array(index.size * this.dimensions);
+    index.vectors.forEach((vector, node) => floats.set(vector, node * this.dimensions));
+    const lines = index.vectors.map((_, node) => this._graphLine(node));
+    await writeFileAtomic(this._vectorsPath(), Buffer.from(floats.buffer));
+    await writeFileAtomic(this._graphPath(), lines.length ? `${lines.join("\n")}\n` : "");
+    this._savedNodes = index.size;
+    this._logLines = lines.length;
+    await this._writeMeta();
+    this.stats.compactions += 1;
+    // Earlier generations (and the files of a compaction that crashed before
+    // its index.json landed) are unreachable now.
+    for (const name of await fs.promises.readdir(this.dir).catch(() => [])) {
+      if (DATA_FILE_PATTERN.test(name) && !name.includes(`-${this.generation}.`)) {
+        await fs.promises.rm(path.join(this.dir, name), { force: true });
+      }
+    }
+  }
+
+  async _writeMeta() {
+    await writeFileAtomic(
+      path.join(this.dir, META_FILE),
+      JSON.stringify({
+        schemaVersion: LOCAL_EMBEDDINGS_SCHEMA_VERSION,
+        model: this.model,
+        dimensions: this.dimensions,
+        generation: this.generation,
+        m: this.index.m,
+        efConstruction: this.index.efConstruction,
+        entryPoint: this.index.entryPoint,
+        updatedAt: new Date().toISOString(),
+      }),
+    );
+  }
+}
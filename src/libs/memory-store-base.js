@@ -8,6 +8,8 @@ import {
   slugifyId,
   writeJsonFile,
 } from "./memory-store-utils.js";
+import { getJsonIndexStore } from "./json-index-store.js";
+import { isPagedIndex, queryIndexPage, registerPagedIndex, summarizeIndex } from "./index-pages.js";
 
 export default class MemoryStoreBase {
   constructor(baseDir, options = undefined) {
@@ -23,11 +25,24 @@ export default class MemoryStoreBase {
     });
   }
 
+  // Files the shared index store already holds are read from and written to
+  // its in-memory copy, so a direct read never sees an index older than the
+  // upserts this process has queued for it. Paged indexes always go through
+  // the store, which keeps their head sidecars current.
   async _writeJSON(filePath, data) {
+    const indexes = getJsonIndexStore();
+    if (indexes.has(filePath) || isPagedIndex(filePath)) {
+      await indexes.write(filePath, data);
+      return;
+    }
     await writeJsonFile(filePath, data);
   }
 
   async _readJSON(filePath, fallback = null) {
+    const indexes = getJsonIndexStore();
+    if (indexes.has(filePath)) {
+      return indexes.read(filePath, fallback ?? undefined);
+    }
     return readJsonFile(filePath, fallback);
   }
 
@@ -35,6 +50,43 @@ export default class MemoryStoreBase {
     return upsertIndexEntry(filePath, entry, options);
   }
 
+  /**
+   * Read-modify-write of a managed index through the shared store. `mutate`
+   * may run again if another process rewrote the file first, so it must only
+   * depend on its argument and its closure.
+   */
+  async _updateIndex(filePath, fallback, mutate) {
+    return getJsonIndexStore().update(filePath, mutate, { fallback });
+  }
+
+  /**
+   * Commits the index writes queued so far. Upserts and updates only apply in
+   * memory; stores call this once per record, not once per write, so the
+   * indexes a record touches are rewritten once each.
+   */
+  async _commitIndexes() {
+    await getJsonIndexStore().flush();
+  }
+
+  /**
+   * Opts list indexes into head sidecars (see index-pages.js).
+   * @param {Array<[string, { headSize?: number, orders?: Record<string, (entry: any) => number> }?]>} indexes
+   */
+  _registerPagedIndexes(indexes) {
+    for (const [filePath, options] of indexes) {
+      registerPagedIndex(filePath, options);
+    }
+  }
+
+  /** One `limit`/`offset`/`cursor` page of an index; see `queryIndexPage`. */
+  async _queryIndex(filePath, options = undefined) {
+    return queryIndexPage(filePath, { ...(options ?? {}), store: getJsonIndexStore() });
+  }
+
+  async _summarizeIndex(filePath) {
+    return summarizeIndex(filePath, { store: getJsonIndexStore() });
+  }
+
   _relative(target) {
     return relativePath(this.baseDir, target, this.relativeOptions ?? undefined);
   }
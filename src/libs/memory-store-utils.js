@@ -1,45 +1,46 @@
 import fs from "fs";
 import path from "path";
+import { getJsonIndexStore } from "./json-index-store.js";
+import { createFileExclusive, quarantineCorruptFile, writeFileAtomic } from "./atomic-file.js";
 
+/** Temp file + rename: a crash or a concurrent reader never sees a torn file. */
 export async function writeJsonFile(filePath, data) {
-  await fs.promises.writeFile(filePath, JSON.stringify(data, null, 2), "utf8");
+  await writeFileAtomic(filePath, JSON.stringify(data, null, 2));
 }
 
+/**
+ * Missing or unreadable files resolve to `fallback`. A file that exists but
+ * does not parse is copied aside first, so the write that follows the
+ * fallback cannot silently destroy it.
+ */
 export async function readJsonFile(filePath, fallback = null) {
+  let raw;
+  try {
+    raw = await fs.promises.readFile(filePath, "utf8");
+  } catch {
+    return fallback;
+  }
   try {
-    const raw = await fs.promises.readFile(filePath, "utf8");
     return JSON.parse(raw);
   } catch {
+    if (raw.trim()) {
+      await quarantineCorruptFile(filePath);
+    }
     return fallback;
   }
 }
 
+/**
+ * Newest-first upsert into an `{ entries: [] }` index, capped at `limit`.
+ * Served by the shared JsonIndexStore: the index stays in memory, the upsert
+ * is O(1) by id, and the file is rewritten once per coalesced commit rather
+ * than once per call. Resolves to the index's entry count.
+ */
 export async function upsertIndexEntry(indexPath, entry, options = undefined) {
   if (!indexPath) {
     return null;
   }
-  const fallback =
-    options?.fallback && typeof options.fallback === "object"
-      ? options.fallback
-      : { entries: [] };
-  const index = (await readJsonFile(indexPath, fallback)) ?? fallback;
-  const entries = Array.isArray(index.entries) ? index.entries : [];
-  const idKey = typeof options?.idKey === "string" && options.idKey.trim() ? options.idKey : "id";
-  const entryId = entry && Object.prototype.hasOwnProperty.call(entry, idKey) ? entry[idKey] : null;
-  const filtered = entryId
-    ? entries.filter((item) => item && item[idKey] !== entryId)
-    : entries.slice();
-  if (entry) {
-    filtered.unshift(entry);
-  }
-  const limitRaw = Number(options?.limit);
-  const limit = Number.isFinite(limitRaw) && limitRaw > 0 ? Math.floor(limitRaw) : 200;
-  index.entries = filtered.slice(0, limit);
-  if (options?.setUpdatedAt !== false) {
-    index.updatedAt = options?.updatedAt ?? new Date().toISOString();
-  }
-  await writeJsonFile(indexPath, index);
-  return index;
+  return getJsonIndexStore().upsert(indexPath, entry, options);
 }
 
 export async function ensureJsonFile(filePath, defaultValue, options = undefined) {
@@ -47,7 +48,8 @@ export async function ensureJsonFile(filePath, defaultValue, options = undefined
   try {
     await fs.promises.access(filePath, fs.constants.F_OK);
   } catch {
-    await writeJsonFile(filePath, defaultValue);
+    // Another process may create it at the same moment; never clobber theirs.
+    await createFileExclusive(filePath, JSON.stringify(defaultValue, null, 2));
     return;
   }
   if (!ensureReadable) {
@@ -126,3 +128,47 @@ export function buildCompositionKey(payload) {
       : "any";
   return [schema || "none", mode || "unknown", commandText, workspace].join("::");
 }
+
+/** Sort keys for the paged prompt-composition views: most recent, and most reliable. */
+export const PROMPT_COMPOSITION_ORDERS = {
+  time: (entry) => Date.parse(entry?.updatedAt ?? entry?.firstSeenAt ?? 0) || 0,
+  score: (entry) => (Number(entry?.successCount) || 0) - (Number(entry?.failureCount) || 0),
+};
+
+/** The `loadPromptCompositions` filter options as an entry predicate. */
+export function buildPromptCompositionFilter(options) {
+  const workspaceFilter =
+    typeof options?.workspaceType === "string" && options.workspaceType.trim().length
+      ? options.workspaceType.trim().toLowerCase()
+      : null;
+  const modeFilter =
+    typeof options?.mode === "string" && options.mode.trim().length
+      ? options.mode.trim().toLowerCase()
+      : null;
+  const includeFallback = Boolean(options?.includeFallback);
+  const includeInvalid = Boolean(options?.includeInvalid);
+  return (entry) => {
+    if (!entry) {
+      return false;
+    }
+    if (!includeInvalid && entry.status === "invalid") {
+      return false;
+    }
+    if (!includeFallback && entry.status === "fallback") {
+      return false;
+    }
+    if (workspaceFilter) {
+      const label = (entry.workspaceType ?? "").toLowerCase();
+      if (label && label !== workspaceFilter) {
+        return false;
+      }
+    }
+    if (modeFilter) {
+      const mode = (entry.mode ?? "").toLowerCase();
+      if (mode && mode !== modeFilter) {
+        return false;
+      }
+    }
+    return true;
+  };
+}
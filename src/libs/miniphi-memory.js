@@ -4,9 +4,16 @@ import { randomUUID, createHash } from "crypto";
 import MemoryStoreBase from "./memory-store-base.js";
 import { parseStrictJsonObject } from "./core-utils.js";
 import { buildStopReasonInfo } from "./lmstudio-error-utils.js";
+import { getBlobStore } from "./blob-store.js";
+import { recordCacheAccess } from "./cache-access.js";
+import NarrativeCache from "./narrative-cache.js";
+import { WriteAheadLog } from "./atomic-file.js";
+import { PROMPT_COMPOSITION_ORDERS, buildPromptCompositionFilter } from "./memory-store-utils.js";
 
 const DEFAULT_SEGMENT_SIZE = 2000; // characters per chunk to stay context-friendly
 
+const helperScriptTime = (entry) => new Date(entry?.updatedAt ?? entry?.createdAt ?? 0).getTime();
+
 function findExistingMiniPhi(startDir) {
   let current = startDir;
   const { root } = path.parse(current);
@@ -111,8 +118,29 @@ export default class MiniPhiMemory extends MemoryStoreBase {
     this.promptCompositionsFile = path.join(this.indicesDir, "prompt-compositions.json");
     this.promptRouterFile = path.join(this.indicesDir, "prompt-router.json");
 
+    // Snapshot loaders page through these instead of parsing them whole.
+    this._registerPagedIndexes([
+      [this.executionsIndexFile],
+      [this.knowledgeIndexFile],
+      [this.promptSessionsIndexFile],
+      [this.researchIndexFile],
+      [this.webIndexFile],
+      [this.historyNotesIndexFile],
+      [this.nitpickIndexFile],
+      [this.benchmarkHistoryFile],
+      [this.promptDecompositionIndexFile],
+      [this.helperScriptsIndexFile, { orders: { time: helperScriptTime } }],
+      [this.commandLibraryFile],
+      [this.promptStepJournalIndexFile],
+      [this.promptTemplatesIndexFile],
+      [this.promptCompositionsFile, { orders: PROMPT_COMPOSITION_ORDERS }],
+    ]);
+
+    this.walDir = path.join(this.baseDir, "wal");
+    this.wal = new WriteAheadLog(this.walDir);
+
     this.prepared = false;
-    this.recomposeNarrativesCache = null;
+    this.narrativeCache = null;
   }
 
   /**
@@ -125,6 +153,8 @@ export default class MiniPhiMemory extends MemoryStoreBase {
 
     await fs.promises.mkdir(this.executionsDir, { recursive: true });
     await fs.promises.mkdir(this.indicesDir, { recursive: true });
+    // Finish (or discard) multi-file writes a crashed process left half done.
+    await this.wal.recover().catch(() => {});
     await fs.promises.mkdir(this.healthDir, { recursive: true });
     await fs.promises.mkdir(this.sessionsDir, { recursive: true });
     await fs.promises.mkdir(this.historyDir, { recursive: true });
@@ -154,7 +184,6 @@ export default class MiniPhiMemory extends MemoryStoreBase {
     await this._ensureFile(this.historyNotesIndexFile, { entries: [] });
     await this._ensureFile(this.nitpickIndexFile, { entries: [] });
     await this._ensureFile(this.benchmarkHistoryFile, { entries: [] });
-    await this._ensureFile(this.recomposeNarrativesFile, { entries: {}, order: [] });
     await this._ensureFile(this.promptDecompositionIndexFile, { entries: [] });
     await this._ensureFile(this.helperScriptsIndexFile, { entries: [] });
     await this._ensureFile(this.workspaceHintsFile, { entries: [] });
@@ -351,25 +380,36 @@ export default class MiniPhiMemory extends MemoryStoreBase {
     const metadataFile = path.join(executionDir, "execution.json");
     const executionIndexFile = path.join(executionDir, "index.json");
 
+    // Every file of the execution lands in one journaled commit, so a crash
+    // or a concurrent run never leaves a half-written execution folder.
+    const writes = [];
+    const stage = (filePath, data) => writes.push({ path: filePath, data: JSON.stringify(data, null, 2) });
+
     const segments = this._chunkContent(payload.result.compressedContent ?? "");
-    await Promise.all(
-      segments.map((segment, idx) => {
+    // Re-analyzing the same log produces the same segment texts; the blob
+    // store keeps one compressed copy and the segment file just names it.
+    const blobs = getBlobStore(this.baseDir);
+    const storedSegments = await Promise.all(
+      segments.map(async (segment, idx) => {
         const fileName = path.join(segmentsDir, `segment-${String(idx + 1).padStart(3, "0")}.json`);
         segment.file = this._relative(fileName);
-        return this._writeJSON(fileName, segment);
+        return { fileName, stored: await blobs.externalize(segment) };
       }),
     );
+    for (const { fileName, stored } of storedSegments) {
+      stage(fileName, stored);
+    }
 
     const summary = this._synthesizeSummary(payload.result.analysis);
 
-    await this._writeJSON(metadataFile, metadata);
-    await this._writeJSON(promptFile, {
+    stage(metadataFile, metadata);
+    stage(promptFile, {
       task: payload.task,
       prompt: payload.result.prompt,
       contextLength: payload.contextLength ?? null,
       updatedAt: timestamp,
     });
-    await this._writeJSON(analysisFile, {
+    stage(analysisFile, {
       analysis: payload.result.analysis,
       summary,
       contextRequests: payload.result.contextRequests ?? [],
@@ -382,7 +422,7 @@ export default class MiniPhiMemory extends MemoryStoreBase {
           : null,
       updatedAt: timestamp,
     });
-    await this._writeJSON(compressionFile, {
+    stage(compressionFile, {
       tokens: payload.result.compressedTokens,
       segments: segments.map((segment) => ({
         id: segment.id,
@@ -412,11 +452,11 @@ export default class MiniPhiMemory extends MemoryStoreBase {
         schemaId: payload.result?.schemaId ?? null,
       };
       truncationPlanPath = path.join(executionDir, "truncation-plan.json");
-      await this._writeJSON(truncationPlanPath, planRecord);
+      stage(truncationPlanPath, planRecord);
       metadata.truncationPlan = this._relative(truncationPlanPath);
     }
 
-    await this._writeJSON(executionIndexFile, {
+    stage(executionIndexFile, {
       id: executionId,
       createdAt: timestamp,
       files: {
@@ -429,11 +469,13 @@ export default class MiniPhiMemory extends MemoryStoreBase {
         taskExecution: metadata.taskExecutionRegister,
       },
     });
+    await this.wal.commit(writes);
 
     await this._updatePromptsHistory(payload, executionId, timestamp, promptFile);
     await this._updateKnowledgeBase(payload, executionId, timestamp, summary);
     await this._updateTodoList(payload.result.analysis, executionId, timestamp);
     await this._updateExecutionIndex(executionId, metadata, executionIndexFile, payload.task);
+    await this._updateRootIndex();
 
     return { id: executionId, path: executionDir, truncationPlanPath };
   }
@@ -520,6 +562,7 @@ export default class MiniPhiMemory extends MemoryStoreBase {
     });
 
     await this._updateExecutionIndex(executionId, metadata, executionIndexFile, payload.task);
+    await this._updateRootIndex();
     return { id: executionId, path: executionDir };
   }
 
@@ -645,16 +688,15 @@ export default class MiniPhiMemory extends MemoryStoreBase {
         continue;
       }
       const targetPath = path.join(this.baseDir, child.file);
-      const data = await this._readJSON(targetPath, null);
-      const entryCount = Array.isArray(data?.entries) ? data.entries.length : null;
-      const summary = typeof data?.summary === "string" ? data.summary.trim() : null;
-      const updatedAt = data?.updatedAt ?? data?.recordedAt ?? null;
+      const info = await this._summarizeIndex(targetPath);
+      const meta = info?.meta ?? {};
+      const summary = typeof meta.summary === "string" ? meta.summary.trim() : null;
       entries.push({
         name: child.name ?? child.file,
         file: child.file,
-        entries: entryCount,
+        entries: info?.total ?? null,
         summary,
-        updatedAt,
+        updatedAt: meta.updatedAt ?? meta.recordedAt ?? null,
       });
     }
     return {
@@ -668,11 +710,11 @@ export default class MiniPhiMemory extends MemoryStoreBase {
    */
   async loadBenchmarkHistory(limit = 3) {
     await this.prepare();
-    const history = await this._readJSON(this.benchmarkHistoryFile, { entries: [] });
-    if (!Array.isArray(history?.entries)) {
+    const count = Math.max(0, Number(limit) || 0);
+    if (!count) {
       return [];
     }
-    const capped = history.entries.slice(0, Math.max(0, Math.min(limit, history.entries.length)));
+    const { entries: capped } = await this._queryIndex(this.benchmarkHistoryFile, { limit: count });
     return capped.map((entry) => ({
       id: entry.id ?? null,
       type: entry.type ?? "summary",
@@ -784,6 +826,7 @@ export default class MiniPhiMemory extends MemoryStoreBase {
     try {
       const data = await this._readJSON(sessionFile, null);
       if (data && Array.isArray(data.history)) {
+        recordCacheAccess(this.baseDir, sessionFile);
         return data.history;
       }
     } catch {
@@ -924,12 +967,9 @@ export default class MiniPhiMemory extends MemoryStoreBase {
 
   async loadCommandLibrary(limit = 20) {
     await this.prepare();
-    const data = await this._readJSON(this.commandLibraryFile, { entries: [] });
-    if (!Array.isArray(data.entries) || data.entries.length === 0) {
-      return [];
-    }
     const maxEntries = Number.isFinite(Number(limit)) && Number(limit) > 0 ? Number(limit) : 20;
-    return data.entries.slice(0, maxEntries);
+    const { entries } = await this._queryIndex(this.commandLibraryFile, { limit: maxEntries });
+    return entries;
   }
 
   async recordPromptComposition(payload) {
@@ -996,65 +1036,32 @@ export default class MiniPhiMemory extends MemoryStoreBase {
     return entry;
   }
 
+  /**
+   * Newest prompt compositions matching `options` (or best-scoring with
+   * `order: "score"`); `cursor` continues from a previous call's `nextCursor`
+   * via `queryPromptCompositions`.
+   */
   async loadPromptCompositions(options = undefined) {
+    const { entries } = await this.queryPromptCompositions(options);
+    return entries;
+  }
+
+  async queryPromptCompositions(options = undefined) {
     await this.prepare();
-    const cache = await this._readJSON(this.promptCompositionsFile, { entries: [] });
-    let entries = Array.isArray(cache.entries) ? cache.entries : [];
     const limit =
       Number.isFinite(Number(options?.limit)) && Number(options.limit) > 0
         ? Number(options.limit)
         : 12;
-    const workspaceFilter =
-      typeof options?.workspaceType === "string" && options.workspaceType.trim().length
-        ? options.workspaceType.trim().toLowerCase()
-        : null;
-    const modeFilter =
-      typeof options?.mode === "string" && options.mode.trim().length
-        ? options.mode.trim().toLowerCase()
-        : null;
-    const includeFallback = Boolean(options?.includeFallback);
-    const includeInvalid = Boolean(options?.includeInvalid);
-
-    entries = entries.filter((entry) => {
-      if (!entry) {
-        return false;
-      }
-      if (!includeInvalid && entry.status === "invalid") {
-        return false;
-      }
-      if (!includeFallback && entry.status === "fallback") {
-        return false;
-      }
-      if (workspaceFilter) {
-        const label = (entry.workspaceType ?? "").toLowerCase();
-        if (label && label !== workspaceFilter) {
-          return false;
-        }
-      }
-      if (modeFilter) {
-        const mode = (entry.mode ?? "").toLowerCase();
-        if (mode && mode !== modeFilter) {
-          return false;
-        }
-      }
-      return true;
-    });
-
-    entries.sort((a, b) => {
-      const aTime = Date.parse(a.updatedAt ?? a.firstSeenAt ?? 0) || 0;
-      const bTime = Date.parse(b.updatedAt ?? b.firstSeenAt ?? 0) || 0;
-      return bTime - aTime;
+    return this._queryIndex(this.promptCompositionsFile, {
+      limit,
+      cursor: options?.cursor,
+      order: options?.order === "score" ? "score" : "time",
+      filter: buildPromptCompositionFilter(options),
     });
-
-    return entries.slice(0, limit);
   }
 
   async loadHelperScripts(options = undefined) {
     await this.prepare();
-    const index = await this._readJSON(this.helperScriptsIndexFile, { entries: [] });
-    if (!Array.isArray(index.entries) || index.entries.length === 0) {
-      return [];
-    }
     const limit =
       Number.isFinite(Number(options?.limit)) && Number(options?.limit) > 0
         ? Number(options.limit)
@@ -1071,11 +1078,10 @@ export default class MiniPhiMemory extends MemoryStoreBase {
       typeof options?.search === "string" && options.search.trim().length
         ? options.search.trim().toLowerCase()
         : null;
-    const entries = index.entries
-      .filter((entry) => {
-        if (!entry) {
-          return false;
-        }
+    const { entries } = await this._queryIndex(this.helperScriptsIndexFile, {
+      limit,
+      order: "time",
+      filter: (entry) => {
         if (workspaceFilter) {
           const label = entry.workspaceType?.toLowerCase() ?? "";
           if (!label.includes(workspaceFilter)) {
@@ -1088,24 +1094,16 @@ export default class MiniPhiMemory extends MemoryStoreBase {
             return false;
           }
         }
-        if (search && !this._matchesHelperSearch(entry, search)) {
-          return false;
-        }
-        return true;
-      })
-      .sort((a, b) => {
-        const left = new Date(b.updatedAt ?? b.createdAt ?? 0).getTime();
-        const right = new Date(a.updatedAt ?? a.createdAt ?? 0).getTime();
-        return left - right;
-      })
-      .slice(0, limit)
-      .map((entry) => ({
-        ...entry,
-        absolutePath: this._resolveHelperAbsolute(entry.path ?? null),
-      }));
-    return entries;
+        return !search || this._matchesHelperSearch(entry, search);
+      },
+    });
+    return entries.map((entry) => ({
+      ...entry,
+      absolutePath: this._resolveHelperAbsolute(entry.path ?? null),
+    }));
   }
 
+
   async loadHelperScript(identifier, options = undefined) {
     if (!identifier) {
       return null;
@@ -1145,6 +1143,7 @@ export default class MiniPhiMemory extends MemoryStoreBase {
     await this.prepare();
     const safeId = this._sanitizeId(executionId);
     const planFile = path.join(this.executionsDir, safeId, "truncation-plan.json");
+    recordCacheAccess(this.baseDir, planFile);
     try {
       return await this._readJSON(planFile, null);
     } catch {
@@ -1159,6 +1158,7 @@ export default class MiniPhiMemory extends MemoryStoreBase {
     await this.prepare();
     const safeId = this._sanitizeId(executionId);
     const progressFile = path.join(this.executionsDir, safeId, "truncation-progress.json");
+    recordCacheAccess(this.baseDir, progressFile);
     try {
       return await this._readJSON(progressFile, null);
     } catch {
@@ -1350,7 +1350,6 @@ export default class MiniPhiMemory extends MemoryStoreBase {
   }
 
   async _updatePromptsHistory(payload, executionId, timestamp, promptFile) {
-    const history = await this._readJSON(this.promptsFile, { history: [] });
     const entry = {
       executionId,
       task: payload.task,
@@ -1360,11 +1359,10 @@ export default class MiniPhiMemory extends MemoryStoreBase {
       createdAt: timestamp,
     };
 
-    history.history.unshift(entry);
-    history.history = history.history.slice(0, 200);
-
-    await this._writeJSON(this.promptsFile, history);
-    await this._updateRootIndex();
+    await this._updateIndex(this.promptsFile, { history: [] }, (history) => {
+      const previous = Array.isArray(history.history) ? history.history : [];
+      history.history = [entry, ...previous].slice(0, 200);
+    });
   }
 
   async _updateKnowledgeBase(payload, executionId, timestamp, summary) {
@@ -1372,7 +1370,6 @@ export default class MiniPhiMemory extends MemoryStoreBase {
       return;
     }
 
-    const knowledge = await this._readJSON(this.knowledgeFile, { entries: [] });
     const entry = {
       id: randomUUID(),
       executionId,
@@ -1381,21 +1378,23 @@ export default class MiniPhiMemory extends MemoryStoreBase {
       createdAt: timestamp,
     };
 
-    knowledge.entries.unshift(entry);
-    knowledge.entries = knowledge.entries.slice(0, 200);
-    await this._writeJSON(this.knowledgeFile, knowledge);
+    // Store-managed so concurrent runs merge their entries instead of the
+    // last writer dropping the others'.
+    const knowledge = await this._updateIndex(this.knowledgeFile, { entries: [] }, (doc) => {
+      const entries = Array.isArray(doc.entries) ? doc.entries : [];
+      doc.entries = [entry, ...entries.filter((item) => item?.id !== entry.id)].slice(0, 200);
+    });
 
-    await this._writeJSON(this.knowledgeIndexFile, {
+    await this._updateIndex(this.knowledgeIndexFile, { entries: [] }, () => ({
       updatedAt: timestamp,
       entries: knowledge.entries.map((item) => ({
         id: item.id,
         executionId: item.executionId,
         task: item.task,
-        summaryPreview: item.summary.slice(0, 160),
+        summaryPreview: String(item.summary ?? "").slice(0, 160),
         createdAt: item.createdAt,
       })),
-    });
-    await this._updateRootIndex();
+    }));
   }
 
   async _updateTodoList(analysis, executionId, timestamp) {
@@ -1404,29 +1403,27 @@ export default class MiniPhiMemory extends MemoryStoreBase {
       return;
     }
 
-    const todo = await this._readJSON(this.todoFile, { items: [] });
-    const existingTexts = new Set(todo.items.map((item) => item.text.toLowerCase()));
-
-    for (const action of nextActions) {
-      if (existingTexts.has(action.toLowerCase())) {
-        continue;
+    const added = nextActions.map((action) => ({
+      id: randomUUID(),
+      executionId,
+      text: action,
+      createdAt: timestamp,
+      completed: false,
+    }));
+    await this._updateIndex(this.todoFile, { items: [] }, (todo) => {
+      todo.items = Array.isArray(todo.items) ? todo.items : [];
+      const existingTexts = new Set(todo.items.map((item) => String(item?.text ?? "").toLowerCase()));
+      for (const item of added) {
+        const key = item.text.toLowerCase();
+        if (!existingTexts.has(key)) {
+          todo.items.push(item);
+          existingTexts.add(key);
+        }
       }
-      todo.items.push({
-        id: randomUUID(),
-        executionId,
-        text: action,
-        createdAt: timestamp,
-        completed: false,
-      });
-      existingTexts.add(action.toLowerCase());
-    }
-
-    await this._writeJSON(this.todoFile, todo);
-    await this._updateRootIndex();
+    });
   }
 
   async _updateExecutionIndex(executionId, metadata, executionIndexFile, task) {
-    const index = await this._readJSON(this.executionsIndexFile, { entries: [], byTask: {}, latest: null });
     const entry = {
       id: executionId,
       task,
@@ -1441,17 +1438,19 @@ export default class MiniPhiMemory extends MemoryStoreBase {
       path: this._relative(executionIndexFile),
     };
 
-    index.entries.unshift(entry);
-    index.entries = index.entries.slice(0, 200);
-
     const key = this._hashText(task ?? "unknown-task");
-    const taskEntry = index.byTask[key] ?? { task, executions: [] };
-    taskEntry.executions = [executionId, ...taskEntry.executions.filter((id) => id !== executionId)].slice(0, 20);
-    index.byTask[key] = taskEntry;
-    index.latest = entry;
-
-    await this._writeJSON(this.executionsIndexFile, index);
-    await this._updateRootIndex();
+    await this._updateIndex(
+      this.executionsIndexFile,
+      { entries: [], byTask: {}, latest: null },
+      (index) => {
+        index.entries = [entry, ...(Array.isArray(index.entries) ? index.entries : [])].slice(0, 200);
+        index.byTask = index.byTask && typeof index.byTask === "object" ? index.byTask : {};
+        const taskEntry = index.byTask[key] ?? { task, executions: [] };
+        taskEntry.executions = [executionId, ...taskEntry.executions.filter((id) => id !== executionId)].slice(0, 20);
+        index.byTask[key] = taskEntry;
+        index.latest = entry;
+      },
+    );
   }
 
   async _updatePromptDecompositionIndex(entry) {
@@ -1476,9 +1475,8 @@ export default class MiniPhiMemory extends MemoryStoreBase {
   }
 
   async _updateRootIndex() {
-    const root = await this._readJSON(this.rootIndexFile, { children: [] });
-    root.updatedAt = new Date().toISOString();
-    root.children = [
+    const updatedAt = new Date().toISOString();
+    const children = [
       { name: "executions", file: this._relative(this.executionsIndexFile) },
       { name: "knowledge", file: this._relative(this.knowledgeIndexFile) },
       { name: "prompts", file: this._relative(this.promptsFile) },
@@ -1501,7 +1499,13 @@ export default class MiniPhiMemory extends MemoryStoreBase {
       { name: "prompt-compositions", file: this._relative(this.promptCompositionsFile) },
       { name: "prompt-router", file: this._relative(this.promptRouterFile) },
     ];
-    await this._writeJSON(this.rootIndexFile, root);
+    // Called once at the end of every record, so it is also where the
+    // record's queued index writes are committed, together.
+    await this._updateIndex(this.rootIndexFile, { children: [] }, (root) => {
+      root.updatedAt = updatedAt;
+      root.children = children;
+    });
+    await this._commitIndexes();
   }
 
   async recordBenchmarkSummary(summary, options = {}) {
@@ -1667,23 +1671,27 @@ export default class MiniPhiMemory extends MemoryStoreBase {
       return;
     }
     await this.prepare();
-    const todo = await this._readJSON(this.todoFile, { items: [] });
-    const normalized = new Set(todo.items.map((item) => item.text.toLowerCase()));
     const now = new Date().toISOString();
-    items.forEach((text) => {
-      if (!text || normalized.has(text.toLowerCase())) {
-        return;
-      }
-      todo.items.push({
+    const added = items
+      .filter(Boolean)
+      .map((text) => ({
         id: randomUUID(),
         text,
         createdAt: now,
         completed: false,
         source: source ?? null,
-      });
-      normalized.add(text.toLowerCase());
+      }));
+    await this._updateIndex(this.todoFile, { items: [] }, (todo) => {
+      todo.items = Array.isArray(todo.items) ? todo.items : [];
+      const normalized = new Set(todo.items.map((item) => String(item?.text ?? "").toLowerCase()));
+      for (const item of added) {
+        const key = String(item.text).toLowerCase();
+        if (!normalized.has(key)) {
+          todo.items.push(item);
+          normalized.add(key);
+        }
+      }
     });
-    await this._writeJSON(this.todoFile, todo);
     await this._updateRootIndex();
   }
 
@@ -1692,8 +1700,7 @@ export default class MiniPhiMemory extends MemoryStoreBase {
       return null;
     }
     await this.prepare();
-    const cache = await this._loadNarrativeCache();
-    return cache.entries[hash] ?? null;
+    return this._narratives().get(hash);
   }
 
   async storeCachedNarrative(hash, payload = {}) {
@@ -1701,22 +1708,12 @@ export default class MiniPhiMemory extends MemoryStoreBase {
       return;
     }
     await this.prepare();
-    const cache = await this._loadNarrativeCache();
-    cache.entries[hash] = {
+    await this._narratives().set(hash, {
       document: payload.document,
       relativePath: payload.relativePath ?? null,
       sample: payload.sample ?? null,
       updatedAt: new Date().toISOString(),
-    };
-    cache.order = cache.order.filter((item) => item !== hash);
-    cache.order.unshift(hash);
-    const LIMIT = 400;
-    while (cache.order.length > LIMIT) {
-      const removed = cache.order.pop();
-      delete cache.entries[removed];
-    }
-    await this._writeJSON(this.recomposeNarrativesFile, cache);
-    this.recomposeNarrativesCache = cache;
+    });
   }
 
   _condenseBenchmarkSummary(summary) {
@@ -1760,18 +1757,14 @@ export default class MiniPhiMemory extends MemoryStoreBase {
     };
   }
 
-  async _loadNarrativeCache() {
-    if (this.recomposeNarrativesCache) {
-      return this.recomposeNarrativesCache;
+  /** Per-entry narrative shards; the legacy single-file cache is migrated on first use. */
+  _narratives() {
+    if (!this.narrativeCache) {
+      this.narrativeCache = new NarrativeCache(this.recomposeCacheDir, {
+        legacyFile: this.recomposeNarrativesFile,
+      });
     }
-    const cache = (await this._readJSON(this.recomposeNarrativesFile, { entries: {}, order: [] })) ?? {
-      entries: {},
-      order: [],
-    };
-    cache.entries = cache.entries ?? {};
-    cache.order = Array.isArray(cache.order) ? cache.order : [];
-    this.recomposeNarrativesCache = cache;
-    return cache;
+    return this.narrativeCache;
   }
 
   async saveResearchReport(report) {
@@ -1923,6 +1916,7 @@ export default class MiniPhiMemory extends MemoryStoreBase {
     if (!data) {
       return null;
     }
+    recordCacheAccess(this.baseDir, fullPath);
     return { data, path: fullPath };
   }
 
@@ -0,0 +1,268 @@
+import fs from "fs";
+import path from "path";
+import { createHash } from "crypto";
+
+/**
+ * Sharded on-disk cache of recompose narratives, keyed by source hash.
+ *
+ * The old cache was a single `recompose-cache/narratives.json` holding up to
+ * 400 full documents; every store re-serialized and rewrote all of it, so
+ * `RecomposeTester` workers running in parallel each rewrote megabytes per
+ * file. Here:
+ *
+ * - each entry is its own file, `narratives/<first two hex>/<hash>.json`,
+ *   written with a temp+rename, so a store touches one small file and
+ *   concurrent workers (or processes) never contend;
+ * - a byte-bounded in-memory LRU fronts the disk, so repeated lookups in one
+ *   run cost a Map hit;
+ * - the disk footprint is capped by total bytes rather than entry count:
+ *   past `maxBytes`, least recently used entries are deleted (a hit bumps the
+ *   entry's mtime, which is what orders entries across runs).
+ *
+ * A legacy `narratives.json` is split into shards on first use and removed.
+ */
+
+export const NARRATIVES_DIRNAME = "narratives";
+export const DEFAULT_NARRATIVE_CACHE_MAX_BYTES = 64 * 1024 * 1024;
+export const DEFAULT_NARRATIVE_MEMORY_BYTES = 8 * 1024 * 1024;
+
+const ENTRY_PATTERN = /^([0-9a-f]{2})([0-9a-f]+)\.json$/;
+
+const normalizeKey = (hash) => {
+  const text = String(hash ?? "").trim().toLowerCase();
+  return /^[0-9a-f]{8,128}$/.test(text) ? text : createHash("sha256").update(text).digest("hex");
+};
+
+export default class NarrativeCache {
+  /**
+   * @param {string} cacheDir The `recompose-cache` directory.
+   * @param {{ maxBytes?: number, memoryBytes?: number, legacyFile?: string }} [options]
+   */
+  constructor(cacheDir, options = undefined) {
+    this.dir = path.join(cacheDir, NARRATIVES_DIRNAME);
+    this.legacyFile = options?.legacyFile ?? null;
+    this.maxBytes = Number.isFinite(options?.maxBytes)
+      ? Math.max(0, options.maxBytes)
+      : DEFAULT_NARRATIVE_CACHE_MAX_BYTES;
+    this.memoryBytes = Number.isFinite(options?.memoryBytes)
+      ? Math.max(0, options.memoryBytes)
+      : DEFAULT_NARRATIVE_MEMORY_BYTES;
+    /** @type {Map<string, { entry: Record<string, any>, bytes: number }>} recency order, oldest first */
+    this._memory = new Map();
+    this._memoryUsed = 0;
+    /** @type {Map<string, { bytes: number, usedMs: number }> | null} on-disk sizes in recency order, loaded on first store */
+    this._disk = null;
+    this._diskUsed = 0;
+    this._diskReady = null;
+    this._ready = null;
+    this.stats = { hits: 0, memoryHits: 0, misses: 0, stores: 0, evicted: 0 };
+  }
+
+  entryPath(hash) {
+    const key = normalizeKey(hash);
+    return path.join(this.dir, key.slice(0, 2), `${key}.json`);
+  }
+
+  _ensureReady() {
+    if (!this._ready) {
+      this._ready = this._migrateLegacy().catch(() => {});
+    }
+    return this._ready;
+  }
+
+  async _migrateLegacy() {
+    if (!this.legacyFile) {
+      return;
+    }
+    let legacy;
+    try {
+      legacy = JSON.parse(await fs.promises.readFile(this.legacyFile, "utf8"));
+    } catch {
+      return;
+    }
+    const order = Array.isArray(legacy?.order) ? legacy.order : Object.keys(legacy?.entries ?? {});
+    // Oldest first, so mtimes keep the legacy recency order.
+    const base = Date.now() - order.length * 1000;
+    for (const [position, hash] of [...order].reverse().entries()) {
+      const entry = legacy?.entries?.[hash];
+      if (entry?.document) {
+        const target = await this._writeEntry(hash, entry);
+        const at = new Date(base + position * 1000);
+        await fs.promises.utimes(target, at, at).catch(() => {});
+      }
+    }
+    await fs.promises.rm(this.legacyFile, { force: true });
+  }
+
+  _remember(key, entry, bytes) {
+    const existing = this._memory.get(key);
+    if (existing) {
+      this._memoryUsed -= existing.bytes;
+      this._memory.delete(key);
+    }
+    if (bytes > this.memoryBytes) {
+      return;
+    }
+    this._memory.set(key, { entry, bytes });
+    this._memoryUsed += bytes;
+    for (const [oldest, value] of this._memory) {
+      if (this._memoryUsed <= this.memoryBytes) {
+        break;
+      }
+      this._memory.delete(oldest);
+      this._memoryUsed -= value.bytes;
+    }
+  }
+
+  async get(hash) {
+    if (!hash) {
+      return null;
+    }
+    await this._ensureReady();
+    const key = normalizeKey(hash);
+    const cached = this._memory.get(key);
+    if (cached) {
+      this._memory.delete(key);
+      this._memory.set(key, cached);
+      this._touch(key);
+      this.stats.hits += 1;
+      this.stats.memoryHits += 1;
+      return cached.entry;
+    }
+    let text;
+    try {
+      text = await fs.promises.readFile(this.entryPath(key), "utf8");
+    } catch {
+      this.stats.misses += 1;
+      return null;
+    }
+    let entry;
+    try {
+      entry = JSON.parse(text);
+    } catch {
+      this.stats.misses += 1;
+      return null;
+    }
+    this._remember(key, entry, Buffer.byteLength(text, "utf8"));
+    this._touch(key);
+    this.stats.hits += 1;
+    return entry;
+  }
+
+  /** Bumps the entry's recency, in memory and (for later runs) on disk. */
+  _touch(key) {
+    const now = Date.now();
+    const known = this._disk?.get(key);
+    if (known) {
+      known.usedMs = now;
+      this._disk.delete(key);
+      this._disk.set(key, known);
+    }
+    const at = new Date(now);
+    fs.promises.utimes(this.entryPath(key), at, at).catch(() => {});
+  }
+
+  async _writeEntry(hash, entry) {
+    const target = this.entryPath(hash);
+    const text = JSON.stringify(entry);
+    await fs.promises.mkdir(path.dirname(target), { recursive: true });
+    const tempFile = `${target}.${process.pid}.${Math.random().toString(36).slice(2, 8)}.tmp`;
+    await fs.promises.writeFile(tempFile, text, "utf8");
+    await fs.promises.rename(tempFile, target);
+    return target;
+  }
+
+  async set(hash, entry) {
+    if (!hash || !entry) {
+      return;
+    }
+    await this._ensureReady();
+    const key = normalizeKey(hash);
+    const text = JSON.stringify(entry);
+    const bytes = Buffer.byteLength(text, "utf8");
+    await this._writeEntry(key, entry);
+    this.stats.stores += 1;
+    this._remember(key, entry, bytes);
+    await this._loadDiskSizes();
+    const previous = this._disk.get(key);
+    this._diskUsed += bytes - (previous?.bytes ?? 0);
+    this._disk.delete(key);
+    this._disk.set(key, { bytes, usedMs: Date.now() });
+    if (this._diskUsed > this.maxBytes) {
+      await this._evict(key);
+    }
+  }
+
+  /** One stat walk per process; afterwards sizes are tracked incrementally. */
+  _loadDiskSizes() {
+    if (!this._diskReady) {
+      this._diskReady = this._scanDisk();
+    }
+    return this._diskReady;
+  }
+
+  async _scanDisk() {
+    const found = [];
+    let shards = [];
+    try {
+      shards = await fs.promises.readdir(this.dir);
+    } catch {
+      shards = [];
+    }
+    await Promise.all(
+      shards.map(async (shard) => {
+        let names = [];
+        try {
+          names = await fs.promises.readdir(path.join(this.dir, shard));
+        } catch {
+          return;
+        }
+        for (const name of names) {
+          const match = name.match(ENTRY_PATTERN);
+          if (!match || match[1] !== shard) {
+            continue;
+          }
+          try {
+            const stat = await fs.promises.stat(path.join(this.dir, shard, name));
+            found.push({ key: `${match[1]}${match[2]}`, bytes: stat.size, usedMs: stat.mtimeMs });
+          } catch {
+            // evicted by another process
+          }
+        }
+      }),
+    );
+    found.sort((left, right) => left.usedMs - right.usedMs);
+    this._disk = new Map();
+    this._diskUsed = 0;
+    for (const item of found) {
+      this._disk.set(item.key, { bytes: item.bytes, usedMs: item.usedMs });
+      this._diskUsed += item.bytes;
+    }
+  }
+
+  async _evict(keepKey) {
+    // `_disk` is kept in recency order, oldest first.
+    const victims = Array.from(this._disk.entries()).filter(([key]) => key !== keepKey);
+    for (const [key, info] of victims) {
+      if (this._diskUsed <= this.maxBytes) {
+        break;
+      }
+      this._disk.delete(key);
+      this._diskUsed -= info.bytes;
+      const cached = this._memory.get(key);
+      if (cached) {
+        this._memory.delete(key);
+        this._memoryUsed -= cached.bytes;
+      }
+      await fs.promises.rm(this.entryPath(key), { force: true });
+      this.stats.evicted += 1;
+    }
+  }
+
+  /** Entry count and bytes on disk, as this process tracks them. */
+  async usage() {
+    await this._ensureReady();
+    await this._loadDiskSizes();
+    return { entries: this._disk.size, bytes: this._diskUsed, maxBytes: this.maxBytes };
+  }
+}
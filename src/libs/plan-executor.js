@@ -1,5 +1,8 @@
 import fs from "fs/promises";
 import path from "path";
+import { grepWorkspace } from "./grep-engine.js";
+import { qualifiedSymbolName, readSymbol } from "./symbol-index.js";
+import { getTrigramIndex } from "./trigram-index.js";
 
 const DEFAULT_MAX_SNIPPETS = 4;
 const DEFAULT_MAX_SNIPPET_BYTES = 4000;
@@ -7,8 +10,6 @@ const DEFAULT_MAX_ACTIONS = 4;
 const DEFAULT_MAX_OUTPUT_CHARS = 1500;
 const DEFAULT_MAX_BLOCK_CHARS = 4000;
 const SEARCH_SKIP_DIRS = new Set(["node_modules", ".git", ".miniphi", "dist", "build", "coverage"]);
-const SEARCH_MAX_FILES = 2000;
-const SEARCH_MAX_FILE_BYTES = 512 * 1024;
 const SEARCH_MAX_MATCHES = 20;
 
 const PATH_TOKEN_PATTERN =
@@ -227,63 +228,48 @@ export async function mapSegmentToAction(segment, { cwd } = {}) {
   return { type: "unmapped", reason: "no safe deterministic mapping" };
 }
 
-async function searchTextInWorkspace(term, cwd, { maxMatches = SEARCH_MAX_MATCHES } = {}) {
-  const matches = [];
-  let scanned = 0;
-  const walk = async (dir) => {
-    if (matches.length >= maxMatches || scanned >= SEARCH_MAX_FILES) {
-      return;
-    }
-    let entries;
-    try {
-      entries = await fs.readdir(dir, { withFileTypes: true });
-    } catch {
-      return;
-    }
-    for (const entry of entries) {
-      if (matches.length >= maxMatches || scanned >= SEARCH_MAX_FILES) {
-        return;
-      }
-      const full = path.join(dir, entry.name);
-      if (entry.isDirectory()) {
-        // Dot-directories (.git, .miniphi, ...) are agent/VCS state, not sources.
-        if (!entry.name.startsWith(".") && !SEARCH_SKIP_DIRS.has(entry.name)) {
-          await walk(full);
-        }
-        continue;
-      }
-      if (!entry.isFile()) {
-        continue;
-      }
-      scanned += 1;
-      try {
-        const stats = await fs.stat(full);
-        if (stats.size > SEARCH_MAX_FILE_BYTES) {
-          continue;
-        }
-        const content = await fs.readFile(full, "utf8");
-        if (content.includes("\u0000")) {
-          continue;
-        }
-        const lines = content.split(/\r?\n/);
-        for (let i = 0; i < lines.length && matches.length < maxMatches; i += 1) {
-          if (lines[i].includes(term)) {
-            const relative = path.relative(cwd, full).split(path.sep).join("/");
-            matches.push(`${relative}:${i + 1}: ${lines[i].trim().slice(0, 160)}`);
-          }
-        }
-      } catch {
-        // unreadable file: skip
-      }
-    }
+// Dot-directories (.git, .miniphi, ...) are agent/VCS state, not sources.
+const skipSearchDir = (name) => name.startsWith(".") || SEARCH_SKIP_DIRS.has(name);
+
+async function searchTextInWorkspace(term, cwd, { maxMatches = SEARCH_MAX_MATCHES, regex = false, ignoreCase = false } = {}) {
+  const root = path.resolve(cwd);
+  const options = { regex, ignoreCase, maxMatches, skipDir: skipSearchDir };
+  // Without a .miniphi to keep it in, a trigram index would be rebuilt for
+  // every command: one multi-threaded grep is cheaper than indexing.
+  const trigrams = getTrigramIndex(root);
+  const result = trigrams.indexFile ? await trigrams.search(term, options) : await grepWorkspace(root, term, options);
+  return {
+    lines: result.matches.map((match) => `${match.path}:${match.line}: ${match.text.trim().slice(0, 160)}`),
+    truncated: result.truncated,
   };
-  await walk(path.resolve(cwd));
-  return matches;
 }
 
 /**
- * Executes a single read-only workspace action (read_file/list_dir/search_text)
- * natively (no shell). Exported so the interactive agent executor can reuse the
+ * Signature and body of one definition, headed by its location. Other
+ * definitions of the same name are listed so the caller can pick one by path.
+ */
+async function readSymbolInWorkspace(symbol, cwd, target) {
+  const found = await readSymbol(path.resolve(cwd), symbol, { path: target, skipDir: skipSearchDir });
+  if (!found.definition) {
+    const scope = target ? ` in ${target}` : ` in ${found.scanned} candidate source file(s)`;
+    return { header: `no definition of "${symbol}" found${scope}; try search_text`, text: "" };
+  }
+  const { definition, others } = found;
+  const elsewhere = others.length
+    ? ` (also defined at ${others
+        .slice(0, 5)
+        .map((other) => `${other.path}:${other.line}`)
+        .join(", ")}${others.length > 5 ? ", ..." : ""}; pass path to pick one)`
+    : "";
+  return {
+    header: `${definition.path}:${definition.line}-${definition.endLine} ${definition.kind} ${qualifiedSymbolName(definition)}${elsewhere}`,
+    text: found.text,
+  };
+}
+
+/**
+ * Executes a single read-only workspace action
+ * (read_file/list_dir/search_text/read_symbol) natively (no shell). Exported so the interactive agent executor can reuse the
  * exact same bounded, path-checked primitives the plan flow relies on.
  */
 export async function executeReadonlyAction(action, cwd, { maxOutputChars = DEFAULT_MAX_OUTPUT_CHARS } = {}) {
@@ -304,10 +290,27 @@ async function executeAction(action, cwd, { maxOutputChars }) {
     return truncateOutput(listing, maxOutputChars);
   }
   if (action.type === "search_text") {
-    const matches = await searchTextInWorkspace(action.term, cwd);
-    return matches.length
-      ? truncateOutput(matches.join("\n"), maxOutputChars)
-      : `no matches for "${action.term}"`;
+    let found;
+    try {
+      found = await searchTextInWorkspace(action.term, cwd, {
+        regex: Boolean(action.regex),
+        ignoreCase: Boolean(action.ignoreCase),
+      });
+    } catch (error) {
+      if (error instanceof SyntaxError) {
+        return `invalid search pattern "${action.term}": ${error.message}`;
+      }
+      throw error;
+    }
+    if (!found.lines.length) {
+      return `no matches for "${action.term}"`;
+    }
+    const note = found.truncated ? `\n(first ${found.lines.length} matches; narrow the term for more)` : "";
+    return truncateOutput(`${found.lines.join("\n")}${note}`, maxOutputChars);
+  }
+  if (action.type === "read_symbol") {
+    const { header, text } = await readSymbolInWorkspace(action.symbol, cwd, action.target ?? null);
+    return truncateOutput(text ? `${header}\n${text}` : header, maxOutputChars);
   }
   throw new Error(`unsupported action type ${action.type}`);
 }
@@ -0,0 +1,426 @@
+import fs from "fs";
+import path from "path";
+import zlib from "zlib";
+import { promisify } from "util";
+import { recordCacheAccess } from "./cache-access.js";
+
+const gzip = promisify(zlib.gzip);
+const gunzip = promisify(zlib.gunzip);
+
+/**
+ * Segmented, compressed archive of prompt exchanges under
+ * `.miniphi/prompt-exchanges/archive/`.
+ *
+ * - `segment-<stamp>-<pid>.ndjson.gz` — append-only segments. Every exchange is
+ *   written as its own gzip member holding one JSON line, so a segment is still
+ *   a valid gzip file (`zcat segment-*.ndjson.gz` prints the NDJSON) and any
+ *   single exchange can be inflated from its byte range without touching the
+ *   rest. Each process appends only to segments it created, which keeps byte
+ *   offsets exact without cross-process locking; a segment rotates after
+ *   `segmentMaxBytes`.
+ * - `catalog.ndjson` — one compact row per exchange: id, time, scope, label,
+ *   model, schema, error flag and the `seg`/`off`/`len` locator. Rows are single
+ *   small appends, so concurrent writers interleave whole lines. Rows written
+ *   by other processes are picked up by re-reading only the catalog's new tail.
+ *   A re-archived id appends a new row; the row it replaces stays in the file
+ *   until a prune rewrites the catalog with the live rows only.
+ *
+ * Listing and filtering read the catalog alone. Looking up one exchange is a
+ * Map hit plus one positional read. `entries()` streams matching exchanges
+ * oldest first, using a constant amount of memory.
+ */
+
+export const PROMPT_ARCHIVE_DIRNAME = "archive";
+export const PROMPT_ARCHIVE_CATALOG = "catalog.ndjson";
+export const DEFAULT_SEGMENT_MAX_BYTES = 8 * 1024 * 1024;
+
+const SEGMENT_PATTERN = /^segment-.+\.ndjson\.gz$/;
+
+function pickString(...candidates) {
+  for (const candidate of candidates) {
+    if (typeof candidate === "string" && candidate.trim()) {
+      return candidate.trim();
+    }
+  }
+  return null;
+}
+
+/** The catalog fields for one exchange; everything a listing or filter needs. */
+export function describeExchange(payload) {
+  const request = payload?.request ?? {};
+  const responseFormat = request.response_format ?? request.responseFormat ?? null;
+  const recordedAt = Date.parse(payload?.recordedAt ?? "");
+  return {
+    id: payload.id,
+    at: Number.isFinite(recordedAt) ? recordedAt : Date.now(),
+    scope: payload.scope ?? null,
+    label: payload.label ?? null,
+    model: pickString(request.model, request.modelKey, payload?.metadata?.model, payload?.response?.model),
+    schema: pickString(
+      payload?.metadata?.schemaId,
+      payload?.response?.schemaId,
+      responseFormat?.json_schema?.name,
+    ),
+    main: payload.mainPromptId ?? null,
+    error: Boolean(payload.error),
+  };
+}
+
+function matchesFilter(row, filter) {
+  if (!filter) {
+    return true;
+  }
+  for (const key of ["id", "scope", "label", "model", "schema"]) {
+    const expected = filter[key];
+    if (expected === undefined || expected === null) {
+      continue;
+    }
+    if (expected instanceof RegExp ? !expected.test(row[key] ?? "") : row[key] !== expected) {
+      return false;
+    }
+  }
+  if (filter.mainPromptId && row.main !== filter.mainPromptId) {
+    return false;
+  }
+  if (typeof filter.error === "boolean" && row.error !== filter.error) {
+    return false;
+  }
+  const since = filter.since ? Date.parse(filter.since) || Number(filter.since) : null;
+  const until = filter.until ? Date.parse(filter.until) || Number(filter.until) : null;
+  if (Number.isFinite(since) && row.at < since) {
+    return false;
+  }
+  if (Number.isFinite(until) && row.at > until) {
+    return false;
+  }
+  return true;
+}
+
+export default class PromptArchive {
+  /**
+   * @param {string} exchangesDir The `prompt-exchanges` directory.
+   * @param {{ segmentMaxBytes?: number }} [options]
+   */
+  constructor(exchangesDir, options = undefined) {
+    this.archiveDir = path.join(exchangesDir, PROMPT_ARCHIVE_DIRNAME);
+    this.catalogFile = path.join(this.archiveDir, PROMPT_ARCHIVE_CATALOG);
+    this.segmentMaxBytes = Number.isFinite(options?.segmentMaxBytes)
+      ? Math.max(1, options.segmentMaxBytes)
+      : DEFAULT_SEGMENT_MAX_BYTES;
+    /**
+     * Live catalog rows by id, in append order: a replacing row is re-inserted
+     * at the end rather than searched for.
+     * @type {Map<string, Record<string, any>>}
+     */
+    this.byId = new Map();
+    this._catalogBytes = 0;
+    this._segment = null;
+    this._catalogSealed = false;
+    this._chain = Promise.resolve();
+  }
+
+  segmentPath(segment) {
+    return path.join(this.archiveDir, path.basename(segment));
+  }
+
+  /** Reads catalog rows appended since the last call (by any process). */
+  async refresh() {
+    let handle;
+    try {
+      handle = await fs.promises.open(this.catalogFile, "r");
+    } catch (error) {
+      if (error?.code === "ENOENT") {
+        return this.byId.size;
+      }
+      throw error;
+    }
+    try {
+      const { size } = await handle.stat();
+      if (size < this._catalogBytes) {
+        // Rewritten by a prune; start over.
+        this.byId.clear();
+        this._catalogBytes = 0;
+      }
+      if (size === this._catalogBytes) {
+        return this.byId.size;
+      }
+      const buffer = Buffer.alloc(size - this._catalogBytes);
+      await handle.read(buffer, 0, buffer.length, this._catalogBytes);
+      // Only complete lines are consumed; a partial tail is re-read next time.
+      const end = buffer.lastIndexOf(0x0a);
+      if (end < 0) {
+        return this.byId.size;
+      }
+      for (const line of buffer.subarray(0, end).toString("utf8").split("\n")) {
+        if (!line.trim()) {
+          continue;
+        }
+        let row;
+        try {
+          row = JSON.parse(line);
+        } catch {
+          continue;
+        }
+        if (row?.id && row.seg) {
+          this._index(row);
+        }
+      }
+      this._catalogBytes += end + 1;
+    } finally {
+      await handle.close();
+    }
+    return this.byId.size;
+  }
+
+  _index(row) {
+    this.byId.delete(row.id);
+    this.byId.set(row.id, row);
+  }
+
+  /**
+   * Appends one exchange payload (which must carry an `id`) and returns its
+   * catalog row. Appends from one process are serialized so offsets stay exact.
+   */
+  append(payload) {
+    const run = this._chain.then(() => this._append(payload));
+    this._chain = run.catch(() => {});
+    return run;
+  }
+
+  async _append(payload) {
+    if (!payload?.id) {
+      throw new Error("PromptArchive.append requires an exchange id.");
+    }
+    const member = await gzip(Buffer.from(`${JSON.stringify(payload)}\n`, "utf8"));
+    const segment = await this._openSegment(member.length);
+    await segment.handle.write(member, 0, member.length, null);
+    const row = {
+      ...describeExchange(payload),
+      seg: segment.name,
+      off: segment.size,
+      len: member.length,
+    };
+    segment.size += member.length;
+    if (!this._catalogSealed) {
+      await this._sealCatalog();
+    }
+    // The catalog row goes last: a crash before it leaves unreferenced bytes
+    // in the segment, never a row pointing at a partial member.
+    await fs.promises.appendFile(this.catalogFile, `${JSON.stringify(row)}\n`, "utf8");
+    this._index(row);
+    return row;
+  }
+
+  async _openSegment(incomingBytes) {
+    if (this._segment && this._segment.size + incomingBytes > this.segmentMaxBytes && this._segment.size > 0) {
+      await this._segment.handle.close();
+      this._segment = null;
+    }
+    if (!this._segment) {
+      await fs.promises.mkdir(this.archiveDir, { recursive: true });
+      const stamp = new Date().toISOString().replace(/[-:.TZ]/g, "");
+      const name = `segment-${stamp}-${process.pid}-${Math.random().toString(36).slice(2, 6)}.ndjson.gz`;
+      this._segment = {
+        name,
+        handle: await fs.promises.open(path.join(this.archiveDir, name), "a"),
+        size: 0,
+      };
+    }
+    return this._segment;
+  }
+
+  /** A crash mid-append can leave the catalog without its final newline. */
+  async _sealCatalog() {
+    this._catalogSealed = true;
+    let handle;
+    try {
+      handle = await fs.promises.open(this.catalogFile, "r");
+    } catch {
+      return;
+    }
+    let last = "\n";
+    try {
+      const { size } = await handle.stat();
+      if (size > 0) {
+        const buffer = Buffer.alloc(1);
+        await handle.read(buffer, 0, 1, size - 1);
+        last = buffer.toString("utf8");
+      }
+    } finally {
+      await handle.close();
+    }
+    if (last !== "\n") {
+      await fs.promises.appendFile(this.catalogFile, "\n", "utf8");
+    }
+  }
+
+  /** Waits for pending appends. */
+  async flush() {
+    await this._chain;
+  }
+
+  /** Waits for pending appends and closes the open segment. */
+  async close() {
+    await this._chain;
+    if (this._segment) {
+      await this._segment.handle.close();
+      this._segment = null;
+    }
+  }
+
+  async has(id) {
+    if (!this.byId.has(id)) {
+      await this.refresh();
+    }
+    return this.byId.has(id);
+  }
+
+  /** Catalog rows matching `filter`, oldest first; no segment is opened. */
+  async list(filter = undefined) {
+    await this.refresh();
+    const rows = [];
+    for (const row of this.byId.values()) {
+      if (matchesFilter(row, filter)) {
+        rows.push(row);
+      }
+    }
+    const limit = Number(filter?.limit);
+    return Number.isFinite(limit) && limit > 0 ? rows.slice(-Math.floor(limit)) : rows;
+  }
+
+  async _readRow(row, handle = null) {
+    const own = handle ?? (await fs.promises.open(this.segmentPath(row.seg), "r"));
+    try {
+      const buffer = Buffer.alloc(row.len);
+      await own.read(buffer, 0, row.len, row.off);
+      return JSON.parse((await gunzip(buffer)).toString("utf8"));
+    } finally {
+      if (!handle) {
+        await own.close();
+      }
+    }
+  }
+
+  /** Returns one exchange by id, or null when it is not archived. */
+  async read(id) {
+    if (!(await this.has(id))) {
+      return null;
+    }
+    await this._chain;
+    const row = this.byId.get(id);
+    recordCacheAccess(path.dirname(path.dirname(this.archiveDir)), this.segmentPath(row.seg));
+    try {
+      return await this._readRow(row);
+    } catch (error) {
+      if (error?.code === "ENOENT") {
+        return null;
+      }
+      throw error;
+    }
+  }
+
+  /**
+   * Streams archived exchanges matching `filter` (see `list`), oldest first.
+   * Consecutive rows from one segment share a file handle. Rows whose segment
+   * has been pruned are skipped.
+   * @returns {AsyncGenerator<Record<string, any>>}
+   */
+  async *entries(filter = undefined) {
+    const rows = await this.list(filter);
+    await this._chain;
+    let open = null;
+    try {
+      for (const row of rows) {
+        if (open?.seg !== row.seg) {
+          await open?.handle.close();
+          open = null;
+          try {
+            open = { seg: row.seg, handle: await fs.promises.open(this.segmentPath(row.seg), "r") };
+          } catch {
+            continue;
+          }
+        }
+        yield await this._readRow(row, open.handle);
+      }
+    } finally {
+      await open?.handle.close();
+    }
+  }
+
+  /**
+   * Deletes the named segments and their catalog rows (the quota GC evicts
+   * segments by last access rather than by count). The segment this instance
+   * is writing is never removed. Same caveat as `prune` about concurrent
+   * recorders.
+   */
+  async removeSegments(names) {
+    await this.refresh();
+    await this._chain;
+    const wanted = new Set(Array.from(names ?? [], (name) => path.basename(name)));
+    if (this._segment) {
+      wanted.delete(this._segment.name);
+    }
+    const removable = Array.from(wanted);
+    const before = this.byId.size;
+    if (removable.length) {
+      await this._dropSegments(removable);
+    }
+    return { removedEntries: before - this.byId.size, removedSegments: removable.length };
+  }
+
+  /** Rewrites the catalog with the live rows outside `removable`, then deletes those segments. */
+  async _dropSegments(removable) {
+    const dropped = new Set(removable);
+    const keptRows = [...this.byId.values()].filter((row) => !dropped.has(row.seg));
+    const tempFile = `${this.catalogFile}.${process.pid}.tmp`;
+    await fs.promises.writeFile(
+      tempFile,
+      keptRows.map((row) => `${JSON.stringify(row)}\n`).join(""),
+      "utf8",
+    );
+    await fs.promises.rename(tempFile, this.catalogFile);
+    await Promise.all(
+      removable.map((name) => fs.promises.rm(this.segmentPath(name), { force: true })),
+    );
+    this.byId.clear();
+    this._catalogBytes = 0;
+    await this.refresh();
+  }
+
+  /**
+   * Keeps the newest `keep` exchanges by deleting whole segments that hold
+   * none of them, then rewrites the catalog without their rows. Pruning works
+   * on whole segments, so a few older exchanges can outlive `keep` when they
+   * share a segment with newer ones. Run it while no other process is
+   * recording: rows another process appends during the rewrite are lost.
+   */
+  async prune({ keep, dryRun = false } = {}) {
+    await this.refresh();
+    await this._chain;
+    const rows = [...this.byId.values()];
+    const totalEntries = rows.length;
+    const kept = new Set(rows.slice(Math.max(0, totalEntries - keep)).map((row) => row.seg));
+    if (this._segment) {
+      kept.add(this._segment.name);
+    }
+    let files = [];
+    try {
+      files = (await fs.promises.readdir(this.archiveDir)).filter((name) => SEGMENT_PATTERN.test(name));
+    } catch {
+      files = [];
+    }
+    const referenced = new Set(rows.map((row) => row.seg));
+    // Segments no row references are leftovers of a crash before the first catalog append.
+    const removable = files.filter((name) => !kept.has(name) && referenced.has(name));
+    const keptRows = rows.filter((row) => kept.has(row.seg));
+    if (!dryRun && removable.length) {
+      await this._dropSegments(removable);
+    }
+    return {
+      totalEntries,
+      keptEntries: keptRows.length,
+      removedEntries: totalEntries - keptRows.length,
+      removedSegments: removable.length,
+    };
+  }
+}
@@ -0,0 +1,443 @@
+import LatencyHistogram, { buildLogBounds } from "./latency-histogram.js";
+
+/**
+ * Capacity analytics over the prompt telemetry database (`prompt_scores` and
+ * `prompt_events`, written by PromptPerformanceTracker): TTFT and duration
+ * percentiles, generation throughput, slow-start rate and retry cost, grouped
+ * by model and/or schema, plus regressions between two time windows.
+ *
+ * Reports never scan raw telemetry. `refreshPerfRollups` materializes one
+ * `prompt_perf_daily` row per (day, model, schema), holding counts, sums and
+ * sparse log-bucket histograms (10% wide buckets, so percentiles come out
+ * within ~5%). A refresh only recomputes the days that gained rows since the
+ * previous one, tracked by the high-water ids in `prompt_perf_state`. A report
+ * merges the daily rows of its window, so its cost depends on days × groups,
+ * not on the number of prompts.
+ */
+
+export const PERF_BOUNDS_MS = buildLogBounds(10, 600_000, 1.1);
+export const RETRY_EVENT_TYPES = ["stream-retry", "rest-fallback", "no-token-timeout", "protocol-warning"];
+export const DEFAULT_REGRESSION_THRESHOLD = 0.1;
+const MIN_REGRESSION_SAMPLES = 5;
+const DAY_MS = 24 * 60 * 60 * 1000;
+
+const ROLLUP_SCHEMA = [
+  `CREATE TABLE IF NOT EXISTS prompt_perf_daily (
+    day TEXT NOT NULL,
+    model_key TEXT NOT NULL,
+    schema_id TEXT NOT NULL,
+    prompts INTEGER NOT NULL,
+    ttft_count INTEGER NOT NULL,
+    ttft_sum_ms REAL NOT NULL,
+    ttft_max_ms REAL NOT NULL,
+    ttft_hist TEXT NOT NULL,
+    duration_count INTEGER NOT NULL,
+    duration_sum_ms REAL NOT NULL,
+    duration_max_ms REAL NOT NULL,
+    duration_hist TEXT NOT NULL,
+    output_tokens INTEGER NOT NULL,
+    generation_ms REAL NOT NULL,
+    slow_starts INTEGER NOT NULL,
+    retries INTEGER NOT NULL,
+    retry_prompts INTEGER NOT NULL,
+    retry_duration_ms REAL NOT NULL,
+    computed_at TEXT NOT NULL,
+    PRIMARY KEY (day, model_key, schema_id)
+  );`,
+  `CREATE TABLE IF NOT EXISTS prompt_perf_state (
+    key TEXT PRIMARY KEY,
+    value TEXT
+  );`,
+];
+
+export function toDay(value) {
+  return new Date(value).toISOString().slice(0, 10);
+}
+
+function nextDay(day) {
+  return toDay(Date.parse(`${day}T00:00:00Z`) + DAY_MS);
+}
+
+/**
+ * Resolves `7d`, `24h`, `today` or an ISO date/time into a day (YYYY-MM-DD).
+ * @param {string | undefined} value
+ * @param {number} [now]
+ */
+export function resolveDay(value, now = Date.now()) {
+  if (value === undefined || value === null || value === "" || value === "today") {
+    return toDay(now);
+  }
+  const relative = /^(\d+(?:\.\d+)?)\s*([dhw])$/i.exec(String(value).trim());
+  if (relative) {
+    const unit = { h: 60 * 60 * 1000, d: DAY_MS, w: 7 * DAY_MS }[relative[2].toLowerCase()];
+    return toDay(now - Number(relative[1]) * unit);
+  }
+  const parsed = Date.parse(value);
+  if (!Number.isFinite(parsed)) {
+    throw new Error(`Unrecognized date "${value}" (use YYYY-MM-DD, an ISO time, or e.g. 7d/24h).`);
+  }
+  return toDay(parsed);
+}
+
+function createGroupAccumulator() {
+  return {
+    prompts: 0,
+    ttft: new LatencyHistogram(PERF_BOUNDS_MS),
+    duration: new LatencyHistogram(PERF_BOUNDS_MS),
+    outputTokens: 0,
+    generationMs: 0,
+    slowStarts: 0,
+    retries: 0,
+    retryPrompts: 0,
+    retryDurationMs: 0,
+  };
+}
+
+async function readState(db) {
+  const rows = (await db.all("SELECT key, value FROM prompt_perf_state;")) ?? [];
+  const state = Object.fromEntries(rows.map((row) => [row.key, Number(row.value) || 0]));
+  return { lastScoreId: state.last_score_id ?? 0, lastEventId: state.last_event_id ?? 0 };
+}
+
+async function rollupDay(db, day, computedAt) {
+  const range = [day, nextDay(day)];
+  const placeholders = RETRY_EVENT_TYPES.map(() => "?").join(", ");
+  const scores =
+    (await db.all(
+      `SELECT
+         COALESCE(s.model_key, '') AS model_key,
+         COALESCE(s.schema_id, '') AS schema_id,
+         s.duration_ms,
+         s.ttft_ms,
+         s.output_tokens,
+         EXISTS (
+           SELECT 1 FROM prompt_events e
+           WHERE e.prompt_id = s.prompt_id AND e.event_type IN (${placeholders})
+         ) AS retried
+       FROM prompt_scores s
+       WHERE s.created_at >= ? AND s.created_at < ?;`,
+      [...RETRY_EVENT_TYPES, ...range],
+    )) ?? [];
+  const events =
+    (await db.all(
+      // Events are attributed to their prompt's model/schema when that prompt was scored.
+      `SELECT
+         COALESCE(
+           (SELECT s.model_key FROM prompt_scores s WHERE s.prompt_id = e.prompt_id LIMIT 1),
+           e.model_key,
+           ''
+         ) AS model_key,
+         COALESCE(
+           (SELECT s.schema_id FROM prompt_scores s WHERE s.prompt_id = e.prompt_id LIMIT 1),
+           e.schema_id,
+           ''
+         ) AS schema_id,
+         e.event_type,
+         COUNT(*) AS total
+       FROM prompt_events e
+       WHERE e.created_at >= ? AND e.created_at < ?
+       GROUP BY 1, 2, 3;`,
+      range,
+    )) ?? [];
+
+  const groups = new Map();
+  const groupFor = (modelKey, schemaId) => {
+    const key = `${modelKey}\u0000${schemaId}`;
+    if (!groups.has(key)) {
+      groups.set(key, { modelKey, schemaId, ...createGroupAccumulator() });
+    }
+    return groups.get(key);
+  };
+  for (const row of scores) {
+    const group = groupFor(row.model_key, row.schema_id);
+    group.prompts += 1;
+    const durationMs = Number(row.duration_ms);
+    const ttftMs = Number(row.ttft_ms);
+    const hasDuration = row.duration_ms !== null && Number.isFinite(durationMs);
+    const hasTtft = row.ttft_ms !== null && Number.isFinite(ttftMs);
+    if (hasDuration) {
+      group.duration.record(durationMs);
+    }
+    if (hasTtft) {
+      group.ttft.record(ttftMs);
+    }
+    const tokens = Number(row.output_tokens);
+    if (hasDuration && hasTtft && row.output_tokens !== null && tokens > 0 && durationMs > ttftMs) {
+      group.outputTokens += tokens;
+      group.generationMs += durationMs - ttftMs;
+    }
+    if (row.retried) {
+      group.retryPrompts += 1;
+      group.retryDurationMs += hasDuration ? durationMs : 0;
+    }
+  }
+  for (const row of events) {
+    const group = groupFor(row.model_key, row.schema_id);
+    if (row.event_type === "slow-start") {
+      group.slowStarts += Number(row.total);
+    } else if (RETRY_EVENT_TYPES.includes(row.event_type)) {
+      group.retries += Number(row.total);
+    }
+  }
+
+  await db.run("DELETE FROM prompt_perf_daily WHERE day = ?;", [day]);
+  for (const group of groups.values()) {
+    await db.run(
+      `INSERT INTO prompt_perf_daily (
+         day, model_key, schema_id, prompts,
+         ttft_count, ttft_sum_ms, ttft_max_ms, ttft_hist,
+         duration_count, duration_sum_ms, duration_max_ms, duration_hist,
+         output_tokens, generation_ms, slow_starts, retries, retry_prompts, retry_duration_ms,
+         computed_at
+       ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);`,
+      [
+        day,
+        group.modelKey,
+        group.schemaId,
+        group.prompts,
+        group.ttft.count,
+        group.ttft.sumMs,
+        group.ttft.maxMs,
+        JSON.stringify(group.ttft.sparseCounts()),
+        group.duration.count,
+        group.duration.sumMs,
+        group.duration.maxMs,
+        JSON.stringify(group.duration.sparseCounts()),
+        group.outputTokens,
+        group.generationMs,
+        group.slowStarts,
+        group.retries,
+        group.retryPrompts,
+        group.retryDurationMs,
+        computedAt,
+      ],
+    );
+  }
+  return groups.size;
+}
+
+/**
+ * Brings `prompt_perf_daily` up to date with the telemetry tables.
+ * @param {import("sqlite").Database} db
+ * @param {{ full?: boolean }} [options] `full` rebuilds every day from scratch.
+ */
+export async function refreshPerfRollups(db, options = undefined) {
+  for (const sql of ROLLUP_SCHEMA) {
+    await db.exec(sql);
+  }
+  const state = options?.full ? { lastScoreId: 0, lastEventId: 0 } : await readState(db);
+  const maxIds = await db.get(
+    `SELECT
+       (SELECT COALESCE(MAX(id), 0) FROM prompt_scores) AS maxScoreId,
+       (SELECT COALESCE(MAX(id), 0) FROM prompt_events) AS maxEventId;`,
+  );
+  const maxScoreId = Number(maxIds?.maxScoreId ?? 0);
+  const maxEventId = Number(maxIds?.maxEventId ?? 0);
+  if (maxScoreId === state.lastScoreId && maxEventId === state.lastEventId && !options?.full) {
+    return { daysRefreshed: 0, rows: 0 };
+  }
+  const dayRows =
+    (await db.all(
+      `SELECT DISTINCT substr(created_at, 1, 10) AS day FROM prompt_scores WHERE id > ? AND id <= ?
+       UNION
+       SELECT DISTINCT substr(created_at, 1, 10) AS day FROM prompt_events WHERE id > ? AND id <= ?;`,
+      [state.lastScoreId, maxScoreId, state.lastEventId, maxEventId],
+    )) ?? [];
+  const days = dayRows.map((row) => row.day).filter(Boolean).sort();
+  const computedAt = new Date().toISOString();
+  let rows = 0;
+  await db.exec("BEGIN IMMEDIATE;");
+  try {
+    if (options?.full) {
+      await db.run("DELETE FROM prompt_perf_daily;");
+    }
+    for (const day of days) {
+      rows += await rollupDay(db, day, computedAt);
+    }
+    await db.run(
+      `INSERT INTO prompt_perf_state (key, value) VALUES ('last_score_id', ?), ('last_event_id', ?)
+       ON CONFLICT(key) DO UPDATE SET value = excluded.value;`,
+      [String(maxScoreId), String(maxEventId)],
+    );
+    await db.exec("COMMIT;");
+  } catch (error) {
+    await db.exec("ROLLBACK;").catch(() => {});
+    throw error;
+  }
+  return { daysRefreshed: days.length, rows };
+}
+
+function groupKeyOf(row, groupBy) {
+  const parts = groupBy.map((field) =>
+    field === "schema" ? row.schema_id || "(no schema)" : row.model_key || "(unknown model)",
+  );
+  return parts.join(" · ");
+}
+
+function summarizeGroup(group) {
+  const ttft = group.ttft.toJSON();
+  const duration = group.duration.toJSON();
+  const cleanPrompts = group.duration.count - group.retryPrompts;
+  const cleanMeanMs =
+    cleanPrompts > 0 ? (group.duration.sumMs - group.retryDurationMs) / cleanPrompts : null;
+  const retryMeanMs = group.retryPrompts > 0 ? group.retryDurationMs / group.retryPrompts : null;
+  return {
+    prompts: group.prompts,
+    ttftSamples: ttft.count,
+    ttftP50Ms: ttft.p50Ms,
+    ttftP95Ms: ttft.p95Ms,
+    ttftP99Ms: ttft.p99Ms,
+    durationP50Ms: duration.p50Ms,
+    durationP95Ms: duration.p95Ms,
+    tokensPerSecond:
+      group.generationMs > 0
+        ? Number((group.outputTokens / (group.generationMs / 1000)).toFixed(2))
+        : null,
+    slowStarts: group.slowStarts,
+    slowStartRate: group.prompts ? Number((group.slowStarts / group.prompts).toFixed(4)) : null,
+    retries: group.retries,
+    retriesPer100: group.prompts ? Number(((group.retries / group.prompts) * 100).toFixed(2)) : null,
+    retryPrompts: group.retryPrompts,
+    // Extra wall time retried prompts took over clean ones, summed over the retried prompts.
+    retryCostMs:
+      retryMeanMs !== null && cleanMeanMs !== null
+        ? Math.max(0, Math.round((retryMeanMs - cleanMeanMs) * group.retryPrompts))
+        : null,
+  };
+}
+
+/**
+ * Merges the daily rollups of one window into per-group metrics.
+ * @param {import("sqlite").Database} db
+ * @param {{ since: string, until: string, groupBy?: string[], model?: string, schema?: string }} window
+ */
+export async function summarizeWindow(db, window) {
+  const groupBy = window.groupBy?.length ? window.groupBy : ["model"];
+  const conditions = ["day >= ?", "day <= ?"];
+  const params = [window.since, window.until];
+  if (window.model) {
+    conditions.push("model_key = ?");
+    params.push(window.model);
+  }
+  if (window.schema) {
+    conditions.push("schema_id = ?");
+    params.push(window.schema);
+  }
+  const rows =
+    (await db.all(
+      `SELECT * FROM prompt_perf_daily WHERE ${conditions.join(" AND ")} ORDER BY day;`,
+      params,
+    )) ?? [];
+  const groups = new Map();
+  const total = createGroupAccumulator();
+  for (const row of rows) {
+    const key = groupKeyOf(row, groupBy);
+    if (!groups.has(key)) {
+      groups.set(key, createGroupAccumulator());
+    }
+    for (const group of [groups.get(key), total]) {
+      group.prompts += row.prompts;
+      group.ttft.mergeSparse(JSON.parse(row.ttft_hist), {
+        sumMs: row.ttft_sum_ms,
+        maxMs: row.ttft_max_ms,
+      });
+      group.duration.mergeSparse(JSON.parse(row.duration_hist), {
+        sumMs: row.duration_sum_ms,
+        maxMs: row.duration_max_ms,
+      });
+      group.outputTokens += row.output_tokens;
+      group.generationMs += row.generation_ms;
+      group.slowStarts += row.slow_starts;
+      group.retries += row.retries;
+      group.retryPrompts += row.retry_prompts;
+      group.retryDurationMs += row.retry_duration_ms;
+    }
+  }
+  return {
+    since: window.since,
+    until: window.until,
+    groupBy,
+    days: new Set(rows.map((row) => row.day)).size,
+    total: summarizeGroup(total),
+    groups: Array.from(groups.entries())
+      .map(([group, accumulator]) => ({ group, ...summarizeGroup(accumulator) }))
+      .sort((left, right) => right.prompts - left.prompts),
+  };
+}
+
+const REGRESSION_METRICS = [
+  { key: "ttftP50Ms", label: "TTFT p50", higherIsWorse: true },
+  { key: "ttftP95Ms", label: "TTFT p95", higherIsWorse: true },
+  { key: "durationP95Ms", label: "Duration p95", higherIsWorse: true },
+  { key: "tokensPerSecond", label: "Tokens/s", higherIsWorse: false },
+  { key: "slowStartRate", label: "Slow-start rate", higherIsWorse: true },
+  { key: "retriesPer100", label: "Retries/100", higherIsWorse: true },
+];
+
+/** Metric changes between two window summaries, flagging the ones worse by more than `threshold`. */
+export function compareWindows(current, baseline, threshold = DEFAULT_REGRESSION_THRESHOLD) {
+  const baselineByGroup = new Map(baseline.groups.map((entry) => [entry.group, entry]));
+  const changes = [];
+  for (const entry of current.groups) {
+    const before = baselineByGroup.get(entry.group);
+    if (!before || entry.prompts < MIN_REGRESSION_SAMPLES || before.prompts < MIN_REGRESSION_SAMPLES) {
+      continue;
+    }
+    for (const metric of REGRESSION_METRICS) {
+      const now = entry[metric.key];
+      const then = before[metric.key];
+      if (now === null || then === null || now === undefined || then === undefined) {
+        continue;
+      }
+      const change = then === 0 ? (now === 0 ? 0 : Infinity) : (now - then) / then;
+      const worse = metric.higherIsWorse ? change > threshold : change < -threshold;
+      const better = metric.higherIsWorse ? change < -threshold : change > threshold;
+      if (worse || better) {
+        changes.push({
+          group: entry.group,
+          metric: metric.key,
+          label: metric.label,
+          baseline: then,
+          current: now,
+          change: Number.isFinite(change) ? Number(change.toFixed(4)) : null,
+          regression: worse,
+        });
+      }
+    }
+  }
+  return changes.sort((left, right) => Number(right.regression) - Number(left.regression));
+}
+
+/**
+ * Refreshes the rollups and builds the report for one window, plus an
+ * optional baseline window to compare against.
+ * @param {import("sqlite").Database} db
+ * @param {{
+ *   since: string,
+ *   until: string,
+ *   groupBy?: string[],
+ *   model?: string,
+ *   schema?: string,
+ *   baseline?: { since: string, until: string } | null,
+ *   threshold?: number
+ * }} options
+ */
+export async function buildPerfReport(db, options) {
+  const refresh = await refreshPerfRollups(db);
+  const current = await summarizeWindow(db, options);
+  let baseline = null;
+  let changes = [];
+  if (options.baseline) {
+    baseline = await summarizeWindow(db, { ...options, ...options.baseline });
+    changes = compareWindows(current, baseline, options.threshold ?? DEFAULT_REGRESSION_THRESHOLD);
+  }
+  return { generatedAt: new Date().toISOString(), refresh, current, baseline, changes };
+}
+
+/** The window of the same length that ends the day before `since`. */
+export function precedingWindow(since, until) {
+  const spanDays = Math.round((Date.parse(`${until}T00:00:00Z`) - Date.parse(`${since}T00:00:00Z`)) / DAY_MS) + 1;
+  const baselineUntil = toDay(Date.parse(`${since}T00:00:00Z`) - DAY_MS);
+  const baselineSince = toDay(Date.parse(`${baselineUntil}T00:00:00Z`) - (spanDays - 1) * DAY_MS);
+  return { since: baselineSince, until: baselineUntil };
+}
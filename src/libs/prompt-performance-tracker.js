@@ -4,10 +4,13 @@ import { createHash } from "crypto";
 import { open } from "sqlite";
 import sqlite3 from "sqlite3";
 import { parseStrictJsonObject } from "./core-utils.js";
+import LatencyHistogram from "./latency-histogram.js";
 
 const DEFAULT_DB_FILENAME = "miniphi-prompts.db";
 const MAX_STORED_TEXT = 4000;
 const DEFAULT_SNAPSHOT_LIMIT = 12;
+const DEFAULT_FLUSH_DELAY_MS = 25;
+const DEFAULT_BATCH_SIZE = 64;
 const PROMPT_SCORE_FALLBACK_SCHEMA = [
   "{",
   '  "score": 0,',
@@ -23,16 +26,149 @@ const PROMPT_SCORE_FALLBACK_SCHEMA = [
   "}",
 ].join("\n");
 
+const SQL = {
+  session: `INSERT INTO prompt_sessions (session_id, objective, workspace_path, workspace_type, workspace_fingerprint, created_at)
+       VALUES (@sessionId, @objective, @workspacePath, @workspaceType, @workspaceFingerprint, @createdAt)
+       ON CONFLICT(session_id) DO UPDATE SET
+         objective = COALESCE(excluded.objective, prompt_sessions.objective),
+         workspace_path = COALESCE(excluded.workspace_path, prompt_sessions.workspace_path),
+         workspace_type = COALESCE(excluded.workspace_type, prompt_sessions.workspace_type),
+         workspace_fingerprint = COALESCE(excluded.workspace_fingerprint, prompt_sessions.workspace_fingerprint);`,
+  score: `INSERT INTO prompt_scores (
+        session_id,
+        scope,
+        prompt_id,
+        prompt_label,
+        objective,
+        prompt_text,
+        response_text,
+        score,
+        follow_up_needed,
+        follow_up_reason,
+        evaluation_json,
+        metadata_json,
+        workspace_path,
+        workspace_type,
+        workspace_fingerprint,
+        model_key,
+        schema_id,
+        transport,
+        duration_ms,
+        ttft_ms,
+        output_tokens,
+        created_at
+      ) VALUES (
+        @sessionId,
+        @scope,
+        @promptId,
+        @promptLabel,
+        @objective,
+        @promptText,
+        @responseText,
+        @score,
+        @followUpNeeded,
+        @followUpReason,
+        @evaluationJson,
+        @metadataJson,
+        @workspacePath,
+        @workspaceType,
+        @workspaceFingerprint,
+        @modelKey,
+        @schemaId,
+        @transport,
+        @durationMs,
+        @ttftMs,
+        @outputTokens,
+        @createdAt
+      );`,
+  event: `INSERT INTO prompt_events (
+        session_id,
+        prompt_id,
+        event_type,
+        severity,
+        message,
+        metadata_json,
+        workspace_path,
+        workspace_type,
+        workspace_fingerprint,
+        model_key,
+        schema_id,
+        created_at
+      ) VALUES (
+        @sessionId,
+        @promptId,
+        @eventType,
+        @severity,
+        @message,
+        @metadataJson,
+        @workspacePath,
+        @workspaceType,
+        @workspaceFingerprint,
+        @modelKey,
+        @schemaId,
+        @createdAt
+      );`,
+  bestPrompt: `SELECT prompt_id, prompt_text, response_text, score, evaluation_json, created_at
+       FROM prompt_scores
+       WHERE workspace_fingerprint = ? AND objective = ?
+       ORDER BY score DESC, created_at DESC
+       LIMIT 1;`,
+  scoreStats: `SELECT
+        COUNT(*) AS total,
+        COALESCE(AVG(score), 0) AS avgScore,
+        SUM(CASE WHEN follow_up_needed = 1 THEN 1 ELSE 0 END) AS followUps
+       FROM prompt_scores
+       WHERE workspace_fingerprint = ? AND objective = ?;`,
+  recentScores: `SELECT id, score, created_at
+       FROM prompt_scores
+       WHERE workspace_fingerprint = ? AND objective = ?
+       ORDER BY created_at DESC
+       LIMIT ?;`,
+  snapshot: `INSERT INTO best_prompt_snapshots (
+        workspace_fingerprint,
+        objective,
+        workspace_type,
+        workspace_path,
+        snapshot_json,
+        computed_at
+      ) VALUES (
+        @workspaceFingerprint,
+        @objective,
+        @workspaceType,
+        @workspacePath,
+        @snapshotJson,
+        @computedAt
+      )
+      ON CONFLICT(workspace_fingerprint, objective) DO UPDATE SET
+        workspace_type = excluded.workspace_type,
+        workspace_path = excluded.workspace_path,
+        snapshot_json = excluded.snapshot_json,
+        computed_at = excluded.computed_at;`,
+};
+
 /**
  * Tracks prompt quality metrics inside a SQLite database so MiniPhi can surface
  * high-performing prompt structures per workspace/objective combination.
+ *
+ * Nothing on the prompt completion path waits for SQLite. `track` and
+ * `recordEvent` queue their rows and return. The queue commits as one
+ * transaction through statements prepared once in `prepare()`, either after
+ * `flushDelayMs` or as soon as `batchSize` rows are waiting. Best-prompt
+ * snapshots are rebuilt after each commit, once per workspace/objective pair
+ * the batch touched rather than once per prompt. A batch that fails to commit
+ * is held and retried once, in its own transaction, on the next drain; only a
+ * second failure drops its rows. `flush()` (and `dispose()`) drains everything. `latency` holds per-operation histograms; `track` is
+ * timed without the semantic evaluator call, so it shows the tracker's own
+ * cost on the completion path.
  */
 export default class PromptPerformanceTracker {
   /**
    * @param {{
    *   dbPath?: string,
    *   debug?: boolean,
-   *   snapshotLimit?: number
+   *   snapshotLimit?: number,
+   *   flushDelayMs?: number,
+   *   batchSize?: number
    * }} [options]
    */
   constructor(options = undefined) {
@@ -47,6 +183,30 @@ export default class PromptPerformanceTracker {
     this.scoringSuspended = false;
     this.scoringSuspendedReason = null;
     this.scoringSuspendedNotified = false;
+    this.flushDelayMs = Number.isFinite(options?.flushDelayMs)
+      ? Math.max(0, options.flushDelayMs)
+      : DEFAULT_FLUSH_DELAY_MS;
+    this.batchSize = Number.isFinite(options?.batchSize)
+      ? Math.max(1, Math.floor(options.batchSize))
+      : DEFAULT_BATCH_SIZE;
+    this._statements = null;
+    /** @type {Map<string, Record<string, unknown>>} session upserts waiting for the next batch */
+    this._pendingSessions = new Map();
+    /** @type {Array<{ statement: string, params: Record<string, unknown> }>} */
+    this._pendingRows = [];
+    /** @type {Map<string, Record<string, unknown>>} snapshot keys touched since the last drain */
+    this._dirtySnapshots = new Map();
+    /** The last failed batch, waiting for its one retry. */
+    this._retryBatch = null;
+    this._flushTimer = null;
+    this._drainChain = Promise.resolve();
+    this.latency = {
+      track: new LatencyHistogram(),
+      recordEvent: new LatencyHistogram(),
+      batchCommit: new LatencyHistogram(),
+      snapshot: new LatencyHistogram(),
+    };
+    this.writeStats = { batches: 0, rows: 0, failedBatches: 0, retriedBatches: 0, droppedRows: 0 };
   }
 
   async prepare() {
@@ -68,6 +228,7 @@ export default class PromptPerformanceTracker {
     await this.db.exec("PRAGMA journal_mode = WAL;");
     await this.db.exec("PRAGMA foreign_keys = ON;");
     await this._migrate();
+    await this._prepareStatements();
     this.enabled = true;
   }
 
@@ -77,6 +238,15 @@ export default class PromptPerformanceTracker {
 
   async dispose() {
     if (this.db) {
+      try {
+        await this.flush();
+        if (this._retryBatch) {
+          await this.flush();
+        }
+      } catch {
+        // ignore flush errors during dispose
+      }
+      await this._finalizeStatements();
       try {
         await this.db.close();
       } catch {
@@ -114,6 +284,8 @@ export default class PromptPerformanceTracker {
     if (!this.enabled || !this.db || !payload?.traceContext || !payload.request) {
       return;
     }
+    const startedAt = performance.now();
+    let evaluatorMs = 0;
 
     const traceContext = payload.traceContext;
     const sessionContext = this._resolveSessionContext(traceContext);
@@ -207,10 +379,13 @@ export default class PromptPerformanceTracker {
         executionCommand: traceContext.metadata?.command ?? null,
         executionCwd: traceContext.metadata?.cwd ?? null,
       });
+      const evaluatorStartedAt = performance.now();
       try {
         const raw = await this.semanticEvaluator(evalPrompt, traceContext);
+        evaluatorMs = performance.now() - evaluatorStartedAt;
         evaluation = this._parseEvaluation(raw);
       } catch (error) {
+        evaluatorMs = performance.now() - evaluatorStartedAt;
         const message = error instanceof Error ? error.message : String(error);
         const proseFailure =
           /schema validation/i.test(message) ||
@@ -238,7 +413,7 @@ export default class PromptPerformanceTracker {
     const workspaceFingerprint =
       contextWorkspaceFingerprint ?? this._fingerprint(workspacePath);
     const now = new Date().toISOString();
-    await this._persistSession({
+    this._queueSession({
       sessionId,
       objective,
       workspacePath,
@@ -247,7 +422,7 @@ export default class PromptPerformanceTracker {
       createdAt: now,
     });
 
-    await this._insertPromptScore({
+    this._queuePromptScore({
       scope: traceContext.scope,
       sessionId,
       promptId: traceContext.subPromptId,
@@ -263,15 +438,24 @@ export default class PromptPerformanceTracker {
       workspacePath,
       workspaceType,
       workspaceFingerprint,
+      modelKey: payload.request?.model ?? payload.modelKey ?? null,
+      schemaId: traceContext.schemaId ?? payload.response?.schemaId ?? null,
+      transport: traceContext.transport ?? null,
+      durationMs,
+      ttftMs: payload.response?.timeToFirstTokenMs ?? null,
+      outputTokens:
+        payload.response?.tokensApprox ?? payload.response?.stream?.solutionTokens ?? null,
       createdAt: now,
     });
 
-    await this._snapshotBestPrompt({
+    this._markSnapshotDirty({
       objective,
       workspaceFingerprint,
       workspaceType,
       workspacePath,
     });
+    this._scheduleFlush();
+    this.latency.track.record(performance.now() - startedAt - evaluatorMs);
 
     return {
       score,
@@ -303,6 +487,7 @@ export default class PromptPerformanceTracker {
     ) {
       return;
     }
+    const startedAt = performance.now();
     const traceContext = payload.traceContext;
     const sessionContext = this._resolveSessionContext(traceContext);
     const { sessionId, objective, workspacePath, workspaceType, workspaceFingerprint } =
@@ -312,7 +497,7 @@ export default class PromptPerformanceTracker {
     }
     const metadataJson = payload.metadata ? JSON.stringify(payload.metadata) : null;
     const createdAt = new Date().toISOString();
-    await this._persistSession({
+    this._queueSession({
       sessionId,
       objective,
       workspacePath,
@@ -320,7 +505,7 @@ export default class PromptPerformanceTracker {
       workspaceFingerprint,
       createdAt,
     });
-    await this._insertPromptEvent({
+    this._queuePromptEvent({
       sessionId,
       promptId: traceContext.subPromptId ?? payload.request?.id ?? null,
       eventType: payload.eventType,
@@ -330,8 +515,180 @@ export default class PromptPerformanceTracker {
       workspacePath,
       workspaceType,
       workspaceFingerprint,
+      modelKey: payload.request?.model ?? payload.modelKey ?? null,
+      schemaId:
+        payload.metadata?.schemaId ?? traceContext.schemaId ?? payload.request?.schemaId ?? null,
       createdAt,
     });
+    this._scheduleFlush();
+    this.latency.recordEvent.record(performance.now() - startedAt);
+  }
+
+  /**
+   * Commits every queued row and refreshes the snapshots they touched.
+   * Resolves once the writes are on disk.
+   */
+  async flush() {
+    if (this._flushTimer) {
+      clearTimeout(this._flushTimer);
+      this._flushTimer = null;
+    }
+    return this._kickDrain();
+  }
+
+  /** Latency histograms (and write counters) as plain JSON. */
+  getLatencyStats() {
+    return {
+      ...Object.fromEntries(
+        Object.entries(this.latency).map(([name, histogram]) => [name, histogram.toJSON()]),
+      ),
+      writes: { ...this.writeStats },
+    };
+  }
+
+  _scheduleFlush() {
+    if (this._pendingRows.length >= this.batchSize) {
+      void this.flush().catch((error) => this._warnDrainFailed(error));
+      return;
+    }
+    if (this._flushTimer) {
+      return;
+    }
+    // Deliberately not unref'd: queued rows still commit when a command ends without dispose().
+    this._flushTimer = setTimeout(() => {
+      this._flushTimer = null;
+      void this._kickDrain().catch((error) => this._warnDrainFailed(error));
+    }, this.flushDelayMs);
+  }
+
+  _warnDrainFailed(error) {
+    const message = error instanceof Error ? error.message : String(error);
+    process.emitWarning(`Prompt telemetry drain failed: ${message}`, "PromptPerformanceTracker");
+  }
+
+  _kickDrain() {
+    // A rejected drain must not stall every later one.
+    this._drainChain = this._drainChain.catch(() => {}).then(() => this._drain());
+    return this._drainChain;
+  }
+
+  async _drain() {
+    const batch = {
+      sessions: this._pendingSessions,
+      rows: this._pendingRows,
+      dirty: this._dirtySnapshots,
+    };
+    this._pendingSessions = new Map();
+    this._pendingRows = [];
+    this._dirtySnapshots = new Map();
+    if (!this.db) {
+      return;
+    }
+    const retry = this._retryBatch;
+    this._retryBatch = null;
+    if (retry) {
+      this.writeStats.retriedBatches += 1;
+      await this._commitBatch(retry, true);
+    }
+    await this._commitBatch(batch, false);
+  }
+
+  /**
+   * Commits one batch and refreshes its snapshots. A first failure holds the
+   * batch for a retry on the next drain; a failed retry drops it.
+   */
+  async _commitBatch(batch, retried) {
+    const { sessions, rows, dirty } = batch;
+    if (sessions.size || rows.length) {
+      const startedAt = performance.now();
+      try {
+        await this.db.exec("BEGIN IMMEDIATE;");
+        // Sessions first: score and event rows reference them.
+        for (const params of sessions.values()) {
+          await this._run("session", params);
+        }
+        for (const row of rows) {
+          await this._run(row.statement, row.params);
+        }
+        await this.db.exec("COMMIT;");
+        this.writeStats.batches += 1;
+        this.writeStats.rows += sessions.size + rows.length;
+      } catch (error) {
+        try {
+          await this.db.exec("ROLLBACK;");
+        } catch {
+          // no transaction left to roll back
+        }
+        this.writeStats.failedBatches += 1;
+        const message = error instanceof Error ? error.message : String(error);
+        if (!retried) {
+          this._retryBatch = batch;
+          this._scheduleFlush();
+          process.emitWarning(
+            `Prompt telemetry batch of ${rows.length} rows failed, retrying: ${message}`,
+            "PromptPerformanceTracker",
+          );
+          return;
+        }
+        this.writeStats.droppedRows += rows.length;
+        process.emitWarning(
+          `Dropped ${rows.length} prompt telemetry rows after a retry: ${message}`,
+          "PromptPerformanceTracker",
+        );
+        return;
+      } finally {
+        this.latency.batchCommit.record(performance.now() - startedAt);
+      }
+    }
+    for (const context of dirty.values()) {
+      const startedAt = performance.now();
+      try {
+        await this._snapshotBestPrompt(context);
+      } catch (error) {
+        const message = error instanceof Error ? error.message : String(error);
+        process.emitWarning(`Prompt snapshot failed: ${message}`, "PromptPerformanceTracker");
+      } finally {
+        this.latency.snapshot.record(performance.now() - startedAt);
+      }
+    }
+  }
+
+  async _prepareStatements() {
+    if (!this.db || typeof this.db.prepare !== "function") {
+      return;
+    }
+    const statements = {};
+    for (const [name, sql] of Object.entries(SQL)) {
+      statements[name] = await this.db.prepare(sql);
+    }
+    this._statements = statements;
+  }
+
+  async _finalizeStatements() {
+    const statements = this._statements;
+    this._statements = null;
+    for (const statement of Object.values(statements ?? {})) {
+      try {
+        await statement.finalize();
+      } catch {
+        // ignore finalize errors
+      }
+    }
+  }
+
+  _run(name, params) {
+    const statement = this._statements?.[name];
+    return statement ? statement.run(params) : this.db.run(SQL[name], params);
+  }
+
+  _get(name, params) {
+    const statement = this._statements?.[name];
+    return statement ? statement.get(params) : this.db.get(SQL[name], params);
+  }
+
+  _all(name, params) {
+    const statement = this._statements?.[name];
+    return statement ? statement.all(params) : this.db.all(SQL[name], params);
   }
 
   async _migrate() {
@@ -399,9 +756,65 @@ export default class PromptPerformanceTracker {
     for (const sql of migrations) {
       await this.db.exec(sql);
     }
+    await this._migratePerfColumns();
+  }
+
+  /**
+   * Latency columns used by `miniphi perf` rollups. Databases created before
+   * they existed get them added, and existing rows are backfilled once from
+   * `metadata_json`.
+   */
+  async _migratePerfColumns() {
+    const additions = {
+      prompt_scores: {
+        model_key: "TEXT",
+        schema_id: "TEXT",
+        transport: "TEXT",
+        duration_ms: "REAL",
+        ttft_ms: "REAL",
+        output_tokens: "INTEGER",
+      },
+      prompt_events: {
+        model_key: "TEXT",
+        schema_id: "TEXT",
+      },
+    };
+    let backfill = false;
+    for (const [table, columns] of Object.entries(additions)) {
+      const existing = new Set(
+        ((await this.db.all(`PRAGMA table_info(${table});`)) ?? []).map((column) => column.name),
+      );
+      for (const [column, type] of Object.entries(columns)) {
+        if (!existing.has(column)) {
+          await this.db.exec(`ALTER TABLE ${table} ADD COLUMN ${column} ${type};`);
+          backfill = true;
+        }
+      }
+    }
+    if (backfill) {
+      try {
+        await this.db.exec(
+          `UPDATE prompt_scores SET
+             schema_id = json_extract(metadata_json, '$.trace.schemaId'),
+             duration_ms = json_extract(metadata_json, '$.stats.durationMs'),
+             output_tokens = json_extract(metadata_json, '$.stats.tokensApprox')
+           WHERE metadata_json IS NOT NULL AND duration_ms IS NULL;
+           UPDATE prompt_events SET
+             schema_id = json_extract(metadata_json, '$.schemaId')
+           WHERE metadata_json IS NOT NULL AND schema_id IS NULL;`,
+        );
+      } catch {
+        // SQLite builds without JSON1 simply start with empty columns.
+      }
+    }
+    await this.db.exec(
+      `CREATE INDEX IF NOT EXISTS idx_prompt_scores_perf ON prompt_scores(created_at, model_key, schema_id);
+       CREATE INDEX IF NOT EXISTS idx_prompt_scores_prompt ON prompt_scores(prompt_id);
+       CREATE INDEX IF NOT EXISTS idx_prompt_events_prompt ON prompt_events(prompt_id, event_type);`,
+    );
   }
 
-  async _persistSession({
+  _queueSession({
     sessionId,
     objective,
     workspacePath,
@@ -409,69 +822,26 @@ export default class PromptPerformanceTracker {
     workspaceFingerprint,
     createdAt,
   }) {
-    if (!this.db || !sessionId) {
+    if (!sessionId) {
       return;
     }
-    await this.db.run(
-      `INSERT INTO prompt_sessions (session_id, objective, workspace_path, workspace_type, workspace_fingerprint, created_at)
-       VALUES (@sessionId, @objective, @workspacePath, @workspaceType, @workspaceFingerprint, @createdAt)
-       ON CONFLICT(session_id) DO UPDATE SET
-         objective = COALESCE(excluded.objective, prompt_sessions.objective),
-         workspace_path = COALESCE(excluded.workspace_path, prompt_sessions.workspace_path),
-         workspace_type = COALESCE(excluded.workspace_type, prompt_sessions.workspace_type),
-         workspace_fingerprint = COALESCE(excluded.workspace_fingerprint, prompt_sessions.workspace_fingerprint);`,
-      {
-        "@sessionId": sessionId,
-        "@objective": objective,
-        "@workspacePath": workspacePath,
-        "@workspaceType": workspaceType,
-        "@workspaceFingerprint": workspaceFingerprint,
-        "@createdAt": createdAt,
-      },
-    );
+    // Later values win, matching the COALESCE upsert applied in order.
+    const previous = this._pendingSessions.get(sessionId);
+    const pick = (next, prior) => next ?? prior ?? null;
+    this._pendingSessions.set(sessionId, {
+      "@sessionId": sessionId,
+      "@objective": pick(objective, previous?.["@objective"]),
+      "@workspacePath": pick(workspacePath, previous?.["@workspacePath"]),
+      "@workspaceType": pick(workspaceType, previous?.["@workspaceType"]),
+      "@workspaceFingerprint": pick(workspaceFingerprint, previous?.["@workspaceFingerprint"]),
+      "@createdAt": previous?.["@createdAt"] ?? createdAt,
+    });
   }
 
-  async _insertPromptScore(entry) {
-    if (!this.db) {
-      return;
-    }
-    await this.db.run(
-      `INSERT INTO prompt_scores (
-        session_id,
-        scope,
-        prompt_id,
-        prompt_label,
-        objective,
-        prompt_text,
-        response_text,
-        score,
-        follow_up_needed,
-        follow_up_reason,
-        evaluation_json,
-        metadata_json,
-        workspace_path,
-        workspace_type,
-        workspace_fingerprint,
-        created_at
-      ) VALUES (
-        @sessionId,
-        @scope,
-        @promptId,
-        @promptLabel,
-        @objective,
-        @promptText,
-        @responseText,
-        @score,
-        @followUpNeeded,
-        @followUpReason,
-        @evaluationJson,
-        @metadataJson,
-        @workspacePath,
-        @workspaceType,
-        @workspaceFingerprint,
-        @createdAt
-      );`,
-      {
+  _queuePromptScore(entry) {
+    this._pendingRows.push({
+      statement: "score",
+      params: {
         "@sessionId": entry.sessionId ?? null,
         "@scope": entry.scope ?? "sub",
         "@promptId": entry.promptId,
@@ -487,40 +857,21 @@ export default class PromptPerformanceTracker {
         "@workspacePath": entry.workspacePath ?? null,
         "@workspaceType": entry.workspaceType ?? null,
         "@workspaceFingerprint": entry.workspaceFingerprint ?? null,
+        "@modelKey": entry.modelKey ?? null,
+        "@schemaId": entry.schemaId ?? null,
+        "@transport": entry.transport ?? null,
+        "@durationMs": Number.isFinite(entry.durationMs) ? entry.durationMs : null,
+        "@ttftMs": Number.isFinite(entry.ttftMs) ? entry.ttftMs : null,
+        "@outputTokens": Number.isFinite(entry.outputTokens) ? entry.outputTokens : null,
         "@createdAt": entry.createdAt,
       },
-    );
+    });
   }
 
-  async _insertPromptEvent(entry) {
-    if (!this.db) {
-      return;
-    }
-    await this.db.run(
-      `INSERT INTO prompt_events (
-        session_id,
-        prompt_id,
-        event_type,
-        severity,
-        message,
-        metadata_json,
-        workspace_path,
-        workspace_type,
-        workspace_fingerprint,
-        created_at
-      ) VALUES (
-        @sessionId,
-        @promptId,
-        @eventType,
-        @severity,
-        @message,
-        @metadataJson,
-        @workspacePath,
-        @workspaceType,
-        @workspaceFingerprint,
-        @createdAt
-      );`,
-      {
+  _queuePromptEvent(entry) {
+    this._pendingRows.push({
+      statement: "event",
+      params: {
         "@sessionId": entry.sessionId ?? null,
         "@promptId": entry.promptId ?? null,
         "@eventType": entry.eventType,
@@ -530,43 +881,34 @@ export default class PromptPerformanceTracker {
         "@workspacePath": entry.workspacePath ?? null,
         "@workspaceType": entry.workspaceType ?? null,
         "@workspaceFingerprint": entry.workspaceFingerprint ?? null,
+        "@modelKey": entry.modelKey ?? null,
+        "@schemaId": entry.schemaId ?? null,
         "@createdAt": entry.createdAt,
       },
-    );
+    });
+  }
+
+  _markSnapshotDirty(context) {
+    if (!context.objective || !context.workspaceFingerprint) {
+      return;
+    }
+    this._dirtySnapshots.set(`${context.workspaceFingerprint}\u0000${context.objective}`, context);
   }
 
   async _snapshotBestPrompt({ objective, workspaceFingerprint, workspaceType, workspacePath }) {
     if (!this.db || !objective || !workspaceFingerprint) {
       return;
     }
-    const best = await this.db.get(
-      `SELECT prompt_id, prompt_text, response_text, score, evaluation_json, created_at
-       FROM prompt_scores
-       WHERE workspace_fingerprint = ? AND objective = ?
-       ORDER BY score DESC, created_at DESC
-       LIMIT 1;`,
-      [workspaceFingerprint, objective],
-    );
+    const best = await this._get("bestPrompt", [workspaceFingerprint, objective]);
     if (!best) {
       return;
     }
-    const stats = await this.db.get(
-      `SELECT
-        COUNT(*) AS total,
-        COALESCE(AVG(score), 0) AS avgScore,
-        SUM(CASE WHEN follow_up_needed = 1 THEN 1 ELSE 0 END) AS followUps
-       FROM prompt_scores
-       WHERE workspace_fingerprint = ? AND objective = ?;`,
-      [workspaceFingerprint, objective],
-    );
-    const recent = await this.db.all(
-      `SELECT id, score, created_at
-       FROM prompt_scores
-       WHERE workspace_fingerprint = ? AND objective = ?
-       ORDER BY created_at DESC
-       LIMIT ?;`,
-      [workspaceFingerprint, objective, this.snapshotLimit],
-    );
+    const stats = await this._get("scoreStats", [workspaceFingerprint, objective]);
+    const recent = await this._all("recentScores", [
+      workspaceFingerprint,
+      objective,
+      this.snapshotLimit,
+    ]);
 
     let evaluation = null;
     if (best.evaluation_json) {
@@ -603,36 +945,14 @@ export default class PromptPerformanceTracker {
         .reverse(),
     };
 
-    await this.db.run(
-      `INSERT INTO best_prompt_snapshots (
-        workspace_fingerprint,
-        objective,
-        workspace_type,
-        workspace_path,
-        snapshot_json,
-        computed_at
-      ) VALUES (
-        @workspaceFingerprint,
-        @objective,
-        @workspaceType,
-        @workspacePath,
-        @snapshotJson,
-        @computedAt
-      )
-      ON CONFLICT(workspace_fingerprint, objective) DO UPDATE SET
-        workspace_type = excluded.workspace_type,
-        workspace_path = excluded.workspace_path,
-        snapshot_json = excluded.snapshot_json,
-        computed_at = excluded.computed_at;`,
-      {
-        "@workspaceFingerprint": workspaceFingerprint,
-        "@objective": objective,
-        "@workspaceType": workspaceType,
-        "@workspacePath": workspacePath,
-        "@snapshotJson": JSON.stringify(snapshot),
-        "@computedAt": new Date().toISOString(),
-      },
-    );
+    await this._run("snapshot", {
+      "@workspaceFingerprint": workspaceFingerprint,
+      "@objective": objective,
+      "@workspaceType": workspaceType,
+      "@workspacePath": workspacePath,
+      "@snapshotJson": JSON.stringify(snapshot),
+      "@computedAt": new Date().toISOString(),
+    });
   }
 
   _extractPromptText(request) {
@@ -6,12 +6,20 @@ import {
   normalizePromptRequestPayload,
   normalizePromptResponsePayload,
 } from "./prompt-log-normalizer.js";
+import { getJsonIndexStore } from "./json-index-store.js";
+import { getBlobStore } from "./blob-store.js";
+import PromptArchive from "./prompt-archive.js";
 
 const DEFAULT_HISTORY_LIMIT = 200;
 
 /**
  * Persists structured JSON prompt exchanges (request + response) under the MiniPhi workspace.
  * Each record captures LM Studio prompt metadata so individual sub-prompts can be replayed later.
+ *
+ * Exchanges live in the segmented archive (`prompt-exchanges/archive/`, see
+ * PromptArchive); `index.json` keeps summaries of the newest ones for quick
+ * listings. Exchanges written by older versions as one `<id>.json` file each
+ * are moved into the archive the first time a recorder prepares the folder.
  */
 export default class PromptRecorder {
   /**
@@ -21,6 +29,7 @@ export default class PromptRecorder {
     this.workspaceRoot = workspaceRoot;
     this.recordsDir = path.join(this.workspaceRoot, "prompt-exchanges");
     this.indexFile = path.join(this.recordsDir, "index.json");
+    this.archive = new PromptArchive(this.recordsDir);
     this.prepared = false;
   }
 
@@ -38,9 +47,74 @@ export default class PromptRecorder {
         "utf8",
       );
     }
+    await this._migrateLegacyRecords();
     this.prepared = true;
   }
 
+  /** Moves per-file exchanges from older versions into the archive, oldest first. */
+  async _migrateLegacyRecords() {
+    let names = [];
+    try {
+      names = (await fs.promises.readdir(this.recordsDir)).filter(
+        (name) => name.endsWith(".json") && name !== "index.json",
+      );
+    } catch {
+      return;
+    }
+    if (!names.length) {
+      return;
+    }
+    const legacy = [];
+    for (const name of names) {
+      const filePath = path.join(this.recordsDir, name);
+      try {
+        const payload = JSON.parse(await fs.promises.readFile(filePath, "utf8"));
+        if (payload?.id && payload.request) {
+          legacy.push({ filePath, payload });
+        }
+      } catch {
+        // Not an exchange (or unreadable); leave it alone.
+      }
+    }
+    legacy.sort((left, right) =>
+      String(left.payload.recordedAt ?? "").localeCompare(String(right.payload.recordedAt ?? "")),
+    );
+    const locators = new Map();
+    for (const { filePath, payload } of legacy) {
+      if (!(await this.archive.has(payload.id))) {
+        await this.archive.append(payload);
+      }
+      locators.set(payload.id, this._locator(this.archive.byId.get(payload.id)));
+      await fs.promises.rm(filePath, { force: true });
+    }
+    if (!locators.size) {
+      return;
+    }
+    await getJsonIndexStore().update(
+      this.indexFile,
+      (index) => {
+        for (const entry of Array.isArray(index.entries) ? index.entries : []) {
+          if (locators.has(entry?.id)) {
+            delete entry.file;
+            Object.assign(entry, locators.get(entry.id));
+          }
+        }
+        return index;
+      },
+      { fallback: { entries: [], updatedAt: null } },
+    );
+  }
+
+  _locator(row) {
+    return {
+      archive: path
+        .relative(this.workspaceRoot, this.archive.segmentPath(row.seg))
+        .replace(/\\/g, "/"),
+      offset: row.off,
+      length: row.len,
+    };
+  }
+
   /**
    * Writes a structured prompt exchange to disk.
    * @param {{
@@ -62,9 +136,11 @@ export default class PromptRecorder {
     }
     await this.prepare();
     const id = exchange.id ?? randomUUID();
-    const recordPath = path.join(this.recordsDir, `${id}.json`);
-    const request = this._normalizeRequest(exchange.request);
-    const response = this._normalizeResponse(exchange.response ?? null);
+    // System prompts and schema blocks repeat across nearly every exchange;
+    // they go to the shared blob store once and are referenced by hash here.
+    const blobs = getBlobStore(this.workspaceRoot);
+    const request = await blobs.externalize(this._normalizeRequest(exchange.request));
+    const response = await blobs.externalize(this._normalizeResponse(exchange.response ?? null));
     const payload = {
       id,
       recordedAt: new Date().toISOString(),
@@ -77,13 +153,12 @@ export default class PromptRecorder {
       response,
       error: this._normalizeError(exchange.error ?? null),
     };
-    await fs.promises.writeFile(recordPath, JSON.stringify(payload, null, 2), "utf8");
-    await this._updateIndex(payload, recordPath);
-    return { id, path: recordPath };
+    const row = await this.archive.append(payload);
+    await this._updateIndex(payload, row);
+    return { id, path: this.archive.segmentPath(row.seg), offset: row.off, length: row.len };
   }
 
-  async _updateIndex(payload, recordPath) {
-    const index = await this._readIndex();
+  async _updateIndex(payload, row) {
     const summary = {
       id: payload.id,
       scope: payload.scope,
@@ -91,25 +166,51 @@ export default class PromptRecorder {
       mainPromptId: payload.mainPromptId,
       subPromptId: payload.subPromptId,
       recordedAt: payload.recordedAt,
+      model: row.model,
+      schema: row.schema,
       error: payload.error,
-      file: path.relative(this.workspaceRoot, recordPath).replace(/\\/g, "/"),
+      ...this._locator(row),
     };
-    const filtered = index.entries.filter((entry) => entry.id !== payload.id);
-    filtered.unshift(summary);
-    index.entries = filtered.slice(0, DEFAULT_HISTORY_LIMIT);
-    index.updatedAt = new Date().toISOString();
-    await fs.promises.writeFile(this.indexFile, JSON.stringify(index, null, 2), "utf8");
+    await getJsonIndexStore().upsert(this.indexFile, summary, {
+      limit: DEFAULT_HISTORY_LIMIT,
+      fallback: { entries: [], updatedAt: null },
+    });
   }
 
-  async _readIndex() {
-    try {
-      const raw = await fs.promises.readFile(this.indexFile, "utf8");
-      return JSON.parse(raw);
-    } catch {
-      return { entries: [], updatedAt: null };
+  /**
+   * Returns one exchange by id, or null. With `resolveBlobs`, blob references
+   * are expanded back into their text.
+   * @param {string} id
+   * @param {{ resolveBlobs?: boolean }} [options]
+   */
+  async read(id, options = undefined) {
+    const payload = await this.archive.read(id);
+    return payload && options?.resolveBlobs
+      ? getBlobStore(this.workspaceRoot).internalize(payload)
+      : payload;
+  }
+
+  /**
+   * Streams archived exchanges, oldest first, for exports and eval scripts.
+   * `filter` matches catalog fields (`scope`, `label`, `model`, `schema` as
+   * strings or RegExps; `mainPromptId`, `error`, `since`, `until`, `limit`), so
+   * only matching exchanges are inflated.
+   * @param {Record<string, any>} [filter]
+   * @param {{ resolveBlobs?: boolean }} [options]
+   */
+  async *entries(filter = undefined, options = undefined) {
+    const blobs = options?.resolveBlobs ? getBlobStore(this.workspaceRoot) : null;
+    for await (const payload of this.archive.entries(filter)) {
+      yield blobs ? await blobs.internalize(payload) : payload;
     }
   }
 
+  /** Waits until the archive and the prompt-exchange index reflect every recorded exchange. */
+  async flush() {
+    await this.archive.flush();
+    await getJsonIndexStore().flush(this.indexFile);
+  }
+
   _normalizeRequest(request) {
     return normalizePromptRequestPayload(request);
   }
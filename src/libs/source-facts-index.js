@@ -0,0 +1,387 @@
+import fs from "fs";
+import os from "os";
+import path from "path";
+import { createHash } from "crypto";
+import { Worker } from "worker_threads";
+import { writeFileAtomic, writeFileAtomicSync } from "./atomic-file.js";
+import {
+  LEXICAL_ENGINE,
+  SOURCE_FACTS_VERSION,
+  extractSourceFacts,
+  sourceLanguageOf,
+  treeSitterInstalled,
+} from "./source-facts.js";
+import { RACY_WINDOW_MS } from "./workspace-index.js";
+
+/**
+ * Cache of source facts (source-facts.js) for the files of one workspace
+ * index.
+ *
+ * - Facts are stored per **content hash**, so renamed, copied or
+ *   touched-but-unchanged files are not parsed again. Each path remembers
+ *   the size, mtime and hash it was parsed at; a path whose size and mtime
+ *   still match (outside the racy window) is served without a read.
+ * - `collect` parses the stale files on a pool of `worker_threads`, each
+ *   holding its own tree-sitter parsers. `collectSync` serves the same cache
+ *   for synchronous callers and parses misses inline with the lexical
+ *   scanner; lexical facts are re-parsed by the next `collect` when
+ *   tree-sitter is installed.
+ * - The cache is persisted next to the workspace index, in
+ *   `<index>.facts` (one JSON line per path and per hash).
+ */
+
+export const SOURCE_FACTS_CHUNK_FILES = 16;
+export const SOURCE_FACTS_MAX_FILE_BYTES = 2 * 1024 * 1024;
+export const DEFAULT_SOURCE_FACTS_THREADS = (() => {
+  const configured = Number(process.env.MINIPHI_SOURCE_FACTS_THREADS);
+  if (Number.isFinite(configured) && configured >= 1) {
+    return Math.floor(configured);
+  }
+  const cores = typeof os.availableParallelism === "function" ? os.availableParallelism() : os.cpus().length;
+  return Math.max(1, Math.min(8, cores - 1));
+})();
+
+class FactsPool {
+  constructor(size) {
+    this.size = size;
+    this.workers = [];
+    this.queue = [];
+    this.nextId = 1;
+  }
+
+  _spawn() {
+    const worker = new Worker(new URL("./source-facts-worker.js", import.meta.url));
+    worker.job = null;
+    worker.unref();
+    worker.on("message", (message) => {
+      const job = worker.job;
+      worker.job = null;
+      worker.unref();
+      if (job && job.message.id === message.id) {
+        job.resolve(message.results);
+      }
+      this._dispatch();
+    });
+    const fail = (error) => {
+      const index = this.workers.indexOf(worker);
+      if (index === -1) {
+        return;
+      }
+      this.workers.splice(index, 1);
+      worker.job?.reject(error);
+      worker.job = null;
+    };
+    worker.on("error", fail);
+    worker.on("exit", (code) => fail(new Error(`source facts worker exited with code ${code}`)));
+    this.workers.push(worker);
+    return worker;
+  }
+
+  _dispatch() {
+    while (this.queue.length) {
+      let worker = this.workers.find((candidate) => !candidate.job);
+      if (!worker) {
+        if (this.workers.length >= this.size) {
+          return;
+        }
+        worker = this._spawn();
+      }
+      worker.job = this.queue.shift();
+      worker.ref();
+      worker.postMessage(worker.job.message);
+    }
+  }
+
+  run(message) {
+    return new Promise((resolve, reject) => {
+      message.id = this.nextId;
+      this.nextId += 1;
+      this.queue.push({ message, resolve, reject });
+      this._dispatch();
+    });
+  }
+}
+
+const pools = new Map();
+
+function poolOf(size) {
+  let pool = pools.get(size);
+  if (!pool) {
+    pool = new FactsPool(size);
+    pools.set(size, pool);
+  }
+  return pool;
+}
+
+export default class SourceFactsIndex {
+  /**
+   * @param {import("./workspace-index.js").default} workspace
+   * @param {{ indexFile?: string | null }} [options] `indexFile` defaults to
+   *   `<workspace index>.facts`; null keeps the facts in memory only.
+   */
+  constructor(workspace, options = undefined) {
+    this.workspace = workspace;
+    this.root = workspace.root;
+    this.indexFile =
+      options?.indexFile !== undefined
+        ? options.indexFile
+        : workspace.indexFile
+          ? `${workspace.indexFile.replace(/\.json$/i, "")}.facts`
+          : null;
+    /** @type {Map<string, { size: number, mtimeMs: number, parsedAt: number, hash: string }>} */
+    this.paths = new Map();
+    /** @type {Map<string, { engine: string, facts: object }>} */
+    this.facts = new Map();
+    this.loaded = false;
+    this.dirty = false;
+    this.parserBroken = false;
+    this.stats = { parsed: 0, reused: 0, served: 0 };
+  }
+
+  _isCurrent(relative) {
+    const file = this.workspace.files.get(relative);
+    const known = this.paths.get(relative);
+    if (!file || !known || !this.facts.has(known.hash)) {
+      return false;
+    }
+    return known.size === file.size && known.mtimeMs === file.mtimeMs && file.mtimeMs + RACY_WINDOW_MS < known.parsedAt;
+  }
+
+  /** Lexical facts are replaced once a tree-sitter parser for the file's language can do better. */
+  _upgradable(relative, hash) {
+    return (
+      !this.parserBroken &&
+      this.facts.get(hash)?.engine === LEXICAL_ENGINE &&
+      treeSitterInstalled(sourceLanguageOf(relative) ?? "c")
+    );
+  }
+
+  _store(relative, file, hash, engine, facts) {
+    if (facts) {
+      this.facts.set(hash, { engine, facts });
+      this.stats.parsed += 1;
+    } else {
+      this.stats.reused += 1;
+    }
+    this.paths.set(relative, { size: file.size, mtimeMs: file.mtimeMs, parsedAt: Date.now(), hash });
+    this.dirty = true;
+  }
+
+  _parseLines(lines) {
+    try {
+      const header = JSON.parse(lines[0]);
+      if (header?.version !== SOURCE_FACTS_VERSION || header.root !== this.root) {
+        return;
+      }
+    } catch {
+      return;
+    }
+    for (let line = 1; line < lines.length; line += 1) {
+      if (!lines[line]) {
+        continue;
+      }
+      try {
+        const row = JSON.parse(lines[line]);
+        if (row[0] === "h") {
+          this.facts.set(row[1], { engine: row[2], facts: row[3] });
+        } else if (row[0] === "p") {
+          this.paths.set(row[1], { size: row[2], mtimeMs: row[3], parsedAt: row[4], hash: row[5] });
+        }
+      } catch {
+        // a damaged line only costs that file a re-parse
+      }
+    }
+  }
+
+  async _load() {
+    if (this.loaded) {
+      return;
+    }
+    this.loaded = true;
+    if (this.indexFile) {
+      this._parseLines(await fs.promises.readFile(this.indexFile, "utf8").then((text) => text.split("\n"), () => [""]));
+    }
+  }
+
+  _loadSync() {
+    if (this.loaded) {
+      return;
+    }
+    this.loaded = true;
+    if (this.indexFile) {
+      try {
+        this._parseLines(fs.readFileSync(this.indexFile, "utf8").split("\n"));
+      } catch {
+        // no cache yet
+      }
+    }
+  }
+
+  _serialize() {
+    const lines = [JSON.stringify({ version: SOURCE_FACTS_VERSION, root: this.root })];
+    const referenced = new Set();
+    for (const [relative, known] of this.paths) {
+      if (!this.workspace.files.has(relative)) {
+        continue;
+      }
+      referenced.add(known.hash);
+      lines.push(JSON.stringify(["p", relative, known.size, known.mtimeMs, known.parsedAt, known.hash]));
+    }
+    for (const [hash, entry] of this.facts) {
+      if (referenced.has(hash)) {
+        lines.push(JSON.stringify(["h", hash, entry.engine, entry.facts]));
+      }
+    }
+    return `${lines.join("\n")}\n`;
+  }
+
+  async _save() {
+    if (!this.indexFile || !this.dirty) {
+      return;
+    }
+    this.dirty = false;
+    try {
+      await writeFileAtomic(this.indexFile, this._serialize(), { mkdir: true });
+    } catch {
+      this.dirty = true;
+    }
+  }
+
+  _saveSync() {
+    if (!this.indexFile || !this.dirty) {
+      return;
+    }
+    this.dirty = false;
+    try {
+      fs.mkdirSync(path.dirname(this.indexFile), { recursive: true });
+      writeFileAtomicSync(this.indexFile, this._serialize());
+    } catch {
+      this.dirty = true;
+    }
+  }
+
+  _result(paths) {
+    const result = new Map();
+    for (const relative of paths) {
+      const known = this.paths.get(relative);
+      const entry = known ? this.facts.get(known.hash) : null;
+      if (entry) {
+        result.set(relative, entry.facts);
+      }
+    }
+    this.stats.served += result.size;
+    return result;
+  }
+
+  _eligible(relative) {
+    const file = this.workspace.files.get(relative);
+    return Boolean(file) && file.size <= SOURCE_FACTS_MAX_FILE_BYTES;
+  }
+
+  /**
+   * Facts for `paths` (POSIX, relative to the root, present in the
+   * refreshed workspace index), parsing stale files on the worker pool.
+   * @param {string[]} paths
+   * @param {{ threads?: number }} [options]
+   * @returns {Promise<Map<string, object>>}
+   */
+  async collect(paths, options = undefined) {
+    await this._load();
+    const stale = paths.filter(
+      (relative) => this._eligible(relative) && (!this._isCurrent(relative) || this._upgradable(relative, this.paths.get(relative).hash)),
+    );
+    const threads = Number.isFinite(options?.threads)
+      ? Math.max(1, Math.floor(options.threads))
+      : DEFAULT_SOURCE_FACTS_THREADS;
+    const chunks = [];
+    for (let start = 0; start < stale.length; start += SOURCE_FACTS_CHUNK_FILES) {
+      const files = stale.slice(start, start + SOURCE_FACTS_CHUNK_FILES).map((relative, offset) => [start + offset, relative]);
+      const known = files
+        .filter(([, relative]) => {
+          const hash = this.paths.get(relative)?.hash;
+          return hash && this.facts.has(hash) && !this._upgradable(relative, hash);
+        })
+        .map(([, relative]) => this.paths.get(relative).hash);
+      chunks.push({ root: this.root, files, known });
+    }
+    let replies = null;
+    // Without tree-sitter the workers would run the same scanner; a handful of files is cheaper inline.
+    const parsing = stale.some((relative) => treeSitterInstalled(sourceLanguageOf(relative) ?? "c"));
+    if (parsing || (threads > 1 && stale.length > SOURCE_FACTS_CHUNK_FILES)) {
+      replies = await Promise.all(chunks.map((message) => poolOf(threads).run(message))).catch(() => null);
+    }
+    replies ??= chunks.map((message) => this._parseInline(message));
+    for (const results of replies) {
+      for (const { index, hash, engine, facts } of results) {
+        const relative = stale[index];
+        if (!hash) {
+          continue;
+        }
+        if (engine === LEXICAL_ENGINE && treeSitterInstalled(sourceLanguageOf(relative) ?? "c")) {
+          this.parserBroken = true;
+        }
+        this._store(relative, this.workspace.files.get(relative), hash, engine, facts);
+      }
+    }
+    await this._save();
+    return this._result(paths);
+  }
+
+  _parseInline(message) {
+    const known = new Set(message.known);
+    return message.files.map(([index, relative]) => {
+      try {
+        const buffer = fs.readFileSync(path.join(this.root, relative));
+        const hash = createHash("sha256").update(buffer).digest("hex");
+        if (known.has(hash) || this.facts.has(hash)) {
+          return { index, hash, engine: null, facts: null };
+        }
+        return { index, hash, ...extractSourceFacts(buffer.toString("utf8"), null, sourceLanguageOf(relative) ?? "c") };
+      } catch {
+        return { index, hash: null, engine: null, facts: null };
+      }
+    });
+  }
+
+  /**
+   * Synchronous `collect`: cached facts as they are, misses parsed inline
+   * with the lexical scanner.
+   * @param {string[]} paths
+   * @returns {Map<string, object>}
+   */
+  collectSync(paths) {
+    this._loadSync();
+    const stale = paths.filter((relative) => this._eligible(relative) && !this._isCurrent(relative));
+    if (stale.length) {
+      const files = stale.map((relative, index) => [index, relative]);
+      for (const { index, hash, engine, facts } of this._parseInline({ files, known: [] })) {
+        if (hash) {
+          this._store(stale[index], this.workspace.files.get(stale[index]), hash, engine, facts);
+        }
+      }
+      this._saveSync();
+    }
+    return this._result(paths);
+  }
+
+  /** The engine that produced the cached facts of `relative`, or null. */
+  engineOf(relative) {
+    const known = this.paths.get(relative);
+    return (known && this.facts.get(known.hash)?.engine) ?? null;
+  }
+}
+
+const factsIndexes = new WeakMap();
+
+/**
+ * The facts cache attached to a workspace index (one per index instance).
+ * @param {import("./workspace-index.js").default} workspace
+ */
+export function getSourceFactsIndex(workspace) {
+  let index = factsIndexes.get(workspace);
+  if (!index) {
+    index = new SourceFactsIndex(workspace);
+    factsIndexes.set(workspace, index);
+  }
+  return index;
+}
@@ -0,0 +1,36 @@
+import fs from "fs";
+import path from "path";
+import { createHash } from "crypto";
+import { parentPort } from "worker_threads";
+import { extractSourceFacts, loadParser, sourceLanguageOf } from "./source-facts.js";
+
+/**
+ * Worker side of the source facts pool (see source-facts-index.js): parses
+ * one chunk of files per message with the thread's own tree-sitter parsers
+ * (or the lexical scanners) and posts back each file's content hash and
+ * facts. Files whose hash the caller already has facts for are not parsed.
+ */
+parentPort.on("message", async ({ id, root, files, known }) => {
+  const parsers = new Map();
+  for (const [, relative] of files) {
+    const language = sourceLanguageOf(relative) ?? "c";
+    if (!parsers.has(language)) {
+      parsers.set(language, await loadParser(language));
+    }
+  }
+  const knownHashes = new Set(known ?? []);
+  const results = files.map(([index, relative]) => {
+    try {
+      const buffer = fs.readFileSync(path.join(root, relative));
+      const hash = createHash("sha256").update(buffer).digest("hex");
+      if (knownHashes.has(hash)) {
+        return { index, hash, engine: null, facts: null };
+      }
+      const language = sourceLanguageOf(relative) ?? "c";
+      return { index, hash, ...extractSourceFacts(buffer.toString("utf8"), parsers.get(language), language) };
+    } catch {
+      return { index, hash: null, engine: null, facts: null };
+    }
+  });
+  parentPort.postMessage({ id, results });
+});
@@ -0,0 +1,1108 @@
+import fs from "fs";
+import path from "path";
+import { createRequire } from "module";
+
+/**
+ * Structural facts about sources: `#include` edges, definitions (with their
+ * source ranges and signatures) and, for C, the named functions each
+ * definition calls.
+ *
+ * C facts preferably come from a tree-sitter syntax tree (the
+ * `web-tree-sitter` package plus `tree-sitter-c`); when they are not
+ * installed, a lexical scanner produces the same shape. JavaScript and
+ * TypeScript are lexical only.
+ * The C scanner skips comments, string and character literals, keeps one
+ * consistent branch of each `#if`/`#else` group (so conditional braces stay
+ * balanced), and recognises ANSI and K&R definitions at file scope,
+ * including inside `extern "C"` and `namespace` blocks. The JavaScript
+ * scanner (also used for TypeScript) recognises module-level function and
+ * class declarations, functions assigned to a name, and class methods.
+ * Each result records which `engine` produced it, so cached lexical facts
+ * can be replaced once a parser is available.
+ *
+ * Offsets (`start`, `end`) index the UTF-8-decoded source text.
+ */
+
+export const SOURCE_FACTS_VERSION = 1;
+export const C_SOURCE_EXTENSIONS = new Set([".c", ".h", ".cc", ".cpp", ".cxx", ".hh", ".hpp", ".hxx", ".inc"]);
+export const JS_SOURCE_EXTENSIONS = new Set([".js", ".mjs", ".cjs", ".jsx"]);
+export const TS_SOURCE_EXTENSIONS = new Set([".ts", ".mts", ".cts", ".tsx"]);
+export const TREE_SITTER_ENGINE = "tree-sitter";
+export const LEXICAL_ENGINE = "lexical";
+
+const NOT_CALLS = new Set([
+  "if",
+  "while",
+  "for",
+  "switch",
+  "return",
+  "sizeof",
+  "defined",
+  "alignof",
+  "_Alignof",
+  "_Generic",
+  "__attribute__",
+  "__typeof__",
+  "typeof",
+  "do",
+  "case",
+  "else",
+]);
+const CONDITIONAL_OPEN = new Set(["if", "ifdef", "ifndef"]);
+const CONDITIONAL_ELSE = new Set(["else", "elif", "elifdef", "elifndef"]);
+
+export function isCSourcePath(relativePath) {
+  return C_SOURCE_EXTENSIONS.has(path.extname(relativePath).toLowerCase());
+}
+
+/** "c", "javascript", "typescript", or null for files without facts. */
+export function sourceLanguageOf(relativePath) {
+  const extension = path.extname(relativePath).toLowerCase();
+  if (C_SOURCE_EXTENSIONS.has(extension)) {
+    return "c";
+  }
+  if (JS_SOURCE_EXTENSIONS.has(extension)) {
+    return "javascript";
+  }
+  return TS_SOURCE_EXTENSIONS.has(extension) ? "typescript" : null;
+}
+
+function collapseSignature(text) {
+  return text.replace(/\s+/g, " ").trim();
+}
+
+function isIdentStart(code) {
+  return (code >= 65 && code <= 90) || (code >= 97 && code <= 122) || code === 95 || code === 36;
+}
+
+function isIdentPart(code) {
+  return isIdentStart(code) || (code >= 48 && code <= 57);
+}
+
+/** Whether only whitespace separates identifier `token` from the token that follows it. */
+function callsAhead(text, token, next) {
+  for (let index = token.start + token.value.length; index < next.start; index += 1) {
+    const code = text.charCodeAt(index);
+    if (code !== 32 && code !== 9 && code !== 10 && code !== 13) {
+      return false;
+    }
+  }
+  return true;
+}
+
+function lineStartsAt(text, offset) {
+  return text.lastIndexOf("\n", offset - 1) + 1;
+}
+
+/** Counts newlines before `offset`, resuming from the previous call (offsets only grow). */
+function createLineCounter(text) {
+  let offset = 0;
+  let line = 1;
+  return (target) => {
+    if (target < offset) {
+      offset = 0;
+      line = 1;
+    }
+    for (let index = text.indexOf("\n", offset); index !== -1 && index < target; index = text.indexOf("\n", index + 1)) {
+      line += 1;
+    }
+    offset = target;
+    return line;
+  };
+}
+
+/**
+ * Splits C source into the tokens the lexical extractor needs: identifiers,
+ * `( ) { } ; , =`, string literals (as "str") and preprocessor directives.
+ * Comments, character literals, numbers and other operators are dropped.
+ */
+function tokenizeC(text) {
+  const tokens = [];
+  let index = 0;
+  let atLineStart = true;
+  const length = text.length;
+  while (index < length) {
+    const code = text.charCodeAt(index);
+    if (code === 10) {
+      atLineStart = true;
+      index += 1;
+      continue;
+    }
+    if (code === 32 || code === 9 || code === 13 || code === 12 || code === 11) {
+      index += 1;
+      continue;
+    }
+    if (code === 47 && text.charCodeAt(index + 1) === 47) {
+      const end = text.indexOf("\n", index);
+      index = end === -1 ? length : end;
+      continue;
+    }
+    if (code === 47 && text.charCodeAt(index + 1) === 42) {
+      const end = text.indexOf("*/", index + 2);
+      index = end === -1 ? length : end + 2;
+      continue;
+    }
+    if (code === 35 && atLineStart) {
+      let end = index;
+      for (;;) {
+        const newline = text.indexOf("\n", end);
+        if (newline === -1) {
+          end = length;
+          break;
+        }
+        let back = newline - 1;
+        if (text.charCodeAt(back) === 13) {
+          back -= 1;
+        }
+        if (text.charCodeAt(back) !== 92) {
+          end = newline;
+          break;
+        }
+        end = newline + 1;
+      }
+      const body = text.slice(index + 1, end).replace(/\/\*[\s\S]*?\*\//g, " ");
+      const match = /^\s*(\w+)\s*(.*)$/s.exec(body);
+      tokens.push({ type: "#", name: match ? match[1] : "", rest: match ? match[2] : "", start: index });
+      index = end;
+      continue;
+    }
+    atLineStart = false;
+    if (isIdentStart(code)) {
+      let end = index + 1;
+      while (end < length && isIdentPart(text.charCodeAt(end))) {
+        end += 1;
+      }
+      tokens.push({ type: "id", value: text.slice(index, end), start: index });
+      index = end;
+      continue;
+    }
+    if (code === 34 || code === 39) {
+      let end = index + 1;
+      while (end < length) {
+        const current = text.charCodeAt(end);
+        if (current === 92) {
+          end += 2;
+          continue;
+        }
+        if (current === code || current === 10) {
+          break;
+        }
+        end += 1;
+      }
+      if (code === 34) {
+        tokens.push({ type: "str", value: text.slice(index + 1, end), start: index });
+      }
+      index = end + 1;
+      continue;
+    }
+    if (code === 40 || code === 41 || code === 123 || code === 125 || code === 59 || code === 44 || code === 61) {
+      // "==", "<=", "+=" and friends are not assignments at file scope; only a lone "=" matters.
+      if (code === 61 && (text.charCodeAt(index + 1) === 61 || "=!<>+-*/%&|^".includes(text[index - 1] ?? ""))) {
+        index += 1;
+        continue;
+      }
+      tokens.push({ type: text[index], start: index });
+      index += 1;
+      continue;
+    }
+    index += 1;
+  }
+  return tokens;
+}
+
+function conditionKey(token) {
+  if (token.name === "ifdef" || token.name === "elifdef") {
+    return `defined(${token.rest.trim()})`;
+  }
+  if (token.name === "ifndef" || token.name === "elifndef") {
+    return `!defined(${token.rest.trim()})`;
+  }
+  return token.rest.replace(/\/\/.*$/, "").replace(/\s+/g, "");
+}
+
+function negateKey(key) {
+  if (key.startsWith("!(") && key.endsWith(")")) {
+    return key.slice(2, -1);
+  }
+  return key.startsWith("!") ? key.slice(1) : `!${key}`;
+}
+
+/**
+ * Keeps one branch of each `#if` group, the way a single configuration
+ * would compile it: the first branch, unless the same condition (or its
+ * negation) was already assumed earlier in the file. Choosing consistently
+ * keeps braces balanced when one conditional opens a block that a later
+ * `#if !X` closes.
+ */
+function pickBranches(tokens) {
+  const kept = [];
+  const assumed = new Map();
+  const lookup = (key) => (assumed.has(key) ? assumed.get(key) : assumed.has(negateKey(key)) ? !assumed.get(negateKey(key)) : null);
+  const frames = [];
+  const active = () => !frames.length || frames[frames.length - 1].taking;
+  const choose = (frame, key) => {
+    const value = lookup(key) ?? true;
+    frame.taking = frame.parentActive && value && !frame.taken;
+    if (frame.taking) {
+      frame.taken = true;
+      assumed.set(key, true);
+    }
+  };
+  for (const token of tokens) {
+    if (token.type === "#") {
+      if (CONDITIONAL_OPEN.has(token.name)) {
+        const frame = { parentActive: active(), taking: false, taken: false };
+        frames.push(frame);
+        choose(frame, conditionKey(token));
+        continue;
+      }
+      if (CONDITIONAL_ELSE.has(token.name) && frames.length) {
+        const frame = frames[frames.length - 1];
+        if (token.name === "else") {
+          frame.taking = frame.parentActive && !frame.taken;
+          frame.taken = true;
+        } else {
+          choose(frame, conditionKey(token));
+        }
+        continue;
+      }
+      if (token.name === "endif") {
+        frames.pop();
+        continue;
+      }
+    }
+    if (active()) {
+      kept.push(token);
+    }
+  }
+  return kept;
+}
+
+function parseInclude(rest) {
+  const match = /^\s*(?:"([^"]+)"|<([^>]+)>)/.exec(rest);
+  if (!match) {
+    return null;
+  }
+  return match[1] ? { path: match[1], system: false } : { path: match[2], system: true };
+}
+
+/**
+ * The first top-level `name ( ... )` group of a file-scope statement:
+ * `{ name, open, close }` token positions, or null. A `=` at depth 0 makes
+ * the statement an initializer; `__attribute__ ((...))` and similar groups
+ * are passed over.
+ */
+function findDeclarator(statement, text) {
+  let depth = 0;
+  let open = -1;
+  for (let index = 0; index < statement.length; index += 1) {
+    const token = statement[index];
+    if (token.type === "=" && depth === 0) {
+      return null;
+    }
+    if (token.type === "(") {
+      if (depth === 0) {
+        open = index;
+      }
+      depth += 1;
+    } else if (token.type === ")") {
+      depth -= 1;
+      if (depth === 0 && open > 0) {
+        const nameToken = statement[open - 1];
+        if (nameToken.type === "id" && !NOT_CALLS.has(nameToken.value) && callsAhead(text, nameToken, statement[open])) {
+          return { name: nameToken.value, open, close: index };
+        }
+      }
+    }
+  }
+  return null;
+}
+
+/**
+ * A K&R header: `name (a, b)` with identifier-only parameters, followed by
+ * the first parameter declaration (the `;` that ends it splits the header
+ * off its `{`).
+ */
+function knrHeader(statement, text) {
+  const declarator = findDeclarator(statement, text);
+  if (!declarator || declarator.close === statement.length - 1) {
+    return null;
+  }
+  for (let index = declarator.open + 1; index < declarator.close; index += 1) {
+    const token = statement[index];
+    const expected = (index - declarator.open) % 2 === 1 ? "id" : ",";
+    if (token.type !== expected) {
+      return null;
+    }
+  }
+  for (let index = declarator.close + 1; index < statement.length; index += 1) {
+    if (statement[index].type !== "id") {
+      return null;
+    }
+  }
+  return { name: declarator.name, startToken: statement[0] };
+}
+
+/**
+ * Lexical fallback extractor.
+ * @param {string} text
+ */
+export function extractCFactsLexical(text) {
+  const tokens = pickBranches(tokenizeC(text));
+  const lineAt = createLineCounter(text);
+  const includes = [];
+  const functions = [];
+  const noteInclude = (token) => {
+    if (token.name === "include" || token.name === "import") {
+      const include = parseInclude(token.rest);
+      if (include) {
+        includes.push({ ...include, line: lineAt(token.start) });
+      }
+    }
+  };
+  let statement = [];
+  let pending = null;
+  let transparent = 0;
+
+  for (let index = 0; index < tokens.length; index += 1) {
+    const token = tokens[index];
+    if (token.type === "#") {
+      noteInclude(token);
+      continue;
+    }
+    if (token.type === "}") {
+      transparent = Math.max(0, transparent - 1);
+      statement = [];
+      pending = null;
+      continue;
+    }
+    if (token.type === ";") {
+      const header = knrHeader(statement, text);
+      if (header) {
+        pending = header;
+      } else if (statement.some((entry) => entry.type !== "id")) {
+        pending = null;
+      }
+      statement = [];
+      continue;
+    }
+    if (token.type !== "{") {
+      statement.push(token);
+      continue;
+    }
+    const first = statement[0];
+    if (
+      first?.type === "id" &&
+      ((first.value === "extern" && statement[1]?.type === "str") || first.value === "namespace")
+    ) {
+      transparent += 1;
+      statement = [];
+      pending = null;
+      continue;
+    }
+    const declarator = findDeclarator(statement, text);
+    const defined = declarator
+      ? { name: declarator.name, startToken: statement[0] }
+      : !statement.length && pending
+        ? pending
+        : null;
+    statement = [];
+    pending = null;
+    let depth = 1;
+    if (!defined) {
+      // An initializer, struct/enum body or unrecognised block: skip it whole.
+      while (depth > 0 && index + 1 < tokens.length) {
+        index += 1;
+        const inner = tokens[index];
+        if (inner.type === "{") {
+          depth += 1;
+        } else if (inner.type === "}") {
+          depth -= 1;
+        } else if (inner.type === "#") {
+          noteInclude(inner);
+        }
+      }
+      continue;
+    }
+    const bodyStart = token.start;
+    const calls = [];
+    const seenCalls = new Set();
+    let end = text.length;
+    while (depth > 0 && index + 1 < tokens.length) {
+      index += 1;
+      const inner = tokens[index];
+      if (inner.type === "{") {
+        depth += 1;
+      } else if (inner.type === "}") {
+        depth -= 1;
+        end = inner.start + 1;
+      } else if (inner.type === "#") {
+        noteInclude(inner);
+      } else if (
+        inner.type === "id" &&
+        tokens[index + 1]?.type === "(" &&
+        !NOT_CALLS.has(inner.value) &&
+        callsAhead(text, inner, tokens[index + 1]) &&
+        text[inner.start - 1] !== "." &&
+        text.slice(Math.max(0, inner.start - 2), inner.start) !== "->" &&
+        !seenCalls.has(inner.value)
+      ) {
+        seenCalls.add(inner.value);
+        calls.push(inner.value);
+      }
+    }
+    const start = lineStartsAt(text, defined.startToken.start);
+    functions.push({
+      name: defined.name,
+      kind: "function",
+      start,
+      end,
+      line: lineAt(start),
+      endLine: lineAt(end),
+      signature: collapseSignature(text.slice(defined.startToken.start, bodyStart)),
+      calls,
+    });
+  }
+  return { includes, functions };
+}
+
+function declaredName(node) {
+  if (!node) {
+    return null;
+  }
+  if (node.type === "identifier" || node.type === "field_identifier" || node.type === "qualified_identifier") {
+    return node.text;
+  }
+  if (node.type === "function_declarator") {
+    return declaredName(node.childForFieldName("declarator"));
+  }
+  for (const child of node.namedChildren) {
+    if (child.type === "parameter_list") {
+      continue;
+    }
+    const name = declaredName(child);
+    if (name) {
+      return name;
+    }
+  }
+  return null;
+}
+
+function calleeName(node) {
+  if (!node) {
+    return null;
+  }
+  if (node.type === "identifier") {
+    return node.text;
+  }
+  if (node.type === "parenthesized_expression" && node.namedChildCount === 1) {
+    return calleeName(node.namedChild(0));
+  }
+  return null;
+}
+
+/**
+ * Extracts facts from a tree-sitter-c syntax tree.
+ * @param {any} rootNode
+ * @param {string} text
+ */
+export function extractCFactsFromTree(rootNode, text) {
+  const includes = [];
+  const functions = [];
+  const stack = [rootNode];
+  while (stack.length) {
+    const node = stack.pop();
+    if (node.type === "preproc_include") {
+      const target = node.childForFieldName("path");
+      const include = target ? parseInclude(target.text) : null;
+      if (include) {
+        includes.push({ ...include, line: node.startPosition.row + 1 });
+      }
+      continue;
+    }
+    if (node.type === "function_definition") {
+      const body = node.childForFieldName("body");
+      const name = declaredName(node.childForFieldName("declarator"));
+      if (body && name) {
+        const calls = [];
+        const seen = new Set();
+        const inner = [body];
+        while (inner.length) {
+          const current = inner.pop();
+          if (current.type === "call_expression") {
+            const callee = calleeName(current.childForFieldName("function"));
+            if (callee && !seen.has(callee)) {
+              seen.add(callee);
+              calls.push({ name: callee, at: current.startIndex });
+            }
+          }
+          for (let child = current.namedChildCount - 1; child >= 0; child -= 1) {
+            inner.push(current.namedChild(child));
+          }
+        }
+        const start = lineStartsAt(text, node.startIndex);
+        functions.push({
+          name,
+          kind: "function",
+          start,
+          end: node.endIndex,
+          line: node.startPosition.row + 1,
+          endLine: node.endPosition.row + 1,
+          signature: collapseSignature(text.slice(node.startIndex, body.startIndex)),
+          calls: calls.sort((a, b) => a.at - b.at).map((call) => call.name),
+        });
+        continue;
+      }
+    }
+    for (let child = node.namedChildCount - 1; child >= 0; child -= 1) {
+      stack.push(node.namedChild(child));
+    }
+  }
+  includes.sort((a, b) => a.line - b.line);
+  functions.sort((a, b) => a.start - b.start);
+  return { includes, functions };
+}
+
+const JS_MODIFIERS = new Set([
+  "static",
+  "async",
+  "get",
+  "set",
+  "public",
+  "private",
+  "protected",
+  "readonly",
+  "override",
+  "abstract",
+  "declare",
+  "accessor",
+]);
+const JS_CONTROL_KEYWORDS = new Set(["if", "for", "while", "switch", "catch", "with"]);
+const JS_DECLARATION_PREFIX = new Set([...JS_MODIFIERS, "export", "default", "const", "let", "var"]);
+// After these keywords a `/` starts a regular expression, not a division.
+const JS_EXPRESSION_KEYWORDS = new Set([
+  "return",
+  "typeof",
+  "instanceof",
+  "in",
+  "of",
+  "new",
+  "delete",
+  "void",
+  "throw",
+  "case",
+  "do",
+  "else",
+  "yield",
+  "await",
+]);
+
+/** Maps offsets to 1-based line numbers in any order (binary search over line starts). */
+function createLineIndex(text) {
+  const starts = [0];
+  for (let index = text.indexOf("\n"); index !== -1; index = text.indexOf("\n", index + 1)) {
+    starts.push(index + 1);
+  }
+  return (offset) => {
+    let low = 0;
+    let high = starts.length - 1;
+    while (low < high) {
+      const middle = (low + high + 1) >> 1;
+      if (starts[middle] <= offset) {
+        low = middle;
+      } else {
+        high = middle - 1;
+      }
+    }
+    return low + 1;
+  };
+}
+
+/**
+ * Splits JavaScript/TypeScript into the tokens the lexical extractor needs:
+ * identifiers (keywords and `#private` names included) and `( ) [ ] { } ; ,
+ * = => * .`. Comments, strings, regular expression literals, numbers, other
+ * operators and the text of template literals are dropped; the code inside
+ * `${...}` is tokenized like any other.
+ */
+function tokenizeJs(text) {
+  const tokens = [];
+  // One open-brace counter per enclosing `${` substitution, innermost last.
+  const templates = [];
+  const length = text.length;
+  let index = 0;
+  let regexAllowed = true;
+  const skipTemplate = (from) => {
+    let end = from;
+    while (end < length) {
+      const current = text.charCodeAt(end);
+      if (current === 92) {
+        end += 2;
+        continue;
+      }
+      if (current === 96) {
+        regexAllowed = false;
+        return end + 1;
+      }
+      if (current === 36 && text.charCodeAt(end + 1) === 123) {
+        templates.push(0);
+        regexAllowed = true;
+        return end + 2;
+      }
+      end += 1;
+    }
+    return length;
+  };
+  while (index < length) {
+    const code = text.charCodeAt(index);
+    if (code === 32 || code === 10 || code === 9 || code === 13 || code === 12 || code === 11) {
+      index += 1;
+      continue;
+    }
+    if (code === 47) {
+      const next = text.charCodeAt(index + 1);
+      if (next === 47) {
+        const end = text.indexOf("\n", index);
+        index = end === -1 ? length : end;
+        continue;
+      }
+      if (next === 42) {
+        const end = text.indexOf("*/", index + 2);
+        index = end === -1 ? length : end + 2;
+        continue;
+      }
+      if (regexAllowed) {
+        let end = index + 1;
+        let inClass = false;
+        while (end < length) {
+          const current = text.charCodeAt(end);
+          if (current === 92) {
+            end += 2;
+            continue;
+          }
+          if (current === 10 || (current === 47 && !inClass)) {
+            break;
+          }
+          if (current === 91) {
+            inClass = true;
+          } else if (current === 93) {
+            inClass = false;
+          }
+          end += 1;
+        }
+        end += 1;
+        while (end < length && isIdentPart(text.charCodeAt(end))) {
+          end += 1;
+        }
+        index = end;
+        regexAllowed = false;
+        continue;
+      }
+      index += 1;
+      regexAllowed = true;
+      continue;
+    }
+    if (isIdentStart(code) || (code === 35 && isIdentStart(text.charCodeAt(index + 1)))) {
+      let end = index + 1;
+      while (end < length && isIdentPart(text.charCodeAt(end))) {
+        end += 1;
+      }
+      const value = text.slice(index, end);
+      tokens.push({ type: "id", value, start: index });
+      regexAllowed = JS_EXPRESSION_KEYWORDS.has(value);
+      index = end;
+      continue;
+    }
+    if (code >= 48 && code <= 57) {
+      let end = index + 1;
+      while (end < length && (isIdentPart(text.charCodeAt(end)) || text.charCodeAt(end) === 46)) {
+        end += 1;
+      }
+      index = end;
+      regexAllowed = false;
+      continue;
+    }
+    if (code === 34 || code === 39) {
+      let end = index + 1;
+      while (end < length) {
+        const current = text.charCodeAt(end);
+        if (current === 92) {
+          end += 2;
+          continue;
+        }
+        if (current === code || current === 10) {
+          break;
+        }
+        end += 1;
+      }
+      index = end + 1;
+      regexAllowed = false;
+      continue;
+    }
+    if (code === 96) {
+      index = skipTemplate(index + 1);
+      continue;
+    }
+    if (code === 125 && templates.length && templates[templates.length - 1] === 0) {
+      templates.pop();
+      index = skipTemplate(index + 1);
+      continue;
+    }
+    if (code === 123 || code === 125) {
+      if (templates.length) {
+        templates[templates.length - 1] += code === 123 ? 1 : -1;
+      }
+      tokens.push({ type: text[index], start: index });
+      index += 1;
+      regexAllowed = true;
+      continue;
+    }
+    if (code === 61) {
+      if (text.charCodeAt(index + 1) === 62) {
+        tokens.push({ type: "=>", start: index });
+        index += 2;
+      } else {
+        // Only a lone "=" names what it assigns; "==", "<=", "+=" and friends do not.
+        if (text.charCodeAt(index + 1) !== 61 && !"=!<>+-*/%&|^?".includes(text[index - 1] ?? "")) {
+          tokens.push({ type: "=", start: index });
+        }
+        index += text.charCodeAt(index + 1) === 61 ? 2 : 1;
+      }
+      regexAllowed = true;
+      continue;
+    }
+    if (code === 40 || code === 41 || code === 91 || code === 93 || code === 59 || code === 44 || code === 42 || code === 46) {
+      tokens.push({ type: text[index], start: index });
+      index += 1;
+      regexAllowed = code !== 41 && code !== 93;
+      continue;
+    }
+    regexAllowed = true;
+    index += 1;
+  }
+  return tokens;
+}
+
+function isJsId(token, value = undefined) {
+  return token?.type === "id" && (value === undefined || token.value === value);
+}
+
+/**
+ * The name a statement assigns before token `before` (`const name =`,
+ * `exports.name =`, `name =` for class fields), with the token its
+ * declaration starts at, or null.
+ */
+function jsAssignedName(statement, before) {
+  let depth = 0;
+  for (let index = 0; index < before; index += 1) {
+    const token = statement[index];
+    if (token.type === "(") {
+      depth += 1;
+    } else if (token.type === ")") {
+      depth -= 1;
+    } else if (token.type === "=" && depth === 0) {
+      const nameToken = statement[index - 1];
+      if (!isJsId(nameToken)) {
+        return null;
+      }
+      let first = index - 1;
+      while (statement[first - 1]?.type === "." && isJsId(statement[first - 2])) {
+        first -= 2;
+      }
+      while (isJsId(statement[first - 1]) && JS_DECLARATION_PREFIX.has(statement[first - 1].value)) {
+        first -= 1;
+      }
+      return { name: nameToken.value, startToken: statement[first] };
+    }
+  }
+  return null;
+}
+
+function withJsPrefix(statement, index) {
+  let first = index;
+  while (isJsId(statement[first - 1]) && JS_DECLARATION_PREFIX.has(statement[first - 1].value)) {
+    first -= 1;
+  }
+  return statement[first];
+}
+
+/**
+ * What the `{` ending `statement` opens: `{ open, definition }`, where
+ * `open` is "function", "class" or "block" and `definition` (or null) is
+ * `{ name, kind, startToken }`.
+ */
+function classifyJsBlock(statement, frame) {
+  const memberKind = frame.open === "class" ? "method" : "function";
+  let keyword = -1;
+  for (let index = statement.length - 1; index >= 0; index -= 1) {
+    const token = statement[index];
+    if ((isJsId(token, "function") || isJsId(token, "class")) && statement[index - 1]?.type !== ".") {
+      keyword = index;
+      break;
+    }
+  }
+  const arrow = statement[statement.length - 1]?.type === "=>";
+  if (keyword !== -1 && !arrow) {
+    const open = statement[keyword].value === "class" ? "class" : "function";
+    let nameIndex = keyword + 1;
+    if (statement[nameIndex]?.type === "*") {
+      nameIndex += 1;
+    }
+    const nameToken = statement[nameIndex];
+    const named =
+      isJsId(nameToken) && nameToken.value !== "extends" && nameToken.value !== "implements"
+        ? { name: nameToken.value, startToken: withJsPrefix(statement, keyword) }
+        : jsAssignedName(statement, keyword);
+    const kind = open === "class" ? "class" : memberKind;
+    return { open, definition: named ? { ...named, kind } : null };
+  }
+  if (arrow) {
+    const named = jsAssignedName(statement, statement.length - 1);
+    return { open: "function", definition: named ? { ...named, kind: memberKind } : null };
+  }
+  if (frame.open === "class") {
+    let index = 0;
+    while (isJsId(statement[index]) && JS_MODIFIERS.has(statement[index].value) && statement[index + 1]?.type !== "(") {
+      index += 1;
+    }
+    if (statement[index]?.type === "*") {
+      index += 1;
+    }
+    const nameToken = statement[index];
+    const opensParameters =
+      statement[index + 1]?.type === "(" || (isJsId(statement[index + 1]) && statement[index + 2]?.type === "(");
+    if (isJsId(nameToken) && opensParameters) {
+      return { open: "function", definition: { name: nameToken.value, kind: "method", startToken: statement[0] } };
+    }
+    return { open: "function", definition: null };
+  }
+  // Object literal methods (`name(args) {`) are function bodies; `if (...) {` and friends are blocks.
+  const head = statement.find((token) => !(isJsId(token) && JS_MODIFIERS.has(token.value)));
+  if (isJsId(head) && !JS_CONTROL_KEYWORDS.has(head.value) && statement[statement.length - 1]?.type === ")") {
+    return { open: "function", definition: null };
+  }
+  return { open: "block", definition: null };
+}
+
+/**
+ * Lexical fallback extractor for JavaScript and TypeScript. Definitions
+ * nested inside function bodies (and their calls) are not recorded.
+ * @param {string} text
+ */
+export function extractJsFactsLexical(text) {
+  const tokens = tokenizeJs(text);
+  const lineAt = createLineIndex(text);
+  const functions = [];
+  const frames = [{ open: "block", record: true, container: null, definition: null }];
+  let statement = [];
+  let parens = 0;
+  const define = (frame, definition, bodyStart) => {
+    const entry = {
+      name: definition.name,
+      kind: definition.kind,
+      ...(definition.kind === "method" && frame.container ? { container: frame.container } : {}),
+      start: lineStartsAt(text, definition.startToken.start),
+      end: text.length,
+      line: 0,
+      endLine: 0,
+      signature: collapseSignature(text.slice(definition.startToken.start, bodyStart)),
+      calls: [],
+    };
+    functions.push(entry);
+    return entry;
+  };
+
+  for (let index = 0; index < tokens.length; index += 1) {
+    const token = tokens[index];
+    const frame = frames[frames.length - 1];
+    if (token.type === "(") {
+      parens += 1;
+    } else if (token.type === ")") {
+      parens = Math.max(0, parens - 1);
+    } else if (token.type === ";" && parens === 0) {
+      statement = [];
+      continue;
+    }
+    if (token.type === "=>" && parens === 0 && tokens[index + 1]?.type !== "{" && frame.record) {
+      // An expression-bodied arrow ends at the `;`, `,` or closing bracket of its statement.
+      const named = jsAssignedName(statement, statement.length);
+      if (named) {
+        let depth = 0;
+        let end = text.length;
+        for (let ahead = index + 1; ahead < tokens.length; ahead += 1) {
+          const type = tokens[ahead].type;
+          if (type === "(" || type === "[" || type === "{") {
+            depth += 1;
+          } else if (type === ")" || type === "]" || type === "}") {
+            depth -= 1;
+          }
+          if (depth < 0 || (depth === 0 && (type === ";" || type === ","))) {
+            end = depth < 0 ? tokens[ahead].start : tokens[ahead].start + 1;
+            break;
+          }
+        }
+        const entry = define(frame, { ...named, kind: frame.open === "class" ? "method" : "function" }, token.start + 2);
+        entry.end = end;
+      }
+    }
+    if (token.type === "}") {
+      if (frames.length > 1) {
+        frames.pop();
+        if (frame.definition) {
+          frame.definition.end = token.start + 1;
+        }
+      }
+      statement = [];
+      parens = 0;
+      continue;
+    }
+    if (token.type !== "{") {
+      statement.push(token);
+      continue;
+    }
+    if (parens > 0) {
+      // Object literals and callbacks inside an argument list: skip them whole.
+      let depth = 1;
+      while (depth > 0 && index + 1 < tokens.length) {
+        index += 1;
+        if (tokens[index].type === "{") {
+          depth += 1;
+        } else if (tokens[index].type === "}") {
+          depth -= 1;
+        }
+      }
+      continue;
+    }
+    const { open, definition } = classifyJsBlock(statement, frame);
+    const entry = definition && frame.record ? define(frame, definition, token.start) : null;
+    frames.push({
+      open,
+      record: open === "class" ? frame.record : open === "block" && frame.open !== "class" ? frame.record : false,
+      container: open === "class" ? definition?.name ?? null : frame.container,
+      definition: entry,
+    });
+    statement = [];
+  }
+  for (const entry of functions) {
+    entry.end = Math.min(entry.end, text.length);
+    entry.line = lineAt(entry.start);
+    entry.endLine = lineAt(Math.max(entry.start, entry.end - 1));
+  }
+  return { includes: [], functions };
+}
+
+function locateWasm(packageName, fileName) {
+  const candidates = [];
+  try {
+    const require = createRequire(import.meta.url);
+    let dir = path.dirname(require.resolve(packageName));
+    for (let depth = 0; depth < 4; depth += 1) {
+      candidates.push(path.join(dir, fileName));
+      dir = path.dirname(dir);
+    }
+  } catch {
+    // not resolvable from here; fall back to the working directory's node_modules
+  }
+  candidates.push(path.resolve("node_modules", packageName, fileName));
+  return candidates.find((candidate) => fs.existsSync(candidate)) ?? null;
+}
+
+const TREE_SITTER_GRAMMARS = {
+  c: ["tree-sitter-c", "tree-sitter-c.wasm"],
+};
+
+let runtimePromise = null;
+const parserPromises = new Map();
+const installed = new Map();
+
+/**
+ * Whether the tree-sitter runtime and the grammar for `language` are on disk
+ * (cheap; does not load them).
+ * @param {string} [language]
+ */
+export function treeSitterInstalled(language = "c") {
+  if (!installed.has(language)) {
+    const grammar = TREE_SITTER_GRAMMARS[language];
+    installed.set(
+      language,
+      process.env.MINIPHI_SOURCE_FACTS_ENGINE !== LEXICAL_ENGINE &&
+        Boolean(grammar) &&
+        Boolean(locateWasm(...grammar)) &&
+        Boolean(locateWasm("web-tree-sitter", "tree-sitter.wasm")),
+    );
+  }
+  return installed.get(language);
+}
+
+function loadRuntime() {
+  if (!runtimePromise) {
+    runtimePromise = (async () => {
+      const runtime = await import("web-tree-sitter");
+      const runtimeWasm = locateWasm("web-tree-sitter", "tree-sitter.wasm");
+      await runtime.Parser.init(
+        runtimeWasm
+          ? {
+              locateFile(scriptName, scriptDir) {
+                return scriptName === "tree-sitter.wasm" ? runtimeWasm : path.join(scriptDir, scriptName);
+              },
+            }
+          : undefined,
+      );
+      return runtime;
+    })();
+  }
+  return runtimePromise;
+}
+
+/**
+ * A tree-sitter parser for `language`, or null when `web-tree-sitter` or the
+ * grammar is not installed, or `language` has none (only "c" does). Loaded
+ * once per thread.
+ * @param {string} [language]
+ * @returns {Promise<any | null>}
+ */
+export function loadParser(language = "c") {
+  if (!parserPromises.has(language)) {
+    parserPromises.set(
+      language,
+      (async () => {
+        if (!treeSitterInstalled(language)) {
+          return null;
+        }
+        try {
+          const { Parser, Language } = await loadRuntime();
+          const parser = new Parser();
+          parser.setLanguage(await Language.load(locateWasm(...TREE_SITTER_GRAMMARS[language])));
+          return parser;
+        } catch {
+          return null;
+        }
+      })(),
+    );
+  }
+  return parserPromises.get(language);
+}
+
+/**
+ * Facts for one source text, with the parser when one is given.
+ * @param {string} text
+ * @param {any | null} [parser] a parser for `language`
+ * @param {string} [language] from `sourceLanguageOf`
+ * @returns {{ engine: string, facts: { includes: Array<{ path: string, system: boolean, line: number }>, functions: Array<{ name: string, kind: string, container?: string, start: number, end: number, line: number, endLine: number, signature: string, calls: string[] }> } }}
+ */
+export function extractSourceFacts(text, parser = null, language = "c") {
+  const native = language === "c";
+  if (parser && native) {
+    try {
+      const tree = parser.parse(text);
+      try {
+        return { engine: TREE_SITTER_ENGINE, facts: extractCFactsFromTree(tree.rootNode, text) };
+      } finally {
+        tree.delete?.();
+      }
+    } catch {
+      // fall through to the scanner
+    }
+  }
+  return { engine: LEXICAL_ENGINE, facts: native ? extractCFactsLexical(text) : extractJsFactsLexical(text) };
+}
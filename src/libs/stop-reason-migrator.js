@@ -1,5 +1,7 @@
 import fs from "fs";
 import path from "path";
+import readline from "readline";
+import { once } from "node:events";
 import { isDeepStrictEqual } from "node:util";
 import { buildStopReasonInfo } from "./lmstudio-error-utils.js";
 import {
@@ -190,7 +192,8 @@ async function collectJsonFiles(rootDir) {
         stack.push(fullPath);
         continue;
       }
-      if (entry.isFile() && entry.name.toLowerCase().endsWith(".json")) {
+      const lowerName = entry.name.toLowerCase();
+      if (entry.isFile() && (lowerName.endsWith(".json") || lowerName.endsWith(".ndjson"))) {
         files.push(fullPath);
       }
     }
@@ -199,6 +202,55 @@ async function collectJsonFiles(rootDir) {
   return files;
 }
 
+/**
+ * Normalizes an NDJSON log (e.g. `task-execution.ndjson`) one line at a time,
+ * streaming into a sibling temp file that replaces the original only when
+ * something changed. Lines that do not parse — a torn tail from a crash — are
+ * carried over untouched.
+ */
+async function migrateNdjsonFile(filePath, fileStats, dryRun) {
+  const tempFile = `${filePath}.migrate.tmp`;
+  const output = dryRun ? null : fs.createWriteStream(tempFile, { encoding: "utf8" });
+  const lines = readline.createInterface({
+    input: fs.createReadStream(filePath, { encoding: "utf8" }),
+    crlfDelay: Infinity,
+  });
+  let changed = false;
+  try {
+    for await (const line of lines) {
+      let next = line;
+      if (line.trim()) {
+        let payload = null;
+        try {
+          payload = JSON.parse(line);
+        } catch {
+          payload = null;
+        }
+        if (payload !== null && normalizeValue(payload, fileStats)) {
+          changed = true;
+          next = JSON.stringify(payload);
+        }
+      }
+      if (output && !output.write(`${next}\n`)) {
+        await once(output, "drain");
+      }
+    }
+  } finally {
+    if (output) {
+      output.end();
+      await once(output, "close");
+    }
+  }
+  if (output) {
+    if (changed) {
+      await fs.promises.rename(tempFile, filePath);
+    } else {
+      await fs.promises.unlink(tempFile);
+    }
+  }
+  return changed;
+}
+
 export async function migrateStopReasonArtifacts(options = {}) {
   const baseDir = options.baseDir ? path.resolve(options.baseDir) : null;
   if (!baseDir) {
@@ -224,6 +276,23 @@ export async function migrateStopReasonArtifacts(options = {}) {
   for (const filePath of files) {
     result.filesScanned += 1;
     const relativePath = path.relative(baseDir, filePath).replace(/\\/g, "/");
+    if (filePath.toLowerCase().endsWith(".ndjson")) {
+      const fileStats = { objectsUpdated: 0, fieldsUpdated: 0 };
+      let fileChanged = false;
+      try {
+        fileChanged = await migrateNdjsonFile(filePath, fileStats, dryRun);
+      } catch {
+        result.writeErrors += 1;
+        continue;
+      }
+      if (fileChanged) {
+        result.filesChanged += 1;
+        result.objectsUpdated += fileStats.objectsUpdated;
+        result.fieldsUpdated += fileStats.fieldsUpdated;
+        result.changedFiles.push(relativePath);
+      }
+      continue;
+    }
     let raw = "";
     try {
       raw = await fs.promises.readFile(filePath, "utf8");
@@ -0,0 +1,114 @@
+import fs from "fs/promises";
+import path from "path";
+import { grepFiles } from "./grep-engine.js";
+import { createGrepSpec } from "./grep-matcher.js";
+import { SOURCE_FACTS_MAX_FILE_BYTES, getSourceFactsIndex } from "./source-facts-index.js";
+import { sourceLanguageOf } from "./source-facts.js";
+import { TRIGRAM_MAX_FILE_BYTES, getTrigramIndex } from "./trigram-index.js";
+import { getWorkspaceIndex } from "./workspace-index.js";
+
+/**
+ * Definition lookup behind the `read_symbol` agent action: where a function,
+ * class or method is defined, and its source text.
+ *
+ * - Definitions come from the source facts cache (source-facts-index.js), so
+ *   they carry byte ranges and signatures and are persisted per content hash
+ *   next to the workspace index; a file is parsed once until it changes.
+ * - Only files that contain the symbol's name are parsed. With a persistent
+ *   workspace index the trigram index supplies those candidates; without one
+ *   a single grep over the source files does.
+ * - `name`, `Class.method` and C++ `ns::name` forms are accepted; a bare
+ *   method name matches the methods of every class.
+ */
+
+const symbolNameOf = (symbol) => symbol.split(/\.|::/).pop();
+
+/** Whether a facts definition answers the requested symbol. */
+export function matchesSymbol(definition, symbol) {
+  if (definition.name === symbol) {
+    return true;
+  }
+  if (
+    definition.container &&
+    (symbol === `${definition.container}.${definition.name}` || symbol === `${definition.container}::${definition.name}`)
+  ) {
+    return true;
+  }
+  return definition.name.endsWith(`::${symbol}`);
+}
+
+/** Display name: `Class.method` for methods, the plain name otherwise. */
+export function qualifiedSymbolName(definition) {
+  return definition.container ? `${definition.container}.${definition.name}` : definition.name;
+}
+
+async function candidatePaths(workspace, name, skipDir) {
+  const sources = [];
+  for (const entry of workspace.walkFiles({ skipDir })) {
+    if (sourceLanguageOf(entry.path) && entry.size <= SOURCE_FACTS_MAX_FILE_BYTES) {
+      sources.push(entry);
+    }
+  }
+  const trigrams = getTrigramIndex(workspace.root);
+  if (trigrams.indexFile) {
+    await trigrams.sync();
+    const candidates = new Set(trigrams.candidates(name, { skipDir }).paths);
+    // Files too large for trigrams are never candidates there; they are few, so parse them anyway.
+    return sources
+      .filter((entry) => candidates.has(entry.path) || entry.size > TRIGRAM_MAX_FILE_BYTES)
+      .map((entry) => entry.path);
+  }
+  const paths = sources.map((entry) => entry.path).sort((left, right) => (left < right ? -1 : left > right ? 1 : 0));
+  const found = await grepFiles(workspace.root, paths, createGrepSpec(name), { maxMatches: Number.MAX_SAFE_INTEGER });
+  return [...new Set(found.matches.map((match) => match.path))];
+}
+
+/**
+ * Definitions of `symbol`, in path order.
+ * @param {string} root
+ * @param {string} symbol
+ * @param {{ path?: string | null, skipDir?: (name: string) => boolean, threads?: number }} [options]
+ *   `path` (POSIX, relative to `root`) limits the lookup to one file.
+ * @returns {Promise<{ definitions: Array<{ path: string, name: string, container?: string, kind: string, start: number, end: number, line: number, endLine: number, signature: string }>, scanned: number }>}
+ */
+export async function findSymbol(root, symbol, options = undefined) {
+  const workspace = await getWorkspaceIndex(path.resolve(root)).ensureFresh();
+  const name = symbolNameOf(symbol);
+  let candidates;
+  if (options?.path) {
+    candidates = workspace.files.has(options.path) && sourceLanguageOf(options.path) ? [options.path] : [];
+  } else {
+    candidates = await candidatePaths(workspace, name, options?.skipDir);
+  }
+  const collected = await getSourceFactsIndex(workspace).collect(candidates, { threads: options?.threads });
+  const definitions = [];
+  for (const [relative, facts] of collected) {
+    for (const definition of facts.functions) {
+      if (matchesSymbol(definition, symbol)) {
+        const { calls, ...rest } = definition;
+        definitions.push({ path: relative, ...rest });
+      }
+    }
+  }
+  definitions.sort((left, right) =>
+    left.path < right.path ? -1 : left.path > right.path ? 1 : left.start - right.start,
+  );
+  return { definitions, scanned: candidates.length };
+}
+
+/**
+ * The first definition of `symbol` with its source text (signature and
+ * body), plus the other definitions found.
+ * @param {string} root
+ * @param {string} symbol
+ * @param {{ path?: string | null, skipDir?: (name: string) => boolean, threads?: number }} [options]
+ */
+export async function readSymbol(root, symbol, options = undefined) {
+  const { definitions, scanned } = await findSymbol(root, symbol, options);
+  if (!definitions.length) {
+    return { definition: null, text: "", others: [], scanned };
+  }
+  const [definition, ...others] = definitions;
+  const source = await fs.readFile(path.join(path.resolve(root), definition.path), "utf8");
+  return { definition, text: source.slice(definition.start, definition.end), others, scanned };
+}
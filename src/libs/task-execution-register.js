@@ -1,12 +1,20 @@
 import fs from "fs";
 import path from "path";
+import readline from "readline";
 import { randomUUID } from "crypto";
 import {
   normalizeLinksPayload,
   normalizePromptErrorPayload,
 } from "./prompt-log-normalizer.js";
+import { getBlobStore } from "./blob-store.js";
 
-const DEFAULT_SCHEMA_VERSION = "task-execution-register@v1";
+const DEFAULT_SCHEMA_VERSION = "task-execution-register@v2";
+const HEADER_FILE = "task-execution.json";
+const ENTRIES_FILE = "task-execution.ndjson";
+const DEFAULT_HEADER_DELAY_MS = 250;
+
+/** Registers whose header rewrite is still waiting on its debounce timer. */
+const pendingRegisters = new Set();
 
 async function readJson(filePath) {
   try {
@@ -30,21 +38,100 @@ async function writeJson(filePath, data) {
   }
 }
 
+async function fileSize(filePath) {
+  try {
+    return (await fs.promises.stat(filePath)).size;
+  } catch {
+    return null;
+  }
+}
+
+/** A crash mid-append leaves a partial last line; close it so the next append stays separate. */
+async function terminateTornLine(filePath, size) {
+  const handle = await fs.promises.open(filePath, "r");
+  let last = "";
+  try {
+    const buffer = Buffer.alloc(1);
+    await handle.read(buffer, 0, 1, size - 1);
+    last = buffer.toString("utf8");
+  } finally {
+    await handle.close();
+  }
+  if (last !== "\n") {
+    await fs.promises.appendFile(filePath, "\n", "utf8");
+  }
+}
+
+/**
+ * Streams the entries of one execution register, oldest first, without
+ * loading the file. Accepts the header path, the NDJSON path, or the execution
+ * directory; a v1 register (entries inlined in the header) is read as-is. A
+ * torn trailing line — a crash mid-append — is skipped. With `resolveBlobs`,
+ * blob references in each entry are expanded back into their text.
+ * @param {string} target
+ * @param {{ resolveBlobs?: boolean }} [options]
+ * @returns {AsyncGenerator<Record<string, any>>}
+ */
+export async function* readTaskExecutionEntries(target, options = undefined) {
+  const resolved = path.resolve(target);
+  const dir = resolved.endsWith(".json") || resolved.endsWith(".ndjson") ? path.dirname(resolved) : resolved;
+  // <workspace>/executions/<id>/
+  const blobs = options?.resolveBlobs ? getBlobStore(path.dirname(path.dirname(dir))) : null;
+  const expand = async (entry) => (blobs ? blobs.internalize(entry) : entry);
+  const entriesFile = path.join(dir, ENTRIES_FILE);
+  let stream = null;
+  try {
+    await fs.promises.access(entriesFile, fs.constants.R_OK);
+    stream = fs.createReadStream(entriesFile, { encoding: "utf8" });
+  } catch {
+    const legacy = await readJson(path.join(dir, HEADER_FILE));
+    for (const entry of Array.isArray(legacy?.entries) ? legacy.entries : []) {
+      yield await expand(entry);
+    }
+    return;
+  }
+  const lines = readline.createInterface({ input: stream, crlfDelay: Infinity });
+  for await (const line of lines) {
+    if (!line.trim()) {
+      continue;
+    }
+    let entry = null;
+    try {
+      entry = JSON.parse(line);
+    } catch {
+      continue;
+    }
+    yield await expand(entry);
+  }
+}
+
 /**
  * Records LM Studio request/response pairs for a single task execution.
- * Stored under .miniphi/executions/<executionId>/task-execution.json.
+ *
+ * Stored under .miniphi/executions/<executionId>/ as two files:
+ * `task-execution.ndjson` holds one entry per line and only ever grows by
+ * appending, and `task-execution.json` is a small header (metadata, entry
+ * count, last entry summary) rewritten on a short debounce. Rewriting the
+ * whole session per entry made a long agent run's I/O quadratic; now each
+ * `record()` costs one append. Use `readTaskExecutionEntries` to read entries.
  */
 export default class TaskExecutionRegister {
   /**
    * @param {string} workspaceRoot Absolute path to the .miniphi directory.
    */
-  constructor(workspaceRoot = path.join(process.cwd(), ".miniphi")) {
+  constructor(workspaceRoot = path.join(process.cwd(), ".miniphi"), options = undefined) {
     this.workspaceRoot = workspaceRoot;
     this.executionsDir = path.join(this.workspaceRoot, "executions");
     this.executionId = null;
     this.registerFile = null;
+    this.entriesFile = null;
     this.session = null;
     this.sequence = 0;
+    this.headerDelayMs = Number.isFinite(options?.headerDelayMs)
+      ? Math.max(0, Number(options.headerDelayMs))
+      : DEFAULT_HEADER_DELAY_MS;
+    this._headerTimer = null;
+    this._writeChain = Promise.resolve();
   }
 
   /**
@@ -56,27 +143,48 @@ export default class TaskExecutionRegister {
     if (!executionId) {
       return null;
     }
+    await this.flush();
     this.executionId = executionId;
     const executionDir = path.join(this.executionsDir, executionId);
-    this.registerFile = path.join(executionDir, "task-execution.json");
+    this.registerFile = path.join(executionDir, HEADER_FILE);
+    this.entriesFile = path.join(executionDir, ENTRIES_FILE);
     await fs.promises.mkdir(executionDir, { recursive: true });
 
     const existing = await readJson(this.registerFile);
     if (existing && typeof existing === "object") {
+      const { entries: legacyEntries, ...header } = existing;
+      const logSize = await fileSize(this.entriesFile);
+      if (logSize === null && Array.isArray(legacyEntries) && legacyEntries.length) {
+        // A v1 register: move its inlined entries into the log once.
+        await fs.promises.appendFile(
+          this.entriesFile,
+          legacyEntries.map((entry) => `${JSON.stringify(entry)}\n`).join(""),
+          "utf8",
+        );
+      } else if (logSize) {
+        await terminateTornLine(this.entriesFile, logSize);
+      }
       const mergedMetadata =
         metadata && typeof metadata === "object"
-          ? { ...(existing.metadata ?? {}), ...metadata }
-          : existing.metadata ?? null;
-      const entries = Array.isArray(existing.entries) ? existing.entries : [];
+          ? { ...(header.metadata ?? {}), ...metadata }
+          : header.metadata ?? null;
+      // The header is debounced, so the log is the authority on how far we got.
+      let sequence = 0;
+      let lastEntry = null;
+      for await (const entry of readTaskExecutionEntries(this.entriesFile)) {
+        sequence = Math.max(sequence, Number(entry?.sequence) || 0);
+        lastEntry = entry;
+      }
       this.session = {
-        ...existing,
-        schemaVersion: existing.schemaVersion ?? DEFAULT_SCHEMA_VERSION,
+        ...header,
+        schemaVersion: DEFAULT_SCHEMA_VERSION,
+        entriesFile: ENTRIES_FILE,
         metadata: mergedMetadata,
         updatedAt: new Date().toISOString(),
-        entryCount: entries.length,
+        entryCount: sequence,
+        lastEntry: lastEntry ? this._summarize(lastEntry) : header.lastEntry ?? null,
       };
-      this.session.entries = entries;
-      this.sequence = entries.length;
+      this.sequence = sequence;
     } else {
       const timestamp = new Date().toISOString();
       this.session = {
@@ -84,15 +192,16 @@ export default class TaskExecutionRegister {
         id: executionId,
         createdAt: timestamp,
         updatedAt: timestamp,
+        entriesFile: ENTRIES_FILE,
         metadata: metadata ?? null,
         entryCount: 0,
-        entries: [],
+        lastEntry: null,
       };
       this.sequence = 0;
     }
 
     await writeJson(this.registerFile, this.session);
-    return { id: executionId, path: this.registerFile };
+    return { id: executionId, path: this.registerFile, entriesPath: this.entriesFile };
   }
 
   /**
@@ -112,25 +221,79 @@ export default class TaskExecutionRegister {
       return null;
     }
     const timestamp = new Date().toISOString();
-    const next = {
+    const sequence = this.sequence + 1;
+    this.sequence = sequence;
+    const blobs = getBlobStore(this.workspaceRoot);
+    // Large request/response strings (system prompts, schema blocks) go to the
+    // shared blob store. The entry is built asynchronously but its append is
+    // chained right now, so concurrent record() calls still land in order.
+    const built = Promise.all([
+      blobs.externalize(entry.request ?? null),
+      blobs.externalize(entry.response ?? null),
+    ]).then(([request, response]) => ({
       id: randomUUID(),
-      sequence: this.sequence + 1,
+      sequence,
       recordedAt: timestamp,
       type: entry.type ?? "lmstudio",
       transport: entry.transport ?? null,
-      request: entry.request ?? null,
-      response: entry.response ?? null,
+      request,
+      response,
       error: this._normalizeError(entry.error ?? null),
       metadata: entry.metadata ?? null,
       links: normalizeLinksPayload(entry.links, { baseDir: this.workspaceRoot }),
+    }));
+    const entriesFile = this.entriesFile;
+    this._writeChain = this._writeChain
+      .catch(() => {})
+      .then(async () => {
+        const next = await built;
+        await fs.promises.appendFile(entriesFile, `${JSON.stringify(next)}\n`, "utf8");
+        this.session.entryCount = Math.max(this.session.entryCount ?? 0, next.sequence);
+        this.session.updatedAt = timestamp;
+        this.session.lastEntry = this._summarize(next);
+      });
+    await this._writeChain;
+    this._scheduleHeader();
+    return built;
+  }
+
+  /**
+   * Writes the header now and waits for pending appends. The debounce timer is
+   * unref'd so it never holds the process open: `main()` calls
+   * `flushTaskExecutionRegisters` once the command finishes, and a normally
+   * exiting process still lands the appends.
+   */
+  async flush() {
+    if (this._headerTimer) {
+      clearTimeout(this._headerTimer);
+      this._headerTimer = null;
+      pendingRegisters.delete(this);
+      this._writeChain = this._writeChain
+        .catch(() => {})
+        .then(() => writeJson(this.registerFile, this.session));
+    }
+    await this._writeChain;
+  }
+
+  _scheduleHeader() {
+    if (this._headerTimer) {
+      return;
+    }
+    this._headerTimer = setTimeout(() => {
+      this.flush().catch(() => {});
+    }, this.headerDelayMs);
+    this._headerTimer.unref?.();
+    pendingRegisters.add(this);
+  }
+
+  _summarize(entry) {
+    return {
+      id: entry.id ?? null,
+      sequence: entry.sequence ?? null,
+      recordedAt: entry.recordedAt ?? null,
+      type: entry.type ?? null,
+      failed: Boolean(entry.error),
     };
-    this.sequence = next.sequence;
-    this.session.entries = Array.isArray(this.session.entries) ? this.session.entries : [];
-    this.session.entries.push(next);
-    this.session.entryCount = this.session.entries.length;
-    this.session.updatedAt = timestamp;
-    await writeJson(this.registerFile, this.session);
-    return next;
   }
 
   getExecutionId() {
@@ -141,3 +304,8 @@ export default class TaskExecutionRegister {
     return normalizePromptErrorPayload(error);
   }
 }
+
+/** Writes the header of every register that still has one pending. */
+export async function flushTaskExecutionRegisters() {
+  await Promise.all([...pendingRegisters].map((register) => register.flush().catch(() => {})));
+}
@@ -0,0 +1,535 @@
+import fs from "fs";
+import path from "path";
+import { performance } from "perf_hooks";
+import { writeFileAtomic } from "./atomic-file.js";
+import { grepFiles } from "./grep-engine.js";
+import { createGrepSpec, looksBinary, regexLiteralRuns } from "./grep-matcher.js";
+import { getWorkspaceIndex, RACY_WINDOW_MS } from "./workspace-index.js";
+
+/**
+ * Trigram index over the files of a WorkspaceIndex. It narrows `search_text`
+ * to the files that can contain a match before any file is read.
+ *
+ * - Each text file contributes the set of its byte trigrams, with ASCII
+ *   letters folded to lower case, so one index serves case-sensitive and
+ *   case-insensitive queries. Posting lists map a trigram to the ids of the
+ *   files that contain it.
+ * - A literal query needs every trigram of the term. A regex query needs the
+ *   trigrams of the literal runs that every match of a top-level alternative
+ *   must contain. A query without such a run (`a.b`, `\w+`) cannot be
+ *   narrowed and verifies every file.
+ * - Candidates are verified by the grep engine (grep-engine.js) in path
+ *   order, until `maxMatches`. Search cost therefore follows the matches,
+ *   not the size of the tree.
+ * - `sync()` re-reads only the files whose size or mtime changed in the
+ *   workspace index. Removed files are tombstoned, and the postings are
+ *   rebuilt once tombstones outnumber live files. The per-file trigram sets
+ *   are persisted next to the workspace index, in `<index>.trigrams`.
+ */
+
+export const TRIGRAM_MAX_FILE_BYTES = 512 * 1024;
+
+const TRIGRAM_VERSION = 1;
+const READ_CONCURRENCY = 16;
+const SLICE_MS = 8;
+const TEXT = "t";
+const BINARY = "b";
+const LARGE = "l";
+const UNREADABLE = "e";
+
+const yieldToLoop = () => new Promise((resolve) => setImmediate(resolve));
+const foldByte = (byte) => (byte >= 65 && byte <= 90 ? byte + 32 : byte);
+
+// One bit per possible trigram, shared by all extractions: distinct codes are
+// collected in one linear pass and only those are sorted.
+const seenTrigrams = new Uint8Array(1 << 21);
+
+/** Sorted, distinct, ASCII-folded trigram codes of `buffer`. */
+export function extractTrigrams(buffer) {
+  if (buffer.length < 3) {
+    return new Uint32Array(0);
+  }
+  const distinct = [];
+  let first = foldByte(buffer[0]);
+  let second = foldByte(buffer[1]);
+  for (let index = 2; index < buffer.length; index += 1) {
+    const third = foldByte(buffer[index]);
+    const code = (first << 16) | (second << 8) | third;
+    const bit = 1 << (code & 7);
+    if (!(seenTrigrams[code >>> 3] & bit)) {
+      seenTrigrams[code >>> 3] |= bit;
+      distinct.push(code);
+    }
+    first = second;
+    second = third;
+  }
+  for (const code of distinct) {
+    seenTrigrams[code >>> 3] = 0;
+  }
+  return Uint32Array.from(distinct).sort();
+}
+
+/**
+ * Trigrams of a literal. A case-insensitive query skips trigrams that contain
+ * non-ASCII bytes, because the index folds only ASCII letters.
+ */
+function literalTrigrams(text, ignoreCase) {
+  const bytes = Buffer.from(text, "utf8");
+  const grams = new Set();
+  for (let index = 0; index + 2 < bytes.length; index += 1) {
+    if (ignoreCase && (bytes[index] | bytes[index + 1] | bytes[index + 2]) & 0x80) {
+      continue;
+    }
+    grams.add((foldByte(bytes[index]) << 16) | (foldByte(bytes[index + 1]) << 8) | foldByte(bytes[index + 2]));
+  }
+  return [...grams];
+}
+
+/**
+ * The trigram query for a search: alternatives (OR) of trigram sets (AND),
+ * or null when some alternative has no literal run of three or more bytes,
+ * in which case every file is a candidate.
+ * @param {string} term
+ * @param {{ regex?: boolean, ignoreCase?: boolean }} [options]
+ * @returns {number[][] | null}
+ */
+export function buildTrigramQuery(term, options = undefined) {
+  const ignoreCase = Boolean(options?.ignoreCase);
+  const branches = options?.regex ? regexLiteralRuns(term) : [[term]];
+  const query = [];
+  for (const runs of branches) {
+    const grams = new Set();
+    for (const run of runs) {
+      for (const gram of literalTrigrams(run, ignoreCase)) {
+        grams.add(gram);
+      }
+    }
+    if (!grams.size) {
+      return null;
+    }
+    query.push([...grams]);
+  }
+  return query;
+}
+
+function encodeGrams(grams) {
+  const bytes = [];
+  let previous = 0;
+  for (const gram of grams) {
+    let delta = gram - previous;
+    previous = gram;
+    while (delta >= 0x80) {
+      bytes.push((delta & 0x7f) | 0x80);
+      delta >>>= 7;
+    }
+    bytes.push(delta);
+  }
+  return Buffer.from(bytes).toString("base64");
+}
+
+function decodeGrams(encoded) {
+  const bytes = Buffer.from(encoded, "base64");
+  const grams = [];
+  let previous = 0;
+  let value = 0;
+  let shift = 0;
+  for (const byte of bytes) {
+    value |= (byte & 0x7f) << shift;
+    if (byte & 0x80) {
+      shift += 7;
+      continue;
+    }
+    previous += value;
+    grams.push(previous);
+    value = 0;
+    shift = 0;
+  }
+  return Uint32Array.from(grams);
+}
+
+/** Intersection of ascending id lists, shortest first. */
+function intersectPostings(lists) {
+  const sorted = [...lists].sort((left, right) => left.length - right.length);
+  let result = sorted[0] ?? [];
+  for (let index = 1; index < sorted.length && result.length; index += 1) {
+    const other = sorted[index];
+    const next = [];
+    let cursor = 0;
+    for (const id of result) {
+      while (cursor < other.length && other[cursor] < id) {
+        cursor += 1;
+      }
+      if (other[cursor] === id) {
+        next.push(id);
+      }
+    }
+    result = next;
+  }
+  return result;
+}
+
+export default class TrigramIndex {
+  /**
+   * @param {import("./workspace-index.js").default} workspace
+   * @param {{ indexFile?: string | null, maxFileBytes?: number }} [options]
+   *   `indexFile` defaults to `<workspace index>.trigrams`; null keeps the
+   *   trigrams in memory only.
+   */
+  constructor(workspace, options = undefined) {
+    this.workspace = workspace;
+    this.root = workspace.root;
+    this.indexFile =
+      options?.indexFile !== undefined
+        ? options.indexFile
+        : workspace.indexFile
+          ? `${workspace.indexFile.replace(/\.json$/i, "")}.trigrams`
+          : null;
+    this.maxFileBytes = Number.isFinite(options?.maxFileBytes) ? options.maxFileBytes : TRIGRAM_MAX_FILE_BYTES;
+    /** @type {Map<string, { id: number | null, size: number, mtimeMs: number, indexedAt: number, kind: string, grams: Uint32Array | null }>} */
+    this.records = new Map();
+    /** @type {Array<string | null>} id -> path; null marks a tombstone */
+    this.paths = [];
+    /** @type {{ codes: Uint32Array, starts: Uint32Array, ids: Uint32Array, extra: Map<number, number[]> } | null} */
+    this.postings = null;
+    this.dead = 0;
+    this.loaded = false;
+    this.dirty = false;
+    this.syncedAt = 0;
+    this._pending = null;
+    this.stats = { syncs: 0, extracted: 0, searches: 0 };
+  }
+
+  _put(rel, record) {
+    this._remove(rel);
+    record.id = null;
+    if (record.kind === TEXT && record.grams) {
+      record.id = this.paths.length;
+      this.paths.push(rel);
+      if (this.postings) {
+        this._post(record);
+      }
+    }
+    this.records.set(rel, record);
+  }
+
+  _post(record) {
+    const { extra } = this.postings;
+    for (const gram of record.grams) {
+      const list = extra.get(gram);
+      if (list) {
+        list.push(record.id);
+      } else {
+        extra.set(gram, [record.id]);
+      }
+    }
+  }
+
+  /**
+   * Postings are built on the first query of a process rather than on load,
+   * so commands that never search do not pay for them. They are one flat id
+   * array sliced per trigram (a counting sort over a transient table of all
+   * 2^24 trigrams); files added afterwards go to small `extra` lists, whose
+   * ids are always higher, so every list stays ascending.
+   */
+  _ensurePostings() {
+    if (this.postings) {
+      return;
+    }
+    const cursors = new Uint32Array(1 << 24);
+    let total = 0;
+    for (const record of this.records.values()) {
+      if (record.id !== null) {
+        for (const gram of record.grams) {
+          cursors[gram] += 1;
+        }
+        total += record.grams.length;
+      }
+    }
+    let distinct = 0;
+    for (let gram = 0; gram < cursors.length; gram += 1) {
+      if (cursors[gram]) {
+        distinct += 1;
+      }
+    }
+    const codes = new Uint32Array(distinct);
+    const starts = new Uint32Array(distinct + 1);
+    let slot = 0;
+    let offset = 0;
+    for (let gram = 0; gram < cursors.length; gram += 1) {
+      if (cursors[gram]) {
+        codes[slot] = gram;
+        starts[slot] = offset;
+        offset += cursors[gram];
+        cursors[gram] = starts[slot];
+        slot += 1;
+      }
+    }
+    starts[distinct] = offset;
+    // Records iterate in ascending id order: `_put` re-inserts on every change.
+    const ids = new Uint32Array(total);
+    for (const record of this.records.values()) {
+      if (record.id !== null) {
+        for (const gram of record.grams) {
+          ids[cursors[gram]] = record.id;
+          cursors[gram] += 1;
+        }
+      }
+    }
+    this.postings = { codes, starts, ids, extra: new Map() };
+  }
+
+  _postingsOf(gram) {
+    const { codes, starts, ids, extra } = this.postings;
+    let low = 0;
+    let high = codes.length - 1;
+    let base = ids.subarray(0, 0);
+    while (low <= high) {
+      const middle = (low + high) >>> 1;
+      if (codes[middle] === gram) {
+        base = ids.subarray(starts[middle], starts[middle + 1]);
+        break;
+      }
+      if (codes[middle] < gram) {
+        low = middle + 1;
+      } else {
+        high = middle - 1;
+      }
+    }
+    const added = extra.get(gram);
+    return added ? [...base, ...added] : base;
+  }
+
+  _remove(rel) {
+    const known = this.records.get(rel);
+    if (!known) {
+      return;
+    }
+    if (known.id !== null) {
+      this.paths[known.id] = null;
+      this.dead += 1;
+    }
+    this.records.delete(rel);
+  }
+
+  _rebuildPostings() {
+    const records = [...this.records];
+    this.records = new Map();
+    this.paths = [];
+    this.postings = null;
+    this.dead = 0;
+    for (const [rel, record] of records) {
+      this._put(rel, record);
+    }
+  }
+
+  async _extract(rel, file) {
+    const record = { id: null, size: file.size, mtimeMs: file.mtimeMs, indexedAt: Date.now(), kind: TEXT, grams: null };
+    if (file.size > this.maxFileBytes) {
+      record.kind = LARGE;
+      return record;
+    }
+    let buffer;
+    try {
+      buffer = await fs.promises.readFile(path.join(this.root, rel));
+    } catch {
+      record.kind = UNREADABLE;
+      return record;
+    }
+    if (looksBinary(buffer)) {
+      record.kind = BINARY;
+      return record;
+    }
+    record.grams = extractTrigrams(buffer);
+    this.stats.extracted += 1;
+    return record;
+  }
+
+  async _load() {
+    if (this.loaded) {
+      return;
+    }
+    this.loaded = true;
+    if (!this.indexFile) {
+      return;
+    }
+    let lines;
+    try {
+      lines = (await fs.promises.readFile(this.indexFile, "utf8")).split("\n");
+      const header = JSON.parse(lines[0]);
+      if (header?.version !== TRIGRAM_VERSION || header.root !== this.root) {
+        return;
+      }
+    } catch {
+      return;
+    }
+    let sliceStarted = performance.now();
+    for (let line = 1; line < lines.length; line += 1) {
+      if (lines[line]) {
+        try {
+          const [rel, size, mtimeMs, indexedAt, kind, grams] = JSON.parse(lines[line]);
+          this._put(rel, {
+            id: null,
+            size,
+            mtimeMs,
+            indexedAt,
+            kind,
+            grams: kind === TEXT ? decodeGrams(grams ?? "") : null,
+          });
+        } catch {
+          // a damaged line only costs that file a re-read
+        }
+      }
+      if (performance.now() - sliceStarted > SLICE_MS) {
+        await yieldToLoop();
+        sliceStarted = performance.now();
+      }
+    }
+  }
+
+  async _save() {
+    if (!this.indexFile || !this.dirty) {
+      return;
+    }
+    this.dirty = false;
+    const lines = [JSON.stringify({ version: TRIGRAM_VERSION, root: this.root })];
+    let sliceStarted = performance.now();
+    for (const [rel, record] of this.records) {
+      const row = [rel, record.size, record.mtimeMs, record.indexedAt, record.kind];
+      if (record.kind === TEXT) {
+        row.push(encodeGrams(record.grams));
+      }
+      lines.push(JSON.stringify(row));
+      if (performance.now() - sliceStarted > SLICE_MS) {
+        await yieldToLoop();
+        sliceStarted = performance.now();
+      }
+    }
+    try {
+      await writeFileAtomic(this.indexFile, `${lines.join("\n")}\n`, { mkdir: true });
+    } catch {
+      this.dirty = true;
+    }
+  }
+
+  /** Brings the trigrams in line with the (refreshed) workspace index; concurrent callers share one sync. */
+  async sync() {
+    if (!this._pending) {
+      this._pending = this._sync().finally(() => {
+        this._pending = null;
+      });
+    }
+    return this._pending;
+  }
+
+  async _sync() {
+    await this.workspace.ensureFresh();
+    await this._load();
+    if (this.syncedAt && this.syncedAt === this.workspace.refreshedAt) {
+      return this;
+    }
+    const stale = [];
+    for (const [rel, file] of this.workspace.files) {
+      const known = this.records.get(rel);
+      if (
+        known &&
+        known.size === file.size &&
+        known.mtimeMs === file.mtimeMs &&
+        file.mtimeMs + RACY_WINDOW_MS < known.indexedAt
+      ) {
+        continue;
+      }
+      stale.push([rel, file]);
+    }
+    for (const rel of [...this.records.keys()]) {
+      if (!this.workspace.files.has(rel)) {
+        this._remove(rel);
+        this.dirty = true;
+      }
+    }
+    for (let start = 0; start < stale.length; start += READ_CONCURRENCY) {
+      const batch = stale.slice(start, start + READ_CONCURRENCY);
+      const records = await Promise.all(batch.map(([rel, file]) => this._extract(rel, file)));
+      records.forEach((record, offset) => this._put(batch[offset][0], record));
+      this.dirty = true;
+    }
+    if (this.dead > this.paths.length - this.dead) {
+      this._rebuildPostings();
+    }
+    this.syncedAt = this.workspace.refreshedAt;
+    this.stats.syncs += 1;
+    await this._save();
+    return this;
+  }
+
+  /**
+   * Paths that may match, in path order. `narrowed` is false when the query
+   * has no usable trigram and every text file is a candidate.
+   * @param {string} term
+   * @param {{ regex?: boolean, ignoreCase?: boolean, skipDir?: (name: string) => boolean }} [options]
+   */
+  candidates(term, options = undefined) {
+    const query = buildTrigramQuery(term, options);
+    const ids = new Set();
+    if (query) {
+      this._ensurePostings();
+      for (const grams of query) {
+        const lists = grams.map((gram) => this._postingsOf(gram));
+        for (const id of intersectPostings(lists)) {
+          ids.add(id);
+        }
+      }
+    } else {
+      this.paths.forEach((_, id) => ids.add(id));
+    }
+    const skipDir = options?.skipDir;
+    const paths = [];
+    for (const id of ids) {
+      const rel = this.paths[id];
+      if (!rel) {
+        continue;
+      }
+      if (skipDir && rel.split("/").slice(0, -1).some((name) => skipDir(name))) {
+        continue;
+      }
+      paths.push(rel);
+    }
+    paths.sort((left, right) => (left < right ? -1 : left > right ? 1 : 0));
+    return { paths, narrowed: Boolean(query) };
+  }
+
+  /**
+   * Line matches of `term`, verified against the candidate files' content.
+   * Throws a SyntaxError for an invalid `regex`.
+   * @param {string} term
+   * @param {{ regex?: boolean, ignoreCase?: boolean, maxMatches?: number, skipDir?: (name: string) => boolean, threads?: number }} [options]
+   * @returns {Promise<{ matches: Array<{ path: string, line: number, text: string }>, candidates: number, verified: number, narrowed: boolean, truncated: boolean }>}
+   */
+  async search(term, options = undefined) {
+    const spec = createGrepSpec(term, options);
+    const maxMatches = Number.isFinite(options?.maxMatches) ? options.maxMatches : 20;
+    await this.sync();
+    this.stats.searches += 1;
+    const { paths, narrowed } = this.candidates(term, options);
+    const found = await grepFiles(this.root, paths, spec, { maxMatches, threads: options?.threads });
+    return {
+      matches: found.matches,
+      candidates: paths.length,
+      verified: found.scanned,
+      narrowed,
+      truncated: found.truncated,
+    };
+  }
+}
+
+const trigramIndexes = new WeakMap();
+
+/** The trigram index layered over the shared workspace index of `root`. */
+export function getTrigramIndex(root, options = undefined) {
+  const workspace = getWorkspaceIndex(root, options);
+  let index = trigramIndexes.get(workspace);
+  if (!index) {
+    index = new TrigramIndex(workspace);
+    trigramIndexes.set(workspace, index);
+  }
+  return index;
+}
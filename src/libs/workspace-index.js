@@ -0,0 +1,1048 @@
+import fs from "fs";
+import path from "path";
+import { createHash } from "crypto";
+import { performance } from "perf_hooks";
+import { writeFileAtomic, writeFileAtomicSync } from "./atomic-file.js";
+import { IGNORE_FILE_NAMES, IgnoreRules } from "./ignore-rules.js";
+import { languageFromExtension } from "./recompose-utils.js";
+
+/**
+ * Persistent, incrementally refreshed file index of a directory tree, shared
+ * by every MiniPhi walker (workspace scans, the UI file picker, `search_text`,
+ * history notes, the import graph).
+ *
+ * Those used to be five separate cold walks per command, each with its own
+ * skip list. Here one tree is kept per root and rules:
+ *
+ * - **On disk** under the nearest `.miniphi/index/`, one JSON file per root:
+ *   each directory's mtime and sorted children, each file's size, mtime and
+ *   (once computed) content hash. Trees without a `.miniphi` are indexed in
+ *   memory only.
+ * - **Refreshed by mtime.** A directory whose mtime is unchanged keeps its
+ *   listing without a `readdir`; files are re-stat'ed and their hash is kept
+ *   while size and mtime match. Listings and hashes taken within
+ *   `RACY_WINDOW_MS` of the change they describe are not trusted, as git does
+ *   with racily clean entries.
+ * - **Shared per process.** `getWorkspaceIndex` hands every caller the same
+ *   instance, refreshed at most once per `maxAgeMs`.
+ *
+ * The index skips dot-directories and `INDEX_SKIPPED_DIRS` (recorded as
+ * ignored, never descended); consumers with a wider skip list filter while
+ * walking. A consumer that wants to see inside those directories cannot be
+ * served (`canServe`) and builds a private index with its own rules.
+ *
+ * `.gitignore` / `.miniphiignore` files (and `.git/info/exclude`) are read
+ * during every refresh and applied as the walk goes: an ignored directory is
+ * never listed and an ignored file is never stat'ed (ignore-rules.js).
+ *
+ * While a filesystem watcher owns an index (`live`, workspace-watcher.js),
+ * it is kept current through `applyChanges` instead of timed refreshes.
+ */
+
+export const WORKSPACE_INDEX_DIRNAME = "index";
+export const INDEX_SKIPPED_DIRS = ["node_modules", "dist", "build"];
+export const DEFAULT_INDEX_MAX_AGE_MS = Number.isFinite(Number(process.env.MINIPHI_WORKSPACE_INDEX_MAX_AGE_MS))
+  ? Number(process.env.MINIPHI_WORKSPACE_INDEX_MAX_AGE_MS)
+  : 1000;
+
+const INDEX_VERSION = 2;
+export const RACY_WINDOW_MS = 2000;
+const STAT_BATCH_SIZE = 64;
+const SLICE_MS = 8;
+export const DEFAULT_SCAN_CONCURRENCY = 32;
+const DIR = "d";
+const FILE = "f";
+
+const joinRelative = (parent, name) => (parent ? `${parent}/${name}` : name);
+const yieldToLoop = () => new Promise((resolve) => setImmediate(resolve));
+
+function normalizeNames(values) {
+  return new Set(
+    Array.from(values ?? [], (value) => String(value).trim().toLowerCase()).filter(Boolean),
+  );
+}
+
+function findMiniPhiDir(startDir) {
+  let current = startDir;
+  const { root } = path.parse(current);
+  for (;;) {
+    const candidate = path.join(current, ".miniphi");
+    try {
+      if (fs.statSync(candidate).isDirectory()) {
+        return candidate;
+      }
+    } catch {
+      // keep looking upward
+    }
+    if (current === root) {
+      return null;
+    }
+    current = path.dirname(current);
+  }
+}
+
+function sortChildren(dirents) {
+  return dirents
+    .filter((dirent) => dirent.isDirectory() || dirent.isFile())
+    .map((dirent) => ({ name: dirent.name, type: dirent.isDirectory() ? DIR : FILE }))
+    .sort((a, b) => a.name.localeCompare(b.name));
+}
+
+export default class WorkspaceIndex {
+  /**
+   * @param {string} root
+   * @param {{
+   *   ignoredDirs?: Iterable<string>,
+   *   skipDotDirs?: boolean,
+   *   indexFile?: string | null,
+   *   maxAgeMs?: number,
+   *   concurrency?: number,
+   *   ignoreFiles?: Iterable<string>,
+   * }} [options] `indexFile: null` keeps the index in memory only;
+   *   `ignoreFiles` names the per-directory rule files (`[]` disables them);
+   *   `concurrency` bounds the directory listings and stat batches an async
+   *   refresh keeps in flight.
+   */
+  constructor(root, options = undefined) {
+    this.root = path.resolve(root);
+    this.ignoredDirs = normalizeNames(options?.ignoredDirs ?? INDEX_SKIPPED_DIRS);
+    this.skipDotDirs = options?.skipDotDirs !== false;
+    this.ignoreFiles = Array.from(options?.ignoreFiles ?? IGNORE_FILE_NAMES, String);
+    this.indexFile = options?.indexFile ?? null;
+    this.maxAgeMs = Number.isFinite(options?.maxAgeMs)
+      ? Math.max(0, options.maxAgeMs)
+      : DEFAULT_INDEX_MAX_AGE_MS;
+    this.concurrency = Number.isFinite(options?.concurrency)
+      ? Math.max(1, Math.floor(options.concurrency))
+      : DEFAULT_SCAN_CONCURRENCY;
+    /** @type {Map<string, { mtimeMs: number, listedAt: number, children: Array<{ name: string, type: string }> }>} */
+    this.dirs = new Map();
+    /** @type {Map<string, { size: number, mtimeMs: number, hash: string | null, hashedAt: number }>} */
+    this.files = new Map();
+    /** Directories excluded by ignore-file rules in the last refresh. */
+    this.ignored = new Set();
+    this.refreshedAt = 0;
+    /** The watcher keeping this index current, if any (workspace-watcher.js). */
+    this.live = null;
+    this.loaded = false;
+    this.dirty = false;
+    this._pending = null;
+    /** Callers of `ensureFresh({ onFiles })` waiting on an async refresh. */
+    this._discoveryListeners = new Set();
+    this.stats = { refreshes: 0, listed: 0, reused: 0, hashed: 0 };
+  }
+
+  get rulesKey() {
+    return JSON.stringify({ ignored: [...this.ignoredDirs].sort(), dots: this.skipDotDirs, files: this.ignoreFiles });
+  }
+
+  /** True when the index itself does not descend into a directory called `name`. */
+  skipsDir(name) {
+    return (this.skipDotDirs && name.startsWith(".")) || this.ignoredDirs.has(name.toLowerCase());
+  }
+
+  /**
+   * Whether a consumer skipping directories per `skipDir` sees everything it
+   * needs: it must skip at least what the index skips.
+   */
+  canServe(skipDir) {
+    if (this.skipDotDirs && !skipDir(".miniphi-probe")) {
+      return false;
+    }
+    return [...this.ignoredDirs].every((name) => skipDir(name));
+  }
+
+  /**
+   * The index file is line-oriented: a header line, then one line per
+   * directory with its children and, inline, each child file's record. Async
+   * loads and saves stop every `SLICE_MS` to let the event loop run instead of
+   * one multi-megabyte JSON.parse/stringify per refresh.
+   */
+  _loadHeader(line) {
+    let header;
+    try {
+      header = JSON.parse(line);
+    } catch {
+      return false;
+    }
+    return header?.version === INDEX_VERSION && header.root === this.root && header.rules === this.rulesKey;
+  }
+
+  _loadLine(line) {
+    let record;
+    try {
+      record = JSON.parse(line);
+    } catch {
+      return;
+    }
+    const [rel, mtimeMs, listedAt, entries] = record;
+    const children = [];
+    for (const [name, type, size, fileMtimeMs, hash, hashedAt] of entries) {
+      children.push({ name, type });
+      if (type === FILE && Number.isFinite(size)) {
+        this.files.set(joinRelative(rel, name), {
+          size,
+          mtimeMs: fileMtimeMs,
+          hash: hash ?? null,
+          hashedAt: hashedAt ?? 0,
+        });
+      }
+    }
+    this.dirs.set(rel, { mtimeMs, listedAt, children });
+  }
+
+  *_serializeLines() {
+    yield JSON.stringify({
+      version: INDEX_VERSION,
+      root: this.root,
+      rules: this.rulesKey,
+      refreshedAt: new Date(this.refreshedAt).toISOString(),
+    });
+    for (const [rel, dir] of this.dirs) {
+      const entries = dir.children.map((child) => {
+        const file = child.type === FILE ? this.files.get(joinRelative(rel, child.name)) : null;
+        if (!file) {
+          return [child.name, child.type];
+        }
+        return file.hash
+          ? [child.name, child.type, file.size, file.mtimeMs, file.hash, file.hashedAt]
+          : [child.name, child.type, file.size, file.mtimeMs];
+      });
+      yield JSON.stringify([rel, dir.mtimeMs, dir.listedAt, entries]);
+    }
+  }
+
+  async _serialize() {
+    const lines = [];
+    let sliceStarted = performance.now();
+    for (const line of this._serializeLines()) {
+      lines.push(line);
+      if (performance.now() - sliceStarted > SLICE_MS) {
+        await yieldToLoop();
+        sliceStarted = performance.now();
+      }
+    }
+    return `${lines.join("\n")}\n`;
+  }
+
+  _serializeSync() {
+    return `${Array.from(this._serializeLines()).join("\n")}\n`;
+  }
+
+  _loadSync() {
+    if (this.loaded) {
+      return;
+    }
+    this.loaded = true;
+    if (this.indexFile) {
+      try {
+        const lines = fs.readFileSync(this.indexFile, "utf8").split("\n");
+        if (this._loadHeader(lines[0])) {
+          for (let line = 1; line < lines.length; line += 1) {
+            if (lines[line]) {
+              this._loadLine(lines[line]);
+            }
+          }
+        }
+      } catch {
+        // first run
+      }
+    }
+  }
+
+  async _loadAsync() {
+    if (this.loaded) {
+      return;
+    }
+    this.loaded = true;
+    if (this.indexFile) {
+      try {
+        const lines = (await fs.promises.readFile(this.indexFile, "utf8")).split("\n");
+        if (this._loadHeader(lines[0])) {
+          let sliceStarted = performance.now();
+          for (let line = 1; line < lines.length; line += 1) {
+            if (lines[line]) {
+              this._loadLine(lines[line]);
+            }
+            if (performance.now() - sliceStarted > SLICE_MS) {
+              await yieldToLoop();
+              sliceStarted = performance.now();
+            }
+          }
+        }
+      } catch {
+        // first run
+      }
+    }
+  }
+
+  /** Reuses a listing only when the directory's mtime is unchanged and was not racy when listed. */
+  _cachedChildren(rel, stat) {
+    const known = this.dirs.get(rel);
+    if (known && known.mtimeMs === stat.mtimeMs && stat.mtimeMs + RACY_WINDOW_MS < known.listedAt) {
+      this.stats.reused += 1;
+      return known.children;
+    }
+    return null;
+  }
+
+  _noteDir(rel, stat, children, listed) {
+    const known = this.dirs.get(rel);
+    if (listed) {
+      this.stats.listed += 1;
+      this.dirs.set(rel, { mtimeMs: stat.mtimeMs, listedAt: Date.now(), children });
+      this.dirty = true;
+    } else if (known) {
+      known.mtimeMs = stat.mtimeMs;
+    }
+  }
+
+  _noteFile(rel, stat) {
+    const known = this.files.get(rel);
+    if (known && known.size === stat.size && known.mtimeMs === stat.mtimeMs) {
+      if (known.hash && stat.mtimeMs + RACY_WINDOW_MS >= known.hashedAt) {
+        known.hash = null;
+        this.dirty = true;
+      }
+      return;
+    }
+    this.files.set(rel, { size: stat.size, mtimeMs: stat.mtimeMs, hash: null, hashedAt: 0 });
+    this.dirty = true;
+  }
+
+  _prune(seenDirs, seenFiles) {
+    for (const rel of this.dirs.keys()) {
+      if (!seenDirs.has(rel)) {
+        this.dirs.delete(rel);
+        this.dirty = true;
+      }
+    }
+    for (const rel of this.files.keys()) {
+      if (!seenFiles.has(rel)) {
+        this.files.delete(rel);
+        this.dirty = true;
+      }
+    }
+  }
+
+  /** Ignore files present among `children`, in the order their rules apply. */
+  _ignoreFilesIn(children) {
+    return this.ignoreFiles.filter((name) => children.some((child) => child.type === FILE && child.name === name));
+  }
+
+  /** True when ignore rules exclude a child; excluded directories are remembered for `walk`. */
+  _ruledOut(rules, childRel, isDir, ignored) {
+    if (!rules.ignores(childRel, isDir)) {
+      return false;
+    }
+    if (isDir) {
+      ignored.add(childRel);
+    }
+    return true;
+  }
+
+  /** Ignore rules seeded with the repository-local excludes, read synchronously. */
+  _rootRulesSync() {
+    const rules = new IgnoreRules();
+    if (this.ignoreFiles.length) {
+      try {
+        rules.add("", fs.readFileSync(path.join(this.root, ".git", "info", "exclude"), "utf8"));
+      } catch {
+        // no repository-local excludes
+      }
+    }
+    return rules;
+  }
+
+  refreshSync() {
+    this._loadSync();
+    const seenDirs = new Set();
+    const seenFiles = new Set();
+    const rules = this._rootRulesSync();
+    const ignored = new Set();
+    const stack = [""];
+    while (stack.length) {
+      const rel = stack.pop();
+      const absolute = path.join(this.root, rel);
+      let stat;
+      try {
+        stat = fs.statSync(absolute);
+      } catch {
+        continue;
+      }
+      let children = this._cachedChildren(rel, stat);
+      const listed = !children;
+      if (listed) {
+        try {
+          children = sortChildren(fs.readdirSync(absolute, { withFileTypes: true }));
+        } catch {
+          continue;
+        }
+      }
+      this._noteDir(rel, stat, children, listed);
+      seenDirs.add(rel);
+      for (const name of this._ignoreFilesIn(children)) {
+        try {
+          rules.add(rel, fs.readFileSync(path.join(absolute, name), "utf8"));
+        } catch {
+          // unreadable ignore file: no rules
+        }
+      }
+      for (const child of children) {
+        const childRel = joinRelative(rel, child.name);
+        if (child.type === DIR) {
+          if (!this.skipsDir(child.name) && !this._ruledOut(rules, childRel, true, ignored)) {
+            stack.push(childRel);
+          }
+          continue;
+        }
+        if (this._ruledOut(rules, childRel, false, ignored)) {
+          continue;
+        }
+        try {
+          this._noteFile(childRel, fs.statSync(path.join(absolute, child.name)));
+          seenFiles.add(childRel);
+        } catch {
+          // removed since the listing
+        }
+      }
+    }
+    this._prune(seenDirs, seenFiles);
+    this.ignored = ignored;
+    this._finishRefresh();
+    this._saveSync();
+    return this;
+  }
+
+  /**
+   * Asynchronous refresh: a bounded pool of `concurrency` fs operations over
+   * a FIFO work list (head index, no `shift()`), listing directories through
+   * `opendir` and stat'ing files in small batches, so even a cold walk of a
+   * huge tree never holds the event loop for long. Traversal order does not
+   * matter: listings are stored sorted and `walk` orders the output.
+   */
+  async refresh() {
+    await this._loadAsync();
+    const seenDirs = new Set();
+    const seenFiles = new Set();
+    const rules = new IgnoreRules();
+    const ignored = new Set();
+    if (this.ignoreFiles.length) {
+      try {
+        rules.add("", await fs.promises.readFile(path.join(this.root, ".git", "info", "exclude"), "utf8"));
+      } catch {
+        // no repository-local excludes
+      }
+    }
+    const work = [{ dir: "" }];
+    let head = 0;
+    let active = 0;
+
+    const listDir = async (absolute) => {
+      const dirents = [];
+      const handle = await fs.promises.opendir(absolute, { bufferSize: 64 });
+      for await (const dirent of handle) {
+        dirents.push(dirent);
+      }
+      return sortChildren(dirents);
+    };
+
+    const visitDir = async (rel) => {
+      const absolute = path.join(this.root, rel);
+      let stat;
+      try {
+        stat = await fs.promises.stat(absolute);
+      } catch {
+        return;
+      }
+      let children = this._cachedChildren(rel, stat);
+      const listed = !children;
+      if (listed) {
+        try {
+          children = await listDir(absolute);
+        } catch {
+          return;
+        }
+      }
+      this._noteDir(rel, stat, children, listed);
+      seenDirs.add(rel);
+      for (const name of this._ignoreFilesIn(children)) {
+        try {
+          rules.add(rel, await fs.promises.readFile(path.join(absolute, name), "utf8"));
+        } catch {
+          // unreadable ignore file: no rules
+        }
+      }
+      let batch = [];
+      for (const child of children) {
+        const childRel = joinRelative(rel, child.name);
+        if (child.type === DIR) {
+          if (!this.skipsDir(child.name) && !this._ruledOut(rules, childRel, true, ignored)) {
+            work.push({ dir: childRel });
+          }
+          continue;
+        }
+        if (this._ruledOut(rules, childRel, false, ignored)) {
+          continue;
+        }
+        batch.push(childRel);
+        if (batch.length >= STAT_BATCH_SIZE) {
+          work.push({ files: batch });
+          batch = [];
+        }
+      }
+      if (batch.length) {
+        work.push({ files: batch });
+      }
+    };
+
+    // Callback stats, issued together per batch: cheaper than one awaited
+    // fs.promises.stat per file, and still bounded by the pool.
+    // Each batch is also reported to `onFiles` listeners as soon as it is
+    // stat'ed, so a UI can show a cold tree while it is still being walked.
+    const statFiles = (rels) =>
+      new Promise((resolve) => {
+        let remaining = rels.length;
+        const noted = [];
+        for (const rel of rels) {
+          fs.stat(path.join(this.root, rel), (error, stat) => {
+            if (!error) {
+              this._noteFile(rel, stat);
+              seenFiles.add(rel);
+              noted.push(rel);
+            }
+            remaining -= 1;
+            if (remaining === 0) {
+              for (const listener of this._discoveryListeners) {
+                listener(noted);
+              }
+              resolve();
+            }
+          });
+        }
+      });
+
+    await new Promise((resolve, reject) => {
+      const pump = () => {
+        while (active < this.concurrency && head < work.length) {
+          const task = work[head];
+          work[head] = undefined;
+          head += 1;
+          if (head > 4096 && head * 2 > work.length) {
+            work.splice(0, head);
+            head = 0;
+          }
+          active += 1;
+          (task.files ? statFiles(task.files) : visitDir(task.dir)).then(() => {
+            active -= 1;
+            pump();
+          }, reject);
+        }
+        if (active === 0 && head >= work.length) {
+          resolve();
+        }
+      };
+      pump();
+    });
+
+    this._prune(seenDirs, seenFiles);
+    this.ignored = ignored;
+    this._finishRefresh();
+    await this._save();
+    return this;
+  }
+
+  _finishRefresh() {
+    // Strictly increasing: derived indexes compare it to skip redundant syncs.
+    this.refreshedAt = Math.max(Date.now(), this.refreshedAt + 1);
+    this.stats.refreshes += 1;
+  }
+
+  _isFresh() {
+    return this.refreshedAt > 0 && Date.now() - this.refreshedAt <= this.maxAgeMs;
+  }
+
+  /**
+   * Whether `walk` is current without a refresh: refreshed within `maxAgeMs`,
+   * or kept current by a watcher with nothing queued.
+   */
+  isFresh() {
+    if (this.live && this.refreshedAt > 0) {
+      return !this.live.hasPending();
+    }
+    return this._isFresh();
+  }
+
+  /**
+   * Refreshes unless a refresh finished within `maxAgeMs`; concurrent callers
+   * share one. A watched index only waits for the watcher's pending changes.
+   * @param {{ onFiles?: (paths: string[]) => void }} [options] `onFiles`
+   *   receives batches of files as the refresh it waits on finds them; it is
+   *   not called when no refresh runs, so read the index once this resolves.
+   */
+  async ensureFresh(options = undefined) {
+    if (this.live && this.refreshedAt > 0) {
+      await this.live.applyPending();
+      return this;
+    }
+    if (this._isFresh()) {
+      return this;
+    }
+    if (!this._pending) {
+      this._pending = this.refresh().finally(() => {
+        this._pending = null;
+      });
+    }
+    const onFiles = options?.onFiles;
+    if (!onFiles) {
+      return this._pending;
+    }
+    this._discoveryListeners.add(onFiles);
+    try {
+      return await this._pending;
+    } finally {
+      this._discoveryListeners.delete(onFiles);
+    }
+  }
+
+  /**
+   * Synchronous `ensureFresh`. While an async refresh or `applyChanges` is
+   * running it does not refresh alongside it: the index keeps the state it
+   * has, which is empty (`refreshedAt` 0) until the first refresh lands.
+   */
+  ensureFreshSync() {
+    if (this.isFresh() || this._pending) {
+      return this;
+    }
+    return this.refreshSync();
+  }
+
+  /**
+   * Applies the paths a filesystem watcher reported, without walking the
+   * tree: the parent directory of each path is listed again, new or reported
+   * files are stat'ed, new directories are walked and vanished ones dropped
+   * with their subtree. A reported ignore file, or `null` (the watcher lost
+   * track), falls back to a full refresh.
+   * @param {Iterable<string> | null} relativePaths POSIX, relative to the root
+   * @returns {Promise<{ changed: string[], removed: string[] }>} indexed files
+   *   that were added or modified, and files that left the index
+   */
+  async applyChanges(relativePaths) {
+    while (this._pending) {
+      await this._pending.catch(() => {});
+    }
+    const run = this._applyChanges(relativePaths);
+    const pending = run.then(
+      () => this,
+      () => this,
+    );
+    this._pending = pending;
+    pending.then(() => {
+      if (this._pending === pending) {
+        this._pending = null;
+      }
+    });
+    return run;
+  }
+
+  async _applyChanges(relativePaths) {
+    await this._loadAsync();
+    const reported = relativePaths ? new Set(relativePaths) : null;
+    const before = new Map();
+    const remember = (rel) => {
+      if (!before.has(rel)) {
+        const file = this.files.get(rel);
+        before.set(rel, file ? { size: file.size, mtimeMs: file.mtimeMs } : null);
+      }
+    };
+    const fullRefresh =
+      !reported ||
+      !this.refreshedAt ||
+      [...reported].some((rel) => this.ignoreFiles.includes(rel.slice(rel.lastIndexOf("/") + 1)));
+    if (fullRefresh) {
+      for (const [rel, file] of this.files) {
+        before.set(rel, { size: file.size, mtimeMs: file.mtimeMs });
+      }
+      await this.refresh();
+      for (const rel of this.files.keys()) {
+        if (!before.has(rel)) {
+          before.set(rel, null);
+        }
+      }
+    } else {
+      await this._applyReported(reported, remember);
+      this._finishRefresh();
+      await this._save();
+    }
+    const changed = [];
+    const removed = [];
+    for (const [rel, previous] of before) {
+      const file = this.files.get(rel);
+      if (!file) {
+        if (previous) {
+          removed.push(rel);
+        }
+      } else if (!previous || previous.size !== file.size || previous.mtimeMs !== file.mtimeMs) {
+        changed.push(rel);
+      }
+    }
+    return { changed: changed.sort(), removed: removed.sort() };
+  }
+
+  _dropSubtree(rel, remember) {
+    const prefix = `${rel}/`;
+    for (const fileRel of this.files.keys()) {
+      if (fileRel.startsWith(prefix)) {
+        remember(fileRel);
+        this.files.delete(fileRel);
+      }
+    }
+    for (const dirRel of this.dirs.keys()) {
+      if (dirRel === rel || dirRel.startsWith(prefix)) {
+        this.dirs.delete(dirRel);
+      }
+    }
+    for (const ignoredRel of this.ignored) {
+      if (ignoredRel === rel || ignoredRel.startsWith(prefix)) {
+        this.ignored.delete(ignoredRel);
+      }
+    }
+    this.dirty = true;
+  }
+
+  async _applyReported(reported, remember) {
+    const rules = new IgnoreRules();
+    const ruled = new Set();
+    if (this.ignoreFiles.length) {
+      try {
+        rules.add("", await fs.promises.readFile(path.join(this.root, ".git", "info", "exclude"), "utf8"));
+      } catch {
+        // no repository-local excludes
+      }
+    }
+    const parentOf = (rel) => (rel.includes("/") ? rel.slice(0, rel.lastIndexOf("/")) : "");
+    // Rules of `rel` and its ancestors, each directory's ignore files read once.
+    const addRules = async (rel) => {
+      const chain = [];
+      for (let dir = rel; !ruled.has(dir); dir = parentOf(dir)) {
+        chain.push(dir);
+        if (!dir) {
+          break;
+        }
+      }
+      for (const dir of chain.reverse()) {
+        ruled.add(dir);
+        for (const name of this._ignoreFilesIn(this.dirs.get(dir)?.children ?? [])) {
+          try {
+            rules.add(dir, await fs.promises.readFile(path.join(this.root, dir, name), "utf8"));
+          } catch {
+            // unreadable ignore file: no rules
+          }
+        }
+      }
+    };
+    const noteFile = async (rel) => {
+      remember(rel);
+      try {
+        this._noteFile(rel, await fs.promises.stat(path.join(this.root, rel)));
+      } catch {
+        this.files.delete(rel);
+        this.dirty = true;
+      }
+    };
+    const listDir = async (rel, fresh) => {
+      const absolute = path.join(this.root, rel);
+      let stat;
+      let children;
+      try {
+        stat = await fs.promises.stat(absolute);
+        children = sortChildren(await fs.promises.readdir(absolute, { withFileTypes: true }));
+      } catch {
+        if (rel) {
+          this._dropSubtree(rel, remember);
+        }
+        return;
+      }
+      const previous = this.dirs.get(rel)?.children ?? [];
+      this._noteDir(rel, stat, children, true);
+      await addRules(rel);
+      const present = new Set(children.map((child) => `${child.type}/${child.name}`));
+      for (const child of previous) {
+        if (!present.has(`${child.type}/${child.name}`)) {
+          const childRel = joinRelative(rel, child.name);
+          if (child.type === DIR) {
+            this._dropSubtree(childRel, remember);
+          } else {
+            remember(childRel);
+            this.files.delete(childRel);
+          }
+        }
+      }
+      for (const child of children) {
+        const childRel = joinRelative(rel, child.name);
+        if (child.type === DIR) {
+          if (this.skipsDir(child.name) || this._ruledOut(rules, childRel, true, this.ignored)) {
+            if (this.dirs.has(childRel)) {
+              this._dropSubtree(childRel, remember);
+              this.ignored.add(childRel);
+            }
+          } else if (fresh || !this.dirs.has(childRel)) {
+            await listDir(childRel, true);
+          }
+          continue;
+        }
+        if (this._ruledOut(rules, childRel, false, this.ignored)) {
+          if (this.files.has(childRel)) {
+            remember(childRel);
+            this.files.delete(childRel);
+          }
+          continue;
+        }
+        if (fresh || !this.files.has(childRel) || reported.has(childRel)) {
+          await noteFile(childRel);
+        }
+      }
+    };
+    // A reported path is settled by listing its parent again; a parent the
+    // index does not know is covered by its nearest indexed ancestor.
+    const parents = new Set();
+    for (const rel of reported) {
+      let dir = parentOf(rel);
+      while (dir && !this.dirs.has(dir)) {
+        dir = parentOf(dir);
+      }
+      parents.add(dir);
+      if (this.dirs.has(rel)) {
+        parents.add(rel);
+      }
+    }
+    const depthOf = (rel) => (rel ? rel.split("/").length : 0);
+    for (const dir of [...parents].sort((left, right) => depthOf(left) - depthOf(right))) {
+      if (dir === "" || this.dirs.has(dir)) {
+        await listDir(dir, false);
+      }
+    }
+  }
+
+  async _save() {
+    if (!this.indexFile || !this.dirty) {
+      return;
+    }
+    this.dirty = false;
+    try {
+      await writeFileAtomic(this.indexFile, await this._serialize(), { mkdir: true });
+    } catch {
+      this.dirty = true;
+    }
+  }
+
+  _saveSync() {
+    if (!this.indexFile || !this.dirty) {
+      return;
+    }
+    this.dirty = false;
+    try {
+      fs.mkdirSync(path.dirname(this.indexFile), { recursive: true });
+      writeFileAtomicSync(this.indexFile, this._serializeSync());
+    } catch {
+      this.dirty = true;
+    }
+  }
+
+  /** The indexed record for a POSIX relative path, or null. */
+  stat(relativePath) {
+    const file = this.files.get(relativePath);
+    if (!file) {
+      return null;
+    }
+    return {
+      path: relativePath,
+      size: file.size,
+      mtimeMs: file.mtimeMs,
+      hash: file.hash,
+      language: languageFromExtension(path.extname(relativePath)),
+    };
+  }
+
+  /** sha256 of a file's content, computed on first request and kept while the file is unchanged. */
+  async hashFor(relativePath) {
+    const file = this.files.get(relativePath);
+    if (!file) {
+      return null;
+    }
+    if (!file.hash) {
+      const content = await fs.promises.readFile(path.join(this.root, relativePath));
+      file.hash = createHash("sha256").update(content).digest("hex");
+      file.hashedAt = Date.now();
+      this.stats.hashed += 1;
+      this.dirty = true;
+    }
+    return file.hash;
+  }
+
+  /**
+   * Breadth-first walk in sorted order, as the original workspace scanner
+   * produced it. Directories are yielded (flagged `ignored` when `skipDir`
+   * matches) before being descended; files carry their indexed metadata.
+   * @param {{ skipDir?: (name: string) => boolean, maxDepth?: number }} [options]
+   */
+  *walk(options = undefined) {
+    const skipDir = options?.skipDir ?? ((name) => this.skipsDir(name));
+    const maxDepth = Number.isFinite(options?.maxDepth) ? options.maxDepth : Number.POSITIVE_INFINITY;
+    const queue = [{ rel: "", depth: 0 }];
+    for (let head = 0; head < queue.length; head += 1) {
+      const current = queue[head];
+      const dir = this.dirs.get(current.rel);
+      if (!dir) {
+        continue;
+      }
+      for (const child of dir.children) {
+        const childRel = joinRelative(current.rel, child.name);
+        if (child.type === DIR) {
+          const depth = current.depth + 1;
+          const ignored = skipDir(child.name) || this.skipsDir(child.name) || this.ignored.has(childRel);
+          yield { type: "dir", path: childRel, depth, ignored };
+          if (!ignored && depth <= maxDepth) {
+            queue.push({ rel: childRel, depth });
+          }
+          continue;
+        }
+        const file = this.files.get(childRel);
+        if (file) {
+          yield {
+            type: "file",
+            path: childRel,
+            depth: current.depth,
+            size: file.size,
+            mtimeMs: file.mtimeMs,
+            language: languageFromExtension(path.extname(child.name)),
+          };
+        }
+      }
+    }
+  }
+
+  /**
+   * `walk` read straight from disk, neither using nor updating the index:
+   * the same order, entries and ignore rules, but a consumer that stops early
+   * stops the disk walk too. For bounded listings when the index is not fresh.
+   * @param {{ skipDir?: (name: string) => boolean, maxDepth?: number }} [options]
+   */
+  *walkDisk(options = undefined) {
+    const skipDir = options?.skipDir ?? ((name) => this.skipsDir(name));
+    const maxDepth = Number.isFinite(options?.maxDepth) ? options.maxDepth : Number.POSITIVE_INFINITY;
+    const rules = this._rootRulesSync();
+    const queue = [{ rel: "", depth: 0 }];
+    for (let head = 0; head < queue.length; head += 1) {
+      const current = queue[head];
+      const absolute = path.join(this.root, current.rel);
+      let children;
+      try {
+        children = sortChildren(fs.readdirSync(absolute, { withFileTypes: true }));
+      } catch {
+        continue;
+      }
+      for (const name of this._ignoreFilesIn(children)) {
+        try {
+          rules.add(current.rel, fs.readFileSync(path.join(absolute, name), "utf8"));
+        } catch {
+          // unreadable ignore file: no rules
+        }
+      }
+      for (const child of children) {
+        const childRel = joinRelative(current.rel, child.name);
+        if (child.type === DIR) {
+          const depth = current.depth + 1;
+          const ignored = skipDir(child.name) || this.skipsDir(child.name) || rules.ignores(childRel, true);
+          yield { type: "dir", path: childRel, depth, ignored };
+          if (!ignored && depth <= maxDepth) {
+            queue.push({ rel: childRel, depth });
+          }
+          continue;
+        }
+        if (rules.ignores(childRel, false)) {
+          continue;
+        }
+        let stat;
+        try {
+          stat = fs.statSync(path.join(absolute, child.name));
+        } catch {
+          continue;
+        }
+        yield {
+          type: "file",
+          path: childRel,
+          depth: current.depth,
+          size: stat.size,
+          mtimeMs: stat.mtimeMs,
+          language: languageFromExtension(path.extname(child.name)),
+        };
+      }
+    }
+  }
+
+  /** Files only, in `walk` order. */
+  *walkFiles(options = undefined) {
+    for (const entry of this.walk(options)) {
+      if (entry.type === "file") {
+        yield entry;
+      }
+    }
+  }
+}
+
+const sharedIndexes = new Map();
+
+function indexFileFor(root, rulesKey) {
+  const miniphiDir = findMiniPhiDir(root);
+  if (!miniphiDir) {
+    return null;
+  }
+  const slug = (path.basename(root) || "root").replace(/[^\w.-]+/g, "-").slice(0, 40);
+  const digest = createHash("sha1").update(`${root}\n${rulesKey}`).digest("hex").slice(0, 12);
+  return path.join(miniphiDir, WORKSPACE_INDEX_DIRNAME, `${slug}-${digest}.json`);
+}
+
+/**
+ * The process-wide index for `root` under the given rules, persisted in the
+ * nearest `.miniphi/index/` when there is one.
+ * @param {string} root
+ * @param {{ ignoredDirs?: Iterable<string>, skipDotDirs?: boolean, maxAgeMs?: number }} [options]
+ */
+export function getWorkspaceIndex(root, options = undefined) {
+  const probe = new WorkspaceIndex(root, { ...options, indexFile: null });
+  const key = `${probe.root}\n${probe.rulesKey}`;
+  let index = sharedIndexes.get(key);
+  if (!index) {
+    index = new WorkspaceIndex(probe.root, {
+      ...options,
+      indexFile: indexFileFor(probe.root, probe.rulesKey),
+    });
+    sharedIndexes.set(key, index);
+  }
+  return index;
+}
+
+/**
+ * Marks shared indexes covering `targetPath` (all of them when omitted) as
+ * stale, so the next reader re-stats the tree instead of trusting a refresh
+ * from moments ago. A watched index is handed the path instead, and the next
+ * reader waits only for that path. Called by MiniPhi's own workspace writers.
+ */
+export function invalidateWorkspaceIndexes(targetPath = undefined) {
+  const target = targetPath ? path.resolve(targetPath) : null;
+  for (const index of sharedIndexes.values()) {
+    if (!target || target === index.root || target.startsWith(`${index.root}${path.sep}`)) {
+      if (index.live && target && target !== index.root) {
+        index.live.note(path.relative(index.root, target).split(path.sep).join("/"));
+      } else {
+        index.refreshedAt = 0;
+      }
+    }
+  }
+}
+
+/** Forgets the shared instances, e.g. between tests that reuse a path. */
+export function resetWorkspaceIndexes() {
+  sharedIndexes.clear();
+}
@@ -133,6 +133,26 @@ export default class WorkspaceProfiler {
     };
   }
 
+  /**
+   * `describe`, after letting the connection analyzer parse native sources on
+   * its worker pool instead of inline on this thread.
+   * @param {string} rootDir
+   */
+  async describeAsync(rootDir, options = undefined) {
+    const root = path.resolve(rootDir ?? process.cwd());
+    if (this.includeConnections && typeof this.connectionAnalyzer?.prepare === "function") {
+      try {
+        await this.connectionAnalyzer.prepare(root);
+      } catch (error) {
+        if (this.logger) {
+          const message = error instanceof Error ? error.message : String(error);
+          this.logger(`[WorkspaceProfiler] Source fact parsing failed: ${message}`);
+        }
+      }
+    }
+    return this.describe(root, options);
+  }
+
   _resolveScan(root, options = undefined) {
     return resolveWorkspaceScanSync(root, {
       ignoredDirs: this.ignoredDirs,
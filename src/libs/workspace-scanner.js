@@ -1,5 +1,6 @@
 import fs from "fs";
 import path from "path";
+import WorkspaceIndex, { getWorkspaceIndex } from "./workspace-index.js";
 
 const DEFAULT_IGNORED_DIRS = new Set([
   ".git",
@@ -115,10 +116,8 @@ function buildWorkspaceScanCacheKey(baseDir, options = undefined) {
   });
 }
 
-export function scanWorkspaceSync(baseDir, options = undefined) {
-  const resolvedRoot = baseDir ? path.resolve(baseDir) : null;
-  const resolvedOptions = resolveScanOptions(options);
-  const result = {
+function createScanResult(resolvedRoot, resolvedOptions) {
+  return {
     root: resolvedRoot,
     files: [],
     directories: [],
@@ -131,80 +130,97 @@ export function scanWorkspaceSync(baseDir, options = undefined) {
       maxEntries: resolvedOptions.maxEntries,
     },
   };
-  if (!resolvedRoot || !fs.existsSync(resolvedRoot)) {
-    return result;
+}
+
+/**
+ * The shared persistent index when it covers these skip rules, otherwise a
+ * private in-memory one built with them.
+ */
+function resolveScanIndex(resolvedRoot, resolvedOptions, options) {
+  const skipDir = (name) => shouldSkipDirectory(name, resolvedOptions.ignoredDirs);
+  const shared = options?.useIndex === false ? null : getWorkspaceIndex(resolvedRoot);
+  if (shared?.canServe(skipDir)) {
+    return { index: shared, skipDir };
   }
+  return {
+    index: new WorkspaceIndex(resolvedRoot, { ignoredDirs: resolvedOptions.ignoredDirs, indexFile: null }),
+    skipDir,
+  };
+}
 
-  const queue = [{ dir: resolvedRoot, depth: 0 }];
-  const visited = new Set();
-  while (queue.length > 0) {
-    const current = queue.shift();
-    if (!current) {
-      break;
-    }
-    if (visited.has(current.dir)) {
+/**
+ * Copies a walk (`index.walk` or `index.walkDisk`) into `result`, stopping at
+ * `maxEntries` files.
+ */
+function fillScanResult(result, entries, resolvedOptions) {
+  for (const entry of entries) {
+    if (entry.type === "dir") {
+      if (resolvedOptions.includeDirectories) {
+        result.stats.directories += 1;
+        result.directories.push(entry.path);
+        result.entries.push({ type: "dir", path: entry.path, depth: entry.depth, ignored: entry.ignored });
+      }
       continue;
     }
-    visited.add(current.dir);
-
-    let dirents = [];
-    try {
-      dirents = fs.readdirSync(current.dir, { withFileTypes: true });
-      dirents.sort((a, b) => a.name.localeCompare(b.name));
-    } catch {
+    if (!resolvedOptions.includeFiles) {
       continue;
     }
-
-    for (const dirent of dirents) {
-      const fullPath = path.join(current.dir, dirent.name);
-      const relative = path.relative(resolvedRoot, fullPath) || dirent.name;
-      const normalizedPath = relative.replace(/\\/g, "/");
-      if (dirent.isDirectory()) {
-        const depth = current.depth + 1;
-        const ignored = shouldSkipDirectory(dirent.name, resolvedOptions.ignoredDirs);
-        if (resolvedOptions.includeDirectories) {
-          result.stats.directories += 1;
-          result.directories.push(normalizedPath);
-          result.entries.push({
-            type: "dir",
-            path: normalizedPath,
-            depth,
-            ignored,
-          });
-        }
-        if (!ignored && depth <= resolvedOptions.maxDepth) {
-          queue.push({ dir: fullPath, depth });
-        }
-        continue;
-      }
-      if (!dirent.isFile()) {
-        continue;
-      }
-      if (resolvedOptions.includeFiles) {
-        result.stats.files += 1;
-        result.files.push(normalizedPath);
-        result.entries.push({
-          type: "file",
-          path: normalizedPath,
-          depth: current.depth,
-        });
-        if (result.stats.files >= resolvedOptions.maxEntries) {
-          result.truncated = true;
-          break;
-        }
-      }
-    }
+    result.stats.files += 1;
+    result.files.push(entry.path);
+    result.entries.push({ type: "file", path: entry.path, depth: entry.depth });
     if (result.stats.files >= resolvedOptions.maxEntries) {
       result.truncated = true;
       break;
     }
   }
-
   return result;
 }
 
+/**
+ * Lists the workspace from its index when the index is fresh. A scan capped
+ * by `maxEntries` does not refresh a stale index, which would walk the whole
+ * tree for a few entries: it walks the disk and stops at the cap. An uncapped
+ * scan refreshes the index first, unless an async refresh is already running
+ * and there is nothing indexed yet, in which case it also walks the disk.
+ * @param {string} baseDir
+ * @param {object} [options]
+ */
+export function scanWorkspaceSync(baseDir, options = undefined) {
+  const resolvedRoot = baseDir ? path.resolve(baseDir) : null;
+  const resolvedOptions = resolveScanOptions(options);
+  const result = createScanResult(resolvedRoot, resolvedOptions);
+  if (!resolvedRoot || !fs.existsSync(resolvedRoot)) {
+    return result;
+  }
+  const { index, skipDir } = resolveScanIndex(resolvedRoot, resolvedOptions, options);
+  const walkOptions = { skipDir, maxDepth: resolvedOptions.maxDepth };
+  const capped = Number.isFinite(resolvedOptions.maxEntries);
+  if (index.isFresh() || (!capped && index.ensureFreshSync().refreshedAt > 0)) {
+    return fillScanResult(result, index.walk(walkOptions), resolvedOptions);
+  }
+  return fillScanResult(result, index.walkDisk(walkOptions), resolvedOptions);
+}
+
+/**
+ * Async `scanWorkspaceSync`. It always brings the index up to date, on the
+ * async refresh, and trims the walk afterwards.
+ */
 export async function scanWorkspace(baseDir, options = undefined) {
-  return scanWorkspaceSync(baseDir, options);
+  const resolvedRoot = baseDir ? path.resolve(baseDir) : null;
+  const resolvedOptions = resolveScanOptions(options);
+  const result = createScanResult(resolvedRoot, resolvedOptions);
+  const exists = resolvedRoot
+    ? await fs.promises.access(resolvedRoot).then(
+        () => true,
+        () => false,
+      )
+    : false;
+  if (!exists) {
+    return result;
+  }
+  const { index, skipDir } = resolveScanIndex(resolvedRoot, resolvedOptions, options);
+  await index.ensureFresh();
+  return fillScanResult(result, index.walk({ skipDir, maxDepth: resolvedOptions.maxDepth }), resolvedOptions);
 }
 
 export function resolveWorkspaceScanSync(baseDir, options = undefined) {
@@ -510,7 +510,10 @@ async function generateWorkspaceSnapshot({
 
   let profile;
   try {
-    profile = workspaceProfiler.describe(rootDir, { scanResult, scanCache });
+    profile =
+      typeof workspaceProfiler.describeAsync === "function"
+        ? await workspaceProfiler.describeAsync(rootDir, { scanResult, scanCache })
+        : workspaceProfiler.describe(rootDir, { scanResult, scanCache });
   } catch (error) {
     if (verbose) {
       console.warn(
@@ -0,0 +1,283 @@
+import fs from "fs";
+import path from "path";
+import { EventEmitter } from "events";
+import { getSourceFactsIndex } from "./source-facts-index.js";
+import { sourceLanguageOf } from "./source-facts.js";
+import { getTrigramIndex } from "./trigram-index.js";
+import { getWorkspaceIndex } from "./workspace-index.js";
+
+/**
+ * Keeps the shared workspace index of a root, and the trigram and source
+ * facts (symbol) indexes layered on it, current for a long-lived MiniPhi
+ * process, from filesystem events instead of timed re-walks.
+ *
+ * - Events are collected for `debounceMs` and applied in one batch with
+ *   `WorkspaceIndex.applyChanges`, which lists only the affected directories.
+ *   While the watcher is live, readers of the index wait for pending events
+ *   instead of re-stat'ing the tree every `maxAgeMs`.
+ * - On Linux, `fs.watch({ recursive: true })` walks and watches every
+ *   directory, `node_modules` and `.git` included. There the watcher holds one
+ *   non-recursive watch per *indexed* directory instead, added and closed as
+ *   directories come and go. Other platforms use the native recursive watch.
+ * - Each applied batch re-syncs the trigram index (when it is persisted) and
+ *   re-parses changed sources, then emits `change` with
+ *   `{ changed, removed }` (POSIX paths relative to the root). Agent
+ *   sessions use it to drop context for files edited outside MiniPhi.
+ * - Events can be missed (watch limits, overflow), so a full refresh runs
+ *   every `verifyIntervalMs`. A failed watch stops the watcher and emits
+ *   `error`; the index falls back to timed refreshes.
+ */
+
+export const DEFAULT_WATCH_DEBOUNCE_MS = 75;
+export const DEFAULT_WATCH_VERIFY_INTERVAL_MS = 10 * 60 * 1000;
+
+export default class WorkspaceWatcher extends EventEmitter {
+  /**
+   * @param {string} root
+   * @param {{ debounceMs?: number, verifyIntervalMs?: number, recursive?: boolean }} [options]
+   *   `recursive` defaults to true everywhere but Linux.
+   */
+  constructor(root, options = undefined) {
+    super();
+    this.workspace = getWorkspaceIndex(root);
+    this.root = this.workspace.root;
+    this.debounceMs = Number.isFinite(options?.debounceMs) ? Math.max(0, options.debounceMs) : DEFAULT_WATCH_DEBOUNCE_MS;
+    this.verifyIntervalMs = Number.isFinite(options?.verifyIntervalMs)
+      ? options.verifyIntervalMs
+      : DEFAULT_WATCH_VERIFY_INTERVAL_MS;
+    this.recursive = options?.recursive ?? process.platform !== "linux";
+    this.pending = new Set();
+    this.lost = false;
+    /** @type {Map<string, fs.FSWatcher>} directory -> watch, when not recursive */
+    this.watches = new Map();
+    this.handle = null;
+    this.running = false;
+    this._timer = null;
+    this._verifyTimer = null;
+    this._applying = Promise.resolve();
+    this._publishing = Promise.resolve();
+    this.stats = { events: 0, batches: 0, changed: 0, removed: 0 };
+  }
+
+  async start() {
+    if (this.running) {
+      return this;
+    }
+    await this.workspace.ensureFresh();
+    this.running = true;
+    try {
+      if (this.recursive) {
+        this.handle = fs.watch(this.root, { recursive: true, persistent: false }, (_event, filename) =>
+          this._onEvent(filename ? filename.toString().split(path.sep).join("/") : null),
+        );
+        this.handle.on("error", (error) => this._fail(error));
+      } else {
+        this._syncWatches();
+      }
+    } catch (error) {
+      this._fail(error);
+      throw error;
+    }
+    if (this.verifyIntervalMs > 0) {
+      this._verifyTimer = setInterval(() => this.noteAll(), this.verifyIntervalMs);
+      this._verifyTimer.unref();
+    }
+    this.workspace.live = this;
+    return this;
+  }
+
+  stop() {
+    this.running = false;
+    clearTimeout(this._timer);
+    clearInterval(this._verifyTimer);
+    this._timer = null;
+    this._verifyTimer = null;
+    this.handle?.close();
+    this.handle = null;
+    for (const watch of this.watches.values()) {
+      watch.close();
+    }
+    this.watches.clear();
+    if (this.workspace.live === this) {
+      this.workspace.live = null;
+    }
+  }
+
+  _fail(error) {
+    if (!this.running) {
+      return;
+    }
+    this.stop();
+    this.emit("error", error);
+  }
+
+  /** Events under skipped or ignored directories never reach the index. */
+  _skipped(rel) {
+    const segments = rel.split("/");
+    let prefix = "";
+    for (let index = 0; index < segments.length - 1; index += 1) {
+      prefix = prefix ? `${prefix}/${segments[index]}` : segments[index];
+      if (this.workspace.skipsDir(segments[index]) || this.workspace.ignored.has(prefix)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  _onEvent(rel) {
+    this.stats.events += 1;
+    if (rel === null) {
+      this.noteAll();
+    } else if (!this._skipped(rel)) {
+      this.note(rel);
+    }
+  }
+
+  _watchDir(rel) {
+    const watch = fs.watch(path.join(this.root, rel), { persistent: false }, (_event, filename) =>
+      this._onEvent(filename ? (rel ? `${rel}/${filename}` : filename.toString()) : rel),
+    );
+    watch.on("error", () => {
+      // The directory went away (or became unreadable): its parent's listing settles it.
+      watch.close();
+      this.watches.delete(rel);
+      this.note(rel);
+    });
+    this.watches.set(rel, watch);
+  }
+
+  /** One watch per indexed directory. Running out of watches is a failure, not a partial view. */
+  _syncWatches() {
+    for (const [rel, watch] of this.watches) {
+      if (!this.workspace.dirs.has(rel)) {
+        watch.close();
+        this.watches.delete(rel);
+      }
+    }
+    for (const rel of this.workspace.dirs.keys()) {
+      if (!this.watches.has(rel)) {
+        try {
+          this._watchDir(rel);
+        } catch (error) {
+          if (error?.code === "ENOENT") {
+            this.note(rel);
+            continue;
+          }
+          throw error;
+        }
+      }
+    }
+  }
+
+  /** Queues a changed path (POSIX, relative to the root). */
+  note(rel) {
+    this.pending.add(rel);
+    this._schedule();
+  }
+
+  /** Queues a full refresh, for when events may have been lost. */
+  noteAll() {
+    this.lost = true;
+    this._schedule();
+  }
+
+  hasPending() {
+    return this.lost || this.pending.size > 0;
+  }
+
+  _schedule() {
+    if (!this._timer && this.running) {
+      this._timer = setTimeout(() => {
+        this._timer = null;
+        this.applyPending();
+      }, this.debounceMs);
+      this._timer.unref();
+    }
+  }
+
+  /**
+   * Applies the queued paths to the workspace index; resolves once the index
+   * reflects every event seen so far. Derived indexes and `change` listeners
+   * are served afterwards, without holding up readers of the index.
+   */
+  applyPending() {
+    if (this.hasPending()) {
+      clearTimeout(this._timer);
+      this._timer = null;
+      const batch = this.lost ? null : [...this.pending];
+      this.pending.clear();
+      this.lost = false;
+      const applied = this._applying.then(() => this.workspace.applyChanges(batch));
+      this._applying = applied.then(
+        () => undefined,
+        () => undefined,
+      );
+      applied.then(
+        (changes) => {
+          this._publishing = this._publishing.then(() => this._publish(changes));
+        },
+        (error) => this._fail(error),
+      );
+    }
+    return this._applying;
+  }
+
+  async _publish({ changed, removed }) {
+    this.stats.batches += 1;
+    try {
+      if (this.running && !this.recursive) {
+        this._syncWatches();
+      }
+      if (!changed.length && !removed.length) {
+        return;
+      }
+      this.stats.changed += changed.length;
+      this.stats.removed += removed.length;
+      const trigrams = getTrigramIndex(this.root);
+      if (trigrams.indexFile) {
+        await trigrams.sync();
+      }
+      const sources = changed.filter((rel) => sourceLanguageOf(rel));
+      if (sources.length) {
+        await getSourceFactsIndex(this.workspace).collect(sources);
+      }
+      this.emit("change", { changed, removed });
+    } catch (error) {
+      this._fail(error);
+    }
+  }
+
+  /** Resolves once every event seen so far is applied and published. */
+  async flush() {
+    await this.applyPending();
+    let publishing;
+    do {
+      publishing = this._publishing;
+      await publishing;
+    } while (publishing !== this._publishing);
+  }
+}
+
+/**
+ * Whether the interactive UI should watch its workspace: `MINIPHI_WATCH_WORKSPACE`
+ * (1/true/on, 0/false/off) wins over `workspace.watch` in config.json. Off by
+ * default: one-shot runs finish before a watch pays for itself.
+ * @param {object | null} configData
+ * @param {NodeJS.ProcessEnv} [env]
+ */
+export function resolveWorkspaceWatchEnabled(configData, env = process.env) {
+  const value = env.MINIPHI_WATCH_WORKSPACE ?? configData?.workspace?.watch;
+  if (typeof value === "boolean") {
+    return value;
+  }
+  return typeof value === "string" && ["1", "true", "yes", "on", "enabled"].includes(value.trim().toLowerCase());
+}
+
+/**
+ * Starts a watcher on the shared workspace index of `root`.
+ * @param {string} root
+ * @param {ConstructorParameters<typeof WorkspaceWatcher>[1]} [options]
+ */
+export async function startWorkspaceWatcher(root, options = undefined) {
+  return new WorkspaceWatcher(root, options).start();
+}
@@ -9,6 +9,7 @@ import ProgressPane from "./components/progress-pane.js";
 import PermissionModal from "./components/permission-modal.js";
 import BenchmarkDashboard from "./components/benchmark-dashboard.js";
 import { buildUiModelSelection } from "./model-selection.js";
+import PathFilterIndex from "./path-filter-index.js";
 
 function describePayloadAction(action) {
   if (!action || typeof action !== "object") return "action";
@@ -131,7 +132,11 @@ export default function App({
         benchmarkIndex=${benchmarks}
         running=${benchmarkRunning}
         status=${benchmarkStatus}
-        onStart=${() => setPhase(files.length ? "picker" : "prompt")}
+        onStart=${() => {
+          // A still-streaming scan may not have found anything yet; show the picker anyway.
+          const pickable = files instanceof PathFilterIndex ? files.size > 0 || !files.complete : files.length > 0;
+          setPhase(pickable ? "picker" : "prompt");
+        }}
         onRunEasy=${async () => {
           if (!runEasyBenchmark || benchmarkRunning) return;
           setBenchmarkRunning(true);
@@ -1,26 +1,57 @@
 import { useInput } from "ink";
-import { html, Box, Text, useState, useMemo } from "../ink-elements.js";
+import { html, Box, Text, useState, useMemo, useEffect } from "../ink-elements.js";
+import PathFilterIndex from "../path-filter-index.js";
 
 const VISIBLE_ROWS = 12;
+// Streamed batches arrive far faster than a terminal can usefully repaint.
+const REFRESH_INTERVAL_MS = 100;
 
 /**
  * Fuzzy-filterable multi-select file list. All key handling lives in one
  * `useInput` (typing filters, ↑/↓ move, Space toggles, Enter confirms, Esc
  * skips) so there is no ambiguity between typing and navigation. Calls
  * `onSubmit(selected)` with repo-relative paths that seed the agent's context.
+ *
+ * `files` is an array or a PathFilterIndex that may still be filling from a
+ * streaming workspace scan. Filtering goes through the index, and only the
+ * visible window of matches is ever computed, so the list stays responsive
+ * on trees of hundreds of thousands of files.
  */
 export default function FilePicker({ files = [], onSubmit, onSkip }) {
   const [filter, setFilter] = useState("");
   const [cursor, setCursor] = useState(0);
   const [selected, setSelected] = useState(() => new Set());
+  const [version, setVersion] = useState(0);
 
-  const filtered = useMemo(() => {
-    const needle = filter.trim().toLowerCase();
-    if (!needle) return files;
-    return files.filter((f) => f.toLowerCase().includes(needle));
-  }, [files, filter]);
+  const index = useMemo(
+    () => (files instanceof PathFilterIndex ? files : PathFilterIndex.from(files)),
+    [files],
+  );
+  useEffect(() => {
+    let timer = null;
+    const onChange = () => {
+      if (!timer) {
+        timer = setTimeout(() => {
+          timer = null;
+          setVersion((value) => value + 1);
+        }, REFRESH_INTERVAL_MS);
+      }
+    };
+    index.on("change", onChange);
+    return () => {
+      clearTimeout(timer);
+      index.off("change", onChange);
+    };
+  }, [index]);
 
-  const safeCursor = Math.min(cursor, Math.max(filtered.length - 1, 0));
+  // `version` re-resolves the query after `replace` swapped in the final list.
+  const result = useMemo(() => index.filter(filter), [index, filter, version]);
+  const matchAt = (position) => (result ? result.at(position) : index.paths[position]);
+  // How many of the first `count` rows exist (fewer near the end of the list so far).
+  const knownUpTo = (count) => (result ? result.ensure(count) : Math.min(count, index.size));
+
+  const lastKnown = Math.max(knownUpTo(cursor + 1) - 1, 0);
+  const safeCursor = Math.min(cursor, lastKnown);
 
   useInput((input, key) => {
     if (key.escape) {
@@ -32,7 +63,7 @@ export default function FilePicker({ files = [], onSubmit, onSkip }) {
       return;
     }
     if (key.downArrow) {
-      setCursor((c) => Math.min(c + 1, Math.max(filtered.length - 1, 0)));
+      setCursor((c) => Math.min(c + 1, Math.max(knownUpTo(c + 2) - 1, 0)));
       return;
     }
     if (key.upArrow) {
@@ -40,7 +71,7 @@ export default function FilePicker({ files = [], onSubmit, onSkip }) {
       return;
     }
     if (input === " ") {
-      const target = filtered[safeCursor];
+      const target = matchAt(safeCursor);
       if (target) {
         setSelected((prev) => {
           const next = new Set(prev);
@@ -62,11 +93,18 @@ export default function FilePicker({ files = [], onSubmit, onSkip }) {
     }
   });
 
-  const start = Math.max(
-    0,
-    Math.min(safeCursor - Math.floor(VISIBLE_ROWS / 2), Math.max(filtered.length - VISIBLE_ROWS, 0)),
-  );
-  const windowRows = filtered.slice(start, start + VISIBLE_ROWS);
+  // Virtualized: only the rows in view are looked up, never the full match list.
+  const start = Math.max(0, safeCursor - Math.floor(VISIBLE_ROWS / 2));
+  const known = knownUpTo(start + VISIBLE_ROWS);
+  const windowRows = [];
+  for (let position = Math.max(0, Math.min(start, known - VISIBLE_ROWS)); position < known; position += 1) {
+    windowRows.push({ position, file: matchAt(position) });
+  }
+  // An unfinished filter only knows a lower bound; it is not scanned further just to count.
+  const counted = result
+    ? `${result.indices.length}${result.exhausted ? "" : "+"} matching`
+    : `${index.size} files`;
+  const scanning = index.complete ? "" : ", scanning…";
 
   return html`
     <${Box} flexDirection="column">
@@ -75,18 +113,19 @@ export default function FilePicker({ files = [], onSubmit, onSkip }) {
         <${Text}>${filter || ""}</${Text}><${Text} dimColor>▏</${Text}>
       </${Box}>
       <${Box} flexDirection="column" marginTop=${1}>
-        ${windowRows.map((file, i) => {
-          const idx = start + i;
-          const isCursor = idx === safeCursor;
+        ${windowRows.map(({ position, file }) => {
+          const isCursor = position === safeCursor;
           const isSelected = selected.has(file);
           return html`<${Text} key=${file} color=${isCursor ? "cyan" : undefined} inverse=${isCursor}>${
             isSelected ? "◉" : "◯"
           } ${file}</${Text}>`;
         })}
-        ${filtered.length === 0 ? html`<${Text} dimColor>no matching files</${Text}>` : null}
+        ${known === 0
+          ? html`<${Text} dimColor>${index.complete ? "no matching files" : "scanning workspace…"}</${Text}>`
+          : null}
       </${Box}>
       <${Box} marginTop=${1}>
-        <${Text} dimColor>${selected.size} selected · ↑/↓ move · Space toggle · Enter confirm · Esc skip</${Text}>
+        <${Text} dimColor>${counted}${scanning} · ${selected.size} selected · ↑/↓ move · Space toggle · Enter confirm · Esc skip</${Text}>
       </${Box}>
     </${Box}>
   `;
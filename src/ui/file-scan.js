@@ -1,46 +1,67 @@
-import fs from "fs/promises";
 import path from "path";
+import WorkspaceIndex, { getWorkspaceIndex } from "../libs/workspace-index.js";
 
 // Directories that are agent/VCS/build state, not editable sources. Mirrors the
 // skip set used by the plan executor's search walk.
 const SKIP_DIRS = new Set(["node_modules", ".git", ".miniphi", "dist", "build", "coverage"]);
 const DEFAULT_MAX_FILES = 2000;
 
+const skipDir = (name) => name.startsWith(".") || SKIP_DIRS.has(name);
+
+function pickerIndex(root) {
+  const shared = getWorkspaceIndex(root);
+  return shared.canServe(skipDir) ? shared : new WorkspaceIndex(root, { ignoredDirs: SKIP_DIRS, indexFile: null });
+}
+
+/** Whether a file lies under a directory the picker skips (a stricter index may still list it). */
+const underSkippedDir = (relative) => {
+  const segments = relative.split("/");
+  for (let index = 0; index < segments.length - 1; index += 1) {
+    if (skipDir(segments[index])) {
+      return true;
+    }
+  }
+  return false;
+};
+
 /**
- * Bounded recursive scan of a workspace, returning repo-relative POSIX file
- * paths for the interactive file picker. Skips dot-directories and known build
- * output so the list stays to actual sources.
+ * Bounded scan of a workspace, returning repo-relative POSIX file paths for
+ * the interactive file picker. Skips dot-directories and known build output
+ * so the list stays to actual sources. Reads the shared workspace index, so
+ * the picker does not walk a tree the rest of the run already walked.
  */
 export async function scanWorkspaceFiles(cwd, { maxFiles = DEFAULT_MAX_FILES } = {}) {
-  const root = path.resolve(cwd);
+  const index = pickerIndex(path.resolve(cwd));
+  await index.ensureFresh();
   const files = [];
-  const walk = async (dir) => {
+  for (const entry of index.walkFiles({ skipDir })) {
     if (files.length >= maxFiles) {
-      return;
-    }
-    let entries;
-    try {
-      entries = await fs.readdir(dir, { withFileTypes: true });
-    } catch {
-      return;
-    }
-    for (const entry of entries) {
-      if (files.length >= maxFiles) {
-        return;
-      }
-      if (entry.isDirectory()) {
-        if (!entry.name.startsWith(".") && !SKIP_DIRS.has(entry.name)) {
-          await walk(path.join(dir, entry.name));
-        }
-        continue;
-      }
-      if (entry.isFile()) {
-        const rel = path.relative(root, path.join(dir, entry.name)).split(path.sep).join("/");
-        files.push(rel);
-      }
+      break;
     }
-  };
-  await walk(root);
+    files.push(entry.path);
+  }
+  files.sort();
+  return files;
+}
+
+/**
+ * Unbounded scan for the streaming file picker. `onFiles` receives batches
+ * of paths as a cold or stale index walk discovers them (in discovery order,
+ * possibly none when the index is already fresh); the promise resolves with
+ * the complete sorted list, which supersedes the streamed batches.
+ * @param {string} cwd
+ * @param {{ onFiles?: (paths: string[]) => void }} [options]
+ * @returns {Promise<string[]>}
+ */
+export async function streamWorkspaceFiles(cwd, { onFiles = null } = {}) {
+  const index = pickerIndex(path.resolve(cwd));
+  await index.ensureFresh({
+    onFiles: onFiles ? (batch) => onFiles(batch.filter((relative) => !underSkippedDir(relative))) : undefined,
+  });
+  const files = [];
+  for (const entry of index.walkFiles({ skipDir })) {
+    files.push(entry.path);
+  }
   files.sort();
   return files;
 }
@@ -3,7 +3,8 @@ import { html } from "./html.js";
 import App from "./app.js";
 import AgentSession from "../agent/agent-session.js";
 import { createUiApprover } from "../agent/approvers.js";
-import { scanWorkspaceFiles } from "./file-scan.js";
+import { streamWorkspaceFiles } from "./file-scan.js";
+import PathFilterIndex from "./path-filter-index.js";
 import WebResearcher from "../libs/web-researcher.js";
 import {
   ModelBenchmarkRunner,
@@ -18,6 +19,7 @@ import {
   createKnowledgeLookupAction,
 } from "../libs/cheetah-knowledge-client.js";
 import { createLocalContextMemory } from "../libs/local-context-memory.js";
+import { resolveWorkspaceWatchEnabled, startWorkspaceWatcher } from "../libs/workspace-watcher.js";
 
 /**
  * Boots the interactive MiniPhi agent UI. Dynamically imported from the CLI so
@@ -40,6 +42,8 @@ import { createLocalContextMemory } from "../libs/local-context-memory.js";
  * @param {string} [options.requestedModel] Config/CLI model request (`auto` or an id).
  * @param {string} [options.reasoningProfile] Initial reasoning profile.
  * @param {object} [options.configData] Loaded config.json, used to resolve optional capabilities (e.g. knowledge_lookup).
+ * @param {boolean} [options.watchWorkspace] Keep the workspace indexes live from filesystem events
+ *   (defaults to MINIPHI_WATCH_WORKSPACE / config `workspace.watch`).
  * @returns {Promise<object>} the finished session result.
  */
 export async function launchAgentUi(options = undefined) {
@@ -61,9 +65,15 @@ export async function launchAgentUi(options = undefined) {
     requestedModel = "auto",
     reasoningProfile = "high",
     configData = null,
+    watchWorkspace = resolveWorkspaceWatchEnabled(configData),
   } = options ?? {};
 
-  const files = await scanWorkspaceFiles(cwd);
+  // The picker renders immediately and fills as the scan streams in; the
+  // sorted final list replaces the discovery-order batches.
+  const files = new PathFilterIndex();
+  streamWorkspaceFiles(cwd, { onFiles: (batch) => files.add(batch) })
+    .then((all) => files.replace(all), () => {})
+    .finally(() => files.finish());
   const benchmarkIndex = await loadFreshModelBenchmarkIndex({
     cwd,
     restClient: client,
@@ -119,13 +129,19 @@ export async function launchAgentUi(options = undefined) {
         configData,
         sessionId: null,
         projectId: configData?.context?.cheetah?.projectId ?? null,
+        embeddingClient: client,
       }).catch(() => null)
     : null;
+  // A watch that cannot start (e.g. inotify limits) only costs the live
+  // updates; the indexes keep refreshing on their own schedule.
+  const workspaceWatcher = watchWorkspace ? await startWorkspaceWatcher(cwd).catch(() => null) : null;
+  workspaceWatcher?.on("error", () => {});
   const session = new AgentSession({
     client,
     cwd,
     baseDir,
     localMemory,
+    workspaceWatcher,
     runCommand,
     webResearch:
       webResearch ??
@@ -163,6 +179,10 @@ export async function launchAgentUi(options = undefined) {
       initialReasoningProfile=${reasoningProfile}
     />`,
   );
-  await app.waitUntilExit();
+  try {
+    await app.waitUntilExit();
+  } finally {
+    workspaceWatcher?.stop();
+  }
   return session;
 }
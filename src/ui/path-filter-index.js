@@ -0,0 +1,218 @@
+import { EventEmitter } from "events";
+
+const MAX_CACHED_QUERIES = 16;
+
+/**
+ * One bit per character class a path contains: a-z, any digit, `.`, `/`,
+ * `-`/`_`, anything else. A path can only contain the needle if it has every
+ * class the needle has, so one integer AND rules out most of a large tree
+ * before any string is compared.
+ */
+function charClassMask(text) {
+  let mask = 0;
+  for (let index = 0; index < text.length; index += 1) {
+    const code = text.charCodeAt(index);
+    let bit;
+    if (code >= 97 && code <= 122) {
+      bit = code - 97;
+    } else if (code >= 48 && code <= 57) {
+      bit = 26;
+    } else if (code === 46) {
+      bit = 27;
+    } else if (code === 47) {
+      bit = 28;
+    } else if (code === 45 || code === 95) {
+      bit = 29;
+    } else {
+      bit = 30;
+    }
+    mask |= 1 << bit;
+  }
+  return mask;
+}
+
+/**
+ * Matches of one query, found lazily: `ensure(count)` scans only until
+ * `count` matches are known, so a picker showing twelve rows of a query that
+ * matches most of a 500k-path tree compares a few dozen paths, not all of
+ * them. The source is either the whole path list or the matches of a shorter
+ * query this one contains (typing narrows); both may still grow.
+ */
+class PathFilterResult {
+  constructor(owner, needle, parent) {
+    this.owner = owner;
+    this.needle = needle;
+    this.need = charClassMask(needle);
+    this.parent = parent;
+    /** Positions in `owner.paths`, and the paths themselves, in list order. */
+    this.indices = [];
+    this.matches = [];
+    // Next position in the source: an index into `parent.indices`, or into `owner.paths`.
+    this.position = 0;
+  }
+
+  /** Whether every match of the list as it is now has been found. */
+  get exhausted() {
+    return this.parent
+      ? this.parent.exhausted && this.position >= this.parent.indices.length
+      : this.position >= this.owner.paths.length;
+  }
+
+  /** Scans until `count` matches are known or the source runs out; returns the number known. */
+  ensure(count) {
+    const { needle, need, owner } = this;
+    const masks = owner._masks;
+    const lower = owner._lower;
+    while (this.indices.length < count) {
+      let candidate;
+      if (this.parent) {
+        if (this.position >= this.parent.indices.length) {
+          // Pull a bounded step of parent matches: enough to make progress, not the whole rest.
+          if (this.parent.ensure(this.position + Math.max(count - this.indices.length, 64)) <= this.position) {
+            break;
+          }
+        }
+        candidate = this.parent.indices[this.position];
+      } else {
+        if (this.position >= owner.paths.length) {
+          break;
+        }
+        candidate = this.position;
+      }
+      this.position += 1;
+      if ((masks[candidate] & need) === need && lower[candidate].includes(needle)) {
+        this.indices.push(candidate);
+        this.matches.push(owner.paths[candidate]);
+      }
+    }
+    return this.indices.length;
+  }
+
+  /** The `index`-th match, or undefined. */
+  at(index) {
+    this.ensure(index + 1);
+    return this.matches[index];
+  }
+
+  /** Every match (a full scan). */
+  all() {
+    this.ensure(Number.MAX_SAFE_INTEGER);
+    return this.matches;
+  }
+}
+
+/**
+ * The file picker's path list: grows while the workspace scan streams in and
+ * answers case-insensitive substring filters without re-scanning every path
+ * on each keystroke.
+ *
+ * - Lower-cased paths and their character-class masks are computed once, on
+ *   `add`; a filter compares strings only for paths that pass the mask test.
+ * - `filter` returns a lazy PathFilterResult, cached per query. A longer
+ *   query reads the matches of the narrowest cached query it contains, and
+ *   backspacing returns the cached result. Results pick up paths added later,
+ *   so streaming does not invalidate them.
+ * - Emits `change` after each `add`/`replace`/`finish`; `complete` is set once
+ *   the scan has finished.
+ */
+export default class PathFilterIndex extends EventEmitter {
+  /** @param {string[]} [paths] */
+  constructor(paths = []) {
+    super();
+    this.complete = false;
+    this._reset();
+    this._append(paths);
+  }
+
+  /** A finished index over a fixed list. */
+  static from(paths) {
+    const index = new PathFilterIndex(paths);
+    index.complete = true;
+    return index;
+  }
+
+  get size() {
+    return this.paths.length;
+  }
+
+  _reset() {
+    this.paths = [];
+    this._lower = [];
+    this._masks = new Int32Array(1024);
+    this._known = new Set();
+    /** @type {Map<string, PathFilterResult>} needle -> result, least recently used first */
+    this._cache = new Map();
+  }
+
+  _append(paths) {
+    const first = this.paths.length;
+    for (const file of paths) {
+      if (this._known.has(file)) {
+        continue;
+      }
+      this._known.add(file);
+      const lower = file.toLowerCase();
+      if (this.paths.length === this._masks.length) {
+        const grown = new Int32Array(this._masks.length * 2);
+        grown.set(this._masks);
+        this._masks = grown;
+      }
+      this._masks[this.paths.length] = charClassMask(lower);
+      this.paths.push(file);
+      this._lower.push(lower);
+    }
+    return this.paths.length - first;
+  }
+
+  /** Adds newly discovered paths (duplicates are ignored). */
+  add(paths) {
+    if (this._append(paths)) {
+      this.emit("change");
+    }
+  }
+
+  /** Swaps in the final list, e.g. the sorted scan result. Earlier results are dropped. */
+  replace(paths) {
+    this._reset();
+    this._append(paths);
+    this.emit("change");
+  }
+
+  finish() {
+    this.complete = true;
+    this.emit("change");
+  }
+
+  /**
+   * Paths containing `query` (trimmed, case-insensitive), in list order, or
+   * null for an empty query (every path, i.e. `paths`).
+   * @param {string} query
+   * @returns {PathFilterResult | null}
+   */
+  filter(query) {
+    const needle = String(query ?? "").trim().toLowerCase();
+    if (!needle) {
+      return null;
+    }
+    const cached = this._cache.get(needle);
+    if (cached) {
+      this._cache.delete(needle);
+      this._cache.set(needle, cached);
+      return cached;
+    }
+    let parent = null;
+    for (const [cachedNeedle, result] of this._cache) {
+      // A parent that has not found many matches yet may still be a poor filter; prefer the longest needle.
+      if (needle.includes(cachedNeedle) && (!parent || cachedNeedle.length > parent.needle.length)) {
+        parent = result;
+      }
+    }
+    const result = new PathFilterResult(this, needle, parent);
+    this._cache.set(needle, result);
+    if (this._cache.size > MAX_CACHED_QUERIES) {
+      // Evicted results stay valid for the children that read them.
+      this._cache.delete(this._cache.keys().next().value);
+    }
+    return result;
+  }
+}
@@ -17,6 +17,7 @@ import {
 test("classifyActionType buckets actions for the session loop", () => {
   assert.equal(classifyActionType("read_file"), "readonly");
   assert.equal(classifyActionType("search_text"), "readonly");
+  assert.equal(classifyActionType("read_symbol"), "readonly");
   assert.equal(classifyActionType("web_research"), "research");
   assert.equal(classifyActionType("visual_review"), "visual");
   assert.equal(classifyActionType("knowledge_lookup"), "knowledge");
@@ -35,6 +36,8 @@ test("normalizeAgentAction rejects unsafe paths and malformed actions", () => {
   );
   assert.equal(normalizeAgentAction({ type: "bogus", reason: "x" }, cwd).ok, false);
   assert.equal(normalizeAgentAction({ type: "search_text", term: "  ", reason: "x" }, cwd).ok, false);
+  assert.equal(normalizeAgentAction({ type: "read_symbol", symbol: "", reason: "x" }, cwd).ok, false);
+  assert.equal(normalizeAgentAction({ type: "read_symbol", symbol: "f", path: "../x.c", reason: "x" }, cwd).ok, false);
   assert.equal(normalizeAgentAction({ type: "run_cmd", command: "", reason: "x" }, cwd).ok, false);
   assert.equal(normalizeAgentAction({ type: "web_research", query: "", reason: "x" }, cwd).ok, false);
   assert.equal(
@@ -357,6 +360,46 @@ test("executeReadonly reads files and searches text", async () => {
   }
 });
 
+test("executeReadonly read_symbol returns one definition instead of the whole file", async () => {
+  const workspace = await createTempWorkspace();
+  try {
+    await fs.mkdir(path.join(workspace, "src"), { recursive: true });
+    const filler = Array.from({ length: 200 }, (_, index) => `int filler_${index} (void) { return ${index}; }`).join("\n");
+    await fs.writeFile(
+      path.join(workspace, "src", "execute_cmd.c"),
+      `${filler}\nint\nexecute_command_internal (COMMAND *command)\n{\n  return run (command);\n}\n${filler.replace(/filler/g, "tail")}\n`,
+      "utf8",
+    );
+    await fs.writeFile(
+      path.join(workspace, "src", "session.js"),
+      "export class Session {\n  constructor() {\n    this.turns = [];\n  }\n\n  async submit(task) {\n    return this.turns.push(task);\n  }\n}\n",
+      "utf8",
+    );
+    await fs.writeFile(path.join(workspace, "src", "other.js"), "export function submit() {\n  return 0;\n}\n", "utf8");
+
+    const action = normalizeAgentAction({ type: "read_symbol", symbol: "execute_command_internal", reason: "x" }, workspace).action;
+    assert.equal(describeAction(action), "read_symbol execute_command_internal");
+    const native = await executeReadonly({ action, cwd: workspace, maxOutputChars: 6000 });
+    assert.equal(
+      native,
+      "src/execute_cmd.c:201-205 function execute_command_internal\nint\nexecute_command_internal (COMMAND *command)\n{\n  return run (command);\n}",
+    );
+
+    const method = await executeReadonly({ action: { type: "read_symbol", symbol: "Session.submit" }, cwd: workspace });
+    assert.equal(method, "src/session.js:6-8 method Session.submit\n  async submit(task) {\n    return this.turns.push(task);\n  }");
+    const ambiguous = await executeReadonly({ action: { type: "read_symbol", symbol: "submit" }, cwd: workspace });
+    assert.match(ambiguous, /^src\/other\.js:1-3 function submit \(also defined at src\/session\.js:6; pass path to pick one\)\n/);
+    const scoped = normalizeAgentAction({ type: "read_symbol", symbol: "submit", path: "src/session.js", reason: "x" }, workspace);
+    assert.equal(scoped.action.path, "src/session.js");
+    assert.match(await executeReadonly({ action: scoped.action, cwd: workspace }), /^src\/session\.js:6-8 method Session\.submit\n/);
+
+    const missing = await executeReadonly({ action: { type: "read_symbol", symbol: "nowhere" }, cwd: workspace });
+    assert.match(missing, /^no definition of "nowhere" found in 0 candidate source file\(s\); try search_text$/);
+  } finally {
+    await removeTempWorkspace(workspace);
+  }
+});
+
 test("hashText is stable and matches file-edit-guard hashing", () => {
   assert.equal(hashText("abc"), hashText("abc"));
   assert.notEqual(hashText("abc"), hashText("abd"));
@@ -373,6 +416,7 @@ test("agent-action schema accepts a valid turn and rejects malformed ones", () =
       { type: "web_research", query: "JavaScript animation libraries", max_results: 3, reason: "compare options" },
       { type: "visual_review", path: "index.html", focus: "does the ball look round", reason: "check rendered quality" },
       { type: "knowledge_lookup", subject: "Springfield", reason: "check recorded facts before asserting one" },
+      { type: "read_symbol", symbol: "slugify", path: "src/index.js", reason: "read one definition" },
       { type: "write_file", path: "src/slug.js", content: "export const slug = () => {};\n", reason: "add helper", danger: "low" },
     ],
     needs_more_context: false,
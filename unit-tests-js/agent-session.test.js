@@ -1,5 +1,7 @@
 import test from "node:test";
+import { EventEmitter } from "node:events";
 import assert from "node:assert/strict";
+import { writeFileSync } from "node:fs";
 import fs from "node:fs/promises";
 import path from "node:path";
 import { createTempWorkspace, removeTempWorkspace } from "./cli-test-utils.js";
@@ -146,6 +148,55 @@ test("AgentSession replaces stale file context with the guarded post-edit source
   }
 });
 
+test("AgentSession retires context for files changed outside the session", async () => {
+  const workspace = await createTempWorkspace();
+  try {
+    await fs.mkdir(path.join(workspace, "src"), { recursive: true });
+    await fs.writeFile(path.join(workspace, "src", "a.js"), "export const a = 1;\n", "utf8");
+    // Stands in for a WorkspaceWatcher: the session only needs root, flush and `change`.
+    const watcher = new EventEmitter();
+    watcher.root = workspace;
+    watcher.flush = async () => {};
+    const client = scriptedClient([
+      turn([{ type: "read_file", path: "src/a.js", reason: "inspect" }]),
+      turn([
+        { type: "write_file", path: "src/b.js", content: "export const b = 2;\n", reason: "add", danger: "low" },
+      ]),
+      turn([{ type: "finish", reason: "done" }]),
+    ]);
+    const session = new AgentSession({
+      client,
+      cwd: workspace,
+      baseDir: null,
+      approver: createHeadlessApprover({ policy: "allow" }),
+      workspaceWatcher: watcher,
+    });
+    const external = [];
+    session.on("external-change", (entry) => external.push(entry));
+    session.on("action-result", (entry) => {
+      if (entry.action?.type === "read_file") {
+        writeFileSync(path.join(workspace, "src", "a.js"), "export const a = 'edited elsewhere';\n", "utf8");
+        watcher.emit("change", { changed: ["src/a.js"], removed: [] });
+      } else if (entry.status === "written") {
+        // The watcher's echo of the session's own write.
+        watcher.emit("change", { changed: ["src/b.js"], removed: [] });
+      }
+    });
+
+    const result = await session.submitTask("Add b");
+
+    assert.equal(result.status, "completed");
+    assert.deepEqual(external, [{ turn: 2, paths: ["src/a.js (changed)"] }]);
+    assert.match(client.calls[1][1].content, /Changed outside this session since you read them: src\/a\.js/);
+    assert.equal([...session.context.nodes.values()].filter((node) => node.label === "external changes").length, 1);
+    const reads = [...session.context.nodes.values()].filter((node) => node.label === "read_file src/a.js");
+    assert.deepEqual(reads.map((node) => node.state), ["dropped"]);
+    assert.equal(watcher.listenerCount("change"), 0);
+  } finally {
+    await removeTempWorkspace(workspace);
+  }
+});
+
 test("AgentSession forwards corrective-feedback TTLs into the context graph", () => {
   const session = new AgentSession({
     client: scriptedClient([]),
@@ -3,6 +3,7 @@ import assert from "node:assert/strict";
 import { render } from "ink-testing-library";
 import { html } from "../src/ui/html.js";
 import FilePicker from "../src/ui/components/file-picker.js";
+import PathFilterIndex from "../src/ui/path-filter-index.js";
 import PermissionModal from "../src/ui/components/permission-modal.js";
 import ProgressPane from "../src/ui/components/progress-pane.js";
 
@@ -38,6 +39,32 @@ test("FilePicker filters, toggles, and submits the selection", async () => {
   app.unmount();
 });
 
+test("FilePicker renders a streaming index and only the visible rows", async () => {
+  const files = new PathFilterIndex();
+  const app = render(html`<${FilePicker} files=${files} />`);
+  await delay();
+  assert.match(app.lastFrame(), /scanning workspace/);
+
+  files.add(Array.from({ length: 5000 }, (_, n) => `src/file${String(n).padStart(4, "0")}.js`));
+  await delay(150);
+  let frame = app.lastFrame();
+  assert.match(frame, /src\/file0000\.js/);
+  assert.doesNotMatch(frame, /src\/file0100\.js/);
+  assert.match(frame, /5000 files, scanning/);
+
+  app.stdin.write("file49");
+  await delay();
+  frame = app.lastFrame();
+  assert.match(frame, /src\/file4900\.js/);
+  assert.doesNotMatch(frame, /src\/file0000\.js/);
+  assert.match(frame, /\d+\+? matching/);
+
+  files.finish();
+  await delay(150);
+  assert.doesNotMatch(app.lastFrame(), /scanning/);
+  app.unmount();
+});
+
 test("PermissionModal renders the diff and returns an approve-once decision", async () => {
   let decision = null;
   const app = render(
@@ -0,0 +1,94 @@
+import test from "node:test";
+import assert from "node:assert/strict";
+import fs from "node:fs/promises";
+import path from "node:path";
+import BlobStore, { getBlobStore, isBlobRef } from "../src/libs/blob-store.js";
+import { writeFileWithGuard } from "../src/libs/file-edit-guard.js";
+import PromptRecorder from "../src/libs/prompt-recorder.js";
+import { createTempWorkspace } from "./cli-test-utils.js";
+
+const listBlobs = async (baseDir) => {
+  const found = [];
+  const blobsDir = path.join(baseDir, "blobs");
+  for (const shard of await fs.readdir(blobsDir).catch(() => [])) {
+    found.push(...(await fs.readdir(path.join(blobsDir, shard))));
+  }
+  return found;
+};
+
+test("BlobStore stores each distinct text once, compressed, and round-trips it", async () => {
+  const root = await createTempWorkspace("miniphi-blobs-");
+  try {
+    const store = new BlobStore(root, { minBytes: 64 });
+    const systemPrompt = "You are MiniPhi. Reply with JSON only. ".repeat(200);
+    const exchanges = await Promise.all(
+      Array.from({ length: 5 }, (_, index) =>
+        store.externalize({ messages: [{ role: "system", content: systemPrompt }, { role: "user", content: `q${index}` }] }),
+      ),
+    );
+    assert.ok(isBlobRef(exchanges[0].messages[0].content));
+    assert.equal(exchanges[0].messages[1].content, "q0");
+    assert.equal((await listBlobs(root)).length, 1);
+    assert.equal(store.stats.written, 1);
+    assert.ok(store.stats.bytesWritten < systemPrompt.length / 10);
+
+    // A fresh store (another process) finds the blob instead of rewriting it.
+    const again = new BlobStore(root, { minBytes: 64 });
+    const ref = await again.put(systemPrompt);
+    assert.equal(again.stats.written, 0);
+    assert.equal(await again.get(ref), systemPrompt);
+    assert.deepEqual(await again.internalize(exchanges[3]), {
+      messages: [{ role: "system", content: systemPrompt }, { role: "user", content: "q3" }],
+    });
+
+    const dangling = { $blob: `sha256:${"0".repeat(64)}`, bytes: 3 };
+    assert.deepEqual(await again.internalize({ text: dangling }), { text: dangling });
+  } finally {
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
+
+test("guarded writes keep rollbacks in the blob store and restore from them", async () => {
+  const root = await createTempWorkspace("miniphi-blobs-");
+  try {
+    const targetPath = path.join(root, "app.js");
+    const original = "export const answer = 41;\n";
+    await fs.writeFile(targetPath, original, "utf8");
+    const blobStore = new BlobStore(path.join(root, ".miniphi"));
+    const result = await writeFileWithGuard({
+      targetPath,
+      content: "export const answer = 42;\n",
+      blobStore,
+    });
+    assert.equal(result.status, "written");
+    assert.equal(result.rollbackPath, null);
+    assert.equal(await blobStore.get(result.rollbackBlob), original);
+  } finally {
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
+
+test("PromptRecorder references repeated prompt text by hash", async () => {
+  const root = await createTempWorkspace("miniphi-blobs-");
+  try {
+    const miniPhiRoot = path.join(root, ".miniphi");
+    const recorder = new PromptRecorder(miniPhiRoot);
+    const schemaBlock = JSON.stringify({ type: "object", properties: { plan: { type: "string" } } }).repeat(60);
+    const records = [];
+    for (let index = 0; index < 3; index += 1) {
+      records.push(
+        await recorder.record({
+          request: { messages: [{ role: "system", content: schemaBlock }, { role: "user", content: `step ${index}` }] },
+        }),
+      );
+    }
+    await recorder.flush();
+    const stored = await recorder.read(records[0].id);
+    assert.ok(isBlobRef(stored.request.messages[0].content));
+    assert.equal((await listBlobs(miniPhiRoot)).length, 1);
+    const expanded = await getBlobStore(miniPhiRoot).internalize(stored);
+    assert.equal(expanded.request.messages[0].content, schemaBlock);
+  } finally {
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
@@ -0,0 +1,188 @@
+import test from "node:test";
+import assert from "node:assert/strict";
+import fs from "node:fs/promises";
+import path from "node:path";
+import { randomBytes } from "node:crypto";
+import MiniPhiMemory from "../src/libs/miniphi-memory.js";
+import BlobStore from "../src/libs/blob-store.js";
+import PromptArchive from "../src/libs/prompt-archive.js";
+import { getJsonIndexStore } from "../src/libs/json-index-store.js";
+import { recordCacheAccess } from "../src/libs/cache-access.js";
+import { parseByteSize, resolveCacheGcPolicy, runCacheGc } from "../src/libs/cache-gc.js";
+import { ageTree, createTempWorkspace } from "./cli-test-utils.js";
+
+const DAY = 24 * 60 * 60 * 1000;
+const NOW = Date.now();
+
+async function makeWorkspace() {
+  const root = await createTempWorkspace("miniphi-gc-");
+  await fs.mkdir(path.join(root, ".miniphi"), { recursive: true });
+  const memory = new MiniPhiMemory(root);
+  await memory.prepare();
+  return { root, memory, baseDir: memory.baseDir };
+}
+
+async function cleanup(root) {
+  await getJsonIndexStore().close();
+  await fs.rm(root, { recursive: true, force: true });
+}
+
+/** Writes an execution folder of roughly `bytes` bytes last modified `ageDays` ago. */
+async function writeExecution(baseDir, id, { bytes = 1000, ageDays = 1, extra = "" } = {}) {
+  const dir = path.join(baseDir, "executions", id);
+  await fs.mkdir(dir, { recursive: true });
+  const file = path.join(dir, "index.json");
+  await fs.writeFile(file, JSON.stringify({ id, extra, pad: "x".repeat(bytes) }), "utf8");
+  const at = new Date(NOW - ageDays * DAY);
+  await fs.utimes(file, at, at);
+  return file;
+}
+
+const exists = (target) =>
+  fs.access(target).then(
+    () => true,
+    () => false,
+  );
+
+test("parseByteSize and resolveCacheGcPolicy read human sizes and category names", () => {
+  assert.equal(parseByteSize("500MB"), 500 * 1024 ** 2);
+  assert.equal(parseByteSize("1.5g"), 1.5 * 1024 ** 3);
+  assert.equal(parseByteSize("2GiB"), 2 * 1024 ** 3);
+  assert.equal(parseByteSize(4096), 4096);
+  assert.equal(parseByteSize("lots"), null);
+  const policy = resolveCacheGcPolicy(
+    { maxBytes: "1GB", quotas: { promptArchive: "100MB", bogus: "1MB" }, gcIntervalMinutes: 1 },
+    { quotas: { executions: "10k" } },
+  );
+  assert.equal(policy.maxBytes, 1024 ** 3);
+  assert.deepEqual(policy.quotas, { "prompt-archive": 100 * 1024 ** 2, executions: 10 * 1024 });
+  assert.equal(policy.intervalMs, 60_000);
+  assert.equal(policy.auto, true);
+  assert.equal(resolveCacheGcPolicy({}).auto, false);
+  assert.equal(resolveCacheGcPolicy({ maxBytes: "1GB", autoGc: false }).auto, false);
+});
+
+test("runCacheGc evicts least-recently-used executions past a quota and fixes the index", async () => {
+  const { root, memory, baseDir } = await makeWorkspace();
+  try {
+    await writeExecution(baseDir, "exec-old-read", { ageDays: 9 });
+    await writeExecution(baseDir, "exec-old", { ageDays: 8 });
+    await writeExecution(baseDir, "exec-mid", { ageDays: 4 });
+    await writeExecution(baseDir, "exec-new", { ageDays: 1 });
+    const entries = ["exec-new", "exec-mid", "exec-old", "exec-old-read"].map((id) => ({
+      id,
+      path: `executions/${id}/index.json`,
+    }));
+    await fs.writeFile(
+      memory.executionsIndexFile,
+      JSON.stringify({ entries, byTask: { t: { executions: entries.map((e) => e.id) } }, latest: entries[0] }),
+      "utf8",
+    );
+    // Oldest on disk, but read yesterday: it must outlive exec-old and exec-mid.
+    recordCacheAccess(baseDir, path.join(baseDir, "executions", "exec-old-read", "index.json"), NOW - DAY / 2);
+    await getJsonIndexStore().flush();
+
+    const policy = resolveCacheGcPolicy({ quotas: { executions: 2500 } });
+    const dry = await runCacheGc(memory, { policy, dryRun: true });
+    assert.deepEqual(
+      dry.evicted.map((entry) => entry.key),
+      ["executions/exec-old", "executions/exec-mid"],
+    );
+    assert.ok(await exists(path.join(baseDir, "executions", "exec-old")));
+
+    const result = await runCacheGc(memory, { policy });
+    assert.equal(result.evicted.length, 2);
+    assert.deepEqual(result.overBudget, []);
+    assert.ok(result.after.categories.executions.bytes <= 2500);
+    assert.equal(await exists(path.join(baseDir, "executions", "exec-old")), false);
+    assert.equal(await exists(path.join(baseDir, "executions", "exec-mid")), false);
+    assert.ok(await exists(path.join(baseDir, "executions", "exec-old-read")));
+    const index = await getJsonIndexStore().read(memory.executionsIndexFile);
+    assert.deepEqual(
+      index.entries.map((entry) => entry.id),
+      ["exec-new", "exec-old-read"],
+    );
+    assert.deepEqual(index.byTask.t.executions, ["exec-new", "exec-old-read"]);
+    assert.equal(result.droppedIndexEntries, 2);
+  } finally {
+    await cleanup(root);
+  }
+});
+
+test("runCacheGc frees a shared blob only with its last referrer and keeps pinned blobs", async () => {
+  const { root, memory, baseDir } = await makeWorkspace();
+  try {
+    const blobs = new BlobStore(baseDir, { minBytes: 64 });
+    const shared = await blobs.put("shared system prompt ".repeat(400));
+    const pinned = await blobs.put("knowledge base text ".repeat(400));
+    const orphan = await blobs.put("nobody points here ".repeat(400));
+    await writeExecution(baseDir, "exec-a", { ageDays: 6, extra: shared });
+    await writeExecution(baseDir, "exec-b", { ageDays: 5, extra: shared });
+    await writeExecution(baseDir, "exec-c", { ageDays: 4, extra: pinned });
+    await fs.writeFile(memory.knowledgeFile, JSON.stringify({ note: { $blob: pinned } }), "utf8");
+    await ageTree(path.join(baseDir, "blobs"), 7 * DAY);
+
+    // Evicting only exec-a must keep the shared blob (exec-b still holds it).
+    let result = await runCacheGc(memory, {
+      policy: resolveCacheGcPolicy({ quotas: { executions: 2500 } }),
+    });
+    assert.deepEqual(result.evicted.map((entry) => entry.key), ["executions/exec-a"]);
+    assert.equal(result.removedBlobs, 1);
+    assert.ok(await exists(blobs.pathFor(shared)));
+    assert.equal(await exists(blobs.pathFor(orphan)), false);
+
+    result = await runCacheGc(memory, { policy: resolveCacheGcPolicy({ quotas: { executions: 0 } }) });
+    assert.deepEqual(
+      result.evicted.map((entry) => entry.key).sort(),
+      ["executions/exec-b", "executions/exec-c"],
+    );
+    assert.equal(await exists(blobs.pathFor(shared)), false);
+    assert.ok(await exists(blobs.pathFor(pinned)));
+  } finally {
+    await cleanup(root);
+  }
+});
+
+test("runCacheGc enforces the overall ceiling across categories, archive segments included", async () => {
+  const { root, memory, baseDir } = await makeWorkspace();
+  try {
+    const archive = new PromptArchive(memory.promptExchangesDir, { segmentMaxBytes: 1 });
+    await archive.append({ id: "ex-1", request: { messages: [{ role: "user", content: randomBytes(3000).toString("base64") }] } });
+    await archive.append({ id: "ex-2", request: { messages: [{ role: "user", content: "b" }] } });
+    await archive.close();
+    await ageTree(path.join(memory.promptExchangesDir, "archive"), 10 * DAY);
+    await writeExecution(baseDir, "exec-1", { ageDays: 2, bytes: 3000 });
+    const fresh = new PromptArchive(memory.promptExchangesDir);
+    const firstSegment = (await fresh.list()).find((row) => row.id === "ex-1").seg;
+
+    const before = await runCacheGc(memory, { policy: resolveCacheGcPolicy(), dryRun: true });
+    const ceiling = before.before.totalBytes - 200;
+    const result = await runCacheGc(memory, { policy: resolveCacheGcPolicy({ maxBytes: ceiling }) });
+    assert.equal(result.evicted[0].category, "prompt-archive");
+    assert.ok(result.after.totalBytes <= ceiling);
+    assert.ok(await exists(path.join(baseDir, "executions", "exec-1")));
+    const reread = new PromptArchive(memory.promptExchangesDir);
+    assert.equal(await reread.has("ex-1"), false);
+    assert.equal(await exists(reread.segmentPath(firstSegment)), false);
+  } finally {
+    await cleanup(root);
+  }
+});
+
+test("incremental runCacheGc is throttled and skips the reference scan when within budget", async () => {
+  const { root, memory, baseDir } = await makeWorkspace();
+  try {
+    await writeExecution(baseDir, "exec-1", { ageDays: 3 });
+    const policy = resolveCacheGcPolicy({ maxBytes: "1GB", gcIntervalMinutes: 10 });
+    const first = await runCacheGc(memory, { policy, incremental: true });
+    assert.equal(first.skipped, false);
+    assert.equal(first.referencesScanned, false);
+    assert.equal(first.evicted.length, 0);
+    const second = await runCacheGc(memory, { policy, incremental: true });
+    assert.equal(second.skipped, true);
+    const later = await runCacheGc(memory, { policy, incremental: true, now: NOW + 11 * 60 * 1000 });
+    assert.equal(later.skipped, false);
+  } finally {
+    await cleanup(root);
+  }
+});
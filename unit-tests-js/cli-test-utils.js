@@ -35,6 +35,18 @@ export async function removeTempWorkspace(root) {
   await fs.rm(root, { recursive: true, force: true });
 }
 
+/** Sets the mtime (and atime) of `target`, and of everything under it, to `ms` ago. */
+export async function ageTree(target, ms) {
+  const at = new Date(Date.now() - ms);
+  const stat = await fs.stat(target);
+  if (stat.isDirectory()) {
+    for (const name of await fs.readdir(target)) {
+      await ageTree(path.join(target, name), ms);
+    }
+  }
+  await fs.utimes(target, at, at);
+}
+
 export async function copySampleToWorkspace(sampleRelativePath, workspaceRoot) {
   const source = path.resolve(sampleRelativePath);
   const destination = path.join(workspaceRoot, sampleRelativePath);
@@ -0,0 +1,71 @@
+import test from "node:test";
+import assert from "node:assert/strict";
+import fs from "node:fs/promises";
+import path from "node:path";
+import { spawnSync } from "node:child_process";
+import { readLastCommits, resetLastCommitCache } from "../src/libs/git-last-commits.js";
+import { createTempWorkspace, removeTempWorkspace } from "./cli-test-utils.js";
+
+const GIT_ENV = {
+  ...process.env,
+  GIT_AUTHOR_NAME: "Test Author",
+  GIT_AUTHOR_EMAIL: "author@example.com",
+  GIT_COMMITTER_NAME: "Test Author",
+  GIT_COMMITTER_EMAIL: "author@example.com",
+};
+
+function git(cwd, ...args) {
+  const result = spawnSync("git", ["-C", cwd, ...args], { encoding: "utf8", env: GIT_ENV });
+  assert.equal(result.status, 0, result.stderr);
+  return result.stdout.trim();
+}
+
+function lastCommitOf(cwd, relative) {
+  const [hash, committedAt, author] = git(cwd, "log", "-1", "--pretty=format:%H|%cI|%cn", "--", relative).split("|");
+  return hash ? { hash, committedAt, author } : undefined;
+}
+
+test("one git log pass matches per-file git log -1 and is cached by HEAD", async (t) => {
+  if (spawnSync("git", ["--version"]).status !== 0) {
+    t.skip("git is not available");
+    return;
+  }
+  const root = await createTempWorkspace("miniphi-git-commits-");
+  try {
+    git(root, "init", "-q");
+    const dir = path.join(root, ".miniphi");
+    await fs.mkdir(path.join(dir, "notes"), { recursive: true });
+    await fs.writeFile(path.join(dir, "a.json"), "1");
+    await fs.writeFile(path.join(dir, "notes", "b c.md"), "1");
+    await fs.writeFile(path.join(root, "outside.txt"), "1");
+    git(root, "add", ".");
+    git(root, "commit", "-q", "-m", "first");
+    await fs.writeFile(path.join(dir, "a.json"), "2");
+    git(root, "commit", "-q", "-am", "second");
+    await fs.writeFile(path.join(dir, "untracked.txt"), "1");
+
+    const cacheFile = path.join(dir, "index", "git-last-commits.json");
+    resetLastCommitCache();
+    const first = await readLastCommits(dir, { cacheFile });
+    assert.equal(first.source, "git");
+    assert.deepEqual([...first.commits.keys()].sort(), ["a.json", "notes/b c.md"]);
+    for (const relative of ["a.json", "notes/b c.md", "untracked.txt"]) {
+      assert.deepEqual(first.commits.get(relative), lastCommitOf(dir, relative), relative);
+    }
+
+    assert.equal((await readLastCommits(dir, { cacheFile })).source, "memory");
+    resetLastCommitCache();
+    const reloaded = await readLastCommits(dir, { cacheFile });
+    assert.equal(reloaded.source, "disk");
+    assert.deepEqual(reloaded.commits, first.commits);
+
+    git(root, "add", ".");
+    git(root, "commit", "-q", "-m", "third");
+    const moved = await readLastCommits(dir, { cacheFile });
+    assert.equal(moved.source, "git");
+    assert.deepEqual(moved.commits.get("untracked.txt"), lastCommitOf(dir, "untracked.txt"));
+  } finally {
+    resetLastCommitCache();
+    await removeTempWorkspace(root);
+  }
+});
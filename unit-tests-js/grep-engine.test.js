@@ -0,0 +1,61 @@
+import test from "node:test";
+import assert from "node:assert/strict";
+import fs from "node:fs/promises";
+import path from "node:path";
+import { grepFiles, grepWorkspace } from "../src/libs/grep-engine.js";
+import { createGrepSpec, grepBuffer } from "../src/libs/grep-matcher.js";
+import { resetWorkspaceIndexes } from "../src/libs/workspace-index.js";
+import { createTempWorkspace, removeTempWorkspace } from "./cli-test-utils.js";
+
+test("grepBuffer matches bytes per line for literals, folded terms and regexes", () => {
+  const buffer = Buffer.from("static int\r\nexecute_command_internal (c)\nEXECUTE_COMMAND x\n  execute_cmd ();\n");
+  const grep = (term, options) => grepBuffer(buffer, createGrepSpec(term, options), 10).matches;
+  assert.deepEqual(grep("execute_command"), [{ line: 2, text: "execute_command_internal (c)" }]);
+  assert.deepEqual(
+    grep("execute_command", { ignoreCase: true }).map((match) => match.line),
+    [2, 3],
+  );
+  assert.deepEqual(grep("^\\s+execute_\\w+ \\(", { regex: true }), [{ line: 4, text: "  execute_cmd ();" }]);
+  assert.deepEqual(grep("int$|^EXEC", { regex: true }).map((match) => match.line), [1, 3]);
+  assert.equal(grepBuffer(Buffer.from([104, 105, 0, 104, 105]), createGrepSpec("hi"), 5).binary, true);
+  assert.throws(() => createGrepSpec("(", { regex: true }), SyntaxError);
+});
+
+test("the worker pool returns the inline results, in path order, and stops at maxMatches", async () => {
+  const root = await createTempWorkspace("miniphi-grep-engine-");
+  try {
+    const paths = [];
+    for (let file = 0; file < 150; file += 1) {
+      const relative = `src/f${String(file).padStart(3, "0")}.c`;
+      paths.push(relative);
+      const body = file % 7 === 0 ? `int a;\nvoid needle_${file}(void);\nneedle again\n` : "int nothing;\n";
+      await fs.mkdir(path.dirname(path.join(root, relative)), { recursive: true });
+      await fs.writeFile(path.join(root, relative), body);
+    }
+    await fs.writeFile(path.join(root, "src", "f001.c"), Buffer.from("needle\0binary"));
+    const spec = createGrepSpec("needle");
+
+    const inline = await grepFiles(root, paths, spec, { maxMatches: 1000, threads: 1 });
+    const pooled = await grepFiles(root, paths, spec, { maxMatches: 1000, threads: 3 });
+    assert.equal(inline.matches.length, 22 * 2);
+    assert.deepEqual(pooled, inline);
+
+    const first = await grepFiles(root, paths, spec, { maxMatches: 5, threads: 3 });
+    assert.deepEqual(
+      first.matches.map((match) => `${match.path}:${match.line}`),
+      ["src/f000.c:2", "src/f000.c:3", "src/f007.c:2", "src/f007.c:3", "src/f014.c:2"],
+    );
+    assert.ok(first.truncated);
+    assert.ok(first.scanned < paths.length);
+
+    resetWorkspaceIndexes();
+    const workspace = await grepWorkspace(root, "NEEDLE_1\\d+", { regex: true, ignoreCase: true, threads: 2 });
+    assert.deepEqual(
+      workspace.matches.map((match) => match.path),
+      ["src/f014.c", "src/f105.c", "src/f112.c", "src/f119.c", "src/f126.c", "src/f133.c", "src/f140.c", "src/f147.c"],
+    );
+  } finally {
+    resetWorkspaceIndexes();
+    await removeTempWorkspace(root);
+  }
+});
@@ -0,0 +1,80 @@
+import test from "node:test";
+import assert from "node:assert/strict";
+import fs from "node:fs/promises";
+import path from "node:path";
+import { JsonIndexStore } from "../src/libs/json-index-store.js";
+import {
+  headPathFor,
+  queryIndexPage,
+  readIndexHead,
+  registerPagedIndex,
+  summarizeIndex,
+} from "../src/libs/index-pages.js";
+import { createTempWorkspace } from "./cli-test-utils.js";
+
+test("committed paged indexes get a head that serves pages without the full file", async () => {
+  const root = await createTempWorkspace("miniphi-index-pages-");
+  try {
+    const indexPath = path.join(root, "indices", "compositions.json");
+    registerPagedIndex(indexPath, { headSize: 5, orders: { score: (entry) => entry.score } });
+    const store = new JsonIndexStore({ flushDelayMs: 1 });
+    for (let index = 0; index < 40; index += 1) {
+      await store.upsert(indexPath, { id: `c${index}`, score: index % 7, kind: index % 2 ? "odd" : "even" });
+    }
+    await store.update(indexPath, (doc) => {
+      doc.summary = "forty compositions";
+    });
+    await store.close();
+
+    const head = await readIndexHead(indexPath);
+    assert.equal(head.total, 40);
+    assert.equal(head.meta.summary, "forty compositions");
+    assert.ok(head.rows.length <= 10);
+
+    const first = await queryIndexPage(indexPath, { limit: 2 });
+    assert.equal(first.source, "head");
+    assert.deepEqual(first.entries.map((entry) => entry.id), ["c39", "c38"]);
+    const second = await queryIndexPage(indexPath, { limit: 2, cursor: first.nextCursor });
+    assert.deepEqual(second.entries.map((entry) => entry.id), ["c37", "c36"]);
+
+    const best = await queryIndexPage(indexPath, { limit: 2, order: "score" });
+    assert.equal(best.source, "head");
+    assert.deepEqual(best.entries.map((entry) => entry.id), ["c34", "c27"]);
+
+    // Past the head (or too few filter matches in it) falls back to the file.
+    const deep = await queryIndexPage(indexPath, { limit: 3, offset: 10 });
+    assert.equal(deep.source, "file");
+    assert.deepEqual(deep.entries.map((entry) => entry.id), ["c29", "c28", "c27"]);
+    const odd = await queryIndexPage(indexPath, { limit: 4, filter: (entry) => entry.kind === "odd" });
+    assert.equal(odd.source, "file");
+    assert.deepEqual(odd.entries.map((entry) => entry.id), ["c39", "c37", "c35", "c33"]);
+    const last = await queryIndexPage(indexPath, { limit: 5, offset: 38 });
+    assert.equal(last.entries.length, 2);
+    assert.equal(last.nextCursor, null);
+  } finally {
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
+
+test("a head is ignored once another writer changes the index, then rebuilt", async () => {
+  const root = await createTempWorkspace("miniphi-index-pages-");
+  try {
+    const indexPath = path.join(root, "history.json");
+    registerPagedIndex(indexPath, { headSize: 4 });
+    const store = new JsonIndexStore({ flushDelayMs: 1 });
+    await store.upsert(indexPath, { id: "a" });
+    await store.close();
+    assert.ok(await readIndexHead(indexPath));
+
+    await fs.writeFile(indexPath, JSON.stringify({ entries: [{ id: "b" }, { id: "a" }], updatedAt: "x" }));
+    assert.equal(await readIndexHead(indexPath), null);
+    const page = await queryIndexPage(indexPath, { limit: 1 });
+    assert.equal(page.source, "file");
+    assert.deepEqual(page.entries, [{ id: "b" }]);
+    assert.deepEqual(await summarizeIndex(indexPath), { total: 2, meta: { updatedAt: "x" } });
+    assert.equal((await queryIndexPage(indexPath, { limit: 1 })).source, "head");
+    assert.ok(await fs.stat(headPathFor(indexPath)));
+  } finally {
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
@@ -0,0 +1,125 @@
+import test from "node:test";
+import assert from "node:assert/strict";
+import fs from "node:fs/promises";
+import path from "node:path";
+import { JsonIndexStore } from "../src/libs/json-index-store.js";
+import { createTempWorkspace } from "./cli-test-utils.js";
+
+test("JsonIndexStore coalesces upserts into one newest-first commit", async () => {
+  const root = await createTempWorkspace("miniphi-index-store-");
+  try {
+    const indexPath = path.join(root, "indices", "helpers-index.json");
+    const store = new JsonIndexStore({ flushDelayMs: 5 });
+    for (let index = 0; index < 50; index += 1) {
+      await store.upsert(indexPath, { id: `h${index % 10}`, round: index }, { limit: 8 });
+    }
+    await store.upsert(indexPath, { label: "no id" }, { limit: 8 });
+    await store.flush();
+    assert.equal(store.stats.commits, 1);
+
+    const written = JSON.parse(await fs.readFile(indexPath, "utf8"));
+    assert.equal(written.entries.length, 8);
+    assert.deepEqual(written.entries[0], { label: "no id" });
+    assert.deepEqual(
+      written.entries.slice(1).map((entry) => entry.id),
+      ["h9", "h8", "h7", "h6", "h5", "h4", "h3"],
+    );
+    assert.equal(written.entries[1].round, 49);
+    assert.ok(written.updatedAt);
+    assert.deepEqual(await store.read(indexPath), written);
+  } finally {
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
+
+test("JsonIndexStore replays pending work over another writer's commit", async () => {
+  const root = await createTempWorkspace("miniphi-index-store-");
+  try {
+    const indexPath = path.join(root, "index.json");
+    await fs.writeFile(indexPath, JSON.stringify({ entries: [{ id: "a" }] }), "utf8");
+    const store = new JsonIndexStore({ flushDelayMs: 1000 });
+    await store.upsert(indexPath, { id: "b" });
+
+    // Another process rewrites the file before this one commits.
+    await new Promise((resolve) => setTimeout(resolve, 20));
+    await fs.writeFile(indexPath, JSON.stringify({ entries: [{ id: "c" }, { id: "a" }] }), "utf8");
+    await store.flush();
+
+    const written = JSON.parse(await fs.readFile(indexPath, "utf8"));
+    assert.deepEqual(
+      written.entries.map((entry) => entry.id),
+      ["b", "c", "a"],
+    );
+    assert.equal(store.stats.rebases, 1);
+  } finally {
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
+
+test("JsonIndexStore lock files keep concurrent writers from losing entries", async () => {
+  const root = await createTempWorkspace("miniphi-index-store-");
+  try {
+    const indexPath = path.join(root, "index.json");
+    const writers = Array.from({ length: 4 }, () => new JsonIndexStore({ flushDelayMs: 0, lock: true }));
+    await Promise.all(
+      writers.map(async (store, writer) => {
+        for (let round = 0; round < 10; round += 1) {
+          await store.upsert(indexPath, { id: `w${writer}-${round}` });
+          await store.flush();
+        }
+      }),
+    );
+    const written = JSON.parse(await fs.readFile(indexPath, "utf8"));
+    assert.equal(written.entries.length, 40);
+    assert.equal(new Set(written.entries.map((entry) => entry.id)).size, 40);
+    await assert.rejects(fs.access(`${indexPath}.lock`));
+  } finally {
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
+
+test("JsonIndexStore keeps operations queued when a commit fails", async () => {
+  const root = await createTempWorkspace("miniphi-index-store-");
+  try {
+    const indexPath = path.join(root, "indices", "index.json");
+    // A file where the index directory should be makes the commit fail.
+    await fs.writeFile(path.join(root, "indices"), "", "utf8");
+    const store = new JsonIndexStore({ flushDelayMs: 1000 });
+    await store.upsert(indexPath, { id: "a" });
+    await assert.rejects(store.flush());
+    assert.equal(store.stats.commits, 0);
+
+    await fs.rm(path.join(root, "indices"));
+    await store.upsert(indexPath, { id: "b" });
+    await store.flush();
+    const written = JSON.parse(await fs.readFile(indexPath, "utf8"));
+    assert.deepEqual(
+      written.entries.map((entry) => entry.id),
+      ["b", "a"],
+    );
+  } finally {
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
+
+test("JsonIndexStore exit flush skips an index another process has locked", async () => {
+  const root = await createTempWorkspace("miniphi-index-store-");
+  try {
+    const indexPath = path.join(root, "index.json");
+    await fs.writeFile(indexPath, JSON.stringify({ entries: [{ id: "theirs" }] }), "utf8");
+    const store = new JsonIndexStore({ flushDelayMs: 1000, lock: true });
+    await store.upsert(indexPath, { id: "mine" });
+    await fs.writeFile(`${indexPath}.lock`, JSON.stringify({ pid: 1, token: "other" }), "utf8");
+    store.flushSync();
+    const untouched = JSON.parse(await fs.readFile(indexPath, "utf8"));
+    assert.deepEqual(untouched.entries.map((entry) => entry.id), ["theirs"]);
+
+    await fs.rm(`${indexPath}.lock`);
+    store.flushSync();
+    const written = JSON.parse(await fs.readFile(indexPath, "utf8"));
+    assert.deepEqual(written.entries.map((entry) => entry.id), ["mine", "theirs"]);
+    await store.close();
+  } finally {
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
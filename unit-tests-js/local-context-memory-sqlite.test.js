@@ -0,0 +1,142 @@
+import test from "node:test";
+import assert from "node:assert/strict";
+import fs from "node:fs";
+import os from "node:os";
+import path from "node:path";
+
+import SqliteLocalContextMemory from "../src/libs/local-context-memory-sqlite.js";
+import LocalContextMemory from "../src/libs/local-context-memory.js";
+
+const makeBase = async () =>
+  fs.promises.mkdtemp(path.join(os.tmpdir(), "miniphi-local-memory-sqlite-"));
+
+const write = async (filePath, content) => {
+  await fs.promises.mkdir(path.dirname(filePath), { recursive: true });
+  await fs.promises.writeFile(filePath, content, "utf8");
+};
+
+test("sqlite memory recalls remembered facts by stemmed content across reopen", async () => {
+  const base = await makeBase();
+  const memory = new SqliteLocalContextMemory({ baseDir: base, sessionId: "s1" });
+  await memory.prepare();
+  await memory.remember({
+    kind: "decision",
+    title: "storage choice",
+    text: "The photo service stores uploads in SQLite through better-sqlite3 rather than Postgres.",
+    tags: ["sqlite", "storage"],
+  });
+  await memory.dispose();
+
+  const reopened = new SqliteLocalContextMemory({ baseDir: base, sessionId: "s2" });
+  await reopened.prepare();
+  assert.equal(reopened.stats().records, 1);
+  assert.equal(reopened.stats().backend, "sqlite");
+  const hit = await reopened.recall({ text: "which sqlite driver did we pick for uploading?" });
+  assert.match(hit.referenceCandidates[0].text, /better-sqlite3/);
+  assert.match(hit.referenceCandidates[0].id, /^local:lm_[a-f0-9]{20}:/);
+  assert.equal(hit.referenceCandidates[0].sourceNodeId, null);
+
+  const miss = await reopened.recall({ text: "kubernetes ingress certificate rotation" });
+  assert.equal(miss.referenceCandidates.length, 0);
+
+  const excluded = await reopened.recall({ text: "sqlite uploads", excludeSessionId: "s1" });
+  assert.equal(excluded.referenceCandidates.length, 0);
+  await reopened.dispose();
+});
+
+test("sqlite memory imports an existing records.jsonl once and harvests notes", async () => {
+  const base = await makeBase();
+  const jsonl = new LocalContextMemory({ baseDir: base, flushDelayMs: 0 });
+  await jsonl.prepare();
+  await jsonl.remember({ title: "limit", text: "The upload limit is eight megabytes per photo." });
+  await write(
+    path.join(base, "memory", "notes", "limits.md"),
+    "## Rate limit\nThe API allows sixty uploads per hour per account.\n",
+  );
+
+  const memory = new SqliteLocalContextMemory({ baseDir: base });
+  await memory.prepare();
+  assert.equal(memory.stats().records, 1);
+  const refreshed = await memory.refresh();
+  assert.equal(refreshed.harvested, 1);
+  assert.equal(memory.stats().records, 2);
+  assert.match(
+    (await memory.recall({ text: "how many uploads per hour" })).referenceCandidates[0].text,
+    /sixty uploads/,
+  );
+
+  // An edited note replaces its previous wording; a deleted one takes it along.
+  await write(
+    path.join(base, "memory", "notes", "limits.md"),
+    "## Rate limit\nThe API allows ninety uploads per hour per account.\n",
+  );
+  await memory.refresh();
+  const edited = await memory.recall({ text: "uploads per hour" });
+  assert.ok(edited.referenceCandidates.some((candidate) => /ninety/.test(candidate.text)));
+  assert.ok(!edited.referenceCandidates.some((candidate) => /sixty/.test(candidate.text)));
+  await fs.promises.rm(path.join(base, "memory", "notes", "limits.md"));
+  await memory.refresh();
+  assert.equal(memory.stats().records, 1);
+  await memory.dispose();
+});
+
+test("sqlite memory dedupes repeated facts, forgets by id and scopes a shared file", async () => {
+  const shared = path.join(await makeBase(), "shared.db");
+  const left = new SqliteLocalContextMemory({ baseDir: await makeBase(), dbPath: shared });
+  const right = new SqliteLocalContextMemory({ baseDir: await makeBase(), dbPath: shared });
+  await left.prepare();
+  await right.prepare();
+  const [first, second] = await left.rememberMany([
+    { title: "port", text: "The generated server listens on port 3000.", importance: 0.4 },
+    { title: "port", text: "The generated server listens on port 3000.", importance: 0.9 },
+  ]);
+  assert.equal(first.id, second.id);
+  assert.equal(left.stats().records, 1);
+  assert.equal(right.stats().records, 0);
+  assert.equal((await right.recall({ text: "server port" })).referenceCandidates.length, 0);
+
+  assert.equal(await left.forget(first.id), true);
+  assert.equal((await left.recall({ text: "server port" })).referenceCandidates.length, 0);
+  await left.dispose();
+  await right.dispose();
+});
+
+test("sqlite memory moves a shared memory_fts table into per-scope tables", async () => {
+  const shared = path.join(await makeBase(), "shared.db");
+  const left = new SqliteLocalContextMemory({ baseDir: await makeBase(), dbPath: shared });
+  const right = new SqliteLocalContextMemory({ baseDir: await makeBase(), dbPath: shared });
+  await left.prepare();
+  await right.prepare();
+  await left.remember({ title: "port", text: "The generated server listens on port 3000." });
+  await right.remember({ title: "port", text: "The admin server listens on port 8080." });
+  assert.notEqual(left.ftsTable, right.ftsTable);
+
+  // Rebuild the layout earlier versions wrote: one FTS table for every scope.
+  await left.db.exec(`
+    CREATE VIRTUAL TABLE memory_fts USING fts5(terms, tokenize = 'unicode61');
+    INSERT INTO memory_fts (rowid, terms) SELECT rowid, terms FROM ${left.ftsTable};
+    INSERT INTO memory_fts (rowid, terms) SELECT rowid, terms FROM ${right.ftsTable};
+    DROP TABLE ${left.ftsTable};
+    DROP TABLE ${right.ftsTable};
+  `);
+  await left.dispose();
+  await right.dispose();
+
+  const hasShared = async (memory) =>
+    Boolean(
+      await memory.db.get("SELECT name FROM sqlite_master WHERE type = 'table' AND name = 'memory_fts'"),
+    );
+  const leftAgain = new SqliteLocalContextMemory({ baseDir: left.baseDir, dbPath: shared });
+  await leftAgain.prepare();
+  assert.equal(await hasShared(leftAgain), true);
+  const leftHits = (await leftAgain.recall({ text: "server port" })).referenceCandidates;
+  assert.deepEqual(leftHits.map((candidate) => /3000/.test(candidate.text)), [true]);
+
+  const rightAgain = new SqliteLocalContextMemory({ baseDir: right.baseDir, dbPath: shared });
+  await rightAgain.prepare();
+  assert.equal(await hasShared(rightAgain), false);
+  const rightHits = (await rightAgain.recall({ text: "server port" })).referenceCandidates;
+  assert.deepEqual(rightHits.map((candidate) => /8080/.test(candidate.text)), [true]);
+  await leftAgain.dispose();
+  await rightAgain.dispose();
+});
@@ -32,6 +32,30 @@ test("local memory configuration is on by default and honours env opt-out", () =
   );
 });
 
+test("local memory backend defaults to jsonl and sqlite raises the record cap", async () => {
+  assert.equal(resolveLocalMemoryConfig({}, {}).backend, "jsonl");
+  assert.equal(resolveLocalMemoryConfig({}, {}).maxRecords, 4000);
+  const sqlite = resolveLocalMemoryConfig({}, { MINIPHI_LOCAL_MEMORY_BACKEND: "sqlite" });
+  assert.equal(sqlite.backend, "sqlite");
+  assert.ok(sqlite.maxRecords > 4000);
+  assert.equal(
+    resolveLocalMemoryConfig({ context: { localMemory: { backend: "redis" } } }, {}).backend,
+    "jsonl",
+  );
+
+  // Whether or not the driver loads here, the factory hands back a working store.
+  const base = await makeBase();
+  const memory = await createLocalContextMemory({
+    baseDir: base,
+    env: { MINIPHI_LOCAL_MEMORY_BACKEND: "sqlite" },
+  });
+  assert.ok(memory instanceof LocalContextMemory);
+  await memory.remember({ title: "kept", text: "The cache directory lives under var/cache." });
+  const hit = await memory.recall({ text: "where does the cache directory live" });
+  assert.match(hit.referenceCandidates[0].text, /var\/cache/);
+  await memory.dispose?.();
+});
+
 test("the light stemmer maps the inflections a real agent seed mixes", () => {
   // Each pair is a query wording against the wording a stored sentence used.
   for (const [left, right] of [
@@ -110,6 +134,122 @@ test("repeating the same fact updates it instead of multiplying records", async
   assert.deepEqual(second.tags, ["server"]);
 });
 
+test("recall visits only records that share a term, and forgetting un-posts them", async () => {
+  const base = await makeBase();
+  const memory = new LocalContextMemory({ baseDir: base });
+  await memory.prepare();
+  await memory.rememberMany(
+    Array.from({ length: 60 }, (_, index) => ({
+      title: `filler ${index}`,
+      text: `Routine build number ${index} finished with the usual warnings about lint.`,
+    })),
+  );
+  const target = await memory.remember({
+    title: "ingress",
+    text: "The Kubernetes ingress rotates its certificate every ninety days.",
+  });
+
+  const hit = memory.recall({ text: "when does the ingress certificate rotate?" });
+  assert.match(hit.referenceCandidates[0].text, /ninety days/);
+  assert.equal(hit.scanned, 1);
+  assert.equal(hit.matched, 1);
+
+  // A broad seed still ranks exactly like a full scan: ties fall back to recency, then id.
+  const broad = memory.recall({ text: "build warnings lint", limit: 5 });
+  assert.equal(broad.referenceCandidates.length, 5);
+  assert.equal(broad.matched, 60);
+
+  assert.equal(await memory.forget(target.id), true);
+  const gone = memory.recall({ text: "ingress certificate rotation" });
+  assert.equal(gone.referenceCandidates.length, 0);
+  assert.equal(gone.scanned, 0);
+});
+
+test("writes append to the record log, group-commit, and compact superseded lines", async () => {
+  const base = await makeBase();
+  const recordsPath = path.join(base, "memory", "records.jsonl");
+  const lineCount = async () =>
+    (await fs.promises.readFile(recordsPath, "utf8")).split("\n").filter(Boolean).length;
+  const memory = new LocalContextMemory({ baseDir: base, flushDelayMs: 5 });
+  await memory.prepare();
+
+  const batch = await memory.rememberMany(
+    ["alpha", "bravo", "charlie"].map((word) => ({
+      title: word,
+      text: `The ${word} service owns the nightly export job.`,
+    })),
+  );
+  assert.equal(batch.length, 3);
+  assert.equal(memory.stats().appends, 1);
+  assert.equal(await lineCount(), 3);
+
+  // Concurrent remembers inside one debounce window share one append.
+  await Promise.all([
+    memory.remember({ title: "delta", text: "The delta worker retries failed uploads twice." }),
+    memory.remember({ title: "echo", text: "The echo worker compresses thumbnails to webp." }),
+  ]);
+  assert.equal(memory.stats().appends, 2);
+
+  // A forget is a tombstone line, and the last line for an id wins on load.
+  assert.equal(await memory.forget(batch[0].id), true);
+  assert.equal(await lineCount(), 6);
+  const reopened = new LocalContextMemory({ baseDir: base });
+  await reopened.prepare();
+  assert.equal(reopened.stats().records, 4);
+  assert.equal(reopened.recall({ text: "alpha nightly export" }).referenceCandidates.length > 0, true);
+  assert.doesNotMatch(
+    reopened.recall({ text: "alpha nightly export" }).referenceCandidates[0].text,
+    /alpha/,
+  );
+
+  // Re-remembering the same facts only supersedes lines; compaction folds them back.
+  for (let round = 0; round < 130; round += 1) {
+    await reopened.rememberMany([
+      { title: "delta", text: "The delta worker retries failed uploads twice." },
+      { title: "echo", text: "The echo worker compresses thumbnails to webp." },
+    ]);
+  }
+  assert.ok(reopened.stats().compactions >= 1);
+  assert.ok((await lineCount()) <= 256);
+  const third = new LocalContextMemory({ baseDir: base });
+  await third.prepare();
+  assert.equal(third.stats().records, 4);
+});
+
+test("a failed append keeps its records queued for the next commit", async () => {
+  const base = await makeBase();
+  const memory = new LocalContextMemory({ baseDir: base });
+  await memory.prepare();
+  const recordsPath = path.join(base, "memory", "records.jsonl");
+  // A directory where the log belongs makes the append fail.
+  await fs.promises.mkdir(recordsPath, { recursive: true });
+  await assert.rejects(
+    memory.remember({ title: "kept", text: "The cache directory lives under var/cache." }),
+  );
+  await fs.promises.rm(recordsPath, { recursive: true });
+  assert.equal(await memory.flush(), true);
+
+  const reopened = new LocalContextMemory({ baseDir: base });
+  await reopened.prepare();
+  assert.equal(reopened.stats().records, 1);
+});
+
+test("a torn last log line is dropped and never swallows the next append", async () => {
+  const base = await makeBase();
+  const memory = new LocalContextMemory({ baseDir: base });
+  await memory.prepare();
+  await memory.remember({ title: "kept", text: "The cache directory lives under var/cache." });
+  const recordsPath = path.join(base, "memory", "records.jsonl");
+  await fs.promises.appendFile(recordsPath, '{"id":"lm_0000', "utf8");
+
+  const reopened = new LocalContextMemory({ baseDir: base });
+  await reopened.prepare();
+  await reopened.remember({ title: "next", text: "The log directory lives under var/log." });
+  const third = new LocalContextMemory({ baseDir: base });
+  await third.prepare();
+  assert.equal(third.stats().records, 2);
+});
+
 test("markdown notes are harvested per section and re-harvested when edited", async () => {
   const base = await makeBase();
   const notePath = path.join(base, "memory", "notes", "stack.md");
@@ -157,6 +297,48 @@ test("markdown notes are harvested per section and re-harvested when edited", as
   );
 });
 
+test("refresh stats in parallel and, while watching, re-checks only changed sources", async () => {
+  const base = await makeBase();
+  for (let index = 0; index < 5; index += 1) {
+    const sessionDir = path.join(base, "agent-sessions", `agent-170000000000${index}`);
+    await write(
+      path.join(sessionDir, "result.json"),
+      JSON.stringify({ task: `Build feature ${index}`, stopReason: "completed" }),
+    );
+  }
+  const memory = new LocalContextMemory({ baseDir: base, ioConcurrency: 3 });
+  await memory.prepare();
+  memory.watch();
+  try {
+    const first = await memory.refresh();
+    assert.equal(first.mode, "full");
+    assert.equal(first.harvested, 5);
+
+    const idle = await memory.refresh();
+    assert.equal(idle.mode, "watched");
+    assert.equal(idle.checked, 0);
+
+    await write(
+      path.join(base, "memory", "notes", "deploy.md"),
+      "## Deploys\nProduction deploys run from the release branch only.\n",
+    );
+    let refreshed = null;
+    for (let attempt = 0; attempt < 50; attempt += 1) {
+      await new Promise((resolve) => setTimeout(resolve, 20));
+      refreshed = await memory.refresh();
+      if (refreshed.harvested) {
+        break;
+      }
+    }
+    assert.equal(refreshed.mode, "watched");
+    assert.equal(refreshed.checked, 1);
+    assert.equal(refreshed.harvested, 1);
+    assert.equal(memory.stats().records, 6);
+  } finally {
+    memory.unwatch();
+  }
+});
+
 test("hard-wrapped prose is rejoined before it becomes reference sentences", async () => {
   const base = await makeBase();
   await write(
@@ -0,0 +1,232 @@
+import test from "node:test";
+import assert from "node:assert/strict";
+import fs from "node:fs";
+import os from "node:os";
+import path from "node:path";
+
+import LocalContextMemory from "../src/libs/local-context-memory.js";
+import LocalMemoryEmbeddings, {
+  HnswIndex,
+  embeddingHash,
+} from "../src/libs/local-memory-embeddings.js";
+
+const makeBase = async () =>
+  fs.promises.mkdtemp(path.join(os.tmpdir(), "miniphi-local-embeddings-"));
+
+// A stand-in embedding model: words map onto a handful of concepts, so
+// paraphrases land close together without sharing a single token.
+const CONCEPTS = [
+  ["photo", "photos", "picture", "pictures", "image", "images", "upload", "uploads"],
+  ["store", "stored", "keep", "kept", "persist", "persisted", "save", "saved"],
+  ["lint", "linter", "eslint", "style"],
+  ["commit", "commits", "push", "merge"],
+];
+
+const fakeVector = (text) => {
+  const vector = new Array(CONCEPTS.length + 1).fill(0);
+  vector[CONCEPTS.length] = 0.1;
+  for (const word of String(text).toLowerCase().match(/[a-z]+/g) ?? []) {
+    CONCEPTS.forEach((words, index) => {
+      if (words.includes(word)) {
+        vector[index] += 1;
+      }
+    });
+  }
+  return vector;
+};
+
+const fakeClient = () => {
+  const client = {
+    calls: [],
+    down: false,
+    async createEmbedding({ model, input }) {
+      if (client.down) {
+        throw new Error("connect ECONNREFUSED");
+      }
+      client.calls.push({ model, input });
+      return { data: input.map((text, index) => ({ index, embedding: fakeVector(text) })) };
+    },
+  };
+  return client;
+};
+
+const seededRandom = (seed) => () => {
+  seed = (seed * 1664525 + 1013904223) % 4294967296;
+  return seed / 4294967296;
+};
+
+test("the HNSW graph finds nearly all exact nearest neighbours", () => {
+  const random = seededRandom(7);
+  const unit = (values) => {
+    const norm = Math.hypot(...values);
+    return Float32Array.from(values, (value) => value / norm);
+  };
+  const vectors = Array.from({ length: 1500 }, () =>
+    unit(Array.from({ length: 24 }, () => random() - 0.5)),
+  );
+  const index = new HnswIndex();
+  vectors.forEach((vector) => index.add(vector, random()));
+  const dot = (left, right) => left.reduce((sum, value, at) => sum + value * right[at], 0);
+
+  let found = 0;
+  for (let query = 0; query < 40; query += 1) {
+    const probe = unit(Array.from({ length: 24 }, () => random() - 0.5));
+    const exact = vectors
+      .map((vector, node) => ({ node, similarity: dot(probe, vector) }))
+      .sort((left, right) => right.similarity - left.similarity)
+      .slice(0, 10)
+      .map((hit) => hit.node);
+    const approximate = new Set(index.search(probe, 10).map((hit) => hit.node));
+    found += exact.filter((node) => approximate.has(node)).length;
+  }
+  assert.ok(found / 400 >= 0.9, `recall@10 was ${found / 400}`);
+});
+
+test("sentences are embedded once per content hash, in batches, and persisted", async () => {
+  const base = await makeBase();
+  const client = fakeClient();
+  const embeddings = new LocalMemoryEmbeddings({ dir: base, client, model: "fake", batchSize: 2 });
+  const texts = ["photo uploads", "keep pictures", "linter style", "photo uploads"];
+  const added = await embeddings.ensure(texts.map((text) => ({ hash: embeddingHash(text), text })));
+  assert.equal(added, 3);
+  assert.deepEqual(
+    client.calls.map((call) => call.input.length),
+    [2, 1],
+  );
+  await embeddings.save();
+
+  const reopened = new LocalMemoryEmbeddings({ dir: base, client, model: "fake" });
+  assert.equal(await reopened.ensure(texts.map((text) => ({ hash: embeddingHash(text), text }))), 0);
+  assert.equal(client.calls.length, 2);
+  const [best] = reopened.search(await reopened.embedQuery("saved images"), 1);
+  assert.equal(best.hash, embeddingHash("keep pictures"));
+
+  // Another model is another vector space: the cache does not carry over.
+  const other = new LocalMemoryEmbeddings({ dir: base, client, model: "other" });
+  await other.load();
+  assert.equal(other.size, 0);
+});
+
+test("hybrid recall surfaces a paraphrase and degrades to lexical when embeddings fail", async () => {
+  const base = await makeBase();
+  const memory = new LocalContextMemory({ baseDir: base });
+  await memory.prepare();
+  await memory.remember({ kind: "decision", text: "Photo uploads are persisted on the local disk." });
+  await memory.remember({ kind: "note", text: "The linter runs before every commit." });
+
+  const seed = "where do we keep user pictures";
+  assert.equal(memory.recall({ text: seed }).referenceCandidates.length, 0);
+
+  const client = fakeClient();
+  memory.attachEmbeddings(
+    new LocalMemoryEmbeddings({ dir: path.join(base, "vectors"), client, model: "fake" }),
+  );
+  // Attaching queues the corpus for a background sync; recall never waits on it.
+  await memory.syncEmbeddings();
+  const hybrid = await memory.recall({ text: seed });
+  assert.equal(hybrid.semantic, 1);
+  assert.match(hybrid.referenceCandidates[0].text, /Photo uploads/);
+  assert.match(hybrid.referenceCandidates[0].id, /^local:/);
+  assert.ok(hybrid.referenceCandidates[0].similarity > 0.9);
+
+  // A lexical hit keeps its place and gains the similarity term.
+  const lexical = await memory.recall({ text: "linter commit" });
+  assert.match(lexical.referenceCandidates[0].text, /linter/);
+
+  // An unchanged corpus is not re-embedded; only new seeds cost a call.
+  const calls = client.calls.length;
+  await memory.recall({ text: seed });
+  assert.equal(client.calls.length, calls);
+
+  client.down = true;
+  const fallback = await memory.recall({ text: "linter before commit" });
+  assert.equal(fallback.ok, true);
+  assert.equal(fallback.semantic, 0);
+  assert.match(fallback.referenceCandidates[0].text, /linter/);
+});
+
+test("recall searches what is embedded while new sentences are embedded in the background", async () => {
+  const base = await makeBase();
+  const memory = new LocalContextMemory({ baseDir: base });
+  await memory.prepare();
+  await memory.remember({ kind: "note", text: "The linter runs before every commit." });
+  const client = fakeClient();
+  memory.attachEmbeddings(
+    new LocalMemoryEmbeddings({ dir: path.join(base, "vectors"), client, model: "fake" }),
+  );
+  await memory.syncEmbeddings();
+  const embedded = client.calls.length;
+
+  // A new record queues only its own sentence.
+  let release;
+  const gate = new Promise((resolve) => (release = resolve));
+  const createEmbedding = client.createEmbedding;
+  client.createEmbedding = async (request) => {
+    if (request.input.length === 1 && /Photo/.test(request.input[0])) {
+      await gate;
+    }
+    return createEmbedding(request);
+  };
+  await memory.remember({ kind: "decision", text: "Photo uploads are persisted on the local disk." });
+  const early = await memory.recall({ text: "where do we keep user pictures" });
+  assert.equal(early.semantic, 0);
+  release();
+  await memory.syncEmbeddings();
+  assert.deepEqual(
+    client.calls.slice(embedded).map((call) => call.input),
+    [["where do we keep user pictures"], ["Photo uploads are persisted on the local disk."]],
+  );
+  const late = await memory.recall({ text: "where do we keep user pictures" });
+  assert.equal(late.semantic, 1);
+});
+
+test("forgotten sentences leave the vector cache, which appends and compacts on disk", async () => {
+  const base = await makeBase();
+  const dir = path.join(base, "vectors");
+  const client = fakeClient();
+  const memory = new LocalContextMemory({ baseDir: base });
+  await memory.prepare();
+  memory.attachEmbeddings(new LocalMemoryEmbeddings({ dir, client, model: "fake" }));
+  const photo = await memory.remember({ kind: "decision", text: "Photo uploads are persisted on the local disk." });
+  await memory.remember({ kind: "note", text: "The linter runs before every commit." });
+  await memory.syncEmbeddings();
+  assert.equal(memory.embeddings.size, 2);
+  const vectorFiles = () => fs.readdirSync(dir).filter((name) => name.endsWith(".f32"));
+  const [vectorsFile] = vectorFiles();
+  const bytes = fs.statSync(path.join(dir, vectorsFile)).size;
+
+  await memory.forget(photo.id);
+  assert.equal(memory.embeddings.size, 1);
+  assert.equal((await memory.recall({ text: "where do we keep user pictures" })).semantic, 0);
+  await memory.syncEmbeddings();
+  // A tombstone is one appended graph line; the vectors file is untouched.
+  assert.equal(fs.statSync(path.join(dir, vectorsFile)).size, bytes);
+  const reopened = new LocalMemoryEmbeddings({ dir, client, model: "fake" });
+  await reopened.load();
+  assert.equal(reopened.size, 1);
+  assert.equal(reopened.has(embeddingHash("Photo uploads are persisted on the local disk.")), false);
+
+  // Re-adding the sentence revives its vector without a request.
+  const calls = client.calls.length;
+  const text = "Photo uploads are persisted on the local disk.";
+  assert.equal(await reopened.ensure([{ hash: embeddingHash(text), text }]), 1);
+  assert.equal(client.calls.length, calls);
+
+  // Enough tombstones compact the cache into a new generation of files.
+  const many = Array.from({ length: 80 }, (_, index) => `linter rule number ${index}`);
+  await reopened.ensure(many.map((entry) => ({ hash: embeddingHash(entry), text: entry })));
+  await reopened.save();
+  for (const entry of many) {
+    reopened.forget(embeddingHash(entry));
+  }
+  await reopened.save();
+  assert.equal(reopened.stats.compactions, 1);
+  assert.equal(reopened.index.size, 2);
+  assert.equal(vectorFiles().length, 1);
+  assert.notEqual(vectorFiles()[0], vectorsFile);
+  const compacted = new LocalMemoryEmbeddings({ dir, client, model: "fake" });
+  await compacted.load();
+  assert.equal(compacted.size, 2);
+  const [best] = compacted.search(await compacted.embedQuery("saved images"), 1);
+  assert.equal(best.hash, embeddingHash(text));
+});
@@ -0,0 +1,151 @@
+import test from "node:test";
+import assert from "node:assert/strict";
+import fs from "node:fs/promises";
+import os from "node:os";
+import path from "node:path";
+import { spawn } from "node:child_process";
+import { fileURLToPath, pathToFileURL } from "node:url";
+import { acquireFileLock, WriteAheadLog } from "../src/libs/atomic-file.js";
+import { createTempWorkspace } from "./cli-test-utils.js";
+
+const LIBS_DIR = path.resolve(path.dirname(fileURLToPath(import.meta.url)), "..", "src", "libs");
+const libUrl = (name) => pathToFileURL(path.join(LIBS_DIR, name)).href;
+
+async function listFiles(dir) {
+  const found = [];
+  for (const entry of await fs.readdir(dir, { withFileTypes: true })) {
+    const full = path.join(dir, entry.name);
+    if (entry.isDirectory()) {
+      found.push(...(await listFiles(full)));
+    } else {
+      found.push(full);
+    }
+  }
+  return found;
+}
+
+function runChild(script, args) {
+  return new Promise((resolve, reject) => {
+    const child = spawn(process.execPath, [script, ...args], { stdio: ["ignore", "ignore", "pipe"] });
+    let stderr = "";
+    child.stderr.on("data", (chunk) => {
+      stderr += chunk;
+    });
+    child.on("error", reject);
+    child.on("exit", (code) => (code === 0 ? resolve() : reject(new Error(`worker exited ${code}: ${stderr}`))));
+  });
+}
+
+const WORKER_SOURCE = `
+import path from "node:path";
+import { JsonIndexStore } from "${libUrl("json-index-store.js")}";
+import { WriteAheadLog } from "${libUrl("atomic-file.js")}";
+
+const [root, worker, rounds] = process.argv.slice(2);
+const store = new JsonIndexStore({ flushDelayMs: 1, lock: true });
+const wal = new WriteAheadLog(path.join(root, "wal"));
+const indexPath = path.join(root, "indices", "shared-index.json");
+for (let round = 0; round < Number(rounds); round += 1) {
+  const id = \`w\${worker}-r\${round}\`;
+  await store.upsert(indexPath, { id, worker }, { limit: 100000 });
+  await store.update(path.join(root, "indices", "counter.json"), (doc) => {
+    doc.count = (doc.count ?? 0) + 1;
+  }, { fallback: { count: 0 } });
+  const dir = path.join(root, "executions", id);
+  await wal.commit([
+    { path: path.join(dir, "execution.json"), data: JSON.stringify({ id, part: "meta" }) },
+    { path: path.join(dir, "analysis.json"), data: JSON.stringify({ id, part: "analysis" }) },
+    { path: path.join(root, "latest.json"), data: JSON.stringify({ id }) },
+  ]);
+  if (round % 5 === 0) {
+    await store.flush();
+  }
+}
+await store.close();
+`;
+
+test("parallel processes sharing one workspace lose no index entries and leave no debris", async () => {
+  const root = await createTempWorkspace("miniphi-concurrency-");
+  const workers = 6;
+  const rounds = 25;
+  try {
+    const script = path.join(root, "worker.mjs");
+    await fs.writeFile(script, WORKER_SOURCE, "utf8");
+    await Promise.all(
+      Array.from({ length: workers }, (_, worker) => runChild(script, [root, String(worker), String(rounds)])),
+    );
+
+    const index = JSON.parse(await fs.readFile(path.join(root, "indices", "shared-index.json"), "utf8"));
+    const ids = new Set(index.entries.map((entry) => entry.id));
+    assert.equal(ids.size, workers * rounds);
+    const counter = JSON.parse(await fs.readFile(path.join(root, "indices", "counter.json"), "utf8"));
+    assert.equal(counter.count, workers * rounds);
+
+    const files = await listFiles(root);
+    const leftovers = files.filter((file) => /\.(lock|wal|tmp)$/.test(file) || file.startsWith(path.join(root, "wal") + path.sep));
+    assert.deepEqual(leftovers, []);
+    for (const file of files.filter((name) => name.endsWith(".json"))) {
+      JSON.parse(await fs.readFile(file, "utf8"));
+    }
+    const executions = await fs.readdir(path.join(root, "executions"));
+    assert.equal(executions.length, workers * rounds);
+  } finally {
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
+
+test("WriteAheadLog.recover rolls committed journals forward and discards pending ones", async () => {
+  const root = await createTempWorkspace("miniphi-concurrency-");
+  try {
+    const walDir = path.join(root, "wal");
+    await fs.mkdir(walDir, { recursive: true });
+    const target = (name) => path.join(root, name);
+    await fs.writeFile(target("a.json"), "old-a", "utf8");
+    await fs.writeFile(target("b.json"), "old-b", "utf8");
+    // A pid that cannot be alive, so recover() treats the writers as crashed.
+    const deadPid = 2 ** 22 + 12345;
+    const journal = (txid, state, names) => ({
+      txid,
+      pid: deadPid,
+      state,
+      renames: names.map((name) => ({ from: `${target(name)}.${txid}.wal`, to: target(name) })),
+    });
+    await fs.writeFile(`${target("a.json")}.tx1.wal`, "new-a", "utf8");
+    await fs.writeFile(path.join(walDir, "tx1.json"), JSON.stringify(journal("tx1", "committed", ["a.json", "c.json"])));
+    await fs.writeFile(`${target("b.json")}.tx2.wal`, "new-b", "utf8");
+    await fs.writeFile(path.join(walDir, "tx2.json"), JSON.stringify(journal("tx2", "pending", ["b.json"])));
+
+    const result = await new WriteAheadLog(walDir).recover();
+    assert.deepEqual(result, { rolledForward: 1, rolledBack: 1 });
+    assert.equal(await fs.readFile(target("a.json"), "utf8"), "new-a");
+    assert.equal(await fs.readFile(target("b.json"), "utf8"), "old-b");
+    assert.deepEqual((await fs.readdir(root)).sort(), ["a.json", "b.json", "wal"]);
+    assert.deepEqual(await fs.readdir(walDir), []);
+  } finally {
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
+
+test("acquireFileLock breaks locks held by dead or silent owners and times out on live ones", async () => {
+  const root = await createTempWorkspace("miniphi-concurrency-");
+  try {
+    const file = path.join(root, "index.json");
+    await fs.writeFile(
+      `${file}.lock`,
+      JSON.stringify({ pid: 2 ** 22 + 54321, host: os.hostname(), token: "dead" }),
+      "utf8",
+    );
+    const release = await acquireFileLock(file, { timeoutMs: 1000 });
+    await assert.rejects(acquireFileLock(file, { timeoutMs: 100 }), { code: "ELOCKTIMEOUT" });
+    await release();
+    assert.equal(await fs.access(`${file}.lock`).then(() => true, () => false), false);
+
+    await fs.writeFile(`${file}.lock`, JSON.stringify({ pid: process.pid, host: "elsewhere", token: "x" }));
+    const old = new Date(Date.now() - 60_000);
+    await fs.utimes(`${file}.lock`, old, old);
+    const again = await acquireFileLock(file, { staleMs: 5_000, timeoutMs: 1000 });
+    await again();
+  } finally {
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
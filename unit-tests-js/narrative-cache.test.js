@@ -0,0 +1,95 @@
+import test from "node:test";
+import assert from "node:assert/strict";
+import fs from "node:fs/promises";
+import os from "node:os";
+import path from "node:path";
+import { createHash } from "node:crypto";
+import NarrativeCache from "../src/libs/narrative-cache.js";
+
+const hashOf = (text) => createHash("sha256").update(text).digest("hex");
+const makeDir = () => fs.mkdtemp(path.join(os.tmpdir(), "miniphi-narratives-"));
+const exists = (target) =>
+  fs.access(target).then(
+    () => true,
+    () => false,
+  );
+
+test("NarrativeCache stores one shard file per entry and serves repeats from memory", async () => {
+  const dir = await makeDir();
+  try {
+    const cache = new NarrativeCache(dir);
+    const hashes = ["a.js", "b.js", "c.js"].map(hashOf);
+    await Promise.all(
+      hashes.map((hash, index) => cache.set(hash, { document: `# doc ${index}`, relativePath: `f${index}` })),
+    );
+    for (const hash of hashes) {
+      const file = cache.entryPath(hash);
+      assert.equal(path.basename(path.dirname(file)), hash.slice(0, 2));
+      assert.ok(await exists(file));
+    }
+    assert.equal((await cache.get(hashes[1])).document, "# doc 1");
+    assert.equal(cache.stats.memoryHits, 1);
+
+    const reopened = new NarrativeCache(dir);
+    assert.equal((await reopened.get(hashes[2])).relativePath, "f2");
+    assert.equal(reopened.stats.memoryHits, 0);
+    assert.equal(await reopened.get(hashOf("missing")), null);
+    assert.deepEqual(await reopened.usage(), {
+      entries: 3,
+      bytes: (await cache.usage()).bytes,
+      maxBytes: reopened.maxBytes,
+    });
+  } finally {
+    await fs.rm(dir, { recursive: true, force: true });
+  }
+});
+
+test("NarrativeCache evicts least recently used entries by total bytes", async () => {
+  const dir = await makeDir();
+  try {
+    const entry = (label) => ({ document: `${label} `.repeat(100) });
+    const size = Buffer.byteLength(JSON.stringify(entry("one")));
+    const cache = new NarrativeCache(dir, { maxBytes: size * 3 + 10, memoryBytes: 0 });
+    const [one, two, three, four] = ["one", "two", "thr", "fou"].map(hashOf);
+    await cache.set(one, entry("one"));
+    await cache.set(two, entry("two"));
+    await cache.set(three, entry("thr"));
+    assert.ok(await cache.get(one));
+    await cache.set(four, entry("fou"));
+    assert.equal(cache.stats.evicted, 1);
+    assert.equal(await exists(cache.entryPath(two)), false);
+    assert.ok(await exists(cache.entryPath(one)));
+    assert.ok((await cache.usage()).bytes <= cache.maxBytes);
+  } finally {
+    await fs.rm(dir, { recursive: true, force: true });
+  }
+});
+
+test("NarrativeCache migrates the legacy single-file cache", async () => {
+  const dir = await makeDir();
+  try {
+    const legacyFile = path.join(dir, "narratives.json");
+    const [newer, older] = [hashOf("new"), hashOf("old")];
+    await fs.writeFile(
+      legacyFile,
+      JSON.stringify({
+        entries: {
+          [newer]: { document: "new doc", relativePath: "n.js" },
+          [older]: { document: "old doc", relativePath: "o.js" },
+        },
+        order: [newer, older],
+      }),
+      "utf8",
+    );
+    const cache = new NarrativeCache(dir, { legacyFile });
+    assert.equal((await cache.get(older)).document, "old doc");
+    assert.equal(await exists(legacyFile), false);
+    const [newerStat, olderStat] = await Promise.all([
+      fs.stat(cache.entryPath(newer)),
+      fs.stat(cache.entryPath(older)),
+    ]);
+    assert.ok(newerStat.size > 0 && olderStat.size > 0);
+  } finally {
+    await fs.rm(dir, { recursive: true, force: true });
+  }
+});
@@ -5,6 +5,7 @@ import os from "node:os";
 import path from "node:path";
 import { randomUUID } from "node:crypto";
 import { handleNitpickCommand } from "../src/commands/nitpick.js";
+import { flushTaskExecutionRegisters } from "../src/libs/task-execution-register.js";
 import LMStudioHandler from "../src/libs/lmstudio-handler.js";
 import PromptSchemaRegistry from "../src/libs/prompt-schema-registry.js";
 
@@ -239,6 +240,7 @@ test(
     } finally {
       LMStudioHandler.prototype.load = originalHandlerLoad;
       LMStudioHandler.prototype.chatStream = originalHandlerChatStream;
+      await flushTaskExecutionRegisters();
       await fs.rm(workspace, { recursive: true, force: true });
     }
   },
@@ -0,0 +1,47 @@
+import test from "node:test";
+import assert from "node:assert/strict";
+import PathFilterIndex from "../src/ui/path-filter-index.js";
+
+const naive = (paths, query) => paths.filter((file) => file.toLowerCase().includes(query.trim().toLowerCase()));
+
+test("PathFilterIndex matches case-insensitive substrings in list order", () => {
+  const paths = ["src/App.js", "src/lib/util.js", "README.md", "docs/app-guide.md", "test/app.test.js", "a_b-c.txt"];
+  const index = PathFilterIndex.from(paths);
+  assert.equal(index.filter("  "), null);
+  for (const query of ["app", "APP", "a", "ap", "app.", "lib/u", "md", "_b-", "zzz", "app.test"]) {
+    assert.deepEqual(index.filter(query).all(), naive(paths, query), query);
+  }
+  // Backspacing returns the cached result.
+  assert.equal(index.filter("ap"), index.filter("ap"));
+});
+
+test("PathFilterIndex results are lazy and pick up streamed paths", () => {
+  const index = new PathFilterIndex();
+  const first = Array.from({ length: 5000 }, (_, n) => `pkg${n % 50}/src/file${n}.js`);
+  index.add(first);
+  const result = index.filter("file1");
+  assert.equal(result.ensure(12), 12);
+  assert.equal(result.exhausted, false);
+  assert.ok(result.position < first.length, "a window of matches does not scan the whole list");
+
+  // Narrowing reads the shorter query's matches; both see paths added later.
+  const narrower = index.filter("file12");
+  const later = ["late/file12-extra.js", "late/other.js", first[0]];
+  let changes = 0;
+  index.on("change", () => {
+    changes += 1;
+  });
+  index.add(later);
+  assert.equal(changes, 1);
+  assert.equal(index.size, 5002, "duplicates are ignored");
+  const all = [...first, ...later.slice(0, 2)];
+  assert.deepEqual(narrower.all(), naive(all, "file12"));
+  assert.deepEqual(result.all(), naive(all, "file1"));
+  assert.equal(narrower.exhausted, true);
+
+  index.replace(["b.js", "a.js"]);
+  assert.deepEqual(index.filter("js").all(), ["b.js", "a.js"]);
+  assert.equal(index.complete, false);
+  index.finish();
+  assert.equal(index.complete, true);
+});
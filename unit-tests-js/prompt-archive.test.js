@@ -0,0 +1,118 @@
+import test from "node:test";
+import assert from "node:assert/strict";
+import fs from "node:fs/promises";
+import path from "node:path";
+import zlib from "node:zlib";
+import PromptArchive from "../src/libs/prompt-archive.js";
+import PromptRecorder from "../src/libs/prompt-recorder.js";
+import { createTempWorkspace } from "./cli-test-utils.js";
+
+const exchange = (index, overrides = {}) => ({
+  id: `ex-${index}`,
+  recordedAt: new Date(Date.UTC(2026, 0, 1, 0, 0, index)).toISOString(),
+  scope: index % 2 ? "sub" : "main",
+  label: `step-${index}`,
+  request: { model: index < 3 ? "phi-4" : "qwen", messages: [{ role: "user", content: `q${index}` }] },
+  response: { rawResponseText: `{"answer":${index}}`, schemaId: "log-analysis" },
+  ...overrides,
+});
+
+test("PromptArchive reads one exchange by id and streams filtered exports in order", async () => {
+  const root = await createTempWorkspace("miniphi-prompt-archive-");
+  try {
+    const archive = new PromptArchive(root, { segmentMaxBytes: 400 });
+    await Promise.all(Array.from({ length: 8 }, (_, index) => archive.append(exchange(index))));
+    await archive.close();
+
+    const segments = (await fs.readdir(archive.archiveDir)).filter((name) => name.endsWith(".gz"));
+    assert.ok(segments.length > 1, "small segment cap should rotate");
+    // Every segment is plain multi-member gzip holding NDJSON.
+    const lines = zlib.gunzipSync(await fs.readFile(path.join(archive.archiveDir, segments[0])))
+      .toString("utf8")
+      .trim()
+      .split("\n");
+    assert.equal(JSON.parse(lines[0]).id, "ex-0");
+
+    // Another process sees the catalog and reads by byte range.
+    const reader = new PromptArchive(root);
+    assert.equal((await reader.read("ex-5")).label, "step-5");
+    assert.equal(await reader.read("missing"), null);
+
+    const ids = [];
+    for await (const payload of reader.entries({ model: "qwen", scope: "sub" })) {
+      ids.push(payload.id);
+    }
+    assert.deepEqual(ids, ["ex-3", "ex-5", "ex-7"]);
+    const recent = await reader.list({ schema: "log-analysis", since: "2026-01-01T00:00:06Z" });
+    assert.deepEqual(recent.map((row) => row.id), ["ex-6", "ex-7"]);
+
+    const pruned = await reader.prune({ keep: 2 });
+    assert.ok(pruned.removedSegments > 0);
+    assert.equal((await reader.read("ex-0")), null);
+    assert.equal((await reader.read("ex-7")).id, "ex-7");
+  } finally {
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
+
+test("PromptArchive keeps the latest row for a re-archived id and compacts replaced rows away", async () => {
+  const root = await createTempWorkspace("miniphi-prompt-archive-replace-");
+  try {
+    const archive = new PromptArchive(root, { segmentMaxBytes: 400 });
+    for (let index = 0; index < 4; index += 1) {
+      await archive.append(exchange(index));
+    }
+    await archive.append(exchange(1, { label: "step-1-again" }));
+    await archive.close();
+
+    const reader = new PromptArchive(root);
+    assert.deepEqual((await reader.list()).map((row) => row.id), ["ex-0", "ex-2", "ex-3", "ex-1"]);
+    assert.equal((await reader.read("ex-1")).label, "step-1-again");
+    const catalogLines = async () => (await fs.readFile(reader.catalogFile, "utf8")).trim().split("\n").length;
+    assert.equal(await catalogLines(), 5);
+
+    await reader.prune({ keep: 3 });
+    assert.equal(await catalogLines(), reader.byId.size);
+    assert.equal((await reader.read("ex-1")).label, "step-1-again");
+  } finally {
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
+
+test("PromptRecorder moves legacy per-file exchanges into the archive", async () => {
+  const root = await createTempWorkspace("miniphi-prompt-archive-");
+  try {
+    const miniPhiRoot = path.join(root, ".miniphi");
+    const recordsDir = path.join(miniPhiRoot, "prompt-exchanges");
+    await fs.mkdir(recordsDir, { recursive: true });
+    for (const index of [1, 0]) {
+      await fs.writeFile(path.join(recordsDir, `ex-${index}.json`), JSON.stringify(exchange(index)), "utf8");
+    }
+    await fs.writeFile(
+      path.join(recordsDir, "index.json"),
+      JSON.stringify({ entries: [{ id: "ex-1", file: "prompt-exchanges/ex-1.json" }] }),
+      "utf8",
+    );
+
+    const recorder = new PromptRecorder(miniPhiRoot);
+    await recorder.prepare();
+    await recorder.record({ request: { messages: [{ role: "user", content: "new" }] }, label: "fresh" });
+    await recorder.flush();
+
+    assert.deepEqual(
+      (await fs.readdir(recordsDir)).sort(),
+      ["archive", "index.json"],
+    );
+    const labels = [];
+    for await (const payload of recorder.entries()) {
+      labels.push(payload.label);
+    }
+    assert.deepEqual(labels, ["step-0", "step-1", "fresh"]);
+    const index = JSON.parse(await fs.readFile(path.join(recordsDir, "index.json"), "utf8"));
+    const legacyEntry = index.entries.find((entry) => entry.id === "ex-1");
+    assert.equal(legacyEntry.file, undefined);
+    assert.ok(legacyEntry.archive.startsWith("prompt-exchanges/archive/segment-"));
+  } finally {
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
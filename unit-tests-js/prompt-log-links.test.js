@@ -4,7 +4,9 @@ import fs from "node:fs/promises";
 import os from "node:os";
 import path from "node:path";
 import PromptStepJournal from "../src/libs/prompt-step-journal.js";
-import TaskExecutionRegister from "../src/libs/task-execution-register.js";
+import TaskExecutionRegister, {
+  readTaskExecutionEntries,
+} from "../src/libs/task-execution-register.js";
 import PromptRecorder from "../src/libs/prompt-recorder.js";
 import { normalizeLinksPayload } from "../src/libs/prompt-log-normalizer.js";
 
@@ -66,9 +68,12 @@ test("TaskExecutionRegister and PromptRecorder persist links with posix paths",
       links: { promptExchangeId: "abc", promptExchangePath },
     });
     const registerPath = path.join(miniPhiRoot, "executions", "exec-1", "task-execution.json");
-    const registerPayload = JSON.parse(await fs.readFile(registerPath, "utf8"));
+    const entries = [];
+    for await (const entry of readTaskExecutionEntries(registerPath)) {
+      entries.push(entry);
+    }
     assert.equal(
-      registerPayload.entries[0].links.promptExchangePath,
+      entries[0].links.promptExchangePath,
       "prompt-exchanges/abc.json",
     );
 
@@ -76,10 +81,12 @@ test("TaskExecutionRegister and PromptRecorder persist links with posix paths",
     const record = await recorder.record({
       request: { messages: [{ role: "user", content: "hi" }] },
     });
+    await recorder.flush();
     const indexPath = path.join(miniPhiRoot, "prompt-exchanges", "index.json");
     const index = JSON.parse(await fs.readFile(indexPath, "utf8"));
-    assert.ok(index.entries[0].file.endsWith(`${record.id}.json`));
-    assert.ok(!index.entries[0].file.includes("\\"), "index file path should use posix separators");
+    assert.equal(index.entries[0].id, record.id);
+    assert.ok(index.entries[0].archive.startsWith("prompt-exchanges/archive/"));
+    assert.ok(!index.entries[0].archive.includes("\\"), "index archive path should use posix separators");
   } finally {
     await fs.rm(root, { recursive: true, force: true });
   }
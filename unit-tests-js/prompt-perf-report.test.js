@@ -0,0 +1,97 @@
+import test from "node:test";
+import assert from "node:assert/strict";
+import fs from "node:fs/promises";
+import os from "node:os";
+import path from "node:path";
+import PromptPerformanceTracker from "../src/libs/prompt-performance-tracker.js";
+import { buildPerfReport, precedingWindow, refreshPerfRollups } from "../src/libs/prompt-perf-report.js";
+
+async function insertScore(db, { id, day, model, schema, ttftMs, durationMs, tokens }) {
+  await db.run(
+    `INSERT INTO prompt_sessions (session_id, created_at) VALUES (?, ?)
+     ON CONFLICT(session_id) DO NOTHING;`,
+    ["s1", `${day}T00:00:00.000Z`],
+  );
+  await db.run(
+    `INSERT INTO prompt_scores (session_id, scope, prompt_id, model_key, schema_id, duration_ms, ttft_ms, output_tokens, created_at)
+     VALUES ('s1', 'sub', ?, ?, ?, ?, ?, ?, ?);`,
+    [id, model, schema, durationMs, ttftMs, tokens, `${day}T12:00:00.000Z`],
+  );
+}
+
+async function insertEvent(db, { promptId, day, model, type }) {
+  await db.run(
+    `INSERT INTO prompt_events (session_id, prompt_id, event_type, severity, message, model_key, created_at)
+     VALUES ('s1', ?, ?, 'warn', 'x', ?, ?);`,
+    [promptId, type, model, `${day}T12:00:01.000Z`],
+  );
+}
+
+test("perf rollups report percentiles, throughput, retry cost and window regressions", async () => {
+  const root = await fs.mkdtemp(path.join(os.tmpdir(), "miniphi-perf-"));
+  const tracker = new PromptPerformanceTracker({ dbPath: path.join(root, "prompts.db") });
+  try {
+    await tracker.prepare();
+    const db = tracker.db;
+    // Baseline week: phi-4 answers in ~1s TTFT; current week: ~2s, one in five retried.
+    for (let index = 0; index < 20; index += 1) {
+      await insertScore(db, {
+        id: `b${index}`,
+        day: "2026-03-02",
+        model: "phi-4",
+        schema: "log-analysis",
+        ttftMs: 900 + index * 10,
+        durationMs: 5000,
+        tokens: 400,
+      });
+      const retried = index % 5 === 0;
+      await insertScore(db, {
+        id: `c${index}`,
+        day: index < 10 ? "2026-03-09" : "2026-03-10",
+        model: "phi-4",
+        schema: index % 2 ? "log-analysis" : "plan",
+        ttftMs: 1900 + index * 10,
+        durationMs: retried ? 15000 : 6000,
+        tokens: 400,
+      });
+      if (retried) {
+        await insertEvent(db, { promptId: `c${index}`, day: "2026-03-09", model: "phi-4", type: "stream-retry" });
+      }
+    }
+    await insertEvent(db, { promptId: "c1", day: "2026-03-09", model: "phi-4", type: "slow-start" });
+
+    const window = { since: "2026-03-09", until: "2026-03-15" };
+    assert.deepEqual(precedingWindow(window.since, window.until), { since: "2026-03-02", until: "2026-03-08" });
+    const report = await buildPerfReport(db, {
+      ...window,
+      groupBy: ["model"],
+      baseline: precedingWindow(window.since, window.until),
+    });
+    assert.equal(report.refresh.daysRefreshed, 3);
+    const [phi] = report.current.groups;
+    assert.equal(phi.group, "phi-4");
+    assert.equal(phi.prompts, 20);
+    assert.ok(Math.abs(phi.ttftP50Ms - 1990) / 1990 < 0.1, `ttft p50 ${phi.ttftP50Ms}`);
+    assert.ok(phi.tokensPerSecond > 0);
+    assert.equal(phi.slowStarts, 1);
+    assert.equal(phi.retries, 4);
+    assert.equal(phi.retryPrompts, 4);
+    assert.ok(Math.abs(phi.retryCostMs - 4 * 9000) < 1);
+    const ttftRegression = report.changes.find((change) => change.metric === "ttftP50Ms");
+    assert.equal(ttftRegression.regression, true);
+    assert.ok(ttftRegression.change > 0.9);
+
+    const bySchema = await buildPerfReport(db, { ...window, groupBy: ["schema"] });
+    assert.deepEqual(
+      bySchema.current.groups.map((entry) => [entry.group, entry.prompts]).sort(),
+      [["log-analysis", 10], ["plan", 10]],
+    );
+    assert.equal(bySchema.refresh.daysRefreshed, 0, "nothing new since the last refresh");
+
+    await insertScore(db, { id: "late", day: "2026-03-10", model: "qwen", schema: "plan", ttftMs: 300, durationMs: 900, tokens: 50 });
+    assert.equal((await refreshPerfRollups(db)).daysRefreshed, 1);
+  } finally {
+    await tracker.dispose();
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
@@ -0,0 +1,114 @@
+import test from "node:test";
+import assert from "node:assert/strict";
+import fs from "node:fs/promises";
+import os from "node:os";
+import path from "node:path";
+import PromptPerformanceTracker from "../src/libs/prompt-performance-tracker.js";
+
+test("PromptPerformanceTracker batches telemetry writes off the completion path", async () => {
+  const root = await fs.mkdtemp(path.join(os.tmpdir(), "miniphi-tracker-"));
+  const tracker = new PromptPerformanceTracker({
+    dbPath: path.join(root, "prompts.db"),
+    flushDelayMs: 10_000,
+    batchSize: 16,
+  });
+  try {
+    await tracker.prepare();
+    for (let index = 0; index < 40; index += 1) {
+      const summary = await tracker.track({
+        traceContext: {
+          scope: "sub",
+          label: index % 2 ? "summarize logs" : "plan fix",
+          mainPromptId: "session-1",
+          subPromptId: `prompt-${index}`,
+          metadata: { cwd: root },
+        },
+        request: { messages: [{ role: "user", content: `prompt ${index}` }] },
+        response: { text: "x".repeat(index * 20), startedAt: 0, finishedAt: 5 },
+      });
+      assert.ok(Number.isFinite(summary.score));
+    }
+    await tracker.recordEvent({
+      traceContext: { scope: "sub", mainPromptId: "session-1", subPromptId: "prompt-3" },
+      eventType: "slow-start",
+      message: "no tokens after 4s",
+    });
+    await tracker.flush();
+
+    const scores = await tracker.db.get("SELECT COUNT(*) AS total FROM prompt_scores;");
+    const events = await tracker.db.get("SELECT COUNT(*) AS total FROM prompt_events;");
+    const snapshots = await tracker.db.all(
+      "SELECT objective, snapshot_json FROM best_prompt_snapshots ORDER BY objective;",
+    );
+    assert.equal(scores.total, 40);
+    assert.equal(events.total, 1);
+    assert.deepEqual(
+      snapshots.map((row) => row.objective),
+      ["plan fix", "summarize logs"],
+    );
+    assert.equal(JSON.parse(snapshots[1].snapshot_json).bestPrompt.promptId, "prompt-39");
+
+    const latency = tracker.getLatencyStats();
+    assert.equal(latency.track.count, 40);
+    // Full batches commit on their own; flush() only drains the remainder.
+    assert.ok(latency.writes.batches >= 2 && latency.writes.batches <= 4);
+    assert.equal(latency.writes.failedBatches, 0);
+    assert.ok(latency.snapshot.count <= 6, "snapshots coalesce per batch");
+    assert.ok(latency.track.p50Ms < 1, `track p50 ${latency.track.p50Ms}ms`);
+  } finally {
+    await tracker.dispose();
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
+
+test("PromptPerformanceTracker retries a failed telemetry batch once before dropping it", async () => {
+  const root = await fs.mkdtemp(path.join(os.tmpdir(), "miniphi-tracker-retry-"));
+  const tracker = new PromptPerformanceTracker({
+    dbPath: path.join(root, "prompts.db"),
+    flushDelayMs: 10_000,
+  });
+  const warnings = [];
+  const onWarning = (warning) => warnings.push(warning.message);
+  process.on("warning", onWarning);
+  const track = (index) =>
+    tracker.track({
+      traceContext: { scope: "sub", label: "plan fix", mainPromptId: "session-1", subPromptId: `prompt-${index}` },
+      request: { messages: [{ role: "user", content: `prompt ${index}` }] },
+      response: { text: "ok", startedAt: 0, finishedAt: 5 },
+    });
+  try {
+    await tracker.prepare();
+    const run = tracker._run.bind(tracker);
+    let failures = 1;
+    tracker._run = (name, params) => {
+      if (name === "score" && failures > 0) {
+        failures -= 1;
+        return Promise.reject(new Error("database is locked"));
+      }
+      return run(name, params);
+    };
+    await track(0);
+    await tracker.flush();
+    assert.equal((await tracker.db.get("SELECT COUNT(*) AS total FROM prompt_scores;")).total, 0);
+    await track(1);
+    await tracker.flush();
+    assert.equal((await tracker.db.get("SELECT COUNT(*) AS total FROM prompt_scores;")).total, 2);
+
+    failures = 2;
+    await track(2);
+    await tracker.flush();
+    await tracker.flush();
+    assert.equal((await tracker.db.get("SELECT COUNT(*) AS total FROM prompt_scores;")).total, 2);
+    const { writes } = tracker.getLatencyStats();
+    assert.equal(writes.failedBatches, 3);
+    assert.equal(writes.retriedBatches, 2);
+    assert.equal(writes.droppedRows, 1);
+    await new Promise((resolve) => setImmediate(resolve));
+    assert.ok(warnings.some((message) => /retrying/.test(message)));
+    assert.ok(warnings.some((message) => /Dropped 1 prompt telemetry rows after a retry/.test(message)));
+  } finally {
+    process.off("warning", onWarning);
+    await tracker.dispose();
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
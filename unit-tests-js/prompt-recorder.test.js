@@ -25,7 +25,7 @@ test("PromptRecorder normalizes response_format and tool metadata", async () =>
       },
     });
 
-    const payload = JSON.parse(await fs.readFile(record.path, "utf8"));
+    const payload = await recorder.read(record.id);
     assert.ok(payload.request);
     assert.ok(payload.request.response_format);
     assert.equal(payload.request.responseFormat, undefined);
@@ -65,7 +65,7 @@ test("PromptRecorder normalizes legacy stop reason aliases", async () => {
         stop_reason_code: "fallback",
       },
     });
-    const payload = JSON.parse(await fs.readFile(record.path, "utf8"));
+    const payload = await recorder.read(record.id);
     assert.equal(payload.response.stop_reason, "analysis-error");
     assert.equal(payload.response.stop_reason_code, "analysis-error");
     assert.equal(payload.response.stop_reason_detail, "legacy fallback marker");
@@ -89,7 +89,7 @@ test("PromptRecorder retains tool metadata keys even when no tools are supplied"
         text: "{\"ok\":true}",
       },
     });
-    const payload = JSON.parse(await fs.readFile(record.path, "utf8"));
+    const payload = await recorder.read(record.id);
     assert.equal(
       Object.prototype.hasOwnProperty.call(payload.request, "tool_definitions"),
       true,
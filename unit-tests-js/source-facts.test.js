@@ -0,0 +1,246 @@
+import test from "node:test";
+import assert from "node:assert/strict";
+import fs from "node:fs/promises";
+import path from "node:path";
+import FileConnectionAnalyzer from "../src/libs/file-connection-analyzer.js";
+import {
+  extractCFactsLexical,
+  extractJsFactsLexical,
+  extractSourceFacts,
+  loadParser,
+  treeSitterInstalled,
+} from "../src/libs/source-facts.js";
+import SourceFactsIndex, { getSourceFactsIndex } from "../src/libs/source-facts-index.js";
+import { findSymbol } from "../src/libs/symbol-index.js";
+import WorkspaceIndex, { getWorkspaceIndex, resetWorkspaceIndexes } from "../src/libs/workspace-index.js";
+import { createTempWorkspace, removeTempWorkspace } from "./cli-test-utils.js";
+
+const SOURCE = `#include "shell.h"
+#include <readline/readline.h>
+/* a comment with { braces */
+static const char *names[] = { "a{", "b" };
+struct point { int x; };
+
+extern "C" {
+int
+execute_command (COMMAND *command)
+{
+  if (command == 0)
+    return (helper ("}", 1));
+  return execute_command_internal (command, 0);
+}
+}
+
+int
+old_style (a, b)
+     int a;
+     char *b;
+{
+#if !defined (TEST)
+  while (a--) {
+#endif
+    report (b);
+#if defined (TEST)
+    skipped ();
+#else
+  }
+#endif
+  return table->lookup (a) + sizeof (a);
+}
+`;
+
+test("the lexical scanner finds includes, ANSI and K&R definitions and their calls", () => {
+  const facts = extractCFactsLexical(SOURCE);
+  assert.deepEqual(facts.includes, [
+    { path: "shell.h", system: false, line: 1 },
+    { path: "readline/readline.h", system: true, line: 2 },
+  ]);
+  assert.deepEqual(
+    facts.functions.map(({ name, line, endLine, signature, calls }) => ({ name, line, endLine, signature, calls })),
+    [
+      {
+        name: "execute_command",
+        line: 8,
+        endLine: 14,
+        signature: "int execute_command (COMMAND *command)",
+        calls: ["helper", "execute_command_internal"],
+      },
+      {
+        name: "old_style",
+        line: 17,
+        endLine: 32,
+        signature: "int old_style (a, b) int a; char *b;",
+        calls: ["report"],
+      },
+    ],
+  );
+  const [first] = facts.functions;
+  assert.ok(SOURCE.slice(first.start, first.end).startsWith("int\nexecute_command"));
+  assert.ok(SOURCE.slice(first.start, first.end).endsWith("0);\n}"));
+});
+
+test(
+  "tree-sitter finds the same C includes, definitions and calls as the lexical scanner",
+  { skip: !treeSitterInstalled("c") && "tree-sitter-c is not installed" },
+  async () => {
+    const parser = await loadParser("c");
+    assert.ok(parser);
+    const { engine, facts } = extractSourceFacts(SOURCE, parser, "c");
+    assert.equal(engine, "tree-sitter");
+    const lexical = extractCFactsLexical(SOURCE);
+    assert.deepEqual(facts.includes, lexical.includes);
+    const summary = ({ name, line, endLine, calls }) => ({ name, line, endLine, calls });
+    const expected = new Map(lexical.functions.map((fn) => [fn.name, summary(fn)]));
+    assert.ok(facts.functions.some((fn) => fn.name === "execute_command"));
+    // The split braces under `#if` in old_style may leave the grammar with an
+    // error node; whatever it does recover has to agree with the scanner.
+    for (const fn of facts.functions) {
+      assert.deepEqual(summary(fn), expected.get(fn.name));
+    }
+  },
+);
+
+test("native sources feed include edges and call hotspots from a per-hash facts cache", async () => {
+  const root = await createTempWorkspace("miniphi-source-facts-");
+  try {
+    await fs.mkdir(path.join(root, ".miniphi"), { recursive: true });
+    await fs.mkdir(path.join(root, "lib", "readline"), { recursive: true });
+    await fs.mkdir(path.join(root, "builtins"), { recursive: true });
+    await fs.writeFile(path.join(root, "shell.h"), "extern int run (int);\n");
+    await fs.writeFile(path.join(root, "lib", "readline", "readline.h"), "char *readline (const char *);\n");
+    await fs.writeFile(path.join(root, "lib", "readline", "readline.c"), '#include "readline.h"\nchar *readline (const char *p) { return 0; }\n');
+    await fs.writeFile(
+      path.join(root, "shell.c"),
+      '#include "shell.h"\n#include <readline/readline.h>\nint run (int n) { return n; }\nint main (void) { readline ("$ "); return run (0); }\n',
+    );
+    for (let file = 0; file < 20; file += 1) {
+      await fs.writeFile(
+        path.join(root, "builtins", `b${file}.c`),
+        `#include "../shell.h"\nint builtin_${file} (void) { return run (${file}); }\n`,
+      );
+    }
+    const at = new Date(Date.now() - 60_000);
+    for (const relative of ["shell.c", "shell.h", "lib/readline/readline.c", "lib/readline/readline.h"]) {
+      await fs.utimes(path.join(root, relative), at, at);
+    }
+    for (let file = 0; file < 20; file += 1) {
+      await fs.utimes(path.join(root, "builtins", `b${file}.c`), at, at);
+    }
+    resetWorkspaceIndexes();
+
+    const analyzer = new FileConnectionAnalyzer();
+    await analyzer.prepare(root);
+    const result = analyzer.analyze(root);
+    assert.deepEqual(result.nodes["shell.c"].imports.sort(), ["lib/readline/readline.h", "shell.h"]);
+    assert.equal(result.nodes["shell.h"].importedBy.length, 21);
+    assert.equal(result.nodes["builtins/b3.c"].functions, 1);
+    assert.equal(result.functions, 23);
+    assert.deepEqual(result.hotspots.topCalledFunctions[0], { name: "run", path: "shell.c", callers: 21 });
+    assert.match(result.summary, /Most called functions:\n- run \(shell\.c\): called from 21 functions/);
+
+    const facts = getSourceFactsIndex(getWorkspaceIndex(root));
+    assert.equal(facts.stats.parsed, 24);
+    analyzer.analyze(root);
+    assert.equal(facts.stats.parsed, 24);
+
+    // A fresh process reloads the facts from disk. Touched files are re-read
+    // on the worker pool but not re-parsed, since their content hash is known.
+    await fs.copyFile(path.join(root, "shell.c"), path.join(root, "shell-copy.c"));
+    const touched = new Date(Date.now() - 30_000);
+    for (let file = 0; file < 20; file += 1) {
+      await fs.utimes(path.join(root, "builtins", `b${file}.c`), touched, touched);
+    }
+    const workspace = await new WorkspaceIndex(root, { indexFile: getWorkspaceIndex(root).indexFile }).ensureFresh();
+    const reloaded = new SourceFactsIndex(workspace);
+    const paths = [...workspace.files.keys()].filter((relative) => relative.endsWith(".c"));
+    const collected = await reloaded.collect(paths, { threads: 2 });
+    assert.equal(collected.size, 23);
+    assert.deepEqual([reloaded.stats.parsed, reloaded.stats.reused], [1, 20]);
+    assert.deepEqual(
+      collected.get("shell-copy.c").functions.map((fn) => fn.name),
+      ["run", "main"],
+    );
+  } finally {
+    resetWorkspaceIndexes();
+    await removeTempWorkspace(root);
+  }
+});
+
+const JS_SOURCE = `import path from "path";
+const pattern = /[{(]/g;
+const label = \`\${path.sep}{\${"}"}\`;
+
+export async function load(file = {}) {
+  const nested = () => {};
+  return { run() { return nested(); } };
+}
+
+export const double = (value) =>
+  [value, value].map((item) => item * 2);
+
+export default class Store extends Base {
+  #items = new Map();
+  static create = (options) => new Store(options);
+
+  get size() {
+    return this.#items.size / 2;
+  }
+
+  async *entries() {
+    yield* this.#items;
+  }
+}
+
+module.exports.legacy = function () {
+  return label;
+};
+`;
+
+test("the JavaScript scanner finds module-level functions, classes and methods", () => {
+  const facts = extractJsFactsLexical(JS_SOURCE);
+  assert.deepEqual(
+    facts.functions.map(({ name, kind, container, line, endLine }) => [container ? `${container}.${name}` : name, kind, line, endLine]),
+    [
+      ["load", "function", 5, 8],
+      ["double", "function", 10, 11],
+      ["Store", "class", 13, 24],
+      ["Store.create", "method", 15, 15],
+      ["Store.size", "method", 17, 19],
+      ["Store.entries", "method", 21, 23],
+      ["legacy", "function", 26, 28],
+    ],
+  );
+  const [load, double] = facts.functions;
+  assert.equal(load.signature, "export async function load(file = {})");
+  assert.ok(JS_SOURCE.slice(double.start, double.end).endsWith("item * 2);"));
+});
+
+test("symbol lookups parse only trigram candidates and reuse the persisted facts", async () => {
+  const root = await createTempWorkspace("miniphi-symbols-");
+  try {
+    await fs.mkdir(path.join(root, ".miniphi"), { recursive: true });
+    await fs.mkdir(path.join(root, "src"), { recursive: true });
+    for (let file = 0; file < 10; file += 1) {
+      await fs.writeFile(path.join(root, "src", `m${file}.js`), `export function helper${file}() {\n  return ${file};\n}\n`);
+    }
+    await fs.writeFile(path.join(root, "src", "shell.c"), "static int\nhelper7 (void)\n{\n  return 7;\n}\n");
+    resetWorkspaceIndexes();
+
+    const found = await findSymbol(root, "helper7");
+    assert.equal(found.scanned, 2);
+    assert.deepEqual(
+      found.definitions.map(({ path: relative, line, endLine, signature }) => [relative, line, endLine, signature]),
+      [
+        ["src/m7.js", 1, 3, "export function helper7()"],
+        ["src/shell.c", 1, 5, "static int helper7 (void)"],
+      ],
+    );
+    const facts = getSourceFactsIndex(getWorkspaceIndex(root));
+    assert.equal(facts.stats.parsed, 2);
+    await findSymbol(root, "helper7");
+    assert.equal(facts.stats.parsed, 2);
+  } finally {
+    resetWorkspaceIndexes();
+    await removeTempWorkspace(root);
+  }
+});
@@ -144,3 +144,33 @@ test("migrateStopReasonArtifacts reports malformed JSON paths and supports parse
     await fs.rm(root, { recursive: true, force: true });
   }
 });
+
+test("migrateStopReasonArtifacts streams NDJSON logs line by line", async () => {
+  const root = await fs.mkdtemp(path.join(os.tmpdir(), "miniphi-stop-migrator-ndjson-"));
+  try {
+    const logPath = path.join(root, "executions", "demo", "task-execution.ndjson");
+    await fs.mkdir(path.dirname(logPath), { recursive: true });
+    const lines = [
+      JSON.stringify({ sequence: 1, error: { stop_reason: "partial-fallback", stop_reason_code: "fallback", stop_reason_detail: "legacy fallback marker" } }),
+      JSON.stringify({ sequence: 2, error: null }),
+      '{"sequence":3,"err',
+    ];
+    await fs.writeFile(logPath, `${lines.join("\n")}\n`, "utf8");
+
+    const dryRun = await migrateStopReasonArtifacts({ baseDir: root, dryRun: true });
+    assert.deepEqual(dryRun.changedFiles, ["executions/demo/task-execution.ndjson"]);
+    assert.equal(await fs.readFile(logPath, "utf8"), `${lines.join("\n")}\n`);
+
+    const applied = await migrateStopReasonArtifacts({ baseDir: root });
+    assert.equal(applied.filesChanged, 1);
+    const migrated = (await fs.readFile(logPath, "utf8")).trimEnd().split("\n");
+    assert.equal(migrated.length, 3);
+    assert.equal(JSON.parse(migrated[0]).error.stop_reason, "analysis-error");
+    assert.equal(migrated[1], lines[1]);
+    assert.equal(migrated[2], lines[2]);
+    const entries = await fs.readdir(path.dirname(logPath));
+    assert.deepEqual(entries, ["task-execution.ndjson"]);
+  } finally {
+    await fs.rm(root, { recursive: true, force: true });
+  }
+});
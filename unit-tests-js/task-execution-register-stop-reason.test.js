@@ -3,7 +3,9 @@ import assert from "node:assert/strict";
 import fs from "node:fs/promises";
 import os from "node:os";
 import path from "node:path";
-import TaskExecutionRegister from "../src/libs/task-execution-register.js";
+import TaskExecutionRegister, {
+  readTaskExecutionEntries,
+} from "../src/libs/task-execution-register.js";
 
 test("TaskExecutionRegister normalizes legacy stop reasons in error payloads", async () => {
   const workspace = await fs.mkdtemp(path.join(os.tmpdir(), "miniphi-task-exec-"));
@@ -28,17 +30,20 @@ test("TaskExecutionRegister normalizes legacy stop reasons in error payloads", a
       type: "lmstudio.chat",
       error: "session-timeout: session deadline exceeded.",
     });
+    await register.flush();
 
-    const payload = JSON.parse(await fs.readFile(opened.path, "utf8"));
-    assert.equal(Array.isArray(payload.entries), true);
-    assert.equal(payload.entries.length, 2);
+    const entries = [];
+    for await (const entry of readTaskExecutionEntries(opened.path)) {
+      entries.push(entry);
+    }
+    assert.equal(entries.length, 2);
 
-    const first = payload.entries[0];
+    const first = entries[0];
     assert.equal(first.error.stop_reason, "analysis-error");
     assert.equal(first.error.stop_reason_code, "analysis-error");
     assert.equal(first.error.stop_reason_detail, "legacy fallback marker");
 
-    const second = payload.entries[1];
+    const second = entries[1];
     assert.equal(second.error.stop_reason, "session-timeout");
     assert.equal(second.error.stop_reason_code, "session-timeout");
     assert.equal(
@@ -49,3 +54,80 @@ test("TaskExecutionRegister normalizes legacy stop reasons in error payloads", a
     await fs.rm(workspace, { recursive: true, force: true });
   }
 });
+
+test("TaskExecutionRegister appends entries to NDJSON and keeps the header small", async () => {
+  const workspace = await fs.mkdtemp(path.join(os.tmpdir(), "miniphi-task-exec-"));
+  try {
+    const register = new TaskExecutionRegister(workspace, { headerDelayMs: 0 });
+    const opened = await register.openSession("exec-log", { mode: "run" });
+    await Promise.all(
+      Array.from({ length: 20 }, (_, index) =>
+        register.record({ type: "lmstudio.chat", request: { prompt: `p${index}` } }),
+      ),
+    );
+    // The header rewrite is pending but must not keep the process alive.
+    assert.equal(register._headerTimer.hasRef(), false);
+    await register.flush();
+
+    const lines = (await fs.readFile(opened.entriesPath, "utf8")).trim().split("\n");
+    assert.equal(lines.length, 20);
+    assert.deepEqual(
+      lines.map((line) => JSON.parse(line).sequence),
+      Array.from({ length: 20 }, (_, index) => index + 1),
+    );
+    const header = JSON.parse(await fs.readFile(opened.path, "utf8"));
+    assert.equal(header.entries, undefined);
+    assert.equal(header.entryCount, 20);
+    assert.equal(header.lastEntry.sequence, 20);
+
+    // A crash mid-append leaves a torn line; reopening seals it and continues the sequence.
+    await fs.appendFile(opened.entriesPath, '{"id":"torn","seq', "utf8");
+    const reopened = new TaskExecutionRegister(workspace, { headerDelayMs: 0 });
+    await reopened.openSession("exec-log");
+    const next = await reopened.record({ type: "command" });
+    assert.equal(next.sequence, 21);
+    await reopened.flush();
+    const sequences = [];
+    for await (const entry of readTaskExecutionEntries(opened.path)) {
+      sequences.push(entry.sequence);
+    }
+    assert.equal(sequences.length, 21);
+    assert.equal(sequences.at(-1), 21);
+  } finally {
+    await fs.rm(workspace, { recursive: true, force: true });
+  }
+});
+
+test("TaskExecutionRegister moves a v1 register's inlined entries into the log once", async () => {
+  const workspace = await fs.mkdtemp(path.join(os.tmpdir(), "miniphi-task-exec-"));
+  try {
+    const dir = path.join(workspace, "executions", "legacy");
+    await fs.mkdir(dir, { recursive: true });
+    await fs.writeFile(
+      path.join(dir, "task-execution.json"),
+      JSON.stringify({
+        schemaVersion: "task-execution-register@v1",
+        id: "legacy",
+        metadata: { mode: "run" },
+        entryCount: 2,
+        entries: [
+          { id: "a", sequence: 1, type: "lmstudio" },
+          { id: "b", sequence: 2, type: "lmstudio" },
+        ],
+      }),
+      "utf8",
+    );
+    for (let round = 0; round < 2; round += 1) {
+      const register = new TaskExecutionRegister(workspace, { headerDelayMs: 0 });
+      await register.openSession("legacy");
+      await register.flush();
+    }
+    const ids = [];
+    for await (const entry of readTaskExecutionEntries(dir)) {
+      ids.push(entry.id);
+    }
+    assert.deepEqual(ids, ["a", "b"]);
+  } finally {
+    await fs.rm(workspace, { recursive: true, force: true });
+  }
+});
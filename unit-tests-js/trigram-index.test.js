@@ -0,0 +1,96 @@
+import test from "node:test";
+import assert from "node:assert/strict";
+import fs from "node:fs/promises";
+import path from "node:path";
+import TrigramIndex, { buildTrigramQuery, extractTrigrams } from "../src/libs/trigram-index.js";
+import WorkspaceIndex, { resetWorkspaceIndexes } from "../src/libs/workspace-index.js";
+import { executeReadonlyAction } from "../src/libs/plan-executor.js";
+import { ageTree, createTempWorkspace, removeTempWorkspace } from "./cli-test-utils.js";
+
+const gramsOf = (text) => [...extractTrigrams(Buffer.from(text))];
+const sortedQuery = (...args) => buildTrigramQuery(...args)?.map((grams) => [...grams].sort((a, b) => a - b));
+
+test("regex queries keep only the literal runs every match needs", () => {
+  assert.deepEqual(sortedQuery("Parse", {}), [gramsOf("parse")]);
+  assert.deepEqual(sortedQuery("exec_\\w+_internal", { regex: true }), [
+    [...new Set([...gramsOf("exec_"), ...gramsOf("_internal")])].sort((a, b) => a - b),
+  ]);
+  // The optional "s" and the group do not constrain the match.
+  assert.deepEqual(sortedQuery("builtins?(_x)?\\.c", { regex: true }), [gramsOf("builtin")]);
+  assert.equal(buildTrigramQuery("foo|a.b", { regex: true }), null);
+  assert.equal(buildTrigramQuery("\\x41\\x42\\x43", { regex: true }), null);
+  assert.equal(buildTrigramQuery("ab", {}), null);
+});
+
+test("search narrows candidates, supports regex and case folding, and updates incrementally", async () => {
+  const root = await createTempWorkspace("miniphi-trigram-");
+  try {
+    await fs.mkdir(path.join(root, "src"), { recursive: true });
+    await fs.mkdir(path.join(root, "coverage"), { recursive: true });
+    for (let file = 0; file < 30; file += 1) {
+      await fs.writeFile(path.join(root, "src", `mod${file}.c`), `int helper_${file}(void) { return ${file}; }\n`);
+    }
+    await fs.writeFile(path.join(root, "src", "exec.c"), "static int\nexecute_command_internal (COMMAND *c)\n{\n}\n");
+    await fs.writeFile(path.join(root, "coverage", "exec.c"), "execute_command_internal\n");
+    await fs.writeFile(path.join(root, "src", "blob.bin"), Buffer.from([0, 1, 2, 101, 120, 101, 99]));
+    // Out of the racy window, so unchanged files are not re-read on each sync.
+    await ageTree(root, 60_000);
+    resetWorkspaceIndexes();
+
+    const index = new TrigramIndex(new WorkspaceIndex(root, { indexFile: null, maxAgeMs: 0 }));
+    const skipDir = (name) => name === "coverage";
+    const plain = await index.search("execute_command_internal", { skipDir });
+    assert.deepEqual(plain.matches, [{ path: "src/exec.c", line: 2, text: "execute_command_internal (COMMAND *c)" }]);
+    assert.equal(plain.candidates, 1);
+    assert.ok(plain.narrowed);
+
+    const folded = await index.search("EXECUTE_COMMAND", { ignoreCase: true, skipDir });
+    assert.equal(folded.matches.length, 1);
+    assert.equal((await index.search("EXECUTE_COMMAND", { skipDir })).matches.length, 0);
+
+    const regex = await index.search("helper_1\\d\\(", { regex: true, maxMatches: 3 });
+    assert.deepEqual(regex.matches.map((match) => match.path), ["src/mod10.c", "src/mod11.c", "src/mod12.c"]);
+    assert.ok(regex.truncated);
+    await assert.rejects(index.search("(", { regex: true }), SyntaxError);
+
+    const extracted = index.stats.extracted;
+    await fs.writeFile(path.join(root, "src", "mod3.c"), "int execute_command_internal;\n");
+    await fs.rm(path.join(root, "src", "exec.c"));
+    const updated = await index.search("execute_command_internal", { skipDir });
+    assert.deepEqual(updated.matches.map((match) => match.path), ["src/mod3.c"]);
+    assert.equal(index.stats.extracted, extracted + 1);
+
+    const output = await executeReadonlyAction(
+      { type: "search_text", term: "HELPER_2[0-9]", regex: true, ignoreCase: true },
+      root,
+    );
+    assert.match(output, /^src\/mod20\.c:1: int helper_20/);
+    assert.match(
+      await executeReadonlyAction({ type: "search_text", term: "[", regex: true }, root),
+      /^invalid search pattern/,
+    );
+  } finally {
+    resetWorkspaceIndexes();
+    await removeTempWorkspace(root);
+  }
+});
+
+test("trigram sets persist next to the workspace index", async () => {
+  const root = await createTempWorkspace("miniphi-trigram-persist-");
+  try {
+    await fs.writeFile(path.join(root, "a.txt"), "alpha beta gamma\n");
+    await fs.writeFile(path.join(root, "b.txt"), "delta epsilon\n");
+    await ageTree(root, 60_000);
+    const indexFile = path.join(root, ".miniphi", "index", "tree.json");
+    const first = new TrigramIndex(new WorkspaceIndex(root, { indexFile }));
+    assert.equal((await first.search("gamma")).matches.length, 1);
+    assert.ok(await fs.stat(path.join(root, ".miniphi", "index", "tree.trigrams")));
+
+    const second = new TrigramIndex(new WorkspaceIndex(root, { indexFile }));
+    const found = await second.search("epsilon");
+    assert.deepEqual(found.matches.map((match) => match.path), ["b.txt"]);
+    assert.equal(second.stats.extracted, 0);
+  } finally {
+    await removeTempWorkspace(root);
+  }
+});
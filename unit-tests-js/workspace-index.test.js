@@ -0,0 +1,288 @@
+import test from "node:test";
+import assert from "node:assert/strict";
+import fs from "node:fs/promises";
+import path from "node:path";
+import WorkspaceIndex, {
+  getWorkspaceIndex,
+  invalidateWorkspaceIndexes,
+  resetWorkspaceIndexes,
+} from "../src/libs/workspace-index.js";
+import { scanWorkspace, scanWorkspaceSync } from "../src/libs/workspace-scanner.js";
+import { scanWorkspaceFiles, streamWorkspaceFiles } from "../src/ui/file-scan.js";
+import { ageTree, createTempWorkspace, removeTempWorkspace } from "./cli-test-utils.js";
+
+async function seedWorkspace(root) {
+  const files = {
+    "README.md": "# demo\n",
+    "src/app.js": "export const app = 1;\n",
+    "src/lib/util.js": "export const util = 2;\n",
+    "coverage/report.txt": "covered\n",
+    "node_modules/dep/index.js": "module.exports = 1;\n",
+    ".git/HEAD": "ref: refs/heads/main\n",
+  };
+  for (const [relative, content] of Object.entries(files)) {
+    await fs.mkdir(path.dirname(path.join(root, relative)), { recursive: true });
+    await fs.writeFile(path.join(root, relative), content, "utf8");
+  }
+}
+
+test("WorkspaceIndex persists under .miniphi/index and refreshes by mtime", async () => {
+  const root = await createTempWorkspace("miniphi-workspace-index-");
+  try {
+    await seedWorkspace(root);
+    await fs.mkdir(path.join(root, ".miniphi"), { recursive: true });
+    await ageTree(path.join(root, "src"), 60_000);
+    resetWorkspaceIndexes();
+
+    const index = getWorkspaceIndex(root);
+    await index.refresh();
+    assert.ok(index.indexFile.startsWith(path.join(root, ".miniphi", "index")));
+    assert.deepEqual(
+      [...index.walkFiles()].map((entry) => entry.path),
+      ["README.md", "coverage/report.txt", "src/app.js", "src/lib/util.js"],
+    );
+    assert.equal(index.stat("src/app.js").language, "javascript");
+    const hash = await index.hashFor("src/app.js");
+    assert.match(hash, /^[0-9a-f]{64}$/);
+    await index._save();
+
+    // A new process: the aged directories are not listed again.
+    const reopened = new WorkspaceIndex(root, { indexFile: index.indexFile });
+    await reopened.refresh();
+    assert.equal(reopened.stats.reused, 2);
+    assert.equal(await reopened.hashFor("src/app.js"), hash);
+    assert.equal(reopened.stats.hashed, 0);
+
+    await fs.rm(path.join(root, "src", "lib"), { recursive: true });
+    await fs.writeFile(path.join(root, "src", "app.js"), "export const app = 'changed';\n", "utf8");
+    reopened.refreshSync();
+    assert.equal(reopened.stat("src/lib/util.js"), null);
+    assert.equal(reopened.stat("src/app.js").hash, null);
+    assert.ok(reopened.files.size === 3);
+  } finally {
+    resetWorkspaceIndexes();
+    await removeTempWorkspace(root);
+  }
+});
+
+test("walkers share one index and keep their own skip rules", async () => {
+  const root = await createTempWorkspace("miniphi-workspace-walkers-");
+  try {
+    await seedWorkspace(root);
+    resetWorkspaceIndexes();
+
+    const scan = await scanWorkspace(root);
+    assert.deepEqual(scan.files, ["README.md", "coverage/report.txt", "src/app.js", "src/lib/util.js"]);
+    assert.deepEqual(
+      scan.entries.filter((entry) => entry.type === "dir").map((entry) => [entry.path, entry.ignored]),
+      [
+        [".git", true],
+        ["coverage", false],
+        ["node_modules", true],
+        ["src", false],
+        ["src/lib", false],
+      ],
+    );
+    const shared = getWorkspaceIndex(root);
+    assert.equal(shared.stats.refreshes, 1);
+
+    // The picker skips coverage/ on top of the index rules, without another walk.
+    assert.deepEqual(await scanWorkspaceFiles(root), ["README.md", "src/app.js", "src/lib/util.js"]);
+    assert.equal(shared.stats.refreshes, 1);
+
+    // A caller that wants node_modules gets a private walk with its rules.
+    const wide = scanWorkspaceSync(root, { ignoredDirs: [".git"] });
+    assert.ok(wide.files.includes("node_modules/dep/index.js"));
+    assert.equal(shared.stats.refreshes, 1);
+
+    await fs.writeFile(path.join(root, "src", "new.js"), "export {};\n", "utf8");
+    invalidateWorkspaceIndexes(path.join(root, "src", "new.js"));
+    assert.ok((await scanWorkspace(root)).files.includes("src/new.js"));
+    assert.equal(shared.stats.refreshes, 2);
+  } finally {
+    resetWorkspaceIndexes();
+    await removeTempWorkspace(root);
+  }
+});
+
+test("async refresh matches the sync walk and round-trips through the index file", async () => {
+  const root = await createTempWorkspace("miniphi-workspace-async-");
+  try {
+    for (let dir = 0; dir < 6; dir += 1) {
+      for (let file = 0; file < 70; file += 1) {
+        const relative = path.join(`pkg-${dir}`, `sub-${file % 3}`, `f${file}.c`);
+        await fs.mkdir(path.dirname(path.join(root, relative)), { recursive: true });
+        await fs.writeFile(path.join(root, relative), `int f${file};\n`, "utf8");
+      }
+    }
+    const indexFile = path.join(root, "index.ndjson");
+    const walkOf = (index) => [...index.walk()].map((entry) => `${entry.type}:${entry.path}:${entry.size ?? ""}`);
+
+    const sync = new WorkspaceIndex(root, { indexFile: null }).refreshSync();
+    const async = await new WorkspaceIndex(root, { indexFile, concurrency: 3 }).refresh();
+    assert.equal(async.files.size, 6 * 70);
+    assert.deepEqual(walkOf(async), walkOf(sync));
+
+    const reopened = new WorkspaceIndex(root, { indexFile });
+    await reopened._loadAsync();
+    assert.deepEqual(walkOf(reopened), walkOf(sync));
+  } finally {
+    await removeTempWorkspace(root);
+  }
+});
+
+test("capped sync scans walk the disk until the index is fresh", async () => {
+  const root = await createTempWorkspace("miniphi-workspace-capped-");
+  try {
+    await seedWorkspace(root);
+    await fs.writeFile(path.join(root, ".gitignore"), "*.log\ncoverage/\n", "utf8");
+    await fs.writeFile(path.join(root, "src", "debug.log"), "noise\n", "utf8");
+    resetWorkspaceIndexes();
+    const shared = getWorkspaceIndex(root);
+    const entriesOf = (entries) => entries.map((entry) => `${entry.type}:${entry.path}:${entry.ignored ?? entry.size}`);
+
+    const cold = scanWorkspaceSync(root, { maxEntries: 3 });
+    assert.equal(cold.truncated, true);
+    assert.equal(cold.files.length, 3);
+    assert.equal(shared.stats.refreshes, 0);
+
+    scanWorkspaceSync(root);
+    assert.equal(shared.stats.refreshes, 1);
+    const warm = scanWorkspaceSync(root, { maxEntries: 3 });
+    assert.deepEqual(entriesOf(warm.entries), entriesOf(cold.entries));
+    assert.deepEqual(entriesOf([...shared.walkDisk()]), entriesOf([...shared.walk()]));
+    assert.ok(!shared.files.has("src/debug.log"));
+
+    // A sync caller does not start a second refresh alongside a running one.
+    const other = new WorkspaceIndex(root, { indexFile: null });
+    const pending = other.ensureFresh();
+    assert.equal(other.ensureFreshSync(), other);
+    assert.equal(other.stats.refreshes, 0);
+    await pending;
+    assert.equal(other.stats.refreshes, 1);
+  } finally {
+    resetWorkspaceIndexes();
+    await removeTempWorkspace(root);
+  }
+});
+
+test("nested .gitignore and .miniphiignore rules prune the walk", async () => {
+  const root = await createTempWorkspace("miniphi-workspace-ignore-");
+  try {
+    const files = {
+      ".gitignore": "# generated output\n*.log\n/generated/\nvendor/\n!keep.log\n",
+      ".miniphiignore": "third_party/sdk/\n",
+      "app.log": "x\n",
+      "keep.log": "x\n",
+      "src/main.c": "int main;\n",
+      "src/generated/ok.c": "int ok;\n",
+      "src/.gitignore": "*.tmp\n!important.tmp\n**/fixtures/**/*.bin\n",
+      "src/scratch.tmp": "x\n",
+      "src/important.tmp": "x\n",
+      "src/test/fixtures/deep/blob.bin": "x\n",
+      "src/test/fixtures/deep/blob.txt": "x\n",
+      "generated/out.c": "int out;\n",
+      "vendor/lib.c": "int lib;\n",
+      "lib/vendor/lib.c": "int lib;\n",
+      "third_party/sdk/api.h": "int api;\n",
+      "third_party/other.h": "int other;\n",
+    };
+    for (const [relative, content] of Object.entries(files)) {
+      await fs.mkdir(path.dirname(path.join(root, relative)), { recursive: true });
+      await fs.writeFile(path.join(root, relative), content, "utf8");
+    }
+    const expected = [
+      ".gitignore",
+      ".miniphiignore",
+      "keep.log",
+      "src/.gitignore",
+      "src/important.tmp",
+      "src/main.c",
+      "third_party/other.h",
+      "src/generated/ok.c",
+      "src/test/fixtures/deep/blob.txt",
+    ];
+    for (const refresh of ["refreshSync", "refresh"]) {
+      const index = new WorkspaceIndex(root, { indexFile: null });
+      await index[refresh]();
+      const walked = [...index.walkFiles()].map((entry) => entry.path);
+      assert.deepEqual(walked, expected, refresh);
+      // Ignored directories are reported but never listed.
+      assert.equal(index.dirs.has("generated"), false);
+      assert.equal(index.dirs.has("third_party/sdk"), false);
+      assert.deepEqual(
+        [...index.walk()].filter((entry) => entry.type === "dir" && entry.ignored).map((entry) => entry.path),
+        ["generated", "vendor", "lib/vendor", "third_party/sdk"],
+      );
+    }
+  } finally {
+    await removeTempWorkspace(root);
+  }
+});
+
+test("applyChanges re-lists only the reported paths and reports what changed", async () => {
+  const root = await createTempWorkspace("miniphi-workspace-apply-");
+  try {
+    await seedWorkspace(root);
+    await fs.writeFile(path.join(root, ".gitignore"), "*.log\n", "utf8");
+    const index = new WorkspaceIndex(root, { indexFile: null });
+    await index.refresh();
+    const before = index.refreshedAt;
+
+    await fs.writeFile(path.join(root, "src", "app.js"), "export const app = 'longer now';\n", "utf8");
+    await fs.rm(path.join(root, "src", "lib"), { recursive: true });
+    await fs.mkdir(path.join(root, "src", "feature", "deep"), { recursive: true });
+    await fs.writeFile(path.join(root, "src", "feature", "deep", "x.js"), "x\n", "utf8");
+    await fs.writeFile(path.join(root, "src", "debug.log"), "x\n", "utf8");
+    // Unreported changes are not picked up: only the reported paths are looked at.
+    await fs.writeFile(path.join(root, "coverage", "extra.txt"), "x\n", "utf8");
+
+    const changes = await index.applyChanges(["src/app.js", "src/lib", "src/feature", "src/debug.log"]);
+    assert.deepEqual(changes, { changed: ["src/app.js", "src/feature/deep/x.js"], removed: ["src/lib/util.js"] });
+    assert.ok(index.refreshedAt > before);
+    assert.equal(index.stat("src/debug.log"), null);
+    assert.equal(index.stat("coverage/extra.txt"), null);
+    assert.ok(index.dirs.has("src/feature/deep"));
+    assert.equal(index.dirs.has("src/lib"), false);
+
+    // A changed ignore file can re-include anything, so it falls back to a full refresh.
+    await fs.writeFile(path.join(root, ".gitignore"), "", "utf8");
+    const full = await index.applyChanges([".gitignore"]);
+    assert.deepEqual(full.changed, [".gitignore", "coverage/extra.txt", "src/debug.log"]);
+    assert.deepEqual(full.removed, []);
+    const walked = new WorkspaceIndex(root, { indexFile: null });
+    await walked.refresh();
+    assert.deepEqual(
+      [...index.walkFiles()].map((entry) => entry.path),
+      [...walked.walkFiles()].map((entry) => entry.path),
+    );
+  } finally {
+    await removeTempWorkspace(root);
+  }
+});
+
+test("streamWorkspaceFiles reports files while a cold walk finds them", async () => {
+  const root = await createTempWorkspace("miniphi-workspace-stream-");
+  try {
+    await seedWorkspace(root);
+    for (let index = 0; index < 300; index += 1) {
+      await fs.writeFile(path.join(root, "src", `gen-${String(index).padStart(3, "0")}.js`), "x\n", "utf8");
+    }
+    resetWorkspaceIndexes();
+    const batches = [];
+    const files = await streamWorkspaceFiles(root, { onFiles: (batch) => batches.push(batch) });
+    assert.equal(files.length, 303);
+    assert.deepEqual(files, [...files].sort());
+    assert.ok(batches.length > 1, "a cold walk reports more than one batch");
+    // Streamed batches are the same files, with the picker's skipped directories left out.
+    assert.deepEqual(batches.flat().sort(), files);
+
+    // A fresh index is not walked again: nothing streams, the result comes at once.
+    const again = [];
+    assert.deepEqual(await streamWorkspaceFiles(root, { onFiles: (batch) => again.push(batch) }), files);
+    assert.deepEqual(again, []);
+  } finally {
+    resetWorkspaceIndexes();
+    await removeTempWorkspace(root);
+  }
+});
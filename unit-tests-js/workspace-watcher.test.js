@@ -0,0 +1,70 @@
+import test from "node:test";
+import assert from "node:assert/strict";
+import fs from "node:fs/promises";
+import path from "node:path";
+import { getWorkspaceIndex, resetWorkspaceIndexes } from "../src/libs/workspace-index.js";
+import { getSourceFactsIndex } from "../src/libs/source-facts-index.js";
+import WorkspaceWatcher, { resolveWorkspaceWatchEnabled } from "../src/libs/workspace-watcher.js";
+import { createTempWorkspace, removeTempWorkspace } from "./cli-test-utils.js";
+
+const settle = () => new Promise((resolve) => setTimeout(resolve, 50));
+
+for (const recursive of [false, true]) {
+  test(`WorkspaceWatcher keeps the shared index live (${recursive ? "recursive" : "per-directory"} watch)`, async (t) => {
+    if (recursive && process.platform === "linux" && Number(process.versions.node.split(".")[0]) < 20) {
+      t.skip("recursive fs.watch needs Node 20 on Linux");
+      return;
+    }
+    const root = await createTempWorkspace("miniphi-workspace-watch-");
+    resetWorkspaceIndexes();
+    const watcher = new WorkspaceWatcher(root, { debounceMs: 10, recursive });
+    try {
+      await fs.mkdir(path.join(root, "src"), { recursive: true });
+      await fs.writeFile(path.join(root, "src", "a.js"), "function a() {}\n", "utf8");
+      await watcher.start();
+      const index = getWorkspaceIndex(root);
+      assert.equal(index.live, watcher);
+      const events = [];
+      watcher.on("change", (change) => events.push(change));
+
+      await fs.writeFile(path.join(root, "src", "a.js"), "function renamed() { return 1; }\n", "utf8");
+      await fs.mkdir(path.join(root, "src", "nested"));
+      await fs.writeFile(path.join(root, "src", "nested", "b.js"), "function b() {}\n", "utf8");
+      await fs.mkdir(path.join(root, "node_modules", "dep"), { recursive: true });
+      await fs.writeFile(path.join(root, "node_modules", "dep", "index.js"), "x\n", "utf8");
+      await settle();
+      await watcher.flush();
+      assert.deepEqual([...index.walkFiles()].map((entry) => entry.path), ["src/a.js", "src/nested/b.js"]);
+      const changed = new Set(events.flatMap((change) => change.changed));
+      assert.ok(changed.has("src/a.js") && changed.has("src/nested/b.js"));
+      assert.ok(!changed.has("node_modules/dep/index.js"));
+      // Changed sources are re-parsed before listeners hear about them.
+      const facts = await getSourceFactsIndex(index).collect(["src/a.js"]);
+      assert.deepEqual(facts.get("src/a.js").functions.map((fn) => fn.name), ["renamed"]);
+
+      // Files in a directory created after start are seen too.
+      await fs.writeFile(path.join(root, "src", "nested", "c.js"), "x\n", "utf8");
+      await fs.rm(path.join(root, "src", "a.js"));
+      await settle();
+      await index.ensureFresh();
+      assert.deepEqual([...index.walkFiles()].map((entry) => entry.path), ["src/nested/b.js", "src/nested/c.js"]);
+      await watcher.flush();
+      assert.ok(events.some((change) => change.removed.includes("src/a.js")));
+
+      watcher.stop();
+      assert.equal(index.live, null);
+      assert.equal(watcher.watches.size, 0);
+    } finally {
+      watcher.stop();
+      resetWorkspaceIndexes();
+      await removeTempWorkspace(root);
+    }
+  });
+}
+
+test("resolveWorkspaceWatchEnabled prefers the environment over config", () => {
+  assert.equal(resolveWorkspaceWatchEnabled(null, {}), false);
+  assert.equal(resolveWorkspaceWatchEnabled({ workspace: { watch: true } }, {}), true);
+  assert.equal(resolveWorkspaceWatchEnabled({ workspace: { watch: true } }, { MINIPHI_WATCH_WORKSPACE: "0" }), false);
+  assert.equal(resolveWorkspaceWatchEnabled(null, { MINIPHI_WATCH_WORKSPACE: "on" }), true);
+});